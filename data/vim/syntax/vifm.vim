@@ -141,35 +141,36 @@ syntax match vifmHiGroups contained
 		\ "column:\(ext\|name\|size\|atime\|ctime\|mtime\|iname\|dir\|type\|fileext\|nitems\|groups\|target\|root\|fileroot\|gid\|gname\|mode\|uid\|uname\|perms\|nlinks\|inode\)"
 
 " Options
-syntax keyword vifmOption contained aproposprg autocd autochpos caseoptions
-		\ cdpath cd chaselinks classify columns co confirm cf cpoptions cpo
-		\ cvoptions deleteprg dotdirs dotfiles dirsize fastrun fillchars fcs findprg
-		\ followlinks fusehome gdefault grepprg histcursor history hi hloptions
-		\ hlsearch hls iec ignorecase ic iooptions incsearch is laststatus lines
-		\ locateprg ls lsoptions lsview mediaprg milleroptions millerview
-		\ mintimeoutlen mouse navoptions number nu numberwidth nuw previewoptions
-		\ previewprg quickview relativenumber rnu rulerformat ruf runexec scrollbind
-		\ scb scrolloff sessionoptions ssop so sort sortgroups sortorder sortnumbers
-		\ shell sh shellflagcmd shcf shortmess shm showtabline stal sizefmt slowfs
-		\ smartcase scs statusline stl suggestoptions syncregs syscalls tablabel
-		\ tabline tabprefix tabscope tabstop tabsuffix tal timefmt timeoutlen title
-		\ tm trash trashdir ts tuioptions to undolevels ul vicmd viewcolumns
-		\ vifminfo vimhelp vixcmd wildmenu wmnu wildstyle wordchars wrap wrapscan ws
+syntax keyword vifmOption contained aproposprg autocd autochpos bgthreads
+		\ caseoptions cdpath cd chaselinks classify columns co confirm cf cpoptions
+		\ cpo cvoptions deleteprg dotdirs dotfiles dirsize diskusage fastrun
+		\ fillchars fcs findprg followlinks fusehome gdefault grepprg histcursor
+		\ history hi hloptions hlsearch hls iec ignorecase ic iooptions incsearch is
+		\ laststatus lines locateprg ls lsoptions lsview mediaprg milleroptions
+		\ millerview mintimeoutlen mouse navoptions number nu numberwidth nuw
+		\ previewoptions previewprg quickview relativenumber rnu rulerformat ruf
+		\ runexec scrollbind scb scrolloff sessionoptions ssop so sort sortgroups
+		\ sortorder sortnumbers shell sh shellflagcmd shcf shortmess shm showtabline
+		\ stal sizefmt slowfs smartcase scs statusline stl suggestoptions syncregs
+		\ syscalls tablabel tabline tabprefix tabscope tabstop tabsuffix tal timefmt
+		\ timeoutlen title tm trash trashdir ts tuioptions to undolevels ul vicmd
+		\ viewcolumns vifminfo vimhelp vixcmd wildmenu wmnu wildstyle wordchars wrap
+		\ wrapscan ws
 
 " Disabled boolean options
 syntax keyword vifmOption contained noautocd noautochpos nocf nochaselinks
-		\ nodotfiles nofastrun nofollowlinks nohlsearch nohls noiec noignorecase
-		\ noic noincsearch nois nolaststatus nols nolsview nomillerview nonumber
-		\ nonu noquickview norelativenumber nornu noscrollbind noscb norunexec
-		\ nosmartcase noscs nosortnumbers nosyscalls notitle notrash novimhelp
-		\ nowildmenu nowmnu nowrap nowrapscan nows
+		\ nodiskusage nodotfiles nofastrun nofollowlinks nohlsearch nohls noiec
+		\ noignorecase noic noincsearch nois nolaststatus nols nolsview nomillerview
+		\ nonumber nonu noquickview norelativenumber nornu noscrollbind noscb
+		\ norunexec nosmartcase noscs nosortnumbers nosyscalls notitle notrash
+		\ novimhelp nowildmenu nowmnu nowrap nowrapscan nows
 
 " Inverted boolean options
 syntax keyword vifmOption contained invautocd invautochpos invcf invchaselinks
-		\ invdotfiles invfastrun invfollowlinks invhlsearch invhls inviec
-		\ invignorecase invic invincsearch invis invlaststatus invls invlsview
-		\ invmillerview invnumber invnu invquickview invrelativenumber invrnu
-		\ invscrollbind invscb invrunexec invsmartcase invscs invsortnumbers
+		\ invdiskusage invdotfiles invfastrun invfollowlinks invhlsearch invhls
+		\ inviec invignorecase invic invincsearch invis invlaststatus invls
+		\ invlsview invmillerview invnumber invnu invquickview invrelativenumber
+		\ invrnu invscrollbind invscb invrunexec invsmartcase invscs invsortnumbers
 		\ invsyscalls invtitle invtrash invvimhelp invwildmenu invwmnu invwrap
 		\ invwrapscan invws
 
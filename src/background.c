@@ -25,8 +25,9 @@
 
 #include <fcntl.h> /* open() */
 #include <sys/stat.h> /* O_RDONLY */
-#include <sys/types.h> /* pid_t ssize_t */
+#include <sys/types.h> /* dev_t pid_t ssize_t */
 #ifndef _WIN32
+#include <sys/resource.h> /* PRIO_PROCESS setpriority() */
 #include <sys/wait.h> /* waitpid() */
 #endif
 #include <signal.h> /* SIG* kill() */
@@ -36,11 +37,12 @@
 #include <errno.h> /* errno */
 #include <stddef.h> /* NULL wchar_t */
 #include <stdint.h> /* uintptr_t */
-#include <stdlib.h> /* EXIT_FAILURE _Exit() free() malloc() */
-#include <string.h> /* strdup() */
+#include <stdlib.h> /* EXIT_FAILURE _Exit() calloc() free() malloc() */
+#include <string.h> /* memcpy() strdup() */
 
 #include "cfg/config.h"
 #include "compat/pthread.h"
+#include "compat/reallocarray.h"
 #include "engine/var.h"
 #include "engine/variables.h"
 #include "modes/dialogs/msg_dialog.h"
@@ -75,11 +77,13 @@
  *
  * On non-Windows systems background thread reads data from error streams of
  * external applications, which are then displayed by main thread.  This thread
- * maintains its own list of jobs (via err_next field), which is added to by
- * building a temporary list with new_err_jobs pointing to its head.  Every job
+ * registers error streams in a selector as jobs are passed to it via a
+ * temporary list with new_err_jobs pointing to its head (linked via err_next
+ * field), so only streams with data are visited on each wake up.  Every job
  * that has associated external process has the following life cycle:
  *  1. Created by main thread and passed to error thread through new_err_jobs.
- *  2. Either gets marked by signal handler or its stream reaches EOF.
+ *  2. Either its stream fails (the job is then kept in a list of drained jobs
+ *     until it finishes) or reaches EOF.
  *  3. Its use_count field is decremented.
  *  4. Main thread frees corresponding entry.
  */
@@ -102,24 +106,44 @@
 #define NO_JOB_ID INVALID_HANDLE_VALUE
 #endif
 
-/* Structure with passed to background_task_bootstrap() so it can perform
- * correct initialization/cleanup. */
-typedef struct
+/* Number of threads in the pool when 'bgthreads' hasn't been set. */
+#define DEFAULT_POOL_SIZE 4
+
+/* Niceness of processes started with BJF_LOW_PRIORITY flag. */
+#define LOW_PRIORITY_NICENESS 10
+
+/* Structure with passed to run_task() so it can perform correct
+ * initialization/cleanup. */
+typedef struct background_task_args
 {
 	bg_task_func func; /* Function to execute in a background thread. */
 	void *args;        /* Argument to pass. */
 	bg_job_t *job;     /* Job identifier that corresponds to the task. */
+	int coalesce;      /* Whether identical tasks can be merged with this one. */
+	dev_t *devs;       /* Devices used by the task. */
+	int ndevs;         /* Number of elements in devs. */
+
+	struct background_task_args *next; /* Next element of the queue. */
 }
 background_task_args;
 
+/* Queue of operations or tasks waiting to be picked up by a worker thread. */
+typedef struct
+{
+	background_task_args *head; /* First element or NULL. */
+	background_task_args *tail; /* Last element or NULL. */
+}
+task_queue_t;
+
 static void set_jobcount_var(int count);
 static void job_check(bg_job_t *job);
 static void job_free(bg_job_t *job);
 static void * error_thread(void *p);
-static void update_error_jobs(bg_job_t **jobs);
+static void read_job_errors(bg_job_t *job, selector_t *selector,
+		bg_job_t **drained, int *nwatched);
 static void free_drained_jobs(bg_job_t **jobs);
-static void import_error_jobs(bg_job_t **jobs);
-static void make_ready_list(const bg_job_t *jobs, selector_t *selector);
+static void import_error_jobs(selector_t *selector, int have_drained,
+		int *nwatched);
 #ifndef _WIN32
 static void rip_children(void);
 static void rip_child(pid_t pid, int status);
@@ -132,7 +156,22 @@ static void place_on_job_bar(bg_job_t *job);
 static void get_off_job_bar(bg_job_t *job);
 static bg_job_t * add_background_job(pid_t pid, const char cmd[],
 		uintptr_t err, uintptr_t data, BgJobType type, int with_bg_op);
-static void * background_task_bootstrap(void *arg);
+static int execute_task(const char descr[], const char op_descr[], int total,
+		int important, int coalesce, const dev_t devs[], int ndevs,
+		bg_task_func task_func, void *args);
+static int has_queued_duplicate(const task_queue_t *queue, const char descr[],
+		bg_task_func task_func);
+static void enqueue(task_queue_t *queue, background_task_args *task_args);
+static background_task_args * dequeue(task_queue_t *queue);
+static void unqueue(task_queue_t *queue, background_task_args *task_args);
+static void * pool_thread(void *arg);
+static background_task_args * pick_task(void);
+static background_task_args * pick_op(void);
+static int devs_are_busy(const background_task_args *task_args);
+static void occupy_devs(const background_task_args *task_args);
+static void release_devs(const background_task_args *task_args);
+static void run_task(background_task_args *task_args);
+static void free_task_args(background_task_args *task_args);
 static int update_job_status(bg_job_t *job);
 static void mark_job_finished(bg_job_t *job, int exit_code);
 static int bg_op_cancel(bg_op_t *bg_op);
@@ -149,6 +188,27 @@ static pthread_cond_t new_err_jobs_cond = PTHREAD_COND_INITIALIZER;
 /* Thread-local storage for bg_job_t associated with active thread. */
 static pthread_key_t current_job;
 
+/* Protects the queues and the state of thread pool below. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Signals appearance of new elements in the queues. */
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+/* Operations waiting for a thread, they are picked up before tasks. */
+static task_queue_t op_queue;
+/* Tasks waiting for a thread. */
+static task_queue_t task_queue;
+/* Maximum number of threads in the pool. */
+static int pool_size;
+/* Number of threads in the pool. */
+static int pool_threads;
+/* Number of threads of the pool waiting for work. */
+static int pool_idle;
+/* Number of threads of the pool busy with tasks. */
+static int pool_tasks;
+/* Devices used by running operations. */
+static dev_t *busy_devs;
+/* Number of elements in busy_devs. */
+static int nbusy_devs;
+
 int
 bg_init(void)
 {
@@ -415,7 +475,10 @@ error_thread(void *p)
 {
 	enum { ERROR_SELECT_TIMEOUT_MS = 250 };
 
-	bg_job_t *jobs = NULL;
+	/* Jobs whose stream failed and which wait to finish. */
+	bg_job_t *drained = NULL;
+	/* Number of streams registered in the selector. */
+	int nwatched = 0;
 
 	selector_t *selector = selector_alloc();
 	if(selector == NULL)
@@ -428,59 +491,18 @@ error_thread(void *p)
 
 	while(1)
 	{
-		update_error_jobs(&jobs);
-		make_ready_list(jobs, selector);
+		free_drained_jobs(&drained);
+		import_error_jobs(selector, drained != NULL, &nwatched);
+
 		while(selector_wait(selector, ERROR_SELECT_TIMEOUT_MS))
 		{
-			int need_update_list = (jobs == NULL);
-
-			bg_job_t **job = &jobs;
-			while(*job != NULL)
+			void *data;
+			while(selector_next_ready(selector, &data))
 			{
-				bg_job_t *const j = *job;
-				char err_msg[ERR_MSG_LEN];
-				ssize_t nread;
-
-				if(!selector_is_ready(selector, j->err_stream))
-				{
-					goto next_job;
-				}
-
-#ifndef _WIN32
-				nread = read(j->err_stream, err_msg, sizeof(err_msg) - 1U);
-#else
-				nread = -1;
-				DWORD bytes_read;
-				if(ReadFile(j->err_stream, err_msg, sizeof(err_msg) - 1U, &bytes_read,
-							NULL))
-				{
-					nread = bytes_read;
-				}
-#endif
-				if(nread < 0)
-				{
-					need_update_list = 1;
-					j->drained = 1;
-					goto next_job;
-				}
-
-				if(nread == 0)
-				{
-					/* Reached EOF, exclude corresponding file descriptor from the set,
-					 * cut the job out of our list and decrement its use counter. */
-					selector_remove(selector, j->err_stream);
-					*job = j->err_next;
-					bg_job_decref(j);
-					continue;
-				}
-
-				err_msg[nread] = '\0';
-				append_error_msg(j, err_msg);
-
-			next_job:
-				job = &j->err_next;
+				read_job_errors(data, selector, &drained, &nwatched);
 			}
 
+			int need_update_list = (nwatched == 0);
 			if(!need_update_list && pthread_mutex_lock(&new_err_jobs_lock) == 0)
 			{
 				need_update_list = (new_err_jobs != NULL);
@@ -497,12 +519,49 @@ error_thread(void *p)
 	return NULL;
 }
 
-/* Updates *jobs by removing finished tasks and adding new ones. */
+/* Reads portion of error stream of the job, which is ready for reading. */
 static void
-update_error_jobs(bg_job_t **jobs)
+read_job_errors(bg_job_t *job, selector_t *selector, bg_job_t **drained,
+		int *nwatched)
 {
-	free_drained_jobs(jobs);
-	import_error_jobs(jobs);
+	char err_msg[ERR_MSG_LEN];
+	ssize_t nread;
+
+#ifndef _WIN32
+	nread = read(job->err_stream, err_msg, sizeof(err_msg) - 1U);
+#else
+	nread = -1;
+	DWORD bytes_read;
+	if(ReadFile(job->err_stream, err_msg, sizeof(err_msg) - 1U, &bytes_read,
+				NULL))
+	{
+		nread = bytes_read;
+	}
+#endif
+
+	if(nread < 0)
+	{
+		/* Stop watching the stream, but keep the job until it's finished. */
+		selector_remove(selector, job->err_stream);
+		--*nwatched;
+		job->drained = 1;
+		job->err_next = *drained;
+		*drained = job;
+		return;
+	}
+
+	if(nread == 0)
+	{
+		/* Reached EOF, exclude corresponding file descriptor from the set and
+		 * decrement use counter of the job. */
+		selector_remove(selector, job->err_stream);
+		--*nwatched;
+		bg_job_decref(job);
+		return;
+	}
+
+	err_msg[nread] = '\0';
+	append_error_msg(job, err_msg);
 }
 
 /* Updates *jobs by removing finished tasks. */
@@ -514,7 +573,7 @@ free_drained_jobs(bg_job_t **jobs)
 	{
 		bg_job_t *const j = *job;
 
-		if(j->drained && pthread_spin_lock(&j->status_lock) == 0)
+		if(pthread_spin_lock(&j->status_lock) == 0)
 		{
 			/* If finished, decrement use_count and drop it from the list. */
 			if(!j->running)
@@ -531,18 +590,19 @@ free_drained_jobs(bg_job_t **jobs)
 	}
 }
 
-/* Updates *jobs by adding new tasks. */
+/* Registers new tasks in the selector.  Waits for new tasks if there is nothing
+ * to do. */
 static void
-import_error_jobs(bg_job_t **jobs)
+import_error_jobs(selector_t *selector, int have_drained, int *nwatched)
 {
 	bg_job_t *new_jobs;
 
-	/* Add new tasks to internal list, wait if there are no jobs. */
+	/* Wait if there are no jobs. */
 	if(pthread_mutex_lock(&new_err_jobs_lock) != 0)
 	{
 		return;
 	}
-	while(*jobs == NULL && new_err_jobs == NULL)
+	while(*nwatched == 0 && !have_drained && new_err_jobs == NULL)
 	{
 		if(pthread_cond_wait(&new_err_jobs_cond, &new_err_jobs_lock) != 0)
 		{
@@ -553,7 +613,6 @@ import_error_jobs(bg_job_t **jobs)
 	new_err_jobs = NULL;
 	(void)pthread_mutex_unlock(&new_err_jobs_lock);
 
-	/* Prepend new jobs to the list. */
 	while(new_jobs != NULL)
 	{
 		bg_job_t *const new_job = new_jobs;
@@ -565,22 +624,10 @@ import_error_jobs(bg_job_t **jobs)
 		/* Mark a this job as an interesting one to avoid it being killed until we
 		 * have a chance to read error stream. */
 		new_job->drained = 0;
+		new_job->err_next = NULL;
 
-		new_job->err_next = *jobs;
-		*jobs = new_job;
-	}
-}
-
-/* Reinitializes the selector with up-to-date list of objects to watch. */
-static void
-make_ready_list(const bg_job_t *jobs, selector_t *selector)
-{
-	selector_reset(selector);
-
-	while(jobs != NULL)
-	{
-		selector_add(selector, jobs->err_stream);
-		jobs = jobs->err_next;
+		selector_add_data(selector, new_job->err_stream, new_job);
+		++*nwatched;
 	}
 }
 
@@ -964,6 +1011,8 @@ launch_external(const char cmd[], BgJobFlags flags, ShellRequester by)
 	const int capture_output = (flags & BJF_CAPTURE_OUT);
 	const int merge_streams = (capture_output && (flags & BJF_MERGE_STREAMS));
 
+	const int low_priority = (flags & BJF_LOW_PRIORITY);
+
 #ifndef _WIN32
 	const int keep_in_fg = (flags & BJF_KEEP_IN_FG);
 
@@ -1080,6 +1129,13 @@ launch_external(const char cmd[], BgJobFlags flags, ShellRequester by)
 			_Exit(EXIT_FAILURE);
 		}
 
+		/* Priority is inherited by all processes the shell spawns.  Failing to
+		 * lower it isn't fatal. */
+		if(low_priority)
+		{
+			(void)setpriority(PRIO_PROCESS, 0, LOW_PRIORITY_NICENESS);
+		}
+
 		prepare_for_exec();
 		char *sh_flag = (by == SHELL_BY_USER ? cfg.shell_cmd_flag : "-c");
 		execve(get_execv_path(cfg.shell),
@@ -1177,7 +1233,12 @@ launch_external(const char cmd[], BgJobFlags flags, ShellRequester by)
 	sh_cmd = win_make_sh_cmd(cmd, by);
 
 	wide_cmd = to_wide(sh_cmd);
-	int started = CreateProcessW(NULL, wide_cmd, NULL, NULL, 1, CREATE_SUSPENDED,
+	DWORD creation_flags = CREATE_SUSPENDED;
+	if(low_priority)
+	{
+		creation_flags |= BELOW_NORMAL_PRIORITY_CLASS;
+	}
+	int started = CreateProcessW(NULL, wide_cmd, NULL, NULL, 1, creation_flags,
 			NULL, NULL, &startup, &pinfo);
 	free(wide_cmd);
 	CloseHandle(hnul);
@@ -1261,52 +1322,209 @@ int
 bg_execute(const char descr[], const char op_descr[], int total, int important,
 		bg_task_func task_func, void *args)
 {
-	pthread_t id;
-	int ret;
+	return execute_task(descr, op_descr, total, important, /*coalesce=*/0,
+			/*devs=*/NULL, /*ndevs=*/0, task_func, args);
+}
+
+int
+bg_execute_once(const char descr[], const char op_descr[], int total,
+		int important, bg_task_func task_func, void *args)
+{
+	return execute_task(descr, op_descr, total, important, /*coalesce=*/1,
+			/*devs=*/NULL, /*ndevs=*/0, task_func, args);
+}
+
+int
+bg_execute_on(const char descr[], const char op_descr[], int total,
+		const dev_t devs[], int ndevs, bg_task_func task_func, void *args)
+{
+	return (execute_task(descr, op_descr, total, /*important=*/1,
+				/*coalesce=*/0, devs, ndevs, task_func, args) != 0);
+}
+
+/* Implementation of bg_execute*() functions.  Returns zero if the task was
+ * queued, positive number if it was merged with identical task that's still
+ * waiting to be started and negative number on error. */
+static int
+execute_task(const char descr[], const char op_descr[], int total,
+		int important, int coalesce, const dev_t devs[], int ndevs,
+		bg_task_func task_func, void *args)
+{
+	task_queue_t *const queue = (important ? &op_queue : &task_queue);
 
-	background_task_args *const task_args = malloc(sizeof(*task_args));
+	background_task_args *const task_args = calloc(1, sizeof(*task_args));
 	if(task_args == NULL)
 	{
+		return -1;
+	}
+
+	if(ndevs > 0)
+	{
+		task_args->devs = reallocarray(NULL, ndevs, sizeof(*task_args->devs));
+		if(task_args->devs == NULL)
+		{
+			free(task_args);
+			return -1;
+		}
+		memcpy(task_args->devs, devs, sizeof(*devs)*ndevs);
+		task_args->ndevs = ndevs;
+	}
+
+	if(pthread_mutex_lock(&pool_lock) != 0)
+	{
+		free_task_args(task_args);
+		return -1;
+	}
+
+	if(coalesce && has_queued_duplicate(queue, descr, task_func))
+	{
+		(void)pthread_mutex_unlock(&pool_lock);
+		free_task_args(task_args);
 		return 1;
 	}
 
 	task_args->func = task_func;
 	task_args->args = args;
+	task_args->coalesce = coalesce;
 	task_args->job = add_background_job(WRONG_PID, descr, (uintptr_t)NO_JOB_ID,
 			(uintptr_t)NO_JOB_ID, important ? BJT_OPERATION : BJT_TASK, 1);
 
 	if(task_args->job == NULL)
 	{
-		free(task_args);
-		return 1;
+		(void)pthread_mutex_unlock(&pool_lock);
+		free_task_args(task_args);
+		return -1;
 	}
 
 	replace_string(&task_args->job->bg_op.descr, op_descr);
 	task_args->job->bg_op.total = total;
+	if(pthread_spin_lock(&task_args->job->status_lock) == 0)
+	{
+		task_args->job->queued = 1;
+		(void)pthread_spin_unlock(&task_args->job->status_lock);
+	}
 
 	if(task_args->job->type == BJT_OPERATION)
 	{
 		place_on_job_bar(task_args->job);
 	}
 
-	ret = 0;
-	if(pthread_create(&id, NULL, &background_task_bootstrap, task_args) != 0)
+	enqueue(queue, task_args);
+
+	/* Size of the pool is updated only here to not access configuration from
+	 * other threads. */
+	pool_size = (cfg.bg_threads > 0 ? cfg.bg_threads : DEFAULT_POOL_SIZE);
+
+	int ret = 0;
+	pthread_t id;
+	if(pool_idle == 0 && pool_threads < pool_size &&
+			pthread_create(&id, NULL, &pool_thread, NULL) == 0)
+	{
+		++pool_threads;
+	}
+	else if(pool_threads == 0)
 	{
+		unqueue(queue, task_args);
+
 		/* Mark job as finished with error. */
 		if(pthread_spin_lock(&task_args->job->status_lock) == 0)
 		{
 			task_args->job->running = 0;
+			task_args->job->queued = 0;
 			task_args->job->exit_code = 1;
 			(void)pthread_spin_unlock(&task_args->job->status_lock);
 		}
 
-		free(task_args);
-		ret = 1;
+		free_task_args(task_args);
+		ret = -1;
 	}
 
+	(void)pthread_cond_signal(&pool_cond);
+	(void)pthread_mutex_unlock(&pool_lock);
+
 	return ret;
 }
 
+/* Checks whether identical task which accepts merging is waiting in the queue.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+has_queued_duplicate(const task_queue_t *queue, const char descr[],
+		bg_task_func task_func)
+{
+	const background_task_args *task_args;
+	for(task_args = queue->head; task_args != NULL; task_args = task_args->next)
+	{
+		if(task_args->coalesce && task_args->func == task_func &&
+				strcmp(task_args->job->cmd, descr) == 0 &&
+				!bg_job_cancelled(task_args->job))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Appends element to the end of a queue. */
+static void
+enqueue(task_queue_t *queue, background_task_args *task_args)
+{
+	task_args->next = NULL;
+	if(queue->tail == NULL)
+	{
+		queue->head = task_args;
+	}
+	else
+	{
+		queue->tail->next = task_args;
+	}
+	queue->tail = task_args;
+}
+
+/* Removes first element of a queue.  Returns the element or NULL if the queue
+ * is empty. */
+static background_task_args *
+dequeue(task_queue_t *queue)
+{
+	background_task_args *const task_args = queue->head;
+	if(task_args != NULL)
+	{
+		unqueue(queue, task_args);
+	}
+	return task_args;
+}
+
+/* Removes specified element from a queue. */
+static void
+unqueue(task_queue_t *queue, background_task_args *task_args)
+{
+	background_task_args *prev = NULL;
+	background_task_args *curr = queue->head;
+	while(curr != NULL && curr != task_args)
+	{
+		prev = curr;
+		curr = curr->next;
+	}
+
+	if(curr == NULL)
+	{
+		return;
+	}
+
+	if(prev == NULL)
+	{
+		queue->head = curr->next;
+	}
+	else
+	{
+		prev->next = curr->next;
+	}
+
+	if(queue->tail == curr)
+	{
+		queue->tail = prev;
+	}
+}
+
 /* Makes the job appear on the job bar. */
 static void
 place_on_job_bar(bg_job_t *job)
@@ -1368,6 +1586,7 @@ add_background_job(pid_t pid, const char cmd[], uintptr_t err, uintptr_t data,
 	}
 
 	new->running = 1;
+	new->queued = 0;
 	new->use_count = 0;
 	new->exit_code = -1;
 
@@ -1428,32 +1647,205 @@ free_new:
 	return NULL;
 }
 
-/* pthreads entry point for a new background task.  Performs correct
- * startup/exit with related updates of internal data structures.  Returns
- * result for this thread. */
+/* Entry point of a thread of the pool.  Runs queued operations and tasks and
+ * exits if there are more threads than necessary.  Returns NULL. */
 static void *
-background_task_bootstrap(void *arg)
+pool_thread(void *arg)
 {
-	background_task_args *const task_args = arg;
-
 	(void)pthread_detach(pthread_self());
 	block_all_thread_signals();
 
-	if(pthread_setspecific(current_job, task_args->job) == 0)
+	if(pthread_mutex_lock(&pool_lock) != 0)
 	{
-		task_args->func(&task_args->job->bg_op, task_args->args);
-		mark_job_finished(task_args->job, /*exit_code=*/0);
+		return NULL;
 	}
-	else
+
+	while(1)
 	{
-		mark_job_finished(task_args->job, /*exit_code=*/1);
+		background_task_args *const task_args = pick_task();
+		if(task_args == NULL)
+		{
+			if(pool_threads > pool_size)
+			{
+				break;
+			}
+
+			++pool_idle;
+			const int error = pthread_cond_wait(&pool_cond, &pool_lock);
+			--pool_idle;
+			if(error != 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		const int is_task = (task_args->job->type == BJT_TASK);
+		(void)pthread_mutex_unlock(&pool_lock);
+
+		run_task(task_args);
+
+		if(pthread_mutex_lock(&pool_lock) != 0)
+		{
+			free_task_args(task_args);
+			return NULL;
+		}
+
+		if(is_task)
+		{
+			--pool_tasks;
+		}
+
+		if(task_args->ndevs != 0)
+		{
+			release_devs(task_args);
+			/* Operations waiting for the devices might be able to start now. */
+			(void)pthread_cond_broadcast(&pool_cond);
+		}
+		free_task_args(task_args);
 	}
 
-	free(task_args);
+	--pool_threads;
+	(void)pthread_mutex_unlock(&pool_lock);
+	return NULL;
+}
+
+/* Picks next element to be processed by a thread of the pool.  Operations take
+ * precedence over tasks, which also can't occupy all threads of the pool if
+ * there are more than one of them.  Must be called with pool_lock held.
+ * Returns the element or NULL if there is nothing to do. */
+static background_task_args *
+pick_task(void)
+{
+	background_task_args *const op = pick_op();
+	if(op != NULL)
+	{
+		return op;
+	}
+
+	const int max_tasks = (pool_size > 1 ? pool_size - 1 : 1);
+	if(pool_tasks >= max_tasks)
+	{
+		return NULL;
+	}
 
+	background_task_args *const task = dequeue(&task_queue);
+	if(task != NULL)
+	{
+		++pool_tasks;
+	}
+	return task;
+}
+
+/* Picks first queued operation whose devices aren't used by running
+ * operations and marks its devices as busy.  Must be called with pool_lock
+ * held.  Returns the operation or NULL if there is none. */
+static background_task_args *
+pick_op(void)
+{
+	background_task_args *op;
+	for(op = op_queue.head; op != NULL; op = op->next)
+	{
+		if(!devs_are_busy(op))
+		{
+			unqueue(&op_queue, op);
+			occupy_devs(op);
+			return op;
+		}
+	}
 	return NULL;
 }
 
+/* Checks whether any of devices of the task is used by a running operation.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+devs_are_busy(const background_task_args *task_args)
+{
+	int i, j;
+	for(i = 0; i < task_args->ndevs; ++i)
+	{
+		for(j = 0; j < nbusy_devs; ++j)
+		{
+			if(busy_devs[j] == task_args->devs[i])
+			{
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* Marks devices of the task as busy. */
+static void
+occupy_devs(const background_task_args *task_args)
+{
+	if(task_args->ndevs == 0)
+	{
+		return;
+	}
+
+	dev_t *const devs = reallocarray(busy_devs, nbusy_devs + task_args->ndevs,
+			sizeof(*devs));
+	if(devs != NULL)
+	{
+		busy_devs = devs;
+		memcpy(&busy_devs[nbusy_devs], task_args->devs,
+				sizeof(*devs)*task_args->ndevs);
+		nbusy_devs += task_args->ndevs;
+	}
+}
+
+/* Marks devices of the task as no longer busy. */
+static void
+release_devs(const background_task_args *task_args)
+{
+	int i, j;
+	for(i = 0; i < task_args->ndevs; ++i)
+	{
+		for(j = 0; j < nbusy_devs; ++j)
+		{
+			if(busy_devs[j] == task_args->devs[i])
+			{
+				busy_devs[j] = busy_devs[--nbusy_devs];
+				break;
+			}
+		}
+	}
+}
+
+/* Runs an operation or a task performing correct startup/exit with related
+ * updates of internal data structures. */
+static void
+run_task(background_task_args *task_args)
+{
+	bg_job_t *const job = task_args->job;
+
+	if(pthread_spin_lock(&job->status_lock) == 0)
+	{
+		job->queued = 0;
+		(void)pthread_spin_unlock(&job->status_lock);
+	}
+
+	if(pthread_setspecific(current_job, job) == 0)
+	{
+		task_args->func(&job->bg_op, task_args->args);
+		mark_job_finished(job, /*exit_code=*/0);
+		(void)pthread_setspecific(current_job, NULL);
+	}
+	else
+	{
+		mark_job_finished(job, /*exit_code=*/1);
+	}
+}
+
+/* Frees queue element along with its data. */
+static void
+free_task_args(background_task_args *task_args)
+{
+	free(task_args->devs);
+	free(task_args);
+}
+
 int
 bg_has_active_jobs(int important_only)
 {
@@ -1559,6 +1951,18 @@ bg_job_is_running(bg_job_t *job)
 	return (running && update_job_status(job));
 }
 
+int
+bg_job_is_queued(bg_job_t *job)
+{
+	if(pthread_spin_lock(&job->status_lock) != 0)
+	{
+		return 0;
+	}
+	const int queued = job->queued;
+	(void)pthread_spin_unlock(&job->status_lock);
+	return queued;
+}
+
 int
 bg_job_was_killed(bg_job_t *job)
 {
@@ -1717,28 +2121,40 @@ bg_op_set_descr(bg_op_t *bg_op, const char descr[])
 static int
 bg_op_cancel(bg_op_t *bg_op)
 {
-	int was_cancelled = 0;
-	if(bg_op_lock(bg_op))
-	{
-		was_cancelled = bg_op->cancelled;
-		bg_op->cancelled = 1;
-		bg_op_unlock(bg_op);
-
-		bg_op_changed(bg_op);
-	}
+	const int was_cancelled = __atomic_exchange_n(&bg_op->cancelled, 1,
+			__ATOMIC_SEQ_CST);
+	bg_op_changed(bg_op);
 	return was_cancelled;
 }
 
 int
 bg_op_cancelled(bg_op_t *bg_op)
 {
-	int cancelled = 0;
-	if(bg_op_lock(bg_op))
-	{
-		cancelled = bg_op->cancelled;
-		bg_op_unlock(bg_op);
-	}
-	return cancelled;
+	return __atomic_load_n(&bg_op->cancelled, __ATOMIC_ACQUIRE);
+}
+
+void
+bg_op_set_progress(bg_op_t *bg_op, int progress)
+{
+	__atomic_store_n(&bg_op->progress, progress, __ATOMIC_RELAXED);
+}
+
+int
+bg_op_get_progress(const bg_op_t *bg_op)
+{
+	return __atomic_load_n(&bg_op->progress, __ATOMIC_RELAXED);
+}
+
+void
+bg_op_inc_done(bg_op_t *bg_op)
+{
+	(void)__atomic_add_fetch(&bg_op->done, 1, __ATOMIC_RELAXED);
+}
+
+int
+bg_op_get_done(const bg_op_t *bg_op)
+{
+	return __atomic_load_n(&bg_op->done, __ATOMIC_RELAXED);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -24,7 +24,7 @@
 #include <windef.h>
 #endif
 
-#include <sys/types.h> /* pid_t */
+#include <sys/types.h> /* dev_t pid_t */
 
 #include <stdio.h>
 
@@ -61,10 +61,14 @@ typedef enum
 	BJF_MERGE_STREAMS   = 1 << 4, /* Merge error stream into output stream. */
 	BJF_KEEP_IN_FG      = 1 << 5, /* Do not detach from terminal session or
 	                                 process group. */
+	BJF_LOW_PRIORITY    = 1 << 6, /* Run the command with lowered scheduling
+	                                 priority. */
 }
 BgJobFlags;
 
-/* Auxiliary structure to be updated by background tasks while they progress. */
+/* Auxiliary structure to be updated by background tasks while they progress.
+ * Counters are accessed atomically via bg_op_*() functions and don't require
+ * locking, only descr field is guarded by bg_op_lock(). */
 typedef struct bg_op_t
 {
 	int total; /* Total number of coarse operations. */
@@ -97,6 +101,7 @@ typedef struct bg_job_t
 	/* The lock is meant to guard state-related fields. */
 	pthread_spinlock_t status_lock;
 	int running;   /* Whether this job is still running. */
+	int queued;    /* Whether this job waits for its turn to be started. */
 	int use_count; /* Count of uses of this job entry. */
 	int exit_code; /* Exit code of external command. */
 
@@ -171,11 +176,27 @@ pid_t bg_run_and_capture(char cmd[], int user_sh, FILE *in, FILE **out,
  * needed. */
 void bg_check(void);
 
-/* Starts new background task, which is run in a separate thread.  Returns zero
- * on success, otherwise non-zero is returned. */
+/* Starts new background task, which is run by a pool of threads.  Important
+ * tasks (operations) are started before others.  Returns zero on success,
+ * otherwise non-zero is returned. */
 int bg_execute(const char descr[], const char op_descr[], int total,
 		int important, bg_task_func task_func, void *args);
 
+/* Same as bg_execute(), but does nothing if identical task (same descr and
+ * task_func) is still waiting to be started.  Returns zero if task was queued,
+ * positive number if it was merged with the waiting one (args aren't used in
+ * this case) and negative number on error. */
+int bg_execute_once(const char descr[], const char op_descr[], int total,
+		int important, bg_task_func task_func, void *args);
+
+/* Same as bg_execute() for an operation working with files on the specified
+ * devices.  The operation waits in the queue while any of the devices is used
+ * by another running operation, so operations on the same device are
+ * serialized while those on different devices run in parallel.  Returns zero on
+ * success, otherwise non-zero is returned. */
+int bg_execute_on(const char descr[], const char op_descr[], int total,
+		const dev_t devs[], int ndevs, bg_task_func task_func, void *args);
+
 /* Checks whether there are any internal jobs (important_only is non-zero) or
  * jobs or tasks (important_only is zero) running in background.  External
  * applications whose state is tracked are always ignored by this function. */
@@ -199,6 +220,10 @@ void bg_job_terminate(bg_job_t *job);
  * zero is returned. */
 int bg_job_is_running(bg_job_t *job);
 
+/* Checks whether the job is waiting in a queue to be started.  Returns non-zero
+ * if so, otherwise zero is returned. */
+int bg_job_is_queued(bg_job_t *job);
+
 /* Checks whether the job was killed.  Returns non-zero if so, otherwise zero is
  * returned. */
 int bg_job_was_killed(bg_job_t *job);
@@ -232,11 +257,26 @@ void bg_op_changed(bg_op_t *bg_op);
  * operation change. */
 void bg_op_set_descr(bg_op_t *bg_op, const char descr[]);
 
-/* Convenience method to check for background job cancellation, use
- * lock -> <check> -> unlock -> changed sequence for more generic cases.
- * Returns non-zero if cancellation requested, otherwise zero is returned. */
+/* Checks for background job cancellation without locking.  Returns non-zero if
+ * cancellation requested, otherwise zero is returned. */
 int bg_op_cancelled(bg_op_t *bg_op);
 
+/* Updates progress of background job in percents without locking.  The change
+ * isn't reported, job bar picks it up on its next redraw. */
+void bg_op_set_progress(bg_op_t *bg_op, int progress);
+
+/* Retrieves progress of background job in percents.  Returns the progress or -1
+ * if it's not known. */
+int bg_op_get_progress(const bg_op_t *bg_op);
+
+/* Marks one more coarse operation of background job as processed without
+ * locking. */
+void bg_op_inc_done(bg_op_t *bg_op);
+
+/* Retrieves number of processed coarse operations of background job.  Returns
+ * the number. */
+int bg_op_get_done(const bg_op_t *bg_op);
+
 #endif /* VIFM__BACKGROUND_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
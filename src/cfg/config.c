@@ -207,6 +207,9 @@ cfg_init(void)
 	cfg.hard_graphics_clear = 0;
 	cfg.top_tree_stats = 0;
 	cfg.max_tree_depth = 0;
+	cfg.preview_cache_size = 0;
+	cfg.preview_prefetch = 0;
+	cfg.viewer_delay = 0;
 
 	cfg.timeout_len = 1000;
 	cfg.min_timeout_len = 150;
@@ -219,6 +222,7 @@ cfg_init(void)
 	cfg.word_chars['\x20'] = 0;
 
 	cfg.view_dir_size = VDS_SIZE;
+	cfg.disk_usage = 0;
 
 	cfg.log_file[0] = '\0';
 
@@ -233,6 +237,10 @@ cfg_init(void)
 
 	cfg.fast_file_cloning = 0;
 	cfg.data_sync = 1;
+	cfg.bulk_copy = 0;
+	cfg.journal_ops = 0;
+	cfg.verify_copies = 0;
+	cfg.bg_threads = 4;
 
 	cfg.cvoptions = 0;
 
@@ -603,6 +611,8 @@ store_config_paths(const char data_dir[])
 	free(trash_base);
 
 	snprintf(cfg.log_file, sizeof(cfg.log_file), "%s/" LOG, base);
+	snprintf(cfg.preview_cache_dir, sizeof(cfg.preview_cache_dir),
+			"%s/previews", base);
 
 	char *fuse_home = format_str("%s/fuse/", base);
 	(void)cfg_set_fuse_home(fuse_home);
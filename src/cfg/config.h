@@ -144,7 +144,8 @@ enum
 	VINFO_MCHISTORY = 1 << 16, /* Command-line history of menus. */
 	VINFO_SAVEDIRS  = 1 << 17, /* Restore last used directories on startup. */
 	VINFO_TABS      = 1 << 18, /* Restore global or pane tabs. */
-	NUM_VINFO       = 19,      /* Number of VINFO_* constants. */
+	VINFO_DCACHE    = 1 << 19, /* Cache of directory sizes and item counts. */
+	NUM_VINFO       = 20,      /* Number of VINFO_* constants. */
 
 	EMPTY_VINFO = 0,                   /* Empty set of flags. */
 	FULL_VINFO  = (1 << NUM_VINFO) - 1 /* Full set of flags. */
@@ -184,6 +185,8 @@ typedef struct config_t
 	char config_dir[PATH_MAX + 1];  /* Where local configuration files are
 	                                   stored. */
 	char colors_dir[PATH_MAX + 16]; /* Where local color files are stored. */
+	/* Where output of viewers is cached between sessions. */
+	char preview_cache_dir[PATH_MAX + 16];
 
 	char *session; /* Name of current session or NULL. */
 
@@ -345,6 +348,15 @@ typedef struct config_t
 	int top_tree_stats;
 	/* Max depth of preview tree.  Zero means "no limit". */
 	int max_tree_depth;
+	/* Size budget of on-disk cache of viewers' output in megabytes.  Zero
+	 * disables the cache. */
+	int preview_cache_size;
+	/* Number of entries in direction of cursor movement whose previews are
+	 * prepared ahead of time.  Zero disables prefetching. */
+	int preview_prefetch;
+	/* Delay in milliseconds before starting external viewer of a file in
+	 * background. */
+	int viewer_delay;
 
 	int timeout_len;     /* Maximum period on waiting for the input. */
 	int min_timeout_len; /* Minimum period on waiting for the input. */
@@ -352,11 +364,23 @@ typedef struct config_t
 	char word_chars[256]; /* Whether corresponding character is a word char. */
 
 	ViewDirSize view_dir_size; /* Type of size display for directories in view. */
+	/* Whether sizes are allocated sizes with hard links of a file counted once
+	 * per directory size calculation rather than apparent sizes. */
+	int disk_usage;
 
 	/* Controls use of fast file cloning for file systems that support it. */
 	int fast_file_cloning;
 	/* Force writing data onto media during file copying. */
 	int data_sync;
+	/* Copy files in a way that doesn't flush page cache of other applications. */
+	int bulk_copy;
+	/* Keep journals of background copy/move operations to be able to resume
+	 * them. */
+	int journal_ops;
+	/* Check copied data by reading it back and comparing with the source. */
+	int verify_copies;
+	/* Maximum number of threads running background operations and tasks. */
+	int bg_threads;
 
 	/* Whether various things should be reset on entering/leaving custom views. */
 	int cvoptions;
@@ -304,6 +304,16 @@ state_store(void)
 {
 	write_info_file();
 
+	if(cfg.vifm_info & VINFO_DCACHE)
+	{
+		char dcache_file[PATH_MAX + 16];
+		snprintf(dcache_file, sizeof(dcache_file), "%s/dcache", cfg.config_dir);
+		if(dcache_save(dcache_file) != 0)
+		{
+			LOG_ERROR_MSG("Error storing dcache to: %s", dcache_file);
+		}
+	}
+
 	if(sessions_active())
 	{
 		write_session_file();
@@ -314,6 +324,13 @@ void
 state_load(int reread)
 {
 	char info_file[PATH_MAX + 16];
+
+	if(cfg.vifm_info & VINFO_DCACHE)
+	{
+		snprintf(info_file, sizeof(info_file), "%s/dcache", cfg.config_dir);
+		dcache_load_lazily(info_file);
+	}
+
 	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
 
 	char *locale = drop_locale();
@@ -2233,6 +2250,7 @@ store_global_options(JSON_Object *root)
 	append_dstr(options, format_str("aproposprg=%s",
 				escape_spaces(cfg.apropos_prg)));
 	append_dstr(options, format_str("%sautochpos", cfg.auto_ch_pos ? "" : "no"));
+	append_dstr(options, format_str("bgthreads=%d", cfg.bg_threads));
 	append_dstr(options, format_str("cdpath=%s", cfg.cd_path));
 	append_dstr(options, format_str("%sautocd", cfg.auto_cd ? "" : "no"));
 	append_dstr(options, format_str("%schaselinks", cfg.chase_links ? "" : "no"));
@@ -2340,6 +2358,7 @@ store_global_options(JSON_Object *root)
 
 	append_dstr(options, format_str("dirsize=%s",
 				cfg.view_dir_size == VDS_SIZE ? "size" : "nitems"));
+	append_dstr(options, format_str("%sdiskusage", cfg.disk_usage ? "" : "no"));
 
 	const char *str = classify_to_str();
 	append_dstr(options, format_str("classify=%s",
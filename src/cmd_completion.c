@@ -297,9 +297,14 @@ non_path_completion(completion_data_t *data)
 				id == COM_ALINK || id == COM_RLINK))
 	{
 		static const char *lines[][2] = {
-			{ "-skip", "skip files with conflicting names" }
+			{ "-skip", "skip files with conflicting names" },
+			{ "-bulk", "copy without trashing page cache" },
+			{ "-verify", "check copied data against the source" },
 		};
-		complete_from_string_list(arg, lines, ARRAY_LEN(lines), /*ignore_case=*/0);
+		/* Only the first option is meaningful for links. */
+		const int links = (id == COM_ALINK || id == COM_RLINK);
+		complete_from_string_list(arg, lines, links ? 1 : ARRAY_LEN(lines),
+				/*ignore_case=*/0);
 	}
 	else
 	{
@@ -612,6 +617,7 @@ complete_tree(const char str[])
 {
 	static const char *lines[][2] = {
 		{ "depth=", "maximum node nesting level before folding" },
+		{ "lazy",   "list subdirectories on demand" },
 	};
 
 	complete_from_string_list(str, lines, ARRAY_LEN(lines), 0);
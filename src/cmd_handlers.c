@@ -314,7 +314,8 @@ static int get_at(const view_t *view, const cmd_info_t *cmd_info);
 static int tr_cmd(const cmd_info_t *cmd_info);
 static int trashes_cmd(const cmd_info_t *cmd_info);
 static int tree_cmd(const cmd_info_t *cmd_info);
-static int parse_tree_properties(const cmd_info_t *cmd_info, int *depth);
+static int parse_tree_properties(const cmd_info_t *cmd_info, int *depth,
+		int *lazy);
 static int undolist_cmd(const cmd_info_t *cmd_info);
 static int unlet_cmd(const cmd_info_t *cmd_info);
 static int unmap_cmd(const cmd_info_t *cmd_info);
@@ -4348,6 +4349,14 @@ parse_cpmv_flags(int *argc, char ***argv)
 		{
 			flags |= CMLF_SKIP;
 		}
+		else if(strcmp(argv[0][i], "-bulk") == 0)
+		{
+			flags |= CMLF_BULK;
+		}
+		else if(strcmp(argv[0][i], "-verify") == 0)
+		{
+			flags |= CMLF_VERIFY;
+		}
 		else
 		{
 			ui_sb_errf("Unrecognized :command option: %s", argv[0][i]);
@@ -5159,13 +5168,20 @@ tree_cmd(const cmd_info_t *cmd_info)
 		return 0;
 	}
 
-	int depth;
-	if(parse_tree_properties(cmd_info, &depth) != 0)
+	int depth, lazy;
+	if(parse_tree_properties(cmd_info, &depth, &lazy) != 0)
 	{
 			return CMDS_ERR_CUSTOM;
 	}
 
-	(void)flist_load_tree(curr_view, flist_get_dir(curr_view), depth);
+	if(lazy)
+	{
+		(void)flist_load_lazy_tree(curr_view, flist_get_dir(curr_view));
+	}
+	else
+	{
+		(void)flist_load_tree(curr_view, flist_get_dir(curr_view), depth);
+	}
 	return 0;
 }
 
@@ -5173,9 +5189,10 @@ tree_cmd(const cmd_info_t *cmd_info)
  * zero on success, otherwise non-zero is returned and error message is
  * displayed on the status bar. */
 static int
-parse_tree_properties(const cmd_info_t *cmd_info, int *depth)
+parse_tree_properties(const cmd_info_t *cmd_info, int *depth, int *lazy)
 {
 	*depth = INT_MAX;
+	*lazy = 0;
 
 	int i;
 	for(i = 0; i < cmd_info->argc; ++i)
@@ -5193,6 +5210,11 @@ parse_tree_properties(const cmd_info_t *cmd_info, int *depth)
 
 			*depth = value - 1;
 		}
+		else if(strcmp(arg, "lazy") == 0)
+		{
+			/* Subdirectories are listed on unfolding, search or filtering. */
+			*lazy = 1;
+		}
 		else
 		{
 			ui_sb_errf("Invalid argument: %s", arg);
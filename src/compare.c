@@ -66,7 +66,7 @@
  *       * compute contents fingerprint for current file and insert it
  */
 
-/* This is the only unit that uses xxhash, so import it directly here. */
+/* Import xxhash privately to get it inlined into this unit. */
 #define XXH_PRIVATE_API
 #include "utils/xxhash.h"
 
@@ -1317,6 +1317,7 @@ compare_move_entry(ops_t *ops, view_t *from, view_t *to, int idx)
 	/* Obtaining file fingerprint relies on size field of entries, so try to load
 	 * it and ignore if it fails. */
 	other->size = get_file_size(to_path);
+	other->alloc_size = other->size;
 
 	/* Try to update id of the other entry by computing fingerprint of both files
 	 * and checking if they match. */
@@ -0,0 +1,798 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "du.h"
+
+#include <sys/stat.h> /* S_ISDIR() fstat() fstatat() stat */
+#include <sys/types.h> /* dev_t ino_t */
+#include <dirent.h> /* DIR closedir() fdopendir() readdir() */
+#include <fcntl.h> /* AT_FDCWD AT_SYMLINK_NOFOLLOW O_* openat() */
+#include <unistd.h> /* close() dup() sysconf() */
+
+#include <errno.h> /* ETIMEDOUT */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strdup() strrchr() */
+#include <time.h> /* CLOCK_REALTIME clock_gettime() timespec */
+
+#include "compat/pthread.h"
+#include "compat/reallocarray.h"
+#include "utils/cancellation.h"
+#include "utils/macros.h"
+#include "utils/path.h"
+#include "utils/str.h"
+#include "utils/utils.h"
+#include "status.h"
+
+/* Maximum number of threads that traverse directories.  Traversal is bound by
+ * I/O rather than by CPU, hence more threads than there are CPUs. */
+#define MAX_WORKERS 8
+
+/* Number of directory entries after which abortion is checked. */
+#define STOP_CHECK_BATCH 256
+
+/* How often cancellation is checked while waiting for workers (in
+ * milliseconds). */
+#define POLL_INTERVAL 50
+
+/* Size of a block in st_blocks field of struct stat. */
+#define BLOCK_SIZE 512U
+
+/* Directory whose size is being calculated. */
+typedef struct du_dir_t du_dir_t;
+struct du_dir_t
+{
+	du_dir_t *parent; /* Parent directory or NULL for the root. */
+	char *path;       /* Full path to the directory for dcache. */
+	const char *name; /* Path relative to descriptor of the parent. */
+	int fd;           /* Descriptor of the directory or -1. */
+	uint64_t inode;   /* Inode number of the directory. */
+	uint64_t size;    /* Accumulated apparent size, updated atomically. */
+	uint64_t alloc;   /* Accumulated allocated size, updated atomically. */
+	int pending;      /* Unfinished subdirectories plus one while listing.
+	                     Updated atomically. */
+};
+
+/* Double-ended queue of directories of a single worker.  The owner takes
+ * directories from the back, thieves steal them from the front. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects all fields below. */
+	du_dir_t **items;     /* Ring buffer of directories. */
+	int capacity;         /* Size of the buffer. */
+	int head;             /* Index of the front element. */
+	int count;            /* Number of elements in the buffer. */
+}
+deque_t;
+
+/* Identity of a file. */
+typedef struct
+{
+	dev_t dev; /* Device of the file. */
+	ino_t ino; /* Inode of the file. */
+}
+file_id_t;
+
+/* Open addressing hash set of files with several hard links, which is used to
+ * account for allocated size of such files only once. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects all fields below. */
+	file_id_t *slots;     /* Slots of the table, unused ones are zeroed. */
+	size_t capacity;      /* Number of slots, a power of two. */
+	size_t count;         /* Number of used slots. */
+}
+links_t;
+
+/* State of calculation shared by the workers and the thread that started it. */
+typedef struct du_t du_t;
+
+/* State of a single worker. */
+typedef struct
+{
+	du_t *du;       /* Shared state. */
+	int index;      /* Index of this worker. */
+	deque_t deque;  /* Directories of this worker. */
+	pthread_t tid;  /* Thread of the worker. */
+}
+worker_t;
+
+struct du_t
+{
+	int force_update; /* Whether cached sizes should be ignored. */
+	links_t links;    /* Already seen files with multiple hard links. */
+
+	worker_t workers[MAX_WORKERS]; /* Workers. */
+	int nworkers;                  /* Number of started workers. */
+
+	int queued; /* Number of queued directories, updated atomically. */
+	int idle;   /* Number of sleeping workers, updated atomically. */
+	int stop;   /* Whether processing should be aborted, updated atomically. */
+
+	pthread_mutex_t lock;     /* Protects fields below. */
+	pthread_cond_t work_cond; /* Signals new directories and completion. */
+	pthread_cond_t done_cond; /* Signals completion. */
+	int done;                 /* Whether the root directory is processed. */
+	int failed;               /* Whether the root directory couldn't be read. */
+	uint64_t size;            /* Apparent size of the root directory. */
+	uint64_t alloc;           /* Allocated size of the root directory. */
+};
+
+static int init_du(du_t *du, int force_update);
+static void free_du(du_t *du);
+static void wait_for_workers(du_t *du, const cancellation_t *cancellation);
+static du_dir_t * alloc_dir(du_dir_t *parent, char *path, uint64_t inode);
+static void push_dir(worker_t *worker, du_dir_t *dir);
+static du_dir_t * take_dir(worker_t *worker);
+static int deque_push(deque_t *deque, du_dir_t *dir);
+static du_dir_t * deque_pop_back(deque_t *deque);
+static du_dir_t * deque_pop_front(deque_t *deque);
+static void * worker_thread(void *arg);
+static void process_dir(worker_t *worker, du_dir_t *dir);
+static void list_dir(worker_t *worker, du_dir_t *dir, uint64_t *size,
+		uint64_t *alloc);
+static uint64_t alloc_size_of(du_t *du, const struct stat *st);
+static int links_add(links_t *links, dev_t dev, ino_t ino);
+static int links_grow(links_t *links);
+static file_id_t * links_find(file_id_t slots[], size_t capacity, dev_t dev,
+		ino_t ino);
+static void finish_dir(du_t *du, du_dir_t *dir);
+static int is_stopped(du_t *du);
+
+int
+du_calc(const char path[], int force_update,
+		const cancellation_t *cancellation, uint64_t *size, uint64_t *alloc)
+{
+	du_t du;
+	if(init_du(&du, force_update) != 0)
+	{
+		return 1;
+	}
+
+	du_dir_t *const root = alloc_dir(NULL, strdup(path), DCACHE_UNKNOWN);
+	if(root == NULL)
+	{
+		free_du(&du);
+		return 1;
+	}
+
+	if(deque_push(&du.workers[0].deque, root) != 0)
+	{
+		free(root->path);
+		free(root);
+		free_du(&du);
+		return 1;
+	}
+	du.queued = 1;
+
+	int i;
+	for(i = 0; i < du.nworkers; ++i)
+	{
+		if(pthread_create(&du.workers[i].tid, NULL, &worker_thread,
+					&du.workers[i]) != 0)
+		{
+			break;
+		}
+	}
+	const int started = i;
+
+	if(started == 0)
+	{
+		(void)deque_pop_back(&du.workers[0].deque);
+		free(root->path);
+		free(root);
+		free_du(&du);
+		return 1;
+	}
+
+	wait_for_workers(&du, cancellation);
+
+	for(i = 0; i < started; ++i)
+	{
+		(void)pthread_join(du.workers[i].tid, NULL);
+	}
+
+	const int failed = (du.failed || du.stop);
+	*size = du.size;
+	*alloc = du.alloc;
+	free_du(&du);
+	return failed;
+}
+
+/* Initializes state of calculation.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+init_du(du_t *du, int force_update)
+{
+	*du = (du_t){ .force_update = force_update };
+
+	const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	du->nworkers = (ncpus < 1) ? 2 : MIN(ncpus*2, MAX_WORKERS);
+
+	if(pthread_mutex_init(&du->links.lock, NULL) != 0)
+	{
+		return 1;
+	}
+	if(pthread_mutex_init(&du->lock, NULL) != 0)
+	{
+		(void)pthread_mutex_destroy(&du->links.lock);
+		return 1;
+	}
+	if(pthread_cond_init(&du->work_cond, NULL) != 0)
+	{
+		(void)pthread_mutex_destroy(&du->lock);
+		(void)pthread_mutex_destroy(&du->links.lock);
+		return 1;
+	}
+	if(pthread_cond_init(&du->done_cond, NULL) != 0)
+	{
+		(void)pthread_cond_destroy(&du->work_cond);
+		(void)pthread_mutex_destroy(&du->lock);
+		(void)pthread_mutex_destroy(&du->links.lock);
+		return 1;
+	}
+
+	int i;
+	for(i = 0; i < du->nworkers; ++i)
+	{
+		du->workers[i].du = du;
+		du->workers[i].index = i;
+		if(pthread_mutex_init(&du->workers[i].deque.lock, NULL) != 0)
+		{
+			break;
+		}
+	}
+	du->nworkers = i;
+
+	if(du->nworkers == 0)
+	{
+		free_du(du);
+		return 1;
+	}
+	return 0;
+}
+
+/* Frees resources of calculation state, but not the structure itself. */
+static void
+free_du(du_t *du)
+{
+	int i;
+	for(i = 0; i < du->nworkers; ++i)
+	{
+		(void)pthread_mutex_destroy(&du->workers[i].deque.lock);
+		free(du->workers[i].deque.items);
+	}
+
+	(void)pthread_cond_destroy(&du->done_cond);
+	(void)pthread_cond_destroy(&du->work_cond);
+	(void)pthread_mutex_destroy(&du->lock);
+
+	(void)pthread_mutex_destroy(&du->links.lock);
+	free(du->links.slots);
+}
+
+/* Waits until the root directory is processed checking for cancellation
+ * meanwhile. */
+static void
+wait_for_workers(du_t *du, const cancellation_t *cancellation)
+{
+	if(pthread_mutex_lock(&du->lock) != 0)
+	{
+		return;
+	}
+
+	while(!du->done)
+	{
+		struct timespec deadline;
+		(void)clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += POLL_INTERVAL*1000000L;
+		if(deadline.tv_nsec >= 1000000000L)
+		{
+			++deadline.tv_sec;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		const int error =
+			pthread_cond_timedwait(&du->done_cond, &du->lock, &deadline);
+		if(error != 0 && error != ETIMEDOUT)
+		{
+			break;
+		}
+
+		if(!du->done && !is_stopped(du))
+		{
+			(void)pthread_mutex_unlock(&du->lock);
+			const int cancelled = cancellation_requested(cancellation);
+			if(pthread_mutex_lock(&du->lock) != 0)
+			{
+				return;
+			}
+
+			if(cancelled)
+			{
+				__atomic_store_n(&du->stop, 1, __ATOMIC_SEQ_CST);
+				(void)pthread_cond_broadcast(&du->work_cond);
+			}
+		}
+	}
+
+	(void)pthread_mutex_unlock(&du->lock);
+}
+
+/* Allocates directory description.  Takes ownership of the path.  Returns the
+ * directory or NULL on error. */
+static du_dir_t *
+alloc_dir(du_dir_t *parent, char *path, uint64_t inode)
+{
+	du_dir_t *const dir = (path == NULL ? NULL : calloc(1, sizeof(*dir)));
+	if(dir == NULL)
+	{
+		free(path);
+		return NULL;
+	}
+
+	dir->parent = parent;
+	dir->path = path;
+	dir->name = (parent == NULL ? path : strrchr(path, '/') + 1);
+	dir->fd = -1;
+	dir->inode = inode;
+	dir->pending = 1;
+	return dir;
+}
+
+/* Queues directory on worker's deque and wakes up a sleeping worker if there
+ * are any.  Directory that can't be queued is processed right away. */
+static void
+push_dir(worker_t *worker, du_dir_t *dir)
+{
+	du_t *const du = worker->du;
+
+	if(deque_push(&worker->deque, dir) != 0)
+	{
+		process_dir(worker, dir);
+		return;
+	}
+
+	(void)__atomic_add_fetch(&du->queued, 1, __ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&du->idle, __ATOMIC_SEQ_CST) != 0 &&
+			pthread_mutex_lock(&du->lock) == 0)
+	{
+		(void)pthread_cond_signal(&du->work_cond);
+		(void)pthread_mutex_unlock(&du->lock);
+	}
+}
+
+/* Takes next directory to process: newest one of own deque or the oldest one
+ * of some other worker.  Returns the directory or NULL if there is none. */
+static du_dir_t *
+take_dir(worker_t *worker)
+{
+	du_t *const du = worker->du;
+
+	du_dir_t *dir = deque_pop_back(&worker->deque);
+
+	int i;
+	for(i = 1; dir == NULL && i < du->nworkers; ++i)
+	{
+		worker_t *const victim = &du->workers[(worker->index + i)%du->nworkers];
+		dir = deque_pop_front(&victim->deque);
+	}
+
+	if(dir != NULL)
+	{
+		(void)__atomic_sub_fetch(&du->queued, 1, __ATOMIC_SEQ_CST);
+	}
+	return dir;
+}
+
+/* Appends directory to the back of the deque.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+deque_push(deque_t *deque, du_dir_t *dir)
+{
+	if(pthread_mutex_lock(&deque->lock) != 0)
+	{
+		return 1;
+	}
+
+	if(deque->count == deque->capacity)
+	{
+		const int new_capacity = (deque->capacity == 0 ? 64 : deque->capacity*2);
+		du_dir_t **items = reallocarray(NULL, new_capacity, sizeof(*items));
+		if(items == NULL)
+		{
+			(void)pthread_mutex_unlock(&deque->lock);
+			return 1;
+		}
+
+		int i;
+		for(i = 0; i < deque->count; ++i)
+		{
+			items[i] = deque->items[(deque->head + i)%deque->capacity];
+		}
+
+		free(deque->items);
+		deque->items = items;
+		deque->capacity = new_capacity;
+		deque->head = 0;
+	}
+
+	deque->items[(deque->head + deque->count)%deque->capacity] = dir;
+	++deque->count;
+
+	(void)pthread_mutex_unlock(&deque->lock);
+	return 0;
+}
+
+/* Removes directory from the back of the deque.  Returns the directory or NULL
+ * if the deque is empty. */
+static du_dir_t *
+deque_pop_back(deque_t *deque)
+{
+	du_dir_t *dir = NULL;
+	if(pthread_mutex_lock(&deque->lock) == 0)
+	{
+		if(deque->count != 0)
+		{
+			--deque->count;
+			dir = deque->items[(deque->head + deque->count)%deque->capacity];
+		}
+		(void)pthread_mutex_unlock(&deque->lock);
+	}
+	return dir;
+}
+
+/* Removes directory from the front of the deque.  Returns the directory or
+ * NULL if the deque is empty. */
+static du_dir_t *
+deque_pop_front(deque_t *deque)
+{
+	du_dir_t *dir = NULL;
+	if(pthread_mutex_lock(&deque->lock) == 0)
+	{
+		if(deque->count != 0)
+		{
+			dir = deque->items[deque->head];
+			deque->head = (deque->head + 1)%deque->capacity;
+			--deque->count;
+		}
+		(void)pthread_mutex_unlock(&deque->lock);
+	}
+	return dir;
+}
+
+/* Entry point of a worker thread.  Processes directories until the root one is
+ * finished.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	worker_t *const worker = arg;
+	du_t *const du = worker->du;
+
+	block_all_thread_signals();
+
+	while(1)
+	{
+		du_dir_t *const dir = take_dir(worker);
+		if(dir != NULL)
+		{
+			process_dir(worker, dir);
+			continue;
+		}
+
+		if(pthread_mutex_lock(&du->lock) != 0)
+		{
+			break;
+		}
+
+		(void)__atomic_add_fetch(&du->idle, 1, __ATOMIC_SEQ_CST);
+		while(!du->done && __atomic_load_n(&du->queued, __ATOMIC_SEQ_CST) == 0)
+		{
+			if(pthread_cond_wait(&du->work_cond, &du->lock) != 0)
+			{
+				break;
+			}
+		}
+		(void)__atomic_sub_fetch(&du->idle, 1, __ATOMIC_SEQ_CST);
+
+		const int done = du->done;
+		(void)pthread_mutex_unlock(&du->lock);
+
+		if(done)
+		{
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/* Sums up sizes of files of a directory and queues its subdirectories.
+ * Allocated size of a directory includes blocks of the directory itself. */
+static void
+process_dir(worker_t *worker, du_dir_t *dir)
+{
+	du_t *const du = worker->du;
+
+	if(!is_stopped(du))
+	{
+		const int parent_fd = (dir->parent == NULL ? AT_FDCWD : dir->parent->fd);
+		dir->fd = openat(parent_fd, dir->name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(dir->fd != -1)
+		{
+			uint64_t size, alloc;
+			list_dir(worker, dir, &size, &alloc);
+
+			struct stat st;
+			if(fstat(dir->fd, &st) == 0)
+			{
+				alloc += (uint64_t)st.st_blocks*BLOCK_SIZE;
+			}
+
+			(void)__atomic_add_fetch(&dir->size, size, __ATOMIC_SEQ_CST);
+			(void)__atomic_add_fetch(&dir->alloc, alloc, __ATOMIC_SEQ_CST);
+		}
+		else if(dir->parent == NULL)
+		{
+			du->failed = 1;
+		}
+	}
+
+	finish_dir(du, dir);
+}
+
+/* Queues subdirectories of a directory.  Sets *size and *alloc to apparent and
+ * allocated sizes of its files and of subdirectories whose size is known. */
+static void
+list_dir(worker_t *worker, du_dir_t *dir, uint64_t *size, uint64_t *alloc)
+{
+	du_t *const du = worker->du;
+
+	*size = 0U;
+	*alloc = 0U;
+
+	const int fd = dup(dir->fd);
+	DIR *const d = (fd == -1 ? NULL : fdopendir(fd));
+	if(d == NULL)
+	{
+		if(fd != -1)
+		{
+			(void)close(fd);
+		}
+		du->failed |= (dir->parent == NULL);
+		return;
+	}
+
+	size_t nentries = 0U;
+
+	struct dirent *entry;
+	while((entry = readdir(d)) != NULL)
+	{
+		if(is_builtin_dir(entry->d_name))
+		{
+			continue;
+		}
+
+		if(++nentries%STOP_CHECK_BATCH == 0U && is_stopped(du))
+		{
+			break;
+		}
+
+		struct stat st;
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+		/* Type of the entry is known, but its metadata is needed anyway. */
+		const int flags = (entry->d_type == DT_DIR ? 0 : AT_SYMLINK_NOFOLLOW);
+#else
+		const int flags = AT_SYMLINK_NOFOLLOW;
+#endif
+		if(fstatat(dir->fd, entry->d_name, &st, flags) != 0)
+		{
+			continue;
+		}
+
+		if(!S_ISDIR(st.st_mode))
+		{
+			*size += st.st_size;
+			*alloc += alloc_size_of(du, &st);
+			continue;
+		}
+
+		char *const path = join_paths(dir->path, entry->d_name);
+		if(path == NULL)
+		{
+			continue;
+		}
+
+		if(!du->force_update)
+		{
+			uint64_t dir_size, dir_alloc;
+			dcache_get_at(path, st.st_mtime, st.st_ino, &dir_size, &dir_alloc, NULL);
+			if(dir_size != DCACHE_UNKNOWN && dir_alloc != DCACHE_UNKNOWN)
+			{
+				*size += dir_size;
+				*alloc += dir_alloc;
+				free(path);
+				continue;
+			}
+		}
+
+		du_dir_t *const subdir = alloc_dir(dir, path, st.st_ino);
+		if(subdir != NULL)
+		{
+			(void)__atomic_add_fetch(&dir->pending, 1, __ATOMIC_SEQ_CST);
+			push_dir(worker, subdir);
+		}
+	}
+
+	(void)closedir(d);
+}
+
+/* Computes allocated size of a file which is not a directory.  Files with
+ * several hard links are accounted only once per calculation.  Returns the
+ * size. */
+static uint64_t
+alloc_size_of(du_t *du, const struct stat *st)
+{
+	const uint64_t alloc = (uint64_t)st->st_blocks*BLOCK_SIZE;
+	if(st->st_nlink <= 1)
+	{
+		return alloc;
+	}
+	return (links_add(&du->links, st->st_dev, st->st_ino) == 0 ? alloc : 0U);
+}
+
+/* Adds file identity to the set.  Returns zero if it wasn't there yet and
+ * non-zero if it was.  Errors are handled as if the file is new. */
+static int
+links_add(links_t *links, dev_t dev, ino_t ino)
+{
+	if(pthread_mutex_lock(&links->lock) != 0)
+	{
+		return 0;
+	}
+
+	int seen = 0;
+	/* Keep load factor under 3/4. */
+	if(links->count + 1U <= links->capacity/4U*3U || links_grow(links) == 0)
+	{
+		file_id_t *const slot = links_find(links->slots, links->capacity, dev,
+				ino);
+		seen = (slot->ino == ino && slot->dev == dev);
+		if(!seen)
+		{
+			slot->dev = dev;
+			slot->ino = ino;
+			++links->count;
+		}
+	}
+
+	(void)pthread_mutex_unlock(&links->lock);
+	return seen;
+}
+
+/* Doubles capacity of the set.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+links_grow(links_t *links)
+{
+	const size_t new_capacity = (links->capacity == 0U ? 256U
+	                                                   : links->capacity*2U);
+	file_id_t *const slots = calloc(new_capacity, sizeof(*slots));
+	if(slots == NULL)
+	{
+		return 1;
+	}
+
+	size_t i;
+	for(i = 0U; i < links->capacity; ++i)
+	{
+		const file_id_t *const id = &links->slots[i];
+		if(id->ino != 0 || id->dev != 0)
+		{
+			*links_find(slots, new_capacity, id->dev, id->ino) = *id;
+		}
+	}
+
+	free(links->slots);
+	links->slots = slots;
+	links->capacity = new_capacity;
+	return 0;
+}
+
+/* Looks up slot of the file identity or a free slot where it should go.
+ * Returns pointer to the slot. */
+static file_id_t *
+links_find(file_id_t slots[], size_t capacity, dev_t dev, ino_t ino)
+{
+	uint64_t hash = (uint64_t)ino*UINT64_C(0x9e3779b97f4a7c15) ^ (uint64_t)dev;
+	hash ^= hash >> 29;
+
+	size_t i = hash & (capacity - 1U);
+	while(slots[i].ino != 0 || slots[i].dev != 0)
+	{
+		if(slots[i].ino == ino && slots[i].dev == dev)
+		{
+			break;
+		}
+		i = (i + 1U) & (capacity - 1U);
+	}
+	return &slots[i];
+}
+
+/* Marks directory as listed or one of its subdirectories as finished.  Caches
+ * sizes of directories which have no unfinished subdirectories left and adds
+ * them to sizes of their parents. */
+static void
+finish_dir(du_t *du, du_dir_t *dir)
+{
+	while(dir != NULL)
+	{
+		if(__atomic_sub_fetch(&dir->pending, 1, __ATOMIC_SEQ_CST) != 0)
+		{
+			return;
+		}
+
+		if(dir->fd != -1)
+		{
+			(void)close(dir->fd);
+		}
+
+		const uint64_t size = __atomic_load_n(&dir->size, __ATOMIC_SEQ_CST);
+		const uint64_t alloc = __atomic_load_n(&dir->alloc, __ATOMIC_SEQ_CST);
+		du_dir_t *const parent = dir->parent;
+
+		if(parent == NULL)
+		{
+			if(pthread_mutex_lock(&du->lock) == 0)
+			{
+				du->size = size;
+				du->alloc = alloc;
+				du->done = 1;
+				(void)pthread_cond_broadcast(&du->work_cond);
+				(void)pthread_cond_signal(&du->done_cond);
+				(void)pthread_mutex_unlock(&du->lock);
+			}
+		}
+		else
+		{
+			/* Size of partially processed directory isn't worth caching. */
+			if(dir->fd != -1 && !is_stopped(du))
+			{
+				(void)dcache_set_at(dir->path, dir->inode, size, alloc,
+						DCACHE_UNKNOWN);
+			}
+			(void)__atomic_add_fetch(&parent->size, size, __ATOMIC_SEQ_CST);
+			(void)__atomic_add_fetch(&parent->alloc, alloc, __ATOMIC_SEQ_CST);
+		}
+
+		free(dir->path);
+		free(dir);
+		dir = parent;
+	}
+}
+
+/* Checks whether calculation is being aborted.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+is_stopped(du_t *du)
+{
+	return __atomic_load_n(&du->stop, __ATOMIC_SEQ_CST);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
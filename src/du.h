@@ -0,0 +1,43 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__DU_H__
+#define VIFM__DU_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* du - parallel calculation of directory sizes (not available on Windows) */
+
+struct cancellation_t;
+
+/* Calculates recursive apparent (*size) and allocated (*alloc) sizes of a
+ * directory by traversing it with a pool of threads that balance work by
+ * stealing directories from each other.  Allocated size counts each file with
+ * multiple hard links only once.  Sizes of all subdirectories are put into
+ * dcache, which is also consulted for them unless force_update is set.  Sizes
+ * of the directory itself aren't cached.  Cancellation is checked only by the
+ * calling thread.  Returns zero on success and non-zero on error or
+ * cancellation. */
+int du_calc(const char path[], int force_update,
+		const struct cancellation_t *cancellation, uint64_t *size,
+		uint64_t *alloc);
+
+#endif /* VIFM__DU_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -85,6 +85,7 @@
 #include "running.h"
 #include "sort.h"
 #include "status.h"
+#include "tree_scan.h"
 #include "types.h"
 
 /* State of a fold. */
@@ -104,11 +105,17 @@ static void reset_view(view_t *view);
 static void init_view_history(view_t *view);
 static int navigate_to_file_in_custom_view(view_t *view, const char dir[],
 		const char file[]);
+static dir_entry_t * custom_add_by_stat(view_t *view, const char path[],
+		const struct stat *s);
+static dir_entry_t * entry_list_add_by_stat(view_t *view, dir_entry_t **list,
+		int *list_size, const char path[], const struct stat *s);
 static int fill_dir_entry_by_path(dir_entry_t *entry, const char path[]);
 static void on_custom_view_leave(view_t *view);
 #ifndef _WIN32
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
 		const struct dirent *d);
+static int fill_dir_entry_by_stat(dir_entry_t *entry, const char path[],
+		const struct stat *s, const struct dirent *d);
 static int data_is_dir_entry(const struct dirent *d, const char path[]);
 #else
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
@@ -126,7 +133,8 @@ static int got_excluded(view_t *view, const dir_entry_t *entry, void *arg);
 static int exclude_temporary_entries(view_t *view);
 static int is_temporary(view_t *view, const dir_entry_t *entry, void *arg);
 static void flist_custom_drop_save(view_t *view);
-static uint64_t recalc_entry_size(const dir_entry_t *entry, uint64_t old_size);
+static uint64_t recalc_entry_size(const dir_entry_t *entry, uint64_t old_size,
+		uint64_t old_alloc);
 static uint64_t entry_calc_nitems(const dir_entry_t *entry);
 static void load_dir_list_internal(view_t *view, int reload, int draw_only);
 static int populate_dir_list_internal(view_t *view, int reload);
@@ -163,9 +171,16 @@ static int rescue_from_empty_filelist(view_t *view);
 static void add_parent_entry(view_t *view, dir_entry_t **entries, int *count);
 static void init_dir_entry(view_t *view, dir_entry_t *entry, const char name[]);
 static dir_entry_t * alloc_dir_entry(dir_entry_t **list, int list_size);
+static int update_tree(view_t *view, strlist_t *changed_dirs);
+static int watch_tree_dirs(view_t *view);
+static int refresh_changed_dirs(view_t *view, const strlist_t *changed_dirs);
+static int refresh_child_entries(view_t *view, dir_entry_t *entry);
 static int tree_has_changed(const dir_entry_t *entries, size_t nchildren);
-static FSWatchState poll_watcher(fswatch_t *watch, const char path[]);
+static FSWatchState poll_watcher(fswatch_t *watch, const char path[],
+		strlist_t *changed_dirs);
 static void remove_child_entries(view_t *view, dir_entry_t *entry);
+static int insert_child_entries(view_t *view, dir_entry_t *entry);
+static void add_tree_filtered(view_t *view, dir_entry_t *entry, int delta);
 static void find_dir_in_cdpath(const char base_dir[], const char dst[],
 		char buf[], size_t buf_size);
 static entries_t list_sibling_dirs(view_t *view);
@@ -176,6 +191,8 @@ static dir_entry_t * pick_sibling(view_t *view, entries_t parent_dirs,
 static int iter_entries(view_t *view, dir_entry_t **entry, entry_predicate pred,
 		int valid_only);
 static int mark_selected(view_t *view);
+static int unfold_matching(view_t *view, const char path[], int loaded,
+		file_predicate pred, void *arg, int *nunfolded);
 static int set_position_by_path(view_t *view, const char path[]);
 static int flist_load_tree_internal(view_t *view, const char path[], int reload,
 		int depth);
@@ -188,7 +205,13 @@ static void reset_entry_list(view_t *view, dir_entry_t **entries, int *count);
 static void drop_tops(dir_entry_t *entries, int *nentries, int extra);
 static int add_files_recursively(view_t *view, const char path[],
 		trie_t *excluded_paths, trie_t *folded_paths, int parent_pos,
-		int no_direct_parent, int depth);
+		int no_direct_parent, int depth, tree_scan_t *ts, tree_scan_job_t *job);
+static void drop_tree_jobs(tree_scan_t *ts, tree_scan_job_t *jobs[],
+		int count);
+static int tree_will_descend(trie_t *folded_paths, const char full_path[],
+		FoldState parent_fold, int depth);
+static dir_entry_t * tree_add_entry(view_t *view, const char path[],
+		const tree_scan_entry_t *entry);
 static FoldState get_fold_state(trie_t *folded_paths, const char full_path[]);
 static int set_fold_state(trie_t *folded_paths, const char full_path[],
 		FoldState state);
@@ -865,6 +888,15 @@ flist_custom_start(view_t *view, const char title[])
 
 dir_entry_t *
 flist_custom_add(view_t *view, const char path[])
+{
+	return custom_add_by_stat(view, path, NULL);
+}
+
+/* Same as flist_custom_add(), but can reuse lstat() information about the file
+ * (s can be NULL and is ignored on Windows).  Returns the entry or NULL on
+ * error. */
+static dir_entry_t *
+custom_add_by_stat(view_t *view, const char path[], const struct stat *s)
 {
 	char canonic_path[PATH_MAX + 1];
 	to_canonic_path(path, flist_get_dir(view), canonic_path,
@@ -876,8 +908,8 @@ flist_custom_add(view_t *view, const char path[])
 		return NULL;
 	}
 
-	return entry_list_add(view, &view->custom.entries, &view->custom.entry_count,
-			canonic_path);
+	return entry_list_add_by_stat(view, &view->custom.entries,
+			&view->custom.entry_count, canonic_path, s);
 }
 
 dir_entry_t *
@@ -940,7 +972,17 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 		return 1;
 	}
 
-	entry->type = get_type_from_mode(s.st_mode);
+	return fill_dir_entry_by_stat(entry, path, &s, d);
+}
+
+/* Fills fields of the entry from lstat() information about the file specified
+ * by its path.  d is optional source of file type.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+fill_dir_entry_by_stat(dir_entry_t *entry, const char path[],
+		const struct stat *s, const struct dirent *d)
+{
+	entry->type = get_type_from_mode(s->st_mode);
 	if(entry->type == FT_UNK)
 	{
 		entry->type = (d == NULL) ? FT_UNK : type_from_dir_entry(d, path);
@@ -951,28 +993,30 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 		return 1;
 	}
 
-	entry->size = (uintmax_t)s.st_size;
-	entry->uid = s.st_uid;
-	entry->gid = s.st_gid;
-	entry->mode = s.st_mode;
-	entry->inode = s.st_ino;
-	entry->mtime = s.st_mtime;
-	entry->atime = s.st_atime;
-	entry->ctime = s.st_ctime;
-	entry->nlinks = s.st_nlink;
+	entry->size = (uintmax_t)s->st_size;
+	/* st_blocks is in units of 512 bytes regardless of block size. */
+	entry->alloc_size = (uint64_t)s->st_blocks*512U;
+	entry->uid = s->st_uid;
+	entry->gid = s->st_gid;
+	entry->mode = s->st_mode;
+	entry->inode = s->st_ino;
+	entry->mtime = s->st_mtime;
+	entry->atime = s->st_atime;
+	entry->ctime = s->st_ctime;
+	entry->nlinks = s->st_nlink;
 
 	if(entry->type == FT_LINK)
 	{
-		struct stat s;
+		struct stat target;
 
 		const SymLinkType symlink_type = get_symlink_type(path);
 		entry->dir_link = (symlink_type != SLT_UNKNOWN);
 		entry->slow_target = (symlink_type == SLT_SLOW);
 
 		/* Query mode of symbolic link target. */
-		if(!entry->slow_target && os_stat(entry->name, &s) == 0)
+		if(!entry->slow_target && os_stat(entry->name, &target) == 0)
 		{
-			entry->mode = s.st_mode;
+			entry->mode = target.st_mode;
 		}
 	}
 
@@ -1051,6 +1095,7 @@ fill_dir_entry(dir_entry_t *entry, const char path[],
 		entry->type = FT_REG;
 	}
 
+	entry->alloc_size = entry->size;
 	return 0;
 }
 
@@ -1410,6 +1455,7 @@ flist_custom_clone(view_t *to, const view_t *from, int as_tree)
 			 * some tree-specific code is driven directly by these fields. */
 			dst[j].child_count = 0;
 			dst[j].child_pos = 0;
+			dst[j].child_filtered = 0;
 			dst[j].folded = 0;
 		}
 
@@ -1596,20 +1642,23 @@ fentry_get_dir_info(const view_t *view, const dir_entry_t *entry,
 		uint64_t *size, uint64_t *nitems)
 {
 	const int is_slow_fs = view->on_slow_fs || entry->slow_target;
-	dcache_result_t size_res, nitems_res;
+	dcache_result_t size_res, alloc_res, nitems_res;
 
 	assert((size != NULL || nitems != NULL) &&
 			"At least one of out parameters has to be non-NULL.");
 
 	dcache_get_of(entry, (size == NULL ? NULL : &size_res),
+			(size == NULL ? NULL : &alloc_res),
 			(nitems == NULL ? NULL : &nitems_res));
 
 	if(size != NULL)
 	{
-		*size = size_res.value;
-		if(size_res.value != DCACHE_UNKNOWN && !size_res.is_valid && !is_slow_fs)
+		const dcache_result_t *const res = (cfg.disk_usage ? &alloc_res
+		                                                   : &size_res);
+		*size = res->value;
+		if(res->value != DCACHE_UNKNOWN && !res->is_valid && !is_slow_fs)
 		{
-			*size = recalc_entry_size(entry, size_res.value);
+			*size = recalc_entry_size(entry, size_res.value, alloc_res.value);
 		}
 	}
 
@@ -1624,20 +1673,24 @@ fentry_get_dir_info(const view_t *view, const dir_entry_t *entry,
 	}
 }
 
-/* Updates cached size of a directory also updating its relevant parents.
- * Returns current size of the directory entry. */
+/* Updates cached sizes of a directory also updating its relevant parents.
+ * Unknown old sizes are treated as zeroes.  Returns current size of the
+ * directory entry according to 'diskusage'. */
 static uint64_t
-recalc_entry_size(const dir_entry_t *entry, uint64_t old_size)
+recalc_entry_size(const dir_entry_t *entry, uint64_t old_size,
+		uint64_t old_alloc)
 {
-	uint64_t size;
+	uint64_t size, alloc;
 
 	char full_path[PATH_MAX + 1];
 	get_full_path_of(entry, sizeof(full_path), full_path);
 
-	size = fops_dir_size(full_path, 0, &ui_cancellation_info);
-	dcache_update_parent_sizes(full_path, size - old_size);
+	fops_dir_sizes(full_path, 0, &ui_cancellation_info, &size, &alloc);
+	dcache_update_parent_sizes(full_path,
+			size - (old_size == DCACHE_UNKNOWN ? 0U : old_size),
+			alloc - (old_alloc == DCACHE_UNKNOWN ? 0U : old_alloc));
 
-	return size;
+	return (cfg.disk_usage ? alloc : size);
 }
 
 /* Calculates number of items at path specified by the entry.  No check for file
@@ -1651,7 +1704,7 @@ entry_calc_nitems(const dir_entry_t *entry)
 	uint64_t ret = count_dir_items(full_path);
 
 	uint64_t inode = get_true_inode(entry);
-	dcache_set_at(full_path, inode, DCACHE_UNKNOWN, ret);
+	dcache_set_at(full_path, inode, DCACHE_UNKNOWN, DCACHE_UNKNOWN, ret);
 
 	return ret;
 }
@@ -1751,7 +1804,7 @@ populate_dir_list_internal(view_t *view, int reload)
 			stroscmp(view->watched_dir, view->curr_dir) == 0)
 	{
 		/* Drain all events that happened before this point. */
-		(void)poll_watcher(view->watch, view->curr_dir);
+		(void)poll_watcher(view->watch, view->curr_dir, NULL);
 	}
 
 	if(is_unc_root(view->curr_dir))
@@ -2064,6 +2117,16 @@ update_dir_watcher(view_t *view)
 		{
 			replace_string(&view->watched_dir, curr_dir);
 		}
+		view->tree_watch_outdated = 1;
+		view->tree_watched = 0;
+	}
+	else if(view->tree_watched &&
+			!(flist_custom_active(view) && cv_tree(view->custom.type)))
+	{
+		/* Directories of a tree are of no interest after leaving it. */
+		(void)fswatch_set_dirs(view->watch, NULL, 0);
+		view->tree_watch_outdated = 1;
+		view->tree_watched = 0;
 	}
 }
 
@@ -2656,6 +2719,7 @@ init_dir_entry(view_t *view, dir_entry_t *entry, const char name[])
 	entry->origin = &view->curr_dir[0];
 
 	entry->size = 0ULL;
+	entry->alloc_size = 0ULL;
 #ifndef _WIN32
 	entry->uid = (uid_t)-1;
 	entry->gid = (gid_t)-1;
@@ -2678,6 +2742,7 @@ init_dir_entry(view_t *view, dir_entry_t *entry, const char name[])
 
 	entry->child_count = 0;
 	entry->child_pos = 0;
+	entry->child_filtered = 0;
 
 	/* All files start as unselected, unmatched and unmarked. */
 	entry->selected = 0;
@@ -2773,6 +2838,16 @@ add_dir_entry(dir_entry_t **list, size_t *list_size, const dir_entry_t *entry)
 dir_entry_t *
 entry_list_add(view_t *view, dir_entry_t **list, int *list_size,
 		const char path[])
+{
+	return entry_list_add_by_stat(view, list, list_size, path, NULL);
+}
+
+/* Same as entry_list_add(), but can reuse lstat() information about the file
+ * (s can be NULL and is ignored on Windows).  Returns the entry or NULL on
+ * error. */
+static dir_entry_t *
+entry_list_add_by_stat(view_t *view, dir_entry_t **list, int *list_size,
+		const char path[], const struct stat *s)
 {
 	dir_entry_t *const dir_entry = alloc_dir_entry(list, *list_size);
 	if(dir_entry == NULL)
@@ -2786,7 +2861,15 @@ entry_list_add(view_t *view, dir_entry_t **list, int *list_size,
 	dir_entry->owns_origin = 1;
 	remove_last_path_component(dir_entry->origin);
 
-	if(fill_dir_entry_by_path(dir_entry, path) != 0)
+#ifndef _WIN32
+	const int failed = (s == NULL)
+	                 ? fill_dir_entry_by_path(dir_entry, path)
+	                 : fill_dir_entry_by_stat(dir_entry, path, s, NULL);
+#else
+	(void)s;
+	const int failed = fill_dir_entry_by_path(dir_entry, path);
+#endif
+	if(failed)
 	{
 		fentry_free(dir_entry);
 		return NULL;
@@ -2816,6 +2899,7 @@ check_if_filelist_has_changed(view_t *view)
 {
 	int failed, changed;
 	const char *const curr_dir = flist_get_dir(view);
+	strlist_t changed_dirs = {};
 
 	if(view->on_slow_fs ||
 			(flist_custom_active(view) && !cv_tree(view->custom.type)) ||
@@ -2834,7 +2918,7 @@ check_if_filelist_has_changed(view_t *view)
 	}
 	else
 	{
-		FSWatchState state = poll_watcher(view->watch, curr_dir);
+		FSWatchState state = poll_watcher(view->watch, curr_dir, &changed_dirs);
 		changed = (state != FSWS_UNCHANGED);
 		failed = (state == FSWS_ERRORED);
 	}
@@ -2855,6 +2939,7 @@ check_if_filelist_has_changed(view_t *view)
 		(void)change_directory(view, curr_dir);
 		flist_sel_stash(view);
 		ui_view_schedule_reload(view);
+		free_string_array(changed_dirs.items, changed_dirs.nitems);
 		return;
 	}
 
@@ -2864,8 +2949,7 @@ check_if_filelist_has_changed(view_t *view)
 	}
 	else if(flist_custom_active(view) && cv_tree(view->custom.type))
 	{
-		if(flist_is_fs_backed(view) &&
-				tree_has_changed(view->dir_entry, view->list_rows))
+		if(flist_is_fs_backed(view) && update_tree(view, &changed_dirs) != 0)
 		{
 			ui_view_schedule_reload(view);
 		}
@@ -2878,6 +2962,167 @@ check_if_filelist_has_changed(view_t *view)
 			ui_view_schedule_redraw(view);
 		}
 	}
+
+	free_string_array(changed_dirs.items, changed_dirs.nitems);
+}
+
+/* Brings tree view in sync with file system by updating changed directories.
+ * Returns non-zero if the tree needs a reload, otherwise zero is returned. */
+static int
+update_tree(view_t *view, strlist_t *changed_dirs)
+{
+	if(view->tree_watched && refresh_changed_dirs(view, changed_dirs) != 0)
+	{
+		return 1;
+	}
+
+	if(!view->tree_watch_outdated)
+	{
+		return (view->tree_watched ? 0
+		                           : tree_has_changed(view->dir_entry,
+		                                              view->list_rows));
+	}
+
+	view->tree_watch_outdated = 0;
+	view->tree_watched = (watch_tree_dirs(view) == 0);
+
+	/* Changes that happened before directories got watched are found by
+	 * polling. */
+	return tree_has_changed(view->dir_entry, view->list_rows);
+}
+
+/* Passes unfolded directories of a tree view to the monitor of the view.
+ * Returns zero if all of them are watched, otherwise non-zero is returned and
+ * none of them is watched. */
+static int
+watch_tree_dirs(view_t *view)
+{
+	if(view->watch == NULL)
+	{
+		return 1;
+	}
+
+	strlist_t dirs = {};
+
+	int i;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		const dir_entry_t *const entry = &view->dir_entry[i];
+		if(entry->type == FT_DIR && !entry->folded && !is_parent_dir(entry->name))
+		{
+			char full_path[PATH_MAX + 1];
+			get_full_path_of(entry, sizeof(full_path), full_path);
+			dirs.nitems = add_to_string_array(&dirs.items, dirs.nitems, full_path);
+		}
+	}
+
+	int error = fswatch_set_dirs(view->watch, dirs.items, dirs.nitems);
+	if(error)
+	{
+		/* Partial set of watches is of no use, so release them. */
+		(void)fswatch_set_dirs(view->watch, NULL, 0);
+	}
+
+	free_string_array(dirs.items, dirs.nitems);
+	return error;
+}
+
+/* Re-lists contents of directories of a tree view that have changed.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+refresh_changed_dirs(view_t *view, const strlist_t *changed_dirs)
+{
+	int i;
+	for(i = 0; i < changed_dirs->nitems; ++i)
+	{
+		const char *const path = changed_dirs->items[i];
+
+		/* Re-listing of a directory takes care of its subdirectories. */
+		int j;
+		for(j = 0; j < changed_dirs->nitems; ++j)
+		{
+			if(j != i && path_starts_with(path, changed_dirs->items[j]) &&
+					!paths_are_equal(path, changed_dirs->items[j]))
+			{
+				break;
+			}
+		}
+		if(j != changed_dirs->nitems)
+		{
+			continue;
+		}
+
+		dir_entry_t *const entry = entry_from_path(view, view->dir_entry,
+				view->list_rows, path);
+		/* Directory that's not in the tree or is folded will be handled via its
+		 * parent if it matters. */
+		if(entry == NULL || entry->type != FT_DIR || entry->folded)
+		{
+			continue;
+		}
+
+		if(refresh_child_entries(view, entry) != 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Replaces children of an unfolded directory of a tree view with new listing
+ * of the directory preserving selection and cursor position.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+refresh_child_entries(view_t *view, dir_entry_t *entry)
+{
+	char cursor_path[PATH_MAX + 1];
+	get_current_full_path(view, sizeof(cursor_path), cursor_path);
+
+	trie_t *const selected = trie_create(/*free_func=*/NULL);
+	int nselected = 0;
+
+	int i;
+	for(i = 1; i <= entry->child_count; ++i)
+	{
+		if(entry[i].selected)
+		{
+			char full_path[PATH_MAX + 1];
+			get_full_path_of(&entry[i], sizeof(full_path), full_path);
+			(void)trie_put(selected, full_path);
+			++nselected;
+		}
+	}
+	view->selected_files -= nselected;
+
+	const int pos = entry - view->dir_entry;
+
+	add_tree_filtered(view, entry, -entry->child_filtered);
+	remove_child_entries(view, entry);
+	int error = insert_child_entries(view, &view->dir_entry[pos]);
+
+	for(i = 0; i < view->list_rows && nselected != 0; ++i)
+	{
+		dir_entry_t *const e = &view->dir_entry[i];
+		char full_path[PATH_MAX + 1];
+		void *dummy;
+
+		get_full_path_of(e, sizeof(full_path), full_path);
+		if(!e->selected && trie_get(selected, full_path, &dummy) == 0)
+		{
+			e->selected = 1;
+			++view->selected_files;
+			--nselected;
+		}
+	}
+	trie_free(selected);
+
+	if(set_position_by_path(view, cursor_path) != 0)
+	{
+		view->list_pos = MIN(pos, view->list_rows - 1);
+	}
+
+	return error;
 }
 
 /* Checks whether tree-view needs a reload (any of subdirectories were changed).
@@ -2939,7 +3184,7 @@ flist_update_cache(view_t *view, cached_entries_t *cache, const char path[])
 		update = 1;
 	}
 
-	if(poll_watcher(cache->watch, path) != FSWS_UNCHANGED || update)
+	if(poll_watcher(cache->watch, path, NULL) != FSWS_UNCHANGED || update)
 	{
 		free_dir_entries(&cache->entries.entries, &cache->entries.nentries);
 		cache->entries = flist_list_in(view, path, 0, 1);
@@ -2952,9 +3197,9 @@ flist_update_cache(view_t *view, cached_entries_t *cache, const char path[])
 /* Polls file-system watcher and re-enters current working directory of the
  * process if necessary.  Returns watcher's state. */
 static FSWatchState
-poll_watcher(fswatch_t *watch, const char path[])
+poll_watcher(fswatch_t *watch, const char path[], strlist_t *changed_dirs)
 {
-	FSWatchState state = fswatch_poll(watch);
+	FSWatchState state = fswatch_poll_dirs(watch, changed_dirs);
 
 	if(state == FSWS_ERRORED || state == FSWS_REPLACED)
 	{
@@ -3031,8 +3276,11 @@ flist_toggle_fold(view_t *view)
 	{
 		curr->folded = !curr->folded;
 		/* We reload even on folding to update number of filtered entries
-		 * properly. */
-		ui_view_schedule_reload(view);
+		 * properly.  Unfolding can be done by listing just the directory. */
+		if(curr->folded || insert_child_entries(view, curr) != 0)
+		{
+			ui_view_schedule_reload(view);
+		}
 	}
 }
 
@@ -3058,6 +3306,111 @@ remove_child_entries(view_t *view, dir_entry_t *entry)
 			sizeof(*entry)*(view->list_rows - (pos + 1 + child_count)));
 	view->list_rows -= child_count;
 	entry->child_count = 0;
+	entry->child_filtered = 0;
+}
+
+/* Adjusts number of filtered out entries of a tree view and of all unfolded
+ * directories that contain the entry. */
+static void
+add_tree_filtered(view_t *view, dir_entry_t *entry, int delta)
+{
+	view->filtered += delta;
+	entry->child_filtered += delta;
+	while(entry->child_pos != 0)
+	{
+		entry -= entry->child_pos;
+		entry->child_filtered += delta;
+	}
+}
+
+/* Unfolds a single entry of a tree view by listing its directory and inserting
+ * the result after the entry, so that size of the rest of the tree doesn't
+ * matter.  Returns zero on success, otherwise non-zero is returned and the list
+ * is left unchanged. */
+static int
+insert_child_entries(view_t *view, dir_entry_t *entry)
+{
+	if(view->custom.type != CV_TREE || entry->child_count != 0 ||
+			view->custom.entry_count != 0 || view->custom.paths_cache != NULL)
+	{
+		return 1;
+	}
+
+	char full_path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(full_path), full_path);
+
+	/* Children are collected into the list which is otherwise used only while
+	 * building a custom view. */
+	view->custom.paths_cache = trie_create(/*free_func=*/NULL);
+
+	ui_cancellation_push_on();
+	tree_scan_t *const ts = tree_scan_alloc();
+	int nfiltered = add_files_recursively(view, full_path,
+			view->custom.excluded_paths, view->custom.folded_paths, -1, 0, INT_MAX,
+			ts, NULL);
+	tree_scan_free(ts);
+	if(nfiltered >= 0 && view->custom.entry_count == 0 &&
+			(cfg.dot_dirs & DD_TREE_LEAFS_PARENT))
+	{
+		if(add_directory_leaf(view, full_path, -1) != 0)
+		{
+			nfiltered = -1;
+		}
+	}
+	if(ui_cancellation_requested())
+	{
+		nfiltered = -1;
+	}
+	ui_cancellation_pop();
+
+	ui_sb_quick_msg_clear();
+
+	trie_free(view->custom.paths_cache);
+	view->custom.paths_cache = NULL;
+
+	dir_entry_t *children = view->custom.entries;
+	int nchildren = view->custom.entry_count;
+	view->custom.entries = NULL;
+	view->custom.entry_count = 0;
+
+	const int pos = entry - view->dir_entry;
+	dir_entry_t *const entries = (nfiltered < 0)
+	                           ? NULL
+	                           : dynarray_extend(view->dir_entry,
+	                                             sizeof(*children)*nchildren);
+	if(entries == NULL)
+	{
+		free_dir_entries(&children, &nchildren);
+		return 1;
+	}
+	view->dir_entry = entries;
+
+	int i;
+	for(i = 0; i < nchildren; ++i)
+	{
+		/* Top-level entries of the listing are children of the entry. */
+		if(children[i].child_pos == 0)
+		{
+			children[i].child_pos = 1 + i;
+		}
+	}
+
+	fix_tree_links(entries, &entries[pos], pos, pos, 0, nchildren);
+
+	memmove(&entries[pos + 1 + nchildren], &entries[pos + 1],
+			sizeof(*entries)*(view->list_rows - (pos + 1)));
+	memcpy(&entries[pos + 1], children, sizeof(*children)*nchildren);
+	dynarray_free(children);
+
+	view->list_rows += nchildren;
+	entries[pos].child_count = nchildren;
+	add_tree_filtered(view, &entries[pos], nfiltered);
+	view->tree_watch_outdated = 1;
+
+	sort_dir_list(0, view);
+	fview_list_updated(view);
+	ui_view_schedule_redraw(view);
+	return 0;
 }
 
 int
@@ -3514,7 +3867,11 @@ fentry_get_size(const view_t *view, const dir_entry_t *entry)
 		fentry_get_dir_info(view, entry, &size, NULL);
 	}
 
-	return (size == DCACHE_UNKNOWN ? entry->size : size);
+	if(size == DCACHE_UNKNOWN)
+	{
+		size = (cfg.disk_usage ? entry->alloc_size : entry->size);
+	}
+	return size;
 }
 
 int
@@ -3954,6 +4311,7 @@ flist_load_tree(view_t *view, const char path[], int depth)
 	{
 		return 1;
 	}
+	view->custom.lazy = 0;
 
 	if(full_path[0] != '\0')
 	{
@@ -3964,6 +4322,108 @@ flist_load_tree(view_t *view, const char path[], int depth)
 	return 0;
 }
 
+int
+flist_load_lazy_tree(view_t *view, const char path[])
+{
+	if(flist_load_tree(view, path, 0) != 0)
+	{
+		return 1;
+	}
+
+	view->custom.lazy = 1;
+	return 0;
+}
+
+int
+flist_tree_unfold_matching(view_t *view, file_predicate pred, void *arg)
+{
+	if(!flist_custom_active(view) || view->custom.type != CV_TREE ||
+			!view->custom.lazy)
+	{
+		return 0;
+	}
+
+	int nunfolded = 0;
+
+	show_progress("Looking into folds...", 0);
+	ui_cancellation_push_on();
+	(void)unfold_matching(view, flist_get_dir(view), 1, pred, arg, &nunfolded);
+	ui_cancellation_pop();
+	ui_sb_quick_msg_clear();
+
+	return nunfolded;
+}
+
+/* Looks for files for which the predicate holds inside of a directory at path
+ * and opens folds that weren't loaded on the way to them.  The loaded parameter
+ * specifies whether entries of the directory are part of the tree.  Returns
+ * non-zero if there was at least one match. */
+static int
+unfold_matching(view_t *view, const char path[], int loaded,
+		file_predicate pred, void *arg, int *nunfolded)
+{
+	tree_scan_list_t lst;
+	tree_scan_list(path, &lst);
+	if(lst.count < 0)
+	{
+		return 0;
+	}
+
+	trie_t *const folded_paths = view->custom.folded_paths;
+	const FoldState parent_fold = get_fold_state(folded_paths, path);
+
+	int found = 0;
+	int i;
+	for(i = 0; i < lst.count && !ui_cancellation_requested(); ++i)
+	{
+		const tree_scan_entry_t *const e = &lst.entries[i];
+		char full_path[PATH_MAX + 1];
+		void *dummy;
+
+		snprintf(full_path, sizeof(full_path), "%s/%s", path, e->name);
+		if(trie_get(view->custom.excluded_paths, full_path, &dummy) == 0 ||
+				!tree_candidate_is_visible(view, path, e->name, e->is_dir, 0))
+		{
+			continue;
+		}
+
+		if(pred(path, e->name, e->is_dir, arg))
+		{
+			found = 1;
+		}
+
+		if(!e->is_dir || e->is_link)
+		{
+			continue;
+		}
+
+		/* Folds closed by the user are left alone. */
+		const FoldState state = get_fold_state(folded_paths, full_path);
+		if(state == FOLD_USER_CLOSED)
+		{
+			continue;
+		}
+
+		const int child_loaded = loaded && state != FOLD_AUTO_CLOSED
+		                      && !(state == FOLD_UNDEFINED &&
+		                           parent_fold == FOLD_AUTO_OPENED);
+		if(unfold_matching(view, full_path, child_loaded, pred, arg, nunfolded))
+		{
+			found = 1;
+			if(!child_loaded &&
+					set_fold_state(folded_paths, full_path, FOLD_AUTO_OPENED))
+			{
+				++*nunfolded;
+			}
+		}
+
+		show_progress("Looking into folds...", 1000);
+	}
+
+	tree_scan_free_list(&lst);
+	return found;
+}
+
 /* Looks up entry by its path in main entry list of the view and updates cursor
  * position when such entry is found.  Returns zero if position was updated,
  * otherwise non-zero is returned. */
@@ -4003,6 +4463,7 @@ flist_clone_tree(view_t *to, const view_t *from)
 
 	trie_free(to->custom.folded_paths);
 	to->custom.folded_paths = trie_clone(from->custom.folded_paths);
+	to->custom.lazy = from->custom.lazy;
 
 	return 0;
 }
@@ -4063,8 +4524,10 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths,
 	}
 	else
 	{
+		tree_scan_t *const ts = tree_scan_alloc();
 		nfiltered = add_files_recursively(view, path, excluded_paths, folded_paths,
-				-1, 0, depth);
+				-1, 0, depth, ts, NULL);
+		tree_scan_free(ts);
 		type = CV_TREE;
 	}
 	ui_cancellation_pop();
@@ -4090,6 +4553,7 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths,
 		return 1;
 	}
 	view->filtered = nfiltered;
+	view->tree_watch_outdated = 1;
 
 	replace_string(&view->custom.orig_dir, canonic_path);
 
@@ -4167,6 +4631,7 @@ complete_tree(const char name[], int valid, const void *parent_data, void *data,
 	{
 		*dir_entry = **(dir_entry_t **)data;
 		dir_entry->child_count = 0;
+		dir_entry->child_filtered = 0;
 		(*(dir_entry_t **)data)->name = NULL;
 		(*(dir_entry_t **)data)->origin = NULL;
 	}
@@ -4261,31 +4726,89 @@ drop_tops(dir_entry_t *entries, int *nentries, int extra)
 /* Adds custom view entries corresponding to file system tree.  parent_pos is
  * expected to be negative for the outermost invocation.  The depth parameter
  * is used to limit nesting level, when it's negative, parent node is just
- * marked as folded.  Returns number of filtered out files on success or partial
- * success and negative value on serious error. */
+ * marked as folded.  Listings of subdirectories are scheduled on ts (can be
+ * NULL) ahead of time, job is such a listing of the path or NULL.  Returns
+ * number of filtered out files on success or partial success and negative value
+ * on serious error. */
 static int
 add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
-		trie_t *folded_paths, int parent_pos, int no_direct_parent, int depth)
+		trie_t *folded_paths, int parent_pos, int no_direct_parent, int depth,
+		tree_scan_t *ts, tree_scan_job_t *job)
 {
+	enum
+	{
+		VISIBLE = 1,     /* Visible with local filter applied. */
+		TRAVERSABLE = 2, /* Visible without local filter. */
+	};
+
 	int i;
 	const int prev_count = view->custom.entry_count;
 	int nfiltered = 0;
 
-	int len;
-	char **lst = list_all_files(path, &len);
-	if(len < 0)
+	tree_scan_list_t lst;
+	if(job == NULL)
+	{
+		tree_scan_list(path, &lst);
+	}
+	else
+	{
+		tree_scan_wait(ts, job, &lst);
+	}
+	if(lst.count < 0)
 	{
 		return -1;
 	}
 
 	FoldState parent_fold = get_fold_state(folded_paths, path);
 
-	for(i = 0; i < len && !ui_cancellation_requested(); ++i)
+	char *const flags = calloc(lst.count + 1, sizeof(*flags));
+	tree_scan_job_t **const jobs = calloc(lst.count + 1, sizeof(*jobs));
+	if(flags == NULL || jobs == NULL)
+	{
+		free(flags);
+		free(jobs);
+		tree_scan_free_list(&lst);
+		return -1;
+	}
+
+	/* Schedule listing of subdirectories that are going to be visited.  Doing it
+	 * in reverse order makes them listed in the order of visiting. */
+	for(i = lst.count - 1; i >= 0; --i)
+	{
+		const tree_scan_entry_t *const e = &lst.entries[i];
+		char full_path[PATH_MAX + 1];
+		void *dummy;
+
+		snprintf(full_path, sizeof(full_path), "%s/%s", path, e->name);
+		if(trie_get(excluded_paths, full_path, &dummy) == 0)
+		{
+			continue;
+		}
+
+		if(tree_candidate_is_visible(view, path, e->name, e->is_dir, 1))
+		{
+			flags[i] |= VISIBLE;
+		}
+		else if(e->is_dir && !e->is_link && depth > 0 &&
+				tree_candidate_is_visible(view, path, e->name, e->is_dir, 0))
+		{
+			flags[i] |= TRAVERSABLE;
+		}
+
+		if(e->is_dir && !e->is_link && (flags[i] & (VISIBLE | TRAVERSABLE)) &&
+				tree_will_descend(folded_paths, full_path, parent_fold, depth))
+		{
+			jobs[i] = tree_scan_queue(ts, full_path);
+		}
+	}
+
+	for(i = 0; i < lst.count && !ui_cancellation_requested(); ++i)
 	{
 		int dir;
 		void *dummy;
 		dir_entry_t *entry;
-		char *const full_path = format_str("%s/%s", path, lst[i]);
+		const tree_scan_entry_t *const e = &lst.entries[i];
+		char *const full_path = format_str("%s/%s", path, e->name);
 
 		if(trie_get(excluded_paths, full_path, &dummy) == 0)
 		{
@@ -4293,10 +4816,10 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			continue;
 		}
 
-		dir = is_dir(full_path);
-		if(!tree_candidate_is_visible(view, path, lst[i], dir, 1))
+		dir = e->is_dir;
+		if(!(flags[i] & VISIBLE))
 		{
-			const int real_dir = (dir && !is_symlink(full_path));
+			const int real_dir = (dir && !e->is_link);
 
 			FoldState state;
 			if(real_dir)
@@ -4316,13 +4839,13 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 
 			/* Traverse directory (but not symlink to it) even if we're skipping it,
 			 * because we might need files that are inside of it. */
-			if(real_dir && depth > 0 &&
-					tree_candidate_is_visible(view, path, lst[i], dir, 0))
+			if(real_dir && depth > 0 && (flags[i] & TRAVERSABLE))
 			{
 				if(state != FOLD_AUTO_CLOSED && state != FOLD_USER_CLOSED)
 				{
 					nfiltered += add_files_recursively(view, full_path, excluded_paths,
-							folded_paths, parent_pos, 1, depth - 1);
+							folded_paths, parent_pos, 1, depth - 1, ts, jobs[i]);
+					jobs[i] = NULL;
 				}
 			}
 
@@ -4331,11 +4854,14 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			continue;
 		}
 
-		entry = flist_custom_add(view, full_path);
+		entry = tree_add_entry(view, full_path, e);
 		if(entry == NULL)
 		{
 			free(full_path);
-			free_string_array(lst, len);
+			drop_tree_jobs(ts, jobs, lst.count);
+			free(jobs);
+			free(flags);
+			tree_scan_free_list(&lst);
 			return -1;
 		}
 
@@ -4364,7 +4890,8 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			{
 				const int idx = view->custom.entry_count - 1;
 				const int filtered = add_files_recursively(view, full_path,
-						excluded_paths, folded_paths, idx, 0, depth - 1);
+						excluded_paths, folded_paths, idx, 0, depth - 1, ts, jobs[i]);
+				jobs[i] = NULL;
 				/* Keep going in case of error and load partial list. */
 				if(filtered >= 0)
 				{
@@ -4372,6 +4899,7 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 					* partial tree. */
 					view->custom.entries[idx].child_count = (view->custom.entry_count - 1)
 					                                      - idx;
+					view->custom.entries[idx].child_filtered = filtered;
 					nfiltered += filtered;
 				}
 			}
@@ -4382,7 +4910,11 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 		show_progress("Building tree...", 1000);
 	}
 
-	free_string_array(lst, len);
+	/* Some of the listings might not be needed after all. */
+	drop_tree_jobs(ts, jobs, lst.count);
+	free(jobs);
+	free(flags);
+	tree_scan_free_list(&lst);
 
 	/* The prev_count != 0 check is to make sure that we won't create leaf instead
 	 * of the whole tree (this is handled in flist_custom_finish()). */
@@ -4401,6 +4933,47 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 	return nfiltered;
 }
 
+/* Discards listings that weren't consumed. */
+static void
+drop_tree_jobs(tree_scan_t *ts, tree_scan_job_t *jobs[], int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		tree_scan_drop(ts, jobs[i]);
+	}
+}
+
+/* Predicts whether add_files_recursively() will descend into a directory which
+ * passes filters.  Returns non-zero if so, otherwise zero is returned. */
+static int
+tree_will_descend(trie_t *folded_paths, const char full_path[],
+		FoldState parent_fold, int depth)
+{
+	if(depth <= 0)
+	{
+		return 0;
+	}
+
+	const FoldState state = get_fold_state(folded_paths, full_path);
+	return state != FOLD_USER_CLOSED
+	    && state != FOLD_AUTO_CLOSED
+	    && !(state == FOLD_UNDEFINED && parent_fold == FOLD_AUTO_OPENED);
+}
+
+/* Adds file found while building a tree to the view reusing information about
+ * it when it's available.  Returns the entry or NULL on error. */
+static dir_entry_t *
+tree_add_entry(view_t *view, const char path[], const tree_scan_entry_t *entry)
+{
+	if(!entry->has_stat)
+	{
+		return flist_custom_add(view, path);
+	}
+
+	return custom_add_by_stat(view, path, &entry->st);
+}
+
 /* Retrieves state of the fold if present.  Returns the state or
  * FOLD_UNDEFINED. */
 static FoldState
@@ -4518,6 +5091,7 @@ init_parent_entry(view_t *view, dir_entry_t *entry, const char path[])
 
 #ifndef _WIN32
 	entry->size = (uintmax_t)s.st_size;
+	entry->alloc_size = (uint64_t)s.st_blocks*512U;
 	entry->uid = s.st_uid;
 	entry->gid = s.st_gid;
 	entry->mode = s.st_mode;
@@ -4525,6 +5099,7 @@ init_parent_entry(view_t *view, dir_entry_t *entry, const char path[])
 #else
 	/* Windows doesn't like returning size of directories even if it can. */
 	entry->size = get_file_size(entry->name);
+	entry->alloc_size = entry->size;
 #endif
 	entry->mtime = s.st_mtime;
 	entry->atime = s.st_atime;
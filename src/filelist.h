@@ -36,6 +36,12 @@ typedef int (*zap_filter)(view_t *view, const dir_entry_t *entry, void *arg);
  * if particular property holds and zero otherwise. */
 typedef int (*entry_predicate)(const dir_entry_t *entry);
 
+/* Type of predicate functions to reason about files that aren't entries of a
+ * view.  Should return non-zero if particular property holds for name inside
+ * of dir and zero otherwise. */
+typedef int (*file_predicate)(const char dir[], const char name[], int is_dir,
+		void *arg);
+
 /* Initialization/termination functions. */
 
 /* Prepares views for the first time. */
@@ -190,8 +196,9 @@ int is_dir_list_loaded(view_t *view);
 int view_needs_cd(const view_t *view, const char path[]);
 /* Sets view's current directory from path value. */
 void set_view_path(view_t *view, const char path[]);
-/* Retrieves size of the entry, possibly using cached or calculated value.
- * Returns the size. */
+/* Retrieves size of the entry (apparent or allocated one depending on
+ * 'diskusage'), possibly using cached or calculated value.  Returns the
+ * size. */
 uint64_t fentry_get_size(const view_t *view, const dir_entry_t *entry);
 /* Loads pointer to the next selected entry in file list of the view.  *entry
  * should be NULL for the first call and result of previous call otherwise.
@@ -255,7 +262,8 @@ dir_entry_t * entry_from_path(view_t *view, dir_entry_t *entries, int count,
 /* Retrieves number of items in a directory specified by the entry.  Returns the
  * number, which is zero for files. */
 uint64_t fentry_get_nitems(const view_t *view, const dir_entry_t *entry);
-/* Queries information about a directory from dcache.  *size might be set to
+/* Queries information about a directory from dcache.  *size is apparent or
+ * allocated size depending on 'diskusage' and might be set to
  * DCACHE_UNKNOWN. */
 void fentry_get_dir_info(const view_t *view, const dir_entry_t *entry,
 		uint64_t *size, uint64_t *nitems);
@@ -302,6 +310,15 @@ int fentry_points_to(const dir_entry_t *entry, const char path[]);
  * parameter can be used to limit nesting level (>= 0).  Considers various
  * filters.  Returns zero on success, otherwise non-zero is returned. */
 int flist_load_tree(view_t *view, const char path[], int depth);
+/* Loads only top level of directory tree specified by its path into the view.
+ * Unlike depth-limited tree, folds that weren't loaded yet are looked into by
+ * search and local filter.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int flist_load_lazy_tree(view_t *view, const char path[]);
+/* Opens folds of a lazy tree that weren't loaded yet on the way to files for
+ * which the predicate holds.  The tree needs to be reloaded afterwards.
+ * Returns number of opened folds. */
+int flist_tree_unfold_matching(view_t *view, file_predicate pred, void *arg);
 /* Makes to contain tree with the same root as from including copying list of
  * excluded files.  Returns zero on success, otherwise non-zero is returned. */
 int flist_clone_tree(view_t *to, const view_t *from);
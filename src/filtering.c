@@ -52,6 +52,9 @@ static int extract_previously_selected_pos(view_t *view);
 static void clear_local_filter_hist_after(view_t *view, int pos);
 static int find_nearest_neighour(const view_t *view);
 static void local_filter_finish(view_t *view);
+static int unfold_filter_matches(view_t *view);
+static int matches_local_filter(const char dir[], const char name[],
+		int is_dir, void *arg);
 static void append_slash(const char name[], char buf[], size_t buf_size);
 
 void
@@ -794,6 +797,12 @@ local_filter_accept(view_t *view, int update_history)
 		hists_filter_save(view->local_filter.filter.raw);
 	}
 
+	/* Filtering was performed on what's loaded, load the rest of matches. */
+	if(unfold_filter_matches(view))
+	{
+		ui_view_schedule_reload(view);
+	}
+
 	/* Some of previously selected files could be filtered out, update number of
 	 * selected files. */
 	flist_sel_recount(view);
@@ -814,6 +823,7 @@ local_filter_apply(view_t *view, const char filter[])
 
 	flist_custom_save(view);
 
+	(void)unfold_filter_matches(view);
 	ui_view_schedule_reload(view);
 }
 
@@ -848,6 +858,25 @@ local_filter_finish(view_t *view)
 	view->local_filter.poshist_len = 0U;
 }
 
+/* Opens folds of a lazy tree which contain files that pass local filter.
+ * Returns non-zero if the view needs to be reloaded. */
+static int
+unfold_filter_matches(view_t *view)
+{
+	return !filter_is_empty(&view->local_filter.filter)
+	    && flist_tree_unfold_matching(view, &matches_local_filter, view) != 0;
+}
+
+/* Checks whether file passes filters including local filter of the view in the
+ * arg.  Returns non-zero if so, otherwise zero is returned. */
+static int
+matches_local_filter(const char dir[], const char name[], int is_dir,
+		void *arg)
+{
+	return filters_file_is_visible(arg, dir, name, is_dir,
+			/*apply_local_filter=*/1);
+}
+
 void
 local_filter_remove(view_t *view)
 {
@@ -70,6 +70,7 @@
 #include "filelist.h"
 #include "flist_pos.h"
 #include "flist_sel.h"
+#include "fops_journal.h"
 #include "ops.h"
 #include "running.h"
 #include "status.h"
@@ -644,8 +645,7 @@ io_progress_bg(const io_progress_t *state, int progress)
 	progress_data_t *const pdata = estim->param;
 	bg_op_t *const bg_op = pdata->bg_op;
 
-	bg_op->progress = progress/IO_PRECISION;
-	bg_op_changed(bg_op);
+	bg_op_set_progress(bg_op, progress/IO_PRECISION);
 }
 
 /* Formats file progress part of the progress message.  Returns pointer to newly
@@ -1126,9 +1126,24 @@ fops_get_bg_ops(OPS main_op, const char descr[], const char dir[])
 		const io_cancellation_t no_cancellation = {};
 		ops->estim = ioeta_alloc(pdata, no_cancellation);
 	}
+	ops_add_dev(ops, dir);
 	return ops;
 }
 
+int
+fops_bg_execute(const char descr[], int total, bg_task_func task_func,
+		bg_args_t *args)
+{
+	size_t i;
+	for(i = 0U; i < args->sel_list_len; ++i)
+	{
+		ops_add_dev(args->ops, args->sel_list[i]);
+	}
+
+	return bg_execute_on(descr, "...", total, args->ops->devs, args->ops->ndevs,
+			task_func, args);
+}
+
 /* Allocates progress data with specified parameters and initializes all the
  * rest of structure fields with default values. */
 TSTATIC progress_data_t *
@@ -1257,6 +1272,11 @@ fops_mv_file_f(const char src[], const char dst[], OPS op, int bg,
 void
 fops_free_bg_args(bg_args_t *args)
 {
+	/* Operation that wasn't even started counts as cancelled. */
+	const int cancelled = (args->ops == NULL || args->ops->bg_op == NULL ||
+			bg_op_cancelled(args->ops->bg_op));
+	fops_journal_finish(args->journal, cancelled);
+
 	free_string_array(args->list, args->nlines);
 	free_string_array(args->sel_list, args->sel_list_len);
 	free(args->is_in_trash);
@@ -26,6 +26,7 @@
 #include "ops.h"
 
 struct dir_entry_t;
+struct fops_journal_t;
 struct view_t;
 
 /* Path roles for fops_is_dir_writable() function. */
@@ -54,6 +55,7 @@ typedef struct
 	char *is_in_trash;       /* Flags indicating whether i-th file is in trash.
 	                            Can be NULL when unused. */
 	ops_t *ops;              /* Pointer to pre-allocated operation description. */
+	struct fops_journal_t *journal; /* Journal of the operation or NULL. */
 }
 bg_args_t;
 
@@ -166,6 +168,12 @@ void fops_bg_ops_init(ops_t *ops, bg_op_t *bg_op);
  * newly allocated structure, which should be freed by fops_free_ops(). */
 ops_t * fops_get_bg_ops(OPS main_op, const char descr[], const char dir[]);
 
+/* Starts background operation over files in args->sel_list.  The operation is
+ * serialized with other operations that involve the same devices.  Returns zero
+ * on success, otherwise non-zero is returned. */
+int fops_bg_execute(const char descr[], int total, bg_task_func task_func,
+		bg_args_t *args);
+
 /* Checks whether operation should be carried on.  Returns zero if it was
  * cancelled (via Ctrl-C) or aborted (via error dialog option) by the user. */
 int fops_active(const ops_t *ops);
@@ -34,6 +34,7 @@
 #include "filelist.h"
 #include "flist_pos.h"
 #include "fops_common.h"
+#include "fops_journal.h"
 #include "fops_misc.h"
 #include "ops.h"
 #include "trash.h"
@@ -62,7 +63,7 @@ static int check_for_clashes(verify_args_t *args, char *list[], char *marked[],
 		int nlines, char **error);
 static const char * cmlo_to_str(CopyMoveLikeOp op);
 static void cpmv_files_in_bg(bg_op_t *bg_op, void *arg);
-static void cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[],
+static int cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[],
 		int move, int force, int skip, int from_trash, const char dst_dir[]);
 static int cp_file_f(const char src[], const char dst[], CopyMoveLikeOp op,
 		int bg, int cancellable, ops_t *ops, int force);
@@ -121,6 +122,15 @@ fops_cpmv(view_t *view, char *list[], int nlines, CopyMoveLikeOp op, int flags)
 			return 0;
 	}
 
+	if(flags & CMLF_BULK)
+	{
+		ops->bulk_copy = 1;
+	}
+	if(flags & CMLF_VERIFY)
+	{
+		ops->verify = 1;
+	}
+
 	nmarked_files = fops_enqueue_marked_files(ops, view, dst_dir, 0);
 
 	un_group_open(undo_msg);
@@ -351,8 +361,30 @@ fops_cpmv_bg(view_t *view, char *list[], int nlines, int move, int flags)
 
 	args->ops = fops_get_bg_ops(move ? OP_MOVE : OP_COPY,
 			move ? "moving" : "copying", args->path);
+	if(flags & CMLF_BULK)
+	{
+		args->ops->bulk_copy = 1;
+	}
+	if(flags & CMLF_VERIFY)
+	{
+		args->ops->verify = 1;
+	}
 
-	if(bg_execute(task_desc, "...", args->sel_list_len, 1, &cpmv_files_in_bg,
+	char **dsts = NULL;
+	int ndsts = 0;
+	for(i = 0U; i < args->sel_list_len; ++i)
+	{
+		ndsts = put_into_string_array(&dsts, ndsts,
+				join_paths(args->path, args->list[i]));
+	}
+	if(ndsts == (int)args->sel_list_len)
+	{
+		args->journal = fops_journal_start(task_desc, args->path, move, force,
+				args->sel_list, dsts, args->sel_list_len);
+	}
+	free_string_array(dsts, ndsts);
+
+	if(fops_bg_execute(task_desc, args->sel_list_len, &cpmv_files_in_bg,
 				args) != 0)
 	{
 		fops_free_bg_args(args);
@@ -608,16 +640,20 @@ cpmv_files_in_bg(bg_op_t *bg_op, void *arg)
 		const char *const src = args->sel_list[i];
 		const char *const dst = args->list[i];
 		bg_op_set_descr(bg_op, src);
-		cpmv_file_in_bg(ops, src, dst, args->move, args->force, args->skip,
-				args->is_in_trash[i], args->path);
-		++bg_op->done;
+		if(cpmv_file_in_bg(ops, src, dst, args->move, args->force, args->skip,
+					args->is_in_trash[i], args->path) == 0)
+		{
+			fops_journal_item_done(args->journal, i);
+		}
+		bg_op_inc_done(bg_op);
 	}
 
 	fops_free_bg_args(args);
 }
 
-/* Actual implementation of background file copying/moving. */
-static void
+/* Actual implementation of background file copying/moving.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
 cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
 		int force, int skip, int from_trash, const char dst_dir[])
 {
@@ -627,7 +663,7 @@ cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
 	{
 		if(skip)
 		{
-			return;
+			return 0;
 		}
 
 		if(force && !from_trash)
@@ -638,12 +674,9 @@ cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
 
 	if(move)
 	{
-		(void)fops_mv_file_f(src, dst_full, OP_MOVE, 1, 1, ops);
-	}
-	else
-	{
-		(void)cp_file_f(src, dst_full, CMLO_COPY, 1, 1, ops, 0);
+		return fops_mv_file_f(src, dst_full, OP_MOVE, 1, 1, ops);
 	}
+	return cp_file_f(src, dst_full, CMLO_COPY, 1, 1, ops, 0);
 }
 
 /* Copies file from one location to another.  Returns zero on success, otherwise
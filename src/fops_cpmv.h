@@ -37,9 +37,11 @@ CopyMoveLikeOp;
 /* Fine tuning of fops_cpmv() behaviour. */
 typedef enum
 {
-	CMLF_NONE  = 0x00, /* None of the other options. */
-	CMLF_FORCE = 0x01, /* Remove destination if it already exists. */
-	CMLF_SKIP  = 0x02, /* Skip paths that already exist at destination. */
+	CMLF_NONE   = 0x00, /* None of the other options. */
+	CMLF_FORCE  = 0x01, /* Remove destination if it already exists. */
+	CMLF_SKIP   = 0x02, /* Skip paths that already exist at destination. */
+	CMLF_BULK   = 0x04, /* Copy in a way that preserves contents of page cache. */
+	CMLF_VERIFY = 0x08, /* Check copied data against the source. */
 }
 CopyMoveLikeFlags;
 
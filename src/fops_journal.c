@@ -0,0 +1,682 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "fops_journal.h"
+
+#ifndef _WIN32
+#include <sys/file.h> /* LOCK_EX LOCK_NB LOCK_SH LOCK_UN flock() */
+#endif
+#include <sys/stat.h> /* S_IRWXU S_ISDIR() S_ISREG() stat */
+#include <unistd.h> /* unlink() */
+
+#include <errno.h> /* errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fflush() fopen() fprintf() fputc() fputs()
+                      snprintf() */
+#include <stdlib.h> /* calloc() free() strtoull() */
+#include <string.h> /* strcat() strlen() */
+#include <time.h> /* time_t */
+
+#include "cfg/config.h"
+#include "compat/fs_limits.h"
+#include "compat/os.h"
+#include "utils/fs.h"
+#include "utils/log.h"
+#include "utils/parson.h"
+#include "utils/path.h"
+#include "utils/str.h"
+#include "utils/string_array.h"
+#include "background.h"
+#include "fops_common.h"
+#include "ops.h"
+
+/* Name of a directory inside configuration directory for journals. */
+#define JOURNAL_DIR "journal"
+
+/* Journal of an operation that is being performed. */
+struct fops_journal_t
+{
+	FILE *fp;     /* Locked journal file. */
+	char *path;   /* Path to the journal file. */
+	size_t count; /* Number of items in the journal. */
+	size_t ndone; /* Number of processed items. */
+};
+
+/* Contents of a journal. */
+typedef struct
+{
+	JSON_Value *header; /* Parsed first line of the journal. */
+	JSON_Array *items;  /* Items of the operation. */
+	char *done;         /* Whether i-th item has been processed. */
+	size_t count;       /* Number of items. */
+	size_t ndone;       /* Number of processed items. */
+}
+journal_data_t;
+
+/* Arguments of background task that resumes an operation. */
+typedef struct
+{
+	journal_data_t data;     /* Contents of the journal. */
+	fops_journal_t *journal; /* Journal to keep recording progress to. */
+	ops_t *ops;              /* Operation description. */
+	int move;                /* Whether this is a move operation. */
+}
+resume_args_t;
+
+static void get_journal_dir(char buf[], size_t buf_len);
+static int lock_journal(FILE *fp, int exclusive, int wait);
+static int load_journal(const char path[], journal_data_t *data);
+static void free_journal_data(journal_data_t *data);
+static void resume_in_bg(bg_op_t *bg_op, void *arg);
+static int pick_resume_op(int move, int replace, const char src[],
+		const char dst[], uint64_t size, time_t mtime, OPS *op);
+static int is_dir_pair(const char src[], const char dst[]);
+static int resume_dir_copy(ops_t *ops, const char src[], const char dst[]);
+static int resume_entry_copy(ops_t *ops, const char src[], const char dst[]);
+
+fops_journal_t *
+fops_journal_start(const char descr[], const char dir[], int move, int force,
+		char *src[], char *dst[], size_t count)
+{
+#ifndef _WIN32
+	if(!cfg.journal_ops)
+	{
+		return NULL;
+	}
+
+	char path[PATH_MAX + 16];
+	get_journal_dir(path, sizeof(path));
+	if(make_path(path, S_IRWXU) != 0)
+	{
+		LOG_ERROR_MSG("Failed to create journal directory: %s", path);
+		return NULL;
+	}
+
+	if(strlen(path) + 7 >= sizeof(path))
+	{
+		return NULL;
+	}
+	strcat(path, "/XXXXXX");
+
+	FILE *fp = make_tmp_file(path, 0600, /*auto_delete=*/0);
+	if(fp == NULL)
+	{
+		LOG_SERROR_MSG(errno, "Failed to create journal file: %s", path);
+		return NULL;
+	}
+
+	fops_journal_t *const journal = malloc(sizeof(*journal));
+	if(journal == NULL || lock_journal(fp, /*exclusive=*/1, /*wait=*/1) != 0)
+	{
+		free(journal);
+		fclose(fp);
+		(void)unlink(path);
+		return NULL;
+	}
+
+	journal->fp = fp;
+	journal->path = strdup(path);
+	journal->count = count;
+	journal->ndone = 0U;
+
+	JSON_Value *root_value = json_value_init_object();
+	JSON_Object *root = json_object(root_value);
+	json_object_set_string(root, "descr", descr);
+	json_object_set_string(root, "dir", dir);
+	json_object_set_boolean(root, "move", move);
+
+	JSON_Value *items_value = json_value_init_array();
+	JSON_Array *items = json_array(items_value);
+	json_object_set_value(root, "items", items_value);
+
+	size_t i;
+	for(i = 0U; i < count; ++i)
+	{
+		struct stat st;
+		const int exists = (os_lstat(src[i], &st) == 0);
+
+		JSON_Value *item_value = json_value_init_object();
+		JSON_Object *item = json_object(item_value);
+		json_object_set_string(item, "src", src[i]);
+		json_object_set_string(item, "dst", dst[i]);
+		json_object_set_number(item, "size", exists ? st.st_size : 0);
+		json_object_set_number(item, "mtime", exists ? st.st_mtime : 0);
+		/* Destination that existed before the operation isn't a partial result of
+		 * it and must never be continued. */
+		json_object_set_boolean(item, "replace", path_exists(dst[i], NODEREF));
+		json_array_append_value(items, item_value);
+	}
+
+	char *const header = json_serialize_to_string(root_value);
+	json_value_free(root_value);
+	if(header == NULL)
+	{
+		fops_journal_finish(journal, /*cancelled=*/1);
+		return NULL;
+	}
+
+	fputs(header, fp);
+	fputc('\n', fp);
+	json_free_serialized_string(header);
+
+	for(i = 0U; i < count; ++i)
+	{
+		/* These items aren't going to be processed and it's unsafe to touch them
+		 * on resuming. */
+		if(paths_are_equal(src[i], dst[i]) ||
+				(!force && path_exists(dst[i], NODEREF)))
+		{
+			fops_journal_item_done(journal, i);
+		}
+	}
+
+	if(fflush(fp) != 0)
+	{
+		fops_journal_finish(journal, /*cancelled=*/1);
+		return NULL;
+	}
+	(void)os_fdatasync(fileno(fp));
+
+	return journal;
+#else
+	(void)descr;
+	(void)dir;
+	(void)move;
+	(void)force;
+	(void)src;
+	(void)dst;
+	(void)count;
+	return NULL;
+#endif
+}
+
+void
+fops_journal_item_done(fops_journal_t *journal, size_t i)
+{
+	if(journal == NULL)
+	{
+		return;
+	}
+
+	/* Terminator allows detecting records that weren't fully written. */
+	fprintf(journal->fp, "%" PRINTF_ULL ";\n", (unsigned long long)i);
+	if(fflush(journal->fp) == 0)
+	{
+		(void)os_fdatasync(fileno(journal->fp));
+	}
+	++journal->ndone;
+}
+
+void
+fops_journal_finish(fops_journal_t *journal, int cancelled)
+{
+	if(journal == NULL)
+	{
+		return;
+	}
+
+	if(cancelled || journal->ndone >= journal->count)
+	{
+		(void)unlink(journal->path);
+	}
+
+	/* This also releases the lock. */
+	fclose(journal->fp);
+	free(journal->path);
+	free(journal);
+}
+
+char **
+fops_journal_list(int *len)
+{
+	char dir[PATH_MAX + 16];
+	get_journal_dir(dir, sizeof(dir));
+
+	int nnames = 0;
+	char **names = list_regular_files(dir, NULL, &nnames);
+
+	char **list = NULL;
+	*len = 0;
+
+	int i;
+	for(i = 0; i < nnames; ++i)
+	{
+		char *const path = join_paths(dir, names[i]);
+
+		FILE *const fp = os_fopen(path, "rb");
+		if(fp == NULL)
+		{
+			free(path);
+			continue;
+		}
+
+		/* Journals of running operations are locked. */
+		const int running = (lock_journal(fp, /*exclusive=*/0, /*wait=*/0) != 0);
+		fclose(fp);
+
+		if(running)
+		{
+			free(path);
+			continue;
+		}
+
+		*len = put_into_string_array(&list, *len, path);
+	}
+
+	free_string_array(names, nnames);
+	return list;
+}
+
+char *
+fops_journal_describe(const char path[])
+{
+	journal_data_t data;
+	if(load_journal(path, &data) != 0)
+	{
+		return NULL;
+	}
+
+	const char *const descr = json_object_get_string(json_object(data.header),
+			"descr");
+	char *const result = format_str("%s (%d of %d done)",
+			descr == NULL ? "" : descr, (int)data.ndone, (int)data.count);
+
+	free_journal_data(&data);
+	return result;
+}
+
+int
+fops_journal_resume(const char path[])
+{
+#ifndef _WIN32
+	FILE *const fp = os_fopen(path, "ab");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	/* Lock the journal before reading it to make sure nobody else is resuming
+	 * this operation. */
+	if(lock_journal(fp, /*exclusive=*/1, /*wait=*/0) != 0)
+	{
+		fclose(fp);
+		return 1;
+	}
+
+	resume_args_t *const args = calloc(1, sizeof(*args));
+	fops_journal_t *const journal = malloc(sizeof(*journal));
+	if(args == NULL || journal == NULL || load_journal(path, &args->data) != 0)
+	{
+		free(journal);
+		free(args);
+		fclose(fp);
+		return 1;
+	}
+
+	journal->fp = fp;
+	journal->path = strdup(path);
+	journal->count = args->data.count;
+	journal->ndone = args->data.ndone;
+
+	JSON_Object *const header = json_object(args->data.header);
+	const char *const descr = json_object_get_string(header, "descr");
+	const char *const dir = json_object_get_string(header, "dir");
+
+	args->journal = journal;
+	args->move = (json_object_get_boolean(header, "move") > 0);
+	args->ops = fops_get_bg_ops(args->move ? OP_MOVE : OP_COPY,
+			args->move ? "moving" : "copying", dir == NULL ? "" : dir);
+
+	size_t i;
+	for(i = 0U; i < args->data.count; ++i)
+	{
+		JSON_Object *const item = json_array_get_object(args->data.items, i);
+		const char *const src = json_object_get_string(item, "src");
+		if(src != NULL)
+		{
+			ops_add_dev(args->ops, src);
+		}
+	}
+
+	char *const task_desc = format_str("resume: %s", descr == NULL ? "" : descr);
+	const int total = (int)(args->data.count - args->data.ndone);
+	if(bg_execute_on(task_desc, "...", total, args->ops->devs, args->ops->ndevs,
+				&resume_in_bg, args) != 0)
+	{
+		free(task_desc);
+		/* The journal is preserved to try again later. */
+		fops_journal_finish(args->journal, /*cancelled=*/0);
+		fops_free_ops(args->ops);
+		free_journal_data(&args->data);
+		free(args);
+		return 1;
+	}
+
+	free(task_desc);
+	return 0;
+#else
+	(void)path;
+	return 1;
+#endif
+}
+
+void
+fops_journal_discard(const char path[])
+{
+	FILE *const fp = os_fopen(path, "ab");
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	if(lock_journal(fp, /*exclusive=*/1, /*wait=*/0) == 0)
+	{
+		(void)unlink(path);
+	}
+	fclose(fp);
+}
+
+/* Retrieves path to the directory with journals. */
+static void
+get_journal_dir(char buf[], size_t buf_len)
+{
+	snprintf(buf, buf_len, "%s/" JOURNAL_DIR, cfg.config_dir);
+}
+
+/* Locks journal file.  Returns zero on success and non-zero if the file is
+ * locked by someone else or on error. */
+static int
+lock_journal(FILE *fp, int exclusive, int wait)
+{
+#ifndef _WIN32
+	const int op = (exclusive ? LOCK_EX : LOCK_SH) | (wait ? 0 : LOCK_NB);
+	return (flock(fileno(fp), op) != 0);
+#else
+	(void)fp;
+	(void)exclusive;
+	(void)wait;
+	return 0;
+#endif
+}
+
+/* Reads and parses journal file.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+load_journal(const char path[], journal_data_t *data)
+{
+	int nlines;
+	char **const lines = read_file_of_lines(path, &nlines);
+	if(lines == NULL)
+	{
+		return 1;
+	}
+	if(nlines == 0)
+	{
+		free_string_array(lines, nlines);
+		return 1;
+	}
+
+	data->header = json_parse_string(lines[0]);
+	data->items = json_object_get_array(json_object(data->header), "items");
+	if(data->items == NULL)
+	{
+		json_value_free(data->header);
+		free_string_array(lines, nlines);
+		return 1;
+	}
+
+	data->count = json_array_get_count(data->items);
+	data->ndone = 0U;
+	data->done = calloc(data->count + 1U, 1);
+
+	int i;
+	for(i = 1; i < nlines; ++i)
+	{
+		char *end;
+		const unsigned long long idx = strtoull(lines[i], &end, 10);
+		if(end == lines[i] || *end != ';' || idx >= data->count)
+		{
+			/* Skip incomplete or corrupted record. */
+			continue;
+		}
+
+		if(!data->done[idx])
+		{
+			data->done[idx] = 1;
+			++data->ndone;
+		}
+	}
+
+	free_string_array(lines, nlines);
+	return 0;
+}
+
+/* Frees resources held by contents of a journal. */
+static void
+free_journal_data(journal_data_t *data)
+{
+	json_value_free(data->header);
+	free(data->done);
+}
+
+/* Entry point of a background task that resumes an operation. */
+static void
+resume_in_bg(bg_op_t *bg_op, void *arg)
+{
+	resume_args_t *const args = arg;
+	ops_t *const ops = args->ops;
+	journal_data_t *const data = &args->data;
+	fops_bg_ops_init(ops, bg_op);
+
+	size_t i;
+
+	if(ops->use_system_calls)
+	{
+		bg_op_set_descr(bg_op, "estimating...");
+		for(i = 0U; i < data->count; ++i)
+		{
+			if(!data->done[i])
+			{
+				JSON_Object *const item = json_array_get_object(data->items, i);
+				ops_enqueue(ops, json_object_get_string(item, "src"),
+						json_object_get_string(item, "dst"));
+			}
+		}
+	}
+
+	for(i = 0U; i < data->count; ++i)
+	{
+		if(data->done[i])
+		{
+			continue;
+		}
+
+		JSON_Object *const item = json_array_get_object(data->items, i);
+		const char *const src = json_object_get_string(item, "src");
+		const char *const dst = json_object_get_string(item, "dst");
+		if(src == NULL || dst == NULL)
+		{
+			continue;
+		}
+
+		bg_op_set_descr(bg_op, src);
+
+		const int replace = (json_object_get_boolean(item, "replace") > 0);
+
+		OPS op;
+		if(!args->move && !replace && is_dir_pair(src, dst))
+		{
+			/* Don't redo what was copied before the interruption. */
+			if(resume_dir_copy(ops, src, dst) == 0)
+			{
+				fops_journal_item_done(args->journal, i);
+			}
+		}
+		else if(pick_resume_op(args->move, replace, src, dst,
+					(uint64_t)json_object_get_number(item, "size"),
+					(time_t)json_object_get_number(item, "mtime"), &op) == 0)
+		{
+			if(op == OP_NONE ||
+					perform_operation(op, ops, NULL, src, dst) == OPS_SUCCEEDED)
+			{
+				fops_journal_item_done(args->journal, i);
+			}
+		}
+
+		bg_op_inc_done(bg_op);
+	}
+
+	fops_journal_finish(args->journal, bg_op_cancelled(bg_op));
+	fops_free_ops(ops);
+	free_journal_data(data);
+	free(args);
+}
+
+/* Picks operation that finishes processing of an item, OP_NONE means there is
+ * nothing left to do.  The replace parameter specifies whether destination
+ * existed before the operation, in which case it's overwritten rather than
+ * continued.  Returns zero on success and non-zero if the item can't be safely
+ * resumed. */
+static int
+pick_resume_op(int move, int replace, const char src[], const char dst[],
+		uint64_t size, time_t mtime, OPS *op)
+{
+	struct stat src_st;
+	if(os_lstat(src, &src_st) != 0)
+	{
+		/* Source is gone, it must have been moved. */
+		*op = OP_NONE;
+		return 0;
+	}
+
+	struct stat dst_st;
+	if(os_lstat(dst, &dst_st) != 0)
+	{
+		*op = (move ? OP_MOVE : OP_COPY);
+		return 0;
+	}
+
+	if(!replace && S_ISREG(src_st.st_mode) && S_ISREG(dst_st.st_mode) &&
+			(uint64_t)src_st.st_size == size && src_st.st_mtime == mtime &&
+			(uint64_t)dst_st.st_size <= size)
+	{
+		/* Source is unchanged, so continue from where copying has stopped. */
+		*op = (move ? OP_MOVEA : OP_COPYA);
+		return 0;
+	}
+
+	if(move && S_ISDIR(src_st.st_mode))
+	{
+		/* Source directory could be partially removed after it was copied, so
+		 * replacing destination with it might lose data. */
+		LOG_INFO_MSG("Won't resume moving of a directory: %s", src);
+		return 1;
+	}
+
+	*op = (move ? OP_MOVEF : OP_COPYF);
+	return 0;
+}
+
+/* Checks whether both paths are directories (not symbolic links to them).
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_dir_pair(const char src[], const char dst[])
+{
+	struct stat src_st, dst_st;
+	return os_lstat(src, &src_st) == 0 && os_lstat(dst, &dst_st) == 0 &&
+	       S_ISDIR(src_st.st_mode) && S_ISDIR(dst_st.st_mode);
+}
+
+/* Finishes copying of a directory whose partial copy is at dst by processing
+ * only those entries that weren't fully copied.  Returns zero on success and
+ * non-zero otherwise. */
+static int
+resume_dir_copy(ops_t *ops, const char src[], const char dst[])
+{
+	int len;
+	char **const list = list_all_files(src, &len);
+	if(len < 0)
+	{
+		return 1;
+	}
+
+	int failed = 0;
+	int i;
+	for(i = 0; i < len && !failed; ++i)
+	{
+		if(ops->bg_op != NULL && bg_op_cancelled(ops->bg_op))
+		{
+			failed = 1;
+			break;
+		}
+
+		char *const src_path = join_paths(src, list[i]);
+		char *const dst_path = join_paths(dst, list[i]);
+		failed = (resume_entry_copy(ops, src_path, dst_path) != 0);
+		free(src_path);
+		free(dst_path);
+	}
+
+	free_string_array(list, len);
+	return failed;
+}
+
+/* Finishes copying of an entry of a directory.  Regular files of the same size
+ * and modification time are considered to be copied (copies preserve
+ * modification time, which is set after the data is written), shorter ones
+ * that aren't older than their source are appended to.  Returns zero on
+ * success and non-zero otherwise. */
+static int
+resume_entry_copy(ops_t *ops, const char src[], const char dst[])
+{
+	struct stat src_st;
+	if(os_lstat(src, &src_st) != 0)
+	{
+		/* Nothing to copy. */
+		return 0;
+	}
+
+	OPS op = OP_COPYF;
+	struct stat dst_st;
+	if(os_lstat(dst, &dst_st) != 0)
+	{
+		op = OP_COPY;
+	}
+	else if(S_ISDIR(src_st.st_mode) && S_ISDIR(dst_st.st_mode))
+	{
+		return resume_dir_copy(ops, src, dst);
+	}
+	else if(S_ISREG(src_st.st_mode) && S_ISREG(dst_st.st_mode))
+	{
+		if(dst_st.st_size == src_st.st_size &&
+				dst_st.st_mtime == src_st.st_mtime)
+		{
+			return 0;
+		}
+		if(dst_st.st_size < src_st.st_size && dst_st.st_mtime >= src_st.st_mtime)
+		{
+			op = OP_COPYA;
+		}
+	}
+
+	return (perform_operation(op, ops, NULL, src, dst) == OPS_SUCCEEDED ? 0 : 1);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,71 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__FOPS_JOURNAL_H__
+#define VIFM__FOPS_JOURNAL_H__
+
+#include <stddef.h> /* size_t */
+
+/* Journals of background copy/move operations.  A journal lists all items of
+ * an operation along with size and modification time of their sources and
+ * records which of them have been processed.  Journal of a running operation
+ * is locked, while journal left behind by an interrupted one isn't, which is
+ * how such operations are found to be resumed.  Journals are kept only when
+ * 'iooptions' contains "journal". */
+
+/* Opaque journal type. */
+typedef struct fops_journal_t fops_journal_t;
+
+/* Starts journal of a background operation.  src and dst are full paths of
+ * count items.  Items whose destination already exists are recorded as
+ * processed unless force is set.  Returns the journal or NULL if journaling is
+ * disabled or has failed. */
+fops_journal_t * fops_journal_start(const char descr[], const char dir[],
+		int move, int force, char *src[], char *dst[], size_t count);
+
+/* Records that i-th item has been processed.  The journal can be NULL. */
+void fops_journal_item_done(fops_journal_t *journal, size_t i);
+
+/* Closes the journal of an operation that has come to an end.  The journal is
+ * removed if all items were processed or the operation was cancelled, otherwise
+ * it's left behind to be resumed later.  The journal can be NULL. */
+void fops_journal_finish(fops_journal_t *journal, int cancelled);
+
+/* Lists journals of interrupted operations.  Returns list of paths to them,
+ * *len is set to its length. */
+char ** fops_journal_list(int *len);
+
+/* Describes interrupted operation for the user.  Returns newly allocated string
+ * or NULL on error. */
+char * fops_journal_describe(const char path[]);
+
+/* Starts background task that resumes interrupted operation.  Processed items
+ * are skipped, partially copied files are appended to if their source hasn't
+ * changed since the start, partially copied directories are continued file by
+ * file and other unfinished items (including those that replace destinations
+ * which existed before the operation) are copied/moved anew.  Returns zero on
+ * success, otherwise non-zero is returned. */
+int fops_journal_resume(const char path[]);
+
+/* Discards journal of an interrupted operation, so it won't be resumed. */
+void fops_journal_discard(const char path[]);
+
+#endif /* VIFM__FOPS_JOURNAL_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -39,6 +39,7 @@
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
 #include "cmd_completion.h"
+#include "du.h"
 #include "filelist.h"
 #include "flist_pos.h"
 #include "flist_sel.h"
@@ -366,7 +367,7 @@ fops_delete_bg(view_t *view, int use_trash)
 	args->ops = fops_get_bg_ops(use_trash ? OP_REMOVE : OP_REMOVESL,
 			use_trash ? "deleting" : "Deleting", args->path);
 
-	if(bg_execute(task_desc, "...", args->sel_list_len, 1, &delete_files_in_bg,
+	if(fops_bg_execute(task_desc, args->sel_list_len, &delete_files_in_bg,
 				args) != 0)
 	{
 		fops_free_bg_args(args);
@@ -419,7 +420,7 @@ delete_files_in_bg(bg_op_t *bg_op, void *arg)
 		const char *const src = args->sel_list[i];
 		bg_op_set_descr(bg_op, src);
 		delete_file_in_bg(ops, src, args->use_trash);
-		++bg_op->done;
+		bg_op_inc_done(bg_op);
 	}
 
 	fops_free_bg_args(args);
@@ -1270,14 +1271,28 @@ start_dir_size_calc(const char path[], int force)
 
 	snprintf(task_desc, sizeof(task_desc), "Calculating size: %s", path);
 
-	if(bg_execute(task_desc, path, BG_UNDEFINED_TOTAL, 0, &dir_size_bg,
-				args) != 0)
+	/* Forced recalculation mustn't be merged with one that can use cache. */
+	int result;
+	if(force)
+	{
+		result = bg_execute(task_desc, path, BG_UNDEFINED_TOTAL, 0, &dir_size_bg,
+				args);
+	}
+	else
+	{
+		result = bg_execute_once(task_desc, path, BG_UNDEFINED_TOTAL, 0,
+				&dir_size_bg, args);
+	}
+	if(result != 0)
 	{
 		free(args->path);
 		free(args);
 
-		show_error_msg("Can't calculate size",
-				"Failed to initiate background operation");
+		if(result < 0)
+		{
+			show_error_msg("Can't calculate size",
+					"Failed to initiate background operation");
+		}
 	}
 }
 
@@ -1322,9 +1337,17 @@ uint64_t
 fops_dir_size(const char path[], int force_update,
 		const cancellation_t *cancellation)
 {
-	struct dirent *dentry;
-	const char *slash;
-	uint64_t size;
+	uint64_t size, alloc;
+	fops_dir_sizes(path, force_update, cancellation, &size, &alloc);
+	return size;
+}
+
+void
+fops_dir_sizes(const char path[], int force_update,
+		const cancellation_t *cancellation, uint64_t *size, uint64_t *alloc)
+{
+	*size = 0U;
+	*alloc = 0U;
 
 	time_t mtime = 0;
 	uint64_t inode = DCACHE_UNKNOWN;
@@ -1339,22 +1362,33 @@ fops_dir_size(const char path[], int force_update,
 	 * path. */
 	if(!force_update)
 	{
-		uint64_t dir_size;
-		dcache_get_at(path, mtime, inode, &dir_size, NULL);
-		if(dir_size != DCACHE_UNKNOWN)
+		uint64_t dir_size, dir_alloc;
+		dcache_get_at(path, mtime, inode, &dir_size, &dir_alloc, NULL);
+		if(dir_size != DCACHE_UNKNOWN && dir_alloc != DCACHE_UNKNOWN)
 		{
-			return dir_size;
+			*size = dir_size;
+			*alloc = dir_alloc;
+			return;
 		}
 	}
 
+#ifndef _WIN32
+	if(du_calc(path, force_update, cancellation, size, alloc) != 0)
+	{
+		*size = 0U;
+		*alloc = 0U;
+		return;
+	}
+#else
 	DIR *dir = os_opendir(path);
 	if(dir == NULL)
 	{
-		return 0U;
+		return;
 	}
 
-	slash = (ends_with_slash(path) ? "" : "/");
-	size = 0U;
+	/* There is no notion of allocated size here. */
+	struct dirent *dentry;
+	const char *const slash = (ends_with_slash(path) ? "" : "/");
 	while((dentry = os_readdir(dir)) != NULL)
 	{
 		char full_path[PATH_MAX + 1];
@@ -1368,26 +1402,28 @@ fops_dir_size(const char path[], int force_update,
 				dentry->d_name);
 		if(fops_is_dir_entry(full_path, dentry))
 		{
-			size += fops_dir_size(full_path, force_update, cancellation);
+			*size += fops_dir_size(full_path, force_update, cancellation);
 		}
 		else
 		{
-			size += get_file_size(full_path);
+			*size += get_file_size(full_path);
 		}
 
 		if(cancellation_requested(cancellation))
 		{
 			os_closedir(dir);
-			return 0U;
+			*size = 0U;
+			return;
 		}
 	}
 
 	os_closedir(dir);
+	*alloc = *size;
+#endif
 
 	/* Could calculate nitems here, but they aren't recursive and might only take
 	 * up memory, because interest in size sort of excludes interest in nitems. */
-	(void)dcache_set_at(path, inode, size, DCACHE_UNKNOWN);
-	return size;
+	(void)dcache_set_at(path, inode, *size, *alloc, DCACHE_UNKNOWN);
 }
 
 #ifndef _WIN32
@@ -83,6 +83,13 @@ struct cancellation_t;
 uint64_t fops_dir_size(const char path[], int force,
 		const struct cancellation_t *cancellation);
 
+/* Same as fops_dir_size(), but provides both apparent (*size) and allocated
+ * (*alloc) sizes of a directory.  Allocated size counts each file with multiple
+ * hard links only once.  Both are set to zero on error. */
+void fops_dir_sizes(const char path[], int force,
+		const struct cancellation_t *cancellation, uint64_t *size,
+		uint64_t *alloc);
+
 #ifndef _WIN32
 
 /* Sets uid and or gid for marked files.  Non-zero u enables setting of uid,
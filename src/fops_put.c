@@ -46,6 +46,7 @@
 #include "flist_pos.h"
 #include "fops_common.h"
 #include "fops_cpmv.h"
+#include "fops_journal.h"
 #include "ops.h"
 #include "registers.h"
 #include "trash.h"
@@ -205,8 +206,10 @@ fops_put_bg(view_t *view, int at, int reg_name, int move)
 
 	args->ops = fops_get_bg_ops((args->move ? OP_MOVE : OP_COPY),
 			move ? "Putting" : "putting", args->path);
+	args->journal = fops_journal_start(task_desc, args->path, move, 0,
+			args->sel_list, args->list, args->sel_list_len);
 
-	if(bg_execute(task_desc, "...", args->sel_list_len, 1, &put_files_in_bg,
+	if(fops_bg_execute(task_desc, args->sel_list_len, &put_files_in_bg,
 				args) != 0)
 	{
 		fops_free_bg_args(args);
@@ -239,7 +242,7 @@ put_files_in_bg(bg_op_t *bg_op, void *arg)
 		}
 	}
 
-	for(i = 0U; i < args->sel_list_len; ++i, ++bg_op->done)
+	for(i = 0U; i < args->sel_list_len; ++i, bg_op_inc_done(bg_op))
 	{
 		struct stat src_st;
 		const char *const src = args->sel_list[i];
@@ -255,6 +258,7 @@ put_files_in_bg(bg_op_t *bg_op, void *arg)
 		{
 			/* File isn't there, assume that it's fine and don't error in this
 			 * case. */
+			fops_journal_item_done(args->journal, i);
 			continue;
 		}
 
@@ -262,11 +266,15 @@ put_files_in_bg(bg_op_t *bg_op, void *arg)
 		{
 			/* This file wasn't here before (when checking in fops_put_bg()), won't
 			 * overwrite. */
+			fops_journal_item_done(args->journal, i);
 			continue;
 		}
 
 		bg_op_set_descr(bg_op, src);
-		(void)perform_operation(ops->main_op, ops, NULL, src, dst);
+		if(perform_operation(ops->main_op, ops, NULL, src, dst) == OPS_SUCCEEDED)
+		{
+			fops_journal_item_done(args->journal, i);
+		}
 	}
 
 	fops_free_bg_args(args);
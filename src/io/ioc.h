@@ -125,6 +125,10 @@ struct io_args_t
 			unsigned int fast_file_cloning : 1;
 			/* Whether to call fdatasync() periodically. */
 			unsigned int data_sync : 1;
+			/* Whether to stream data past page cache with adaptive block size. */
+			unsigned int bulk_copy : 1;
+			/* Whether to check copied data by reading it back. */
+			unsigned int verify : 1;
 		};
 	}
 	arg4;
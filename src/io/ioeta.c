@@ -23,12 +23,21 @@
 #include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* calloc() free() */
 
+#include "../compat/pthread.h"
+#include "../utils/fs.h"
+#include "../utils/string_array.h"
+#include "../utils/utils.h"
 #include "private/ioc.h"
 #include "private/ioeta.h"
 #include "private/traverser.h"
 
 static VisitResult eta_visitor(const char full_path[], VisitAction action,
 		void *param);
+static ioeta_walker_t * walker_alloc(void);
+static void walker_free(ioeta_walker_t *walker);
+static void * walker_thread(void *arg);
+static VisitResult walker_visitor(const char full_path[], VisitAction action,
+		void *param);
 
 ioeta_estim_t *
 ioeta_alloc(void *param, io_cancellation_t cancellation)
@@ -49,6 +58,7 @@ ioeta_free(ioeta_estim_t *estim)
 {
 	if(estim != NULL)
 	{
+		walker_free(estim->walker);
 		ioeta_release(estim);
 		free(estim);
 	}
@@ -67,6 +77,197 @@ ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow)
 	}
 }
 
+void
+ioeta_calculate_async(ioeta_estim_t *estim, const char path[], int shallow)
+{
+	/* There is no point in offloading shallow estimation, it's cheap. */
+	if(shallow)
+	{
+		ioeta_add_item(estim, path);
+		return;
+	}
+
+	if(estim->walker == NULL)
+	{
+		estim->walker = walker_alloc();
+	}
+
+	ioeta_walker_t *const walker = estim->walker;
+	if(walker == NULL || pthread_mutex_lock(&walker->lock) != 0)
+	{
+		ioeta_calculate(estim, path, shallow);
+		return;
+	}
+
+	walker->npaths = add_to_string_array(&walker->paths, walker->npaths, path);
+	(void)pthread_cond_broadcast(&walker->cond);
+	(void)pthread_mutex_unlock(&walker->lock);
+}
+
+void
+ioeta_wait(ioeta_estim_t *estim)
+{
+	ioeta_walker_t *const walker = estim->walker;
+	if(walker == NULL)
+	{
+		return;
+	}
+
+	if(pthread_mutex_lock(&walker->lock) == 0)
+	{
+		while(walker->busy || walker->next != walker->npaths)
+		{
+			if(pthread_cond_wait(&walker->cond, &walker->lock) != 0)
+			{
+				break;
+			}
+		}
+		(void)pthread_mutex_unlock(&walker->lock);
+	}
+
+	ioeta_merge(estim);
+}
+
+/* Allocates and starts asynchronous estimation.  Returns the walker or NULL on
+ * error. */
+static ioeta_walker_t *
+walker_alloc(void)
+{
+	ioeta_walker_t *const walker = calloc(1U, sizeof(*walker));
+	if(walker == NULL)
+	{
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&walker->lock, NULL) != 0)
+	{
+		free(walker);
+		return NULL;
+	}
+
+	if(pthread_cond_init(&walker->cond, NULL) != 0)
+	{
+		(void)pthread_mutex_destroy(&walker->lock);
+		free(walker);
+		return NULL;
+	}
+
+	if(pthread_create(&walker->thread, NULL, &walker_thread, walker) != 0)
+	{
+		(void)pthread_cond_destroy(&walker->cond);
+		(void)pthread_mutex_destroy(&walker->lock);
+		free(walker);
+		return NULL;
+	}
+
+	return walker;
+}
+
+/* Stops asynchronous estimation and frees its resources.  The walker can be
+ * NULL. */
+static void
+walker_free(ioeta_walker_t *walker)
+{
+	if(walker == NULL)
+	{
+		return;
+	}
+
+	if(pthread_mutex_lock(&walker->lock) == 0)
+	{
+		walker->stop = 1;
+		(void)pthread_cond_broadcast(&walker->cond);
+		(void)pthread_mutex_unlock(&walker->lock);
+	}
+	(void)pthread_join(walker->thread, NULL);
+
+	(void)pthread_cond_destroy(&walker->cond);
+	(void)pthread_mutex_destroy(&walker->lock);
+	free_string_array(walker->paths, walker->npaths);
+	free(walker);
+}
+
+/* Entry point of a thread that performs asynchronous estimation.  Processes
+ * queued paths until asked to stop.  Returns NULL. */
+static void *
+walker_thread(void *arg)
+{
+	ioeta_walker_t *const walker = arg;
+
+	block_all_thread_signals();
+
+	if(pthread_mutex_lock(&walker->lock) != 0)
+	{
+		return NULL;
+	}
+
+	while(!walker->stop)
+	{
+		if(walker->next == walker->npaths)
+		{
+			walker->busy = 0;
+			(void)pthread_cond_broadcast(&walker->cond);
+			if(pthread_cond_wait(&walker->cond, &walker->lock) != 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		/* Strings of the queue are never changed, only the array is
+		 * reallocated. */
+		const char *const path = walker->paths[walker->next++];
+		walker->busy = 1;
+		(void)pthread_mutex_unlock(&walker->lock);
+
+		(void)traverse(path, &walker_visitor, walker);
+
+		if(pthread_mutex_lock(&walker->lock) != 0)
+		{
+			return NULL;
+		}
+	}
+
+	walker->busy = 0;
+	(void)pthread_cond_broadcast(&walker->cond);
+	(void)pthread_mutex_unlock(&walker->lock);
+	return NULL;
+}
+
+/* Implementation of traverse() visitor for asynchronous estimation.  Returns
+ * status of visitation. */
+static VisitResult
+walker_visitor(const char full_path[], VisitAction action, void *param)
+{
+	ioeta_walker_t *const walker = param;
+
+	uint64_t size = 0U;
+	if(action == VA_FILE && !is_symlink(full_path))
+	{
+		size = get_file_size(full_path);
+	}
+
+	if(pthread_mutex_lock(&walker->lock) != 0)
+	{
+		return VR_ERROR;
+	}
+
+	const int stop = walker->stop;
+	if(action == VA_FILE)
+	{
+		++walker->items;
+		walker->bytes += size;
+	}
+
+	(void)pthread_mutex_unlock(&walker->lock);
+
+	if(stop)
+	{
+		return VR_CANCELLED;
+	}
+	return (action == VA_DIR_ENTER ? VR_SKIP_DIR_LEAVE : VR_OK);
+}
+
 /* Implementation of traverse() visitor for subtree copying.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
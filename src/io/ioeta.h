@@ -68,6 +68,9 @@ typedef struct ioeta_estim_t
 
 	/* Provides means for cancellation checking. */
 	io_cancellation_t cancellation;
+
+	/* State of asynchronous estimation or NULL if it's not used. */
+	struct ioeta_walker_t *walker;
 }
 ioeta_estim_t;
 
@@ -82,6 +85,17 @@ void ioeta_free(ioeta_estim_t *estim);
  * directories. */
 void ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow);
 
+/* Same as ioeta_calculate(), but the subtree is traversed by a separate thread
+ * which walks ahead of the operation.  Totals converge while the operation is
+ * being performed and get merged on progress updates.  Falls back to
+ * synchronous calculation if the thread can't be started. */
+void ioeta_calculate_async(ioeta_estim_t *estim, const char path[],
+		int shallow);
+
+/* Waits for asynchronous estimation (if any) to finish and merges its results
+ * into the estim. */
+void ioeta_wait(ioeta_estim_t *estim);
+
 #endif /* VIFM__IO__IOETA_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -24,18 +24,22 @@
 
 #ifndef _WIN32
 #include <sys/ioctl.h> /* ioctl() */
+#include <fcntl.h> /* POSIX_FADV_* SYNC_FILE_RANGE_* posix_fadvise()
+                      sync_file_range() */
 #endif
 #include <sys/stat.h> /* stat */
-#include <sys/types.h> /* mode_t */
-#include <unistd.h> /* symlink() unlink() */
+#include <sys/types.h> /* mode_t off_t ssize_t */
+#include <unistd.h> /* ftruncate() lseek() read() symlink() unlink() write() */
 
 #include <assert.h> /* assert() */
-#include <errno.h> /* EEXIST ENOENT EISDIR errno */
+#include <errno.h> /* EEXIST EINTR ENOENT ENXIO EISDIR errno */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* FILE fpos_t fclose() fgetpos() fflush() fread() fseek()
                       fsetpos() fwrite() snprintf() */
 #include <stdlib.h> /* free() */
 #include <string.h> /* strchr() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
@@ -51,12 +55,28 @@
 #include "private/ioeta.h"
 #include "ioc.h"
 
+/* Import xxhash privately to get it inlined into this unit. */
+#define XXH_PRIVATE_API
+#include "../utils/xxhash.h"
+
 /* Amount of data to transfer at once. */
 #define BLOCK_SIZE 32*1024
 
 /* Amount of data after which data flush should be performed. */
 #define FLUSH_SIZE 256*1024*1024
 
+/* Upper limit on amount of data transferred at once in bulk copy mode. */
+#define BULK_MAX_BLOCK_SIZE 8*1024*1024
+
+/* Size of a window of written data which is flushed and evicted from page cache
+ * at once in bulk copy mode. */
+#define BULK_WINDOW_SIZE 32*1024*1024
+
+/* Block size is grown while transferring a block takes less time than this and
+ * shrunk when it takes more than twice of it (in milliseconds).  This keeps
+ * progress and cancellation responsive. */
+#define BULK_BLOCK_TIME 50
+
 /* Type of io function used by retry_wrapper(). */
 typedef IoRes (*iop_func)(io_args_t *args);
 
@@ -65,6 +85,18 @@ static IoRes iop_mkdir_internal(io_args_t *args);
 static IoRes iop_rmfile_internal(io_args_t *args);
 static IoRes iop_rmdir_internal(io_args_t *args);
 static IoRes iop_cp_internal(io_args_t *args);
+static int is_sparse(const struct stat *st);
+static int copy_sparse(io_args_t *args, int in_fd, int out_fd, uint64_t size,
+		XXH3_state_t *hash);
+static void hash_zeros(XXH3_state_t *hash, uint64_t len);
+static int copy_bulk(io_args_t *args, int in_fd, int out_fd,
+		XXH3_state_t *hash);
+static int verify_copy(io_args_t *args, uint64_t from, XXH64_hash_t digest);
+#ifndef _WIN32
+static void drop_window(int in_fd, int out_fd, off_t from, off_t to);
+static long long time_in_ms(void);
+static int write_all(int fd, const char buf[], size_t len);
+#endif
 static int clone_file(int dst_fd, int src_fd);
 #ifdef _WIN32
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
@@ -304,12 +336,16 @@ iop_cp_internal(io_args_t *args)
 	FILE *in, *out;
 	int error;
 	int cloned;
+	int copied = 0;
 	struct stat src_st;
 	const char *open_mode = "wb";
 
 	uint64_t orig_out_size = 0U;
 	int correct_out_size = 0;
 
+	/* Hash of source data for verifying destination (NULL if not verifying). */
+	XXH3_state_t *hash = NULL;
+
 	ioeta_update(args->estim, src, dst, 0, 0);
 
 #ifdef _WIN32
@@ -546,7 +582,39 @@ iop_cp_internal(io_args_t *args)
 
 	/* TODO: use sendfile() if platform supports it. */
 
-	if(!error && !cloned)
+	/* Cloned file shares data with its source, there is nothing to verify. */
+	if(!error && !cloned && args->arg4.verify)
+	{
+		hash = XXH3_createState();
+		if(hash != NULL)
+		{
+			(void)XXH3_64bits_reset(hash);
+		}
+	}
+
+	if(!error && !cloned && crs != IO_CRS_APPEND_TO_FILES && is_sparse(&st))
+	{
+		const int result = copy_sparse(args, fileno(in), fileno(out), st.st_size,
+				hash);
+		if(result >= 0)
+		{
+			error = result;
+			copied = 1;
+		}
+	}
+
+	if(!error && !cloned && !copied && crs != IO_CRS_APPEND_TO_FILES &&
+			args->arg4.bulk_copy)
+	{
+		const int result = copy_bulk(args, fileno(in), fileno(out), hash);
+		if(result >= 0)
+		{
+			error = result;
+			copied = 1;
+		}
+	}
+
+	if(!error && !cloned && !copied)
 	{
 		char block[BLOCK_SIZE];
 		/* Suppress possible false-positive compiler warning. */
@@ -571,6 +639,11 @@ iop_cp_internal(io_args_t *args)
 				break;
 			}
 
+			if(hash != NULL)
+			{
+				(void)XXH3_64bits_update(hash, block, nread);
+			}
+
 			ioeta_update(args->estim, NULL, NULL, 0, nread);
 
 #ifndef _WIN32
@@ -630,6 +703,12 @@ iop_cp_internal(io_args_t *args)
 		error = 1;
 	}
 
+	if(error == 0 && hash != NULL)
+	{
+		error = verify_copy(args, orig_out_size, XXH3_64bits_digest(hash));
+	}
+	XXH3_freeState(hash);
+
 	if(error == 0 && os_lstat(src, &src_st) == 0)
 	{
 		error = os_chmod(dst, src_st.st_mode & 07777);
@@ -650,6 +729,430 @@ iop_cp_internal(io_args_t *args)
 	return io_res_from_code(error);
 }
 
+/* Checks whether file described by the stat structure has holes in it.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_sparse(const struct stat *st)
+{
+#if !defined(_WIN32) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+	return S_ISREG(st->st_mode)
+	    && (uint64_t)st->st_blocks*512U < (uint64_t)st->st_size;
+#else
+	(void)st;
+	return 0;
+#endif
+}
+
+/* Copies sparse file by transferring only its data extents, holes are
+ * recreated by seeking over them in the destination.  Skipped holes are
+ * reported as processed data to keep estimation correct.  Returns zero on
+ * success, positive number on error and negative number if sparse copying isn't
+ * supported (nothing is done in this case). */
+static int
+copy_sparse(io_args_t *args, int in_fd, int out_fd, uint64_t size,
+		XXH3_state_t *hash)
+{
+#if !defined(_WIN32) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+	const char *const src = args->arg1.src;
+	const char *const dst = args->arg2.dst;
+	const int data_sync = args->arg4.data_sync;
+
+	off_t pos = 0;
+	uint64_t ncopied = 0U;
+
+	/* Probe for support of the feature before doing anything. */
+	if(lseek(in_fd, 0, SEEK_DATA) < 0 && errno != ENXIO)
+	{
+		return -1;
+	}
+
+	while((uint64_t)pos < size)
+	{
+		off_t data = lseek(in_fd, pos, SEEK_DATA);
+		if(data < 0)
+		{
+			if(errno != ENXIO)
+			{
+				(void)ioe_errlst_append(&args->result.errors, src, errno,
+						"Failed to find data in source file");
+				return 1;
+			}
+			/* The rest of the file is a hole. */
+			data = size;
+		}
+
+		off_t hole = (data < (off_t)size ? lseek(in_fd, data, SEEK_HOLE) : data);
+		if(hole < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, src, errno,
+					"Failed to find hole in source file");
+			return 1;
+		}
+
+		hash_zeros(hash, data - pos);
+		ioeta_update(args->estim, NULL, NULL, 0, data - pos);
+
+		if(lseek(in_fd, data, SEEK_SET) < 0 || lseek(out_fd, data, SEEK_SET) < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, dst, errno,
+					"Failed to seek over a hole");
+			return 1;
+		}
+
+		while(data < hole)
+		{
+			char block[BLOCK_SIZE];
+
+			if(io_cancelled(args))
+			{
+				return 1;
+			}
+
+			const size_t to_read = MIN((uint64_t)(hole - data), sizeof(block));
+			const ssize_t nread = read(in_fd, block, to_read);
+			if(nread < 0)
+			{
+				(void)ioe_errlst_append(&args->result.errors, src, errno,
+						"Read from source file failed");
+				return 1;
+			}
+			if(nread == 0)
+			{
+				/* File got shorter while we were copying it. */
+				hole = data;
+				break;
+			}
+
+			if(write_all(out_fd, block, nread) != 0)
+			{
+				(void)ioe_errlst_append(&args->result.errors, dst, errno,
+						"Write to destination file failed");
+				return 1;
+			}
+
+			data += nread;
+			if(hash != NULL)
+			{
+				(void)XXH3_64bits_update(hash, block, nread);
+			}
+			ioeta_update(args->estim, NULL, NULL, 0, nread);
+
+			/* Force flushing data to disk to not pollute RAM with this data too
+			 * much. */
+			ncopied += nread;
+			if(data_sync && ncopied >= FLUSH_SIZE)
+			{
+				(void)os_fdatasync(out_fd);
+				ncopied -= FLUSH_SIZE;
+			}
+		}
+
+		pos = hole;
+	}
+
+	/* This also recreates trailing hole (if there is one). */
+	if(ftruncate(out_fd, size) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Failed to set size of destination file");
+		return 1;
+	}
+
+	return 0;
+#else
+	(void)args;
+	(void)in_fd;
+	(void)out_fd;
+	(void)size;
+	(void)hash;
+	return -1;
+#endif
+}
+
+/* Feeds hash with specified number of zero bytes, which is how holes of sparse
+ * files read.  The hash can be NULL. */
+static void
+hash_zeros(XXH3_state_t *hash, uint64_t len)
+{
+	static const char zeros[BLOCK_SIZE];
+
+	if(hash == NULL)
+	{
+		return;
+	}
+
+	while(len != 0U)
+	{
+		const size_t chunk = MIN(len, sizeof(zeros));
+		(void)XXH3_64bits_update(hash, zeros, chunk);
+		len -= chunk;
+	}
+}
+
+/* Copies file contents in a way that doesn't evict everything else from page
+ * cache: reads are announced as sequential, size of blocks adapts to speed of
+ * the devices and data that has been copied is written back and dropped from
+ * the cache in windows.  Returns zero on success, positive number on error and
+ * negative number if bulk copying isn't supported (nothing is done in this
+ * case). */
+static int
+copy_bulk(io_args_t *args, int in_fd, int out_fd, XXH3_state_t *hash)
+{
+#ifndef _WIN32
+	const char *const src = args->arg1.src;
+	const char *const dst = args->arg2.dst;
+
+	size_t block_size = BLOCK_SIZE;
+	char *block = malloc(block_size);
+	if(block == NULL)
+	{
+		return -1;
+	}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	(void)posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	int error = 0;
+	off_t pos = 0;
+	off_t window_start = 0;
+	off_t prev_window_start = 0;
+	for(;;)
+	{
+		if(io_cancelled(args))
+		{
+			error = 1;
+			break;
+		}
+
+		const long long started_at = time_in_ms();
+
+		const ssize_t nread = read(in_fd, block, block_size);
+		if(nread < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			(void)ioe_errlst_append(&args->result.errors, src, errno,
+					"Read from source file failed");
+			error = 1;
+			break;
+		}
+		if(nread == 0)
+		{
+			break;
+		}
+
+		if(write_all(out_fd, block, nread) != 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, dst, errno,
+					"Write to destination file failed");
+			error = 1;
+			break;
+		}
+
+		pos += nread;
+		if(hash != NULL)
+		{
+			(void)XXH3_64bits_update(hash, block, nread);
+		}
+		ioeta_update(args->estim, NULL, NULL, 0, nread);
+
+		if(pos - window_start >= BULK_WINDOW_SIZE)
+		{
+			/* Start writeback of the window just filled and finish previous one, this
+			 * way there is always at most two windows of dirty data. */
+#ifdef SYNC_FILE_RANGE_WRITE
+			(void)sync_file_range(out_fd, window_start, pos - window_start,
+					SYNC_FILE_RANGE_WRITE);
+			if(prev_window_start != window_start)
+			{
+				(void)sync_file_range(out_fd, prev_window_start,
+						window_start - prev_window_start,
+						SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+						SYNC_FILE_RANGE_WAIT_AFTER);
+				drop_window(in_fd, out_fd, prev_window_start, window_start);
+			}
+			prev_window_start = window_start;
+#else
+			(void)os_fdatasync(out_fd);
+			drop_window(in_fd, out_fd, window_start, pos);
+			prev_window_start = pos;
+#endif
+			window_start = pos;
+		}
+
+		if((size_t)nread != block_size)
+		{
+			continue;
+		}
+
+		const long long elapsed = time_in_ms() - started_at;
+		size_t new_block_size = block_size;
+		if(elapsed < BULK_BLOCK_TIME && block_size < BULK_MAX_BLOCK_SIZE)
+		{
+			new_block_size = block_size*2U;
+		}
+		else if(elapsed > 2*BULK_BLOCK_TIME && block_size > BLOCK_SIZE)
+		{
+			new_block_size = block_size/2U;
+		}
+
+		if(new_block_size != block_size)
+		{
+			char *const new_block = realloc(block, new_block_size);
+			if(new_block != NULL)
+			{
+				block = new_block;
+				block_size = new_block_size;
+			}
+		}
+	}
+
+	free(block);
+
+	if(!error)
+	{
+		/* Write out the tail and drop it from the cache as well. */
+		(void)os_fdatasync(out_fd);
+		drop_window(in_fd, out_fd, prev_window_start, pos);
+	}
+
+	return error;
+#else
+	(void)args;
+	(void)in_fd;
+	(void)out_fd;
+	(void)hash;
+	return -1;
+#endif
+}
+
+/* Re-reads destination file starting at the specified offset and compares hash
+ * of its contents with digest of the source data.  Mismatch is reported as an
+ * error.  Returns zero on success, otherwise non-zero is returned. */
+static int
+verify_copy(io_args_t *args, uint64_t from, XXH64_hash_t digest)
+{
+	const char *const dst = args->arg2.dst;
+
+	FILE *const in = os_fopen(dst, "rb");
+	if(in == NULL)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Failed to open destination file for verification");
+		return 1;
+	}
+
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+	/* Make sure data is read back from the storage rather than from cache. */
+	(void)os_fdatasync(fileno(in));
+	(void)posix_fadvise(fileno(in), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+
+	XXH3_state_t *const hash = XXH3_createState();
+	if(hash == NULL || fseek(in, from, SEEK_SET) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Failed to start verification");
+		XXH3_freeState(hash);
+		fclose(in);
+		return 1;
+	}
+	(void)XXH3_64bits_reset(hash);
+
+	int error = 0;
+	char block[BLOCK_SIZE];
+	size_t nread;
+	while((nread = fread(&block, 1, sizeof(block), in)) != 0U)
+	{
+		if(io_cancelled(args))
+		{
+			error = 1;
+			break;
+		}
+
+		(void)XXH3_64bits_update(hash, block, nread);
+	}
+
+	if(!error && ferror(in))
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Read from destination file failed");
+		error = 1;
+	}
+	else if(!error && XXH3_64bits_digest(hash) != digest)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, EIO,
+				"Destination file doesn't match the source");
+		error = 1;
+	}
+
+	XXH3_freeState(hash);
+	fclose(in);
+	return error;
+}
+
+#ifndef _WIN32
+
+/* Advises the kernel that specified range of both files won't be needed
+ * anymore.  Destination range should be already written back, otherwise the
+ * advice has no effect on it. */
+static void
+drop_window(int in_fd, int out_fd, off_t from, off_t to)
+{
+#ifdef POSIX_FADV_DONTNEED
+	if(to > from)
+	{
+		(void)posix_fadvise(in_fd, from, to - from, POSIX_FADV_DONTNEED);
+		(void)posix_fadvise(out_fd, from, to - from, POSIX_FADV_DONTNEED);
+	}
+#else
+	(void)in_fd;
+	(void)out_fd;
+	(void)from;
+	(void)to;
+#endif
+}
+
+/* Retrieves current time in milliseconds.  Returns the time. */
+static long long
+time_in_ms(void)
+{
+	struct timespec current_time;
+	if(clock_gettime(CLOCK_MONOTONIC, &current_time) != 0)
+	{
+		return 0;
+	}
+
+	return current_time.tv_sec*1000LL + current_time.tv_nsec/1000000;
+}
+
+/* Writes whole buffer to a file descriptor retrying on partial writes.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+write_all(int fd, const char buf[], size_t len)
+{
+	while(len != 0U)
+	{
+		const ssize_t nwritten = write(fd, buf, len);
+		if(nwritten < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return 1;
+		}
+		buf += nwritten;
+		len -= nwritten;
+	}
+	return 0;
+}
+
+#endif
+
 /* Try to clone file fast on btrfs.  Returns 0 on success, otherwise non-zero is
  * returned. */
 static int
@@ -38,6 +38,7 @@
 #include "private/ioc.h"
 #include "private/ioe.h"
 #include "private/ioeta.h"
+#include "private/remover.h"
 #include "private/traverser.h"
 #include "ioc.h"
 #include "iop.h"
@@ -60,6 +61,14 @@ IoRes
 ior_rm(io_args_t *args)
 {
 	const char *const path = args->arg1.path;
+
+#ifndef _WIN32
+	if(!is_symlink(path) && is_dir(path))
+	{
+		return remover_rm(args);
+	}
+#endif
+
 	return traverse(path, &rm_visitor, args);
 }
 
@@ -432,6 +441,8 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 					/* It's safe to always use fast file cloning on moving files. */
 					.arg4.fast_file_cloning = cp ? cp_args->arg4.fast_file_cloning : 1,
 					.arg4.data_sync = cp_args->arg4.data_sync,
+					.arg4.bulk_copy = cp_args->arg4.bulk_copy,
+					.arg4.verify = cp_args->arg4.verify,
 
 					.cancellation = cp_args->cancellation,
 					.confirm = cp_args->confirm,
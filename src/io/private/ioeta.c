@@ -23,11 +23,15 @@
 #include <stdlib.h> /* free() */
 #include <string.h> /* strdup() */
 
+#include "../../compat/pthread.h"
 #include "../../utils/fs.h"
+#include "../../utils/macros.h"
 #include "../../utils/str.h"
 #include "../ioeta.h"
 #include "ionotif.h"
 
+static void adjust_totals(ioeta_estim_t *estim);
+
 void
 ioeta_release(ioeta_estim_t *estim)
 {
@@ -35,6 +39,35 @@ ioeta_release(ioeta_estim_t *estim)
 	free(estim->target);
 }
 
+void
+ioeta_merge(ioeta_estim_t *estim)
+{
+	ioeta_walker_t *const walker = estim->walker;
+	if(walker == NULL || pthread_mutex_lock(&walker->lock) != 0)
+	{
+		return;
+	}
+
+	const size_t items = walker->items;
+	const uint64_t bytes = walker->bytes;
+	(void)pthread_mutex_unlock(&walker->lock);
+
+	size_t new_items = items - walker->merged_items;
+	uint64_t new_bytes = bytes - walker->merged_bytes;
+	walker->merged_items = items;
+	walker->merged_bytes = bytes;
+
+	/* Part of newly found items might have already been accounted for by
+	 * processing which outran estimation. */
+	const size_t lead_items = MIN(new_items, walker->lead_items);
+	const uint64_t lead_bytes = MIN(new_bytes, walker->lead_bytes);
+	walker->lead_items -= lead_items;
+	walker->lead_bytes -= lead_bytes;
+
+	estim->total_items += new_items - lead_items;
+	estim->total_bytes += new_bytes - lead_bytes;
+}
+
 void
 ioeta_add_item(ioeta_estim_t *estim, const char path[])
 {
@@ -78,22 +111,14 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		return;
 	}
 
+	ioeta_merge(estim);
+
 	estim->current_byte += bytes;
 	estim->current_file_byte += bytes;
-	if(estim->current_byte > estim->total_bytes)
-	{
-		/* Estimations are out of date, update them. */
-		estim->total_bytes = estim->current_byte;
-	}
 
 	if(finished)
 	{
 		++estim->current_item;
-		if(estim->current_item > estim->total_items)
-		{
-			/* Estimations are out of date, update them. */
-			estim->total_items = estim->current_item;
-		}
 		estim->current_file_byte = 0U;
 		estim->total_file_bytes = 0U;
 	}
@@ -103,6 +128,8 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		estim->total_file_bytes = get_file_size(path);
 	}
 
+	adjust_totals(estim);
+
 	if(path != NULL)
 	{
 		replace_string(&estim->item, path);
@@ -116,6 +143,62 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 	ionotif_notify(IO_PS_IN_PROGRESS, estim);
 }
 
+void
+ioeta_update_batch(ioeta_estim_t *estim, const char path[],
+		const char target[], size_t items, uint64_t bytes)
+{
+	if(estim == NULL || estim->silent)
+	{
+		return;
+	}
+
+	ioeta_merge(estim);
+
+	estim->current_byte += bytes;
+	estim->current_item += items;
+	estim->current_file_byte = 0U;
+	estim->total_file_bytes = 0U;
+
+	adjust_totals(estim);
+
+	if(path != NULL)
+	{
+		replace_string(&estim->item, path);
+	}
+
+	if(target != NULL)
+	{
+		replace_string(&estim->target, target);
+	}
+
+	ionotif_notify(IO_PS_IN_PROGRESS, estim);
+}
+
+/* Makes sure that totals of estimation aren't less than current values. */
+static void
+adjust_totals(ioeta_estim_t *estim)
+{
+	if(estim->current_byte > estim->total_bytes)
+	{
+		/* Estimations are out of date or incomplete, update them. */
+		if(estim->walker != NULL)
+		{
+			estim->walker->lead_bytes += estim->current_byte - estim->total_bytes;
+		}
+		estim->total_bytes = estim->current_byte;
+	}
+
+	if(estim->current_item > estim->total_items)
+	{
+		/* Estimations are out of date or incomplete, update them. */
+		if(estim->walker != NULL)
+		{
+			estim->walker->lead_items += estim->current_item - estim->total_items;
+		}
+		estim->total_items = estim->current_item;
+	}
+}
+
 int
 ioeta_silent_on(ioeta_estim_t *estim)
 {
@@ -155,6 +238,8 @@ ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save)
 {
 	char *item = estim->item;
 	char *target = estim->target;
+	const size_t total_items = estim->total_items;
+	const uint64_t total_bytes = estim->total_bytes;
 
 	if(estim->silent)
 	{
@@ -167,6 +252,14 @@ ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save)
 	*estim = *save;
 	estim->item = item;
 	estim->target = target;
+
+	if(estim->walker != NULL)
+	{
+		/* Totals might have been extended by asynchronous estimation since the
+		 * save, don't lose results that were already merged. */
+		estim->total_items = MAX(estim->total_items, total_items);
+		estim->total_bytes = MAX(estim->total_bytes, total_bytes);
+	}
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -19,16 +19,48 @@
 #ifndef VIFM__IO__PRIVATE__IOETA_H__
 #define VIFM__IO__PRIVATE__IOETA_H__
 
+#include <stddef.h> /* size_t */
 #include <stdint.h> /* uint64_t */
 
+#include "../../compat/pthread.h"
 #include "../ioeta.h"
 
 /* ioeta - private functions of Input/Output estimation */
 
+/* State of estimation that is performed by a separate thread walking ahead of
+ * the operation.  Results are accumulated here and get merged into the
+ * estimation by the thread that performs the operation. */
+typedef struct ioeta_walker_t
+{
+	pthread_t thread;     /* Thread that traverses file system. */
+	pthread_mutex_t lock; /* Protects fields below up to merge state. */
+	pthread_cond_t cond;  /* Signals changes of the queue and of state. */
+
+	char **paths; /* Queue of paths to be estimated. */
+	int npaths;   /* Number of elements in the queue. */
+	int next;     /* Index of the next path to process. */
+	int busy;     /* Whether walking is in progress. */
+	int stop;     /* Whether walking should be aborted. */
+
+	size_t items;   /* Number of items found so far. */
+	uint64_t bytes; /* Size of files found so far. */
+
+	/* Merge state, which is used only by the thread of the operation. */
+	size_t merged_items;   /* Number of items already merged into estimation. */
+	uint64_t merged_bytes; /* Number of bytes already merged into estimation. */
+	size_t lead_items;     /* Number of items processed beyond estimation. */
+	uint64_t lead_bytes;   /* Number of bytes processed beyond estimation. */
+}
+ioeta_walker_t;
+
 /* Frees resources of estimation, but not the structure itself.  estim can't be
  * NULL. */
 void ioeta_release(ioeta_estim_t *estim);
 
+/* Merges results of asynchronous estimation into totals of the estimation.
+ * Does nothing if there is no asynchronous estimation. */
+void ioeta_merge(ioeta_estim_t *estim);
+
 /* Adds zero-size item to the estimation. */
 void ioeta_add_item(ioeta_estim_t *estim, const char path[]);
 
@@ -48,6 +80,12 @@ void ioeta_add_dir(ioeta_estim_t *estim, const char path[]);
 void ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes);
 
+/* Same as ioeta_update() for several items that have been processed in full
+ * since the last update, but calls progress changed notification handler only
+ * once. */
+void ioeta_update_batch(ioeta_estim_t *estim, const char path[],
+		const char target[], size_t items, uint64_t bytes);
+
 /* Silence future progress reports.  Returns previous state to be passed to
  * ioeta_silent_set() later.  If estim is NULL, returns zero. */
 int ioeta_silent_on(ioeta_estim_t *estim);
@@ -0,0 +1,678 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "remover.h"
+
+#include <sys/stat.h> /* S_ISDIR() S_ISREG() fstatat() stat */
+#include <dirent.h> /* DIR closedir() fdopendir() readdir() */
+#include <fcntl.h> /* AT_FDCWD AT_REMOVEDIR AT_SYMLINK_NOFOLLOW O_* openat() */
+#include <unistd.h> /* close() dup() sysconf() unlinkat() */
+
+#include <errno.h> /* ETIMEDOUT errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strdup() strrchr() */
+#include <time.h> /* CLOCK_REALTIME clock_gettime() timespec */
+
+#include "../../compat/pthread.h"
+#include "../../utils/macros.h"
+#include "../../utils/path.h"
+#include "../../utils/str.h"
+#include "../../utils/utils.h"
+#include "../ioc.h"
+#include "../iop.h"
+#include "ioc.h"
+#include "ioe.h"
+#include "ioeta.h"
+
+/* Maximum number of threads that remove files. */
+#define MAX_WORKERS 4
+
+/* Number of removed items after which progress is reported. */
+#define PROGRESS_BATCH 256
+
+/* How often cancellation is checked while waiting for workers (in
+ * milliseconds). */
+#define POLL_INTERVAL 50
+
+/* Directory whose content is being removed. */
+typedef struct rm_dir_t rm_dir_t;
+struct rm_dir_t
+{
+	rm_dir_t *parent; /* Parent directory or NULL for the root. */
+	rm_dir_t *next;   /* Next directory in the queue. */
+	char *path;       /* Full path to the directory for reporting. */
+	const char *name; /* Path relative to descriptor of the parent. */
+	int fd;           /* Descriptor of the directory or -1. */
+	int pending;      /* Unfinished subdirectories plus one while listing. */
+};
+
+/* State of removal shared by the workers and the thread that started it. */
+typedef struct
+{
+	io_args_t *args; /* Arguments of the operation. */
+
+	pthread_mutex_t lock;       /* Protects all fields below. */
+	pthread_cond_t work_cond;   /* Signals new directories and completion. */
+	pthread_cond_t event_cond;  /* Signals progress and failures. */
+	pthread_cond_t reply_cond;  /* Signals handling of failures. */
+
+	pthread_t workers[MAX_WORKERS]; /* Worker threads. */
+	int max_workers;                /* Limit on number of workers. */
+	int nworkers;                   /* Number of started workers. */
+	int active;                     /* Number of busy workers. */
+
+	rm_dir_t *queue; /* Stack of directories to be processed. */
+	int done;        /* Whether all directories have been processed. */
+	int stop;        /* Whether processing should be aborted. */
+	IoRes result;    /* Result of the operation. */
+
+	size_t items;   /* Number of items removed since last report. */
+	uint64_t bytes; /* Size of files removed since last report. */
+	char *item;     /* Last processed directory or NULL. */
+
+	char *failed_path;   /* Path that failed to be removed or NULL. */
+	int failed_dir;      /* Whether failed_path is a directory. */
+	int failure_handled; /* Whether failure has been dealt with. */
+}
+remover_t;
+
+static int init_remover(remover_t *rm, io_args_t *args);
+static void free_remover(remover_t *rm);
+static void coordinate(remover_t *rm);
+static void handle_failure(remover_t *rm, const char path[], int dir);
+static int push_dir(remover_t *rm, rm_dir_t *parent, char *path);
+static void * worker_thread(void *arg);
+static void process_dir(remover_t *rm, rm_dir_t *dir);
+static void list_dir(remover_t *rm, rm_dir_t *dir);
+static int entry_is_dir(int dir_fd, const struct dirent *d, uint64_t *size);
+static void finish_dir(remover_t *rm, rm_dir_t *dir);
+static void report_failure(remover_t *rm, const char path[], int dir);
+static void report_progress(remover_t *rm, const char path[], size_t items,
+		uint64_t bytes);
+static int is_stopped(remover_t *rm);
+
+IoRes
+remover_rm(io_args_t *args)
+{
+	const char *const path = args->arg1.path;
+
+	if(io_cancelled(args))
+	{
+		return IO_RES_ABORTED;
+	}
+
+	remover_t rm;
+	if(init_remover(&rm, args) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, path, IO_ERR_UNKNOWN,
+				"Failed to start removal");
+		return IO_RES_FAILED;
+	}
+
+	int error = 0;
+	char *const root_path = strdup(path);
+	if(pthread_mutex_lock(&rm.lock) == 0)
+	{
+		error = (root_path == NULL || push_dir(&rm, NULL, root_path) != 0);
+		(void)pthread_mutex_unlock(&rm.lock);
+	}
+
+	if(error || rm.nworkers == 0)
+	{
+		if(!error)
+		{
+			free(rm.queue->path);
+			free(rm.queue);
+		}
+		free_remover(&rm);
+		(void)ioe_errlst_append(&args->result.errors, path, IO_ERR_UNKNOWN,
+				"Failed to start removal");
+		return IO_RES_FAILED;
+	}
+
+	coordinate(&rm);
+
+	int i;
+	for(i = 0; i < rm.nworkers; ++i)
+	{
+		(void)pthread_join(rm.workers[i], NULL);
+	}
+
+	const IoRes result = rm.result;
+	free_remover(&rm);
+	return result;
+}
+
+/* Initializes state of removal.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+init_remover(remover_t *rm, io_args_t *args)
+{
+	*rm = (remover_t){ .args = args, .result = IO_RES_SUCCEEDED };
+
+	const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	rm->max_workers = (ncpus < 1) ? 1 : MIN(ncpus, MAX_WORKERS);
+
+	if(pthread_mutex_init(&rm->lock, NULL) != 0)
+	{
+		return 1;
+	}
+	if(pthread_cond_init(&rm->work_cond, NULL) != 0)
+	{
+		(void)pthread_mutex_destroy(&rm->lock);
+		return 1;
+	}
+	if(pthread_cond_init(&rm->event_cond, NULL) != 0)
+	{
+		(void)pthread_cond_destroy(&rm->work_cond);
+		(void)pthread_mutex_destroy(&rm->lock);
+		return 1;
+	}
+	if(pthread_cond_init(&rm->reply_cond, NULL) != 0)
+	{
+		(void)pthread_cond_destroy(&rm->event_cond);
+		(void)pthread_cond_destroy(&rm->work_cond);
+		(void)pthread_mutex_destroy(&rm->lock);
+		return 1;
+	}
+	return 0;
+}
+
+/* Frees resources of removal state, but not the structure itself. */
+static void
+free_remover(remover_t *rm)
+{
+	(void)pthread_cond_destroy(&rm->reply_cond);
+	(void)pthread_cond_destroy(&rm->event_cond);
+	(void)pthread_cond_destroy(&rm->work_cond);
+	(void)pthread_mutex_destroy(&rm->lock);
+	free(rm->item);
+}
+
+/* Serves requests of workers until they are done.  Everything that can call
+ * back into the rest of the application happens here. */
+static void
+coordinate(remover_t *rm)
+{
+	if(pthread_mutex_lock(&rm->lock) != 0)
+	{
+		return;
+	}
+
+	while(1)
+	{
+		if(rm->failed_path != NULL && !rm->failure_handled)
+		{
+			char *const path = rm->failed_path;
+			const int dir = rm->failed_dir;
+			const int stop = rm->stop;
+
+			(void)pthread_mutex_unlock(&rm->lock);
+			if(!stop)
+			{
+				handle_failure(rm, path, dir);
+			}
+			if(pthread_mutex_lock(&rm->lock) != 0)
+			{
+				return;
+			}
+
+			rm->failure_handled = 1;
+			(void)pthread_cond_broadcast(&rm->reply_cond);
+			continue;
+		}
+
+		if(rm->items != 0U)
+		{
+			const size_t items = rm->items;
+			const uint64_t bytes = rm->bytes;
+			char *const item = rm->item;
+			rm->items = 0U;
+			rm->bytes = 0U;
+			rm->item = NULL;
+
+			(void)pthread_mutex_unlock(&rm->lock);
+			ioeta_update_batch(rm->args->estim, item, item, items, bytes);
+			free(item);
+			if(pthread_mutex_lock(&rm->lock) != 0)
+			{
+				return;
+			}
+			continue;
+		}
+
+		if(rm->done)
+		{
+			break;
+		}
+
+		struct timespec deadline;
+		(void)clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += POLL_INTERVAL*1000000L;
+		if(deadline.tv_nsec >= 1000000000L)
+		{
+			++deadline.tv_sec;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		const int error =
+			pthread_cond_timedwait(&rm->event_cond, &rm->lock, &deadline);
+		if(error != 0 && error != ETIMEDOUT)
+		{
+			break;
+		}
+
+		if(!rm->stop)
+		{
+			(void)pthread_mutex_unlock(&rm->lock);
+			const int cancelled = io_cancelled(rm->args);
+			if(pthread_mutex_lock(&rm->lock) != 0)
+			{
+				return;
+			}
+
+			if(cancelled && !rm->stop)
+			{
+				rm->stop = 1;
+				rm->result = IO_RES_ABORTED;
+				(void)pthread_cond_broadcast(&rm->work_cond);
+				(void)pthread_cond_broadcast(&rm->reply_cond);
+			}
+		}
+	}
+
+	(void)pthread_mutex_unlock(&rm->lock);
+}
+
+/* Retries removal of a path that failed to be removed by a worker in the same
+ * way as it's done for removal without workers, which takes care of reporting
+ * the error and of asking the user what to do about it. */
+static void
+handle_failure(remover_t *rm, const char path[], int dir)
+{
+	io_args_t *const rm_args = rm->args;
+	io_args_t args = {
+		.arg1.path = path,
+
+		.cancellation = rm_args->cancellation,
+		.estim = rm_args->estim,
+
+		.result = rm_args->result,
+	};
+
+	const IoRes result = (dir ? iop_rmdir(&args) : iop_rmfile(&args));
+	rm_args->result = args.result;
+
+	if(result == IO_RES_FAILED || result == IO_RES_ABORTED)
+	{
+		if(pthread_mutex_lock(&rm->lock) == 0)
+		{
+			if(!rm->stop)
+			{
+				rm->stop = 1;
+				rm->result = result;
+				(void)pthread_cond_broadcast(&rm->work_cond);
+				(void)pthread_cond_broadcast(&rm->reply_cond);
+			}
+			(void)pthread_mutex_unlock(&rm->lock);
+		}
+	}
+}
+
+/* Queues directory for processing and starts another worker if all of them
+ * are busy.  Takes ownership of the path.  Must be called with the lock held.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+push_dir(remover_t *rm, rm_dir_t *parent, char *path)
+{
+	rm_dir_t *const dir = calloc(1, sizeof(*dir));
+	if(dir == NULL)
+	{
+		free(path);
+		return 1;
+	}
+
+	dir->parent = parent;
+	dir->path = path;
+	dir->name = (parent == NULL ? path : strrchr(path, '/') + 1);
+	dir->fd = -1;
+	dir->pending = 1;
+
+	if(parent != NULL)
+	{
+		++parent->pending;
+	}
+
+	dir->next = rm->queue;
+	rm->queue = dir;
+
+	if(rm->active == rm->nworkers && rm->nworkers < rm->max_workers)
+	{
+		if(pthread_create(&rm->workers[rm->nworkers], NULL, &worker_thread,
+					rm) == 0)
+		{
+			++rm->nworkers;
+		}
+	}
+
+	(void)pthread_cond_signal(&rm->work_cond);
+	return 0;
+}
+
+/* Entry point of a worker thread.  Processes queued directories until there
+ * are none left.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	remover_t *const rm = arg;
+
+	block_all_thread_signals();
+
+	if(pthread_mutex_lock(&rm->lock) != 0)
+	{
+		return NULL;
+	}
+
+	while(!rm->done)
+	{
+		rm_dir_t *const dir = rm->queue;
+		if(dir == NULL)
+		{
+			if(pthread_cond_wait(&rm->work_cond, &rm->lock) != 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		rm->queue = dir->next;
+		++rm->active;
+		(void)pthread_mutex_unlock(&rm->lock);
+
+		process_dir(rm, dir);
+
+		if(pthread_mutex_lock(&rm->lock) != 0)
+		{
+			return NULL;
+		}
+
+		if(--rm->active == 0 && rm->queue == NULL)
+		{
+			rm->done = 1;
+			(void)pthread_cond_broadcast(&rm->work_cond);
+			(void)pthread_cond_signal(&rm->event_cond);
+		}
+	}
+
+	(void)pthread_mutex_unlock(&rm->lock);
+	return NULL;
+}
+
+/* Removes files of a directory and queues its subdirectories. */
+static void
+process_dir(remover_t *rm, rm_dir_t *dir)
+{
+	if(!is_stopped(rm))
+	{
+		const int parent_fd = (dir->parent == NULL ? AT_FDCWD : dir->parent->fd);
+		dir->fd = openat(parent_fd, dir->name,
+				O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+		if(dir->fd == -1)
+		{
+			/* Let the usual removal report why this directory can't be removed. */
+			report_failure(rm, dir->path, 1);
+		}
+		else
+		{
+			list_dir(rm, dir);
+		}
+	}
+
+	finish_dir(rm, dir);
+}
+
+/* Removes all files of a directory and queues its subdirectories. */
+static void
+list_dir(remover_t *rm, rm_dir_t *dir)
+{
+	const int fd = dup(dir->fd);
+	DIR *const d = (fd == -1 ? NULL : fdopendir(fd));
+	if(d == NULL)
+	{
+		if(fd != -1)
+		{
+			(void)close(fd);
+		}
+		report_failure(rm, dir->path, 1);
+		return;
+	}
+
+	const int track_sizes = (rm->args->estim != NULL);
+	size_t items = 0U;
+	uint64_t bytes = 0U;
+	size_t nentries = 0U;
+
+	struct dirent *entry;
+	while((entry = readdir(d)) != NULL)
+	{
+		if(is_builtin_dir(entry->d_name))
+		{
+			continue;
+		}
+
+		/* Not checking this on every entry to avoid contention on the lock. */
+		if(++nentries%PROGRESS_BATCH == 0U && is_stopped(rm))
+		{
+			break;
+		}
+
+		uint64_t size = 0U;
+		if(entry_is_dir(dir->fd, entry, track_sizes ? &size : NULL))
+		{
+			char *const path = join_paths(dir->path, entry->d_name);
+			if(path != NULL && pthread_mutex_lock(&rm->lock) == 0)
+			{
+				(void)push_dir(rm, dir, path);
+				(void)pthread_mutex_unlock(&rm->lock);
+			}
+			continue;
+		}
+
+		if(unlinkat(dir->fd, entry->d_name, 0) == 0)
+		{
+			++items;
+			bytes += size;
+			if(items == PROGRESS_BATCH)
+			{
+				report_progress(rm, dir->path, items, bytes);
+				items = 0U;
+				bytes = 0U;
+			}
+			continue;
+		}
+
+		report_progress(rm, dir->path, items, bytes);
+		items = 0U;
+		bytes = 0U;
+
+		char *const path = join_paths(dir->path, entry->d_name);
+		if(path != NULL)
+		{
+			report_failure(rm, path, 0);
+			free(path);
+		}
+	}
+
+	report_progress(rm, dir->path, items, bytes);
+	(void)closedir(d);
+}
+
+/* Checks whether directory entry is a directory (not a symbolic link to it).
+ * Sets *size to size of regular files unless size is NULL.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+entry_is_dir(int dir_fd, const struct dirent *d, uint64_t *size)
+{
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+	if(d->d_type != DT_UNKNOWN && (d->d_type != DT_REG || size == NULL))
+	{
+		return (d->d_type == DT_DIR);
+	}
+#endif
+
+	struct stat st;
+	if(fstatat(dir_fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+	{
+		return 0;
+	}
+
+	if(S_ISREG(st.st_mode) && size != NULL)
+	{
+		*size = st.st_size;
+	}
+	return S_ISDIR(st.st_mode);
+}
+
+/* Marks directory as listed or one of its subdirectories as finished.  Removes
+ * directories which have no unfinished subdirectories left. */
+static void
+finish_dir(remover_t *rm, rm_dir_t *dir)
+{
+	while(dir != NULL)
+	{
+		if(pthread_mutex_lock(&rm->lock) != 0)
+		{
+			return;
+		}
+		const int last = (--dir->pending == 0);
+		const int stop = rm->stop;
+		(void)pthread_mutex_unlock(&rm->lock);
+
+		if(!last)
+		{
+			return;
+		}
+
+		/* Directories that failed to be opened have been dealt with already. */
+		if(dir->fd != -1)
+		{
+			(void)close(dir->fd);
+
+			if(!stop)
+			{
+				const int parent_fd =
+					(dir->parent == NULL ? AT_FDCWD : dir->parent->fd);
+				if(unlinkat(parent_fd, dir->name, AT_REMOVEDIR) == 0)
+				{
+					report_progress(rm, dir->path, 1U, 0U);
+				}
+				else
+				{
+					report_failure(rm, dir->path, 1);
+				}
+			}
+		}
+
+		rm_dir_t *const parent = dir->parent;
+		free(dir->path);
+		free(dir);
+		dir = parent;
+	}
+}
+
+/* Passes failure to the thread that started removal and waits until it's
+ * handled. */
+static void
+report_failure(remover_t *rm, const char path[], int dir)
+{
+	char *const failed_path = strdup(path);
+	if(failed_path == NULL || pthread_mutex_lock(&rm->lock) != 0)
+	{
+		free(failed_path);
+		return;
+	}
+
+	/* Wait for failures of other workers to be handled. */
+	while(rm->failed_path != NULL && !rm->stop)
+	{
+		if(pthread_cond_wait(&rm->reply_cond, &rm->lock) != 0)
+		{
+			break;
+		}
+	}
+
+	if(rm->failed_path == NULL && !rm->stop)
+	{
+		rm->failed_path = failed_path;
+		rm->failed_dir = dir;
+		rm->failure_handled = 0;
+		(void)pthread_cond_signal(&rm->event_cond);
+
+		while(!rm->failure_handled)
+		{
+			if(pthread_cond_wait(&rm->reply_cond, &rm->lock) != 0)
+			{
+				break;
+			}
+		}
+
+		rm->failed_path = NULL;
+		(void)pthread_cond_broadcast(&rm->reply_cond);
+	}
+
+	(void)pthread_mutex_unlock(&rm->lock);
+	free(failed_path);
+}
+
+/* Accumulates progress to be reported by the thread that started removal. */
+static void
+report_progress(remover_t *rm, const char path[], size_t items,
+		uint64_t bytes)
+{
+	if(items == 0U || rm->args->estim == NULL)
+	{
+		return;
+	}
+
+	if(pthread_mutex_lock(&rm->lock) == 0)
+	{
+		rm->items += items;
+		rm->bytes += bytes;
+		(void)replace_string(&rm->item, path);
+		(void)pthread_cond_signal(&rm->event_cond);
+		(void)pthread_mutex_unlock(&rm->lock);
+	}
+}
+
+/* Checks whether removal is being aborted.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+is_stopped(remover_t *rm)
+{
+	int stop = 1;
+	if(pthread_mutex_lock(&rm->lock) == 0)
+	{
+		stop = rm->stop;
+		(void)pthread_mutex_unlock(&rm->lock);
+	}
+	return stop;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,35 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__IO__PRIVATE__REMOVER_H__
+#define VIFM__IO__PRIVATE__REMOVER_H__
+
+#include "../ioc.h"
+
+/* remover - parallel removal of directory trees (not available on Windows) */
+
+/* Removes directory specified by args->arg1.path along with all of its
+ * content.  Directories are processed via their descriptors by a small pool of
+ * threads, while progress reports, error handling and cancellation checks are
+ * all performed by the calling thread.  Returns status of the operation. */
+IoRes remover_rm(io_args_t *args);
+
+#endif /* VIFM__IO__PRIVATE__REMOVER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -59,22 +59,35 @@ typedef char (*macro_filter_func)(int *quoted, char c, char data,
 /* File iteration function. */
 typedef int (*iter_func)(view_t *view, dir_entry_t **entry);
 
+/* State for which macros are expanded. */
+typedef struct
+{
+	view_t *curr;                /* View that is considered to be current. */
+	view_t *other;               /* View that is considered to be inactive. */
+	const dir_entry_t *entry;    /* Entry under cursor of the current view without
+	                                selection or NULL to use actual state. */
+	const preview_area_t *parea; /* Preview area or NULL to guess it. */
+}
+macro_ctx_t;
+
 static char filter_all(int *quoted, char c, char data, int ncurr, int nother);
 static char filter_single(int *quoted, char c, char data,
 		int ncurr, int nother);
 static char * expand_macros_i(const char command[], const char args[],
-		MacroFlags *flags, int for_shell, int for_op, macro_filter_func filter);
-TSTATIC char * append_selected_files(view_t *view, char expanded[],
-		int under_cursor, int quotes, const char mod[], iter_func iter,
-		int for_shell);
+		MacroFlags *flags, int for_shell, int for_op, macro_filter_func filter,
+		const macro_ctx_t *ctx);
+TSTATIC char * append_selected_files(view_t *view, const dir_entry_t *entry,
+		char expanded[], int under_cursor, int quotes, const char mod[],
+		iter_func iter, int for_shell);
 static char * append_entry(view_t *view, char expanded[], PathType type,
-		dir_entry_t *entry, int quotes, const char mod[], int for_shell);
+		const dir_entry_t *entry, int quotes, const char mod[], int for_shell);
 static char * expand_directory_path(view_t *view, char *expanded, int quotes,
 		const char *mod, int for_shell);
 static char * expand_register(const char curr_dir[], char expanded[],
 		int quotes, const char mod[], int key, int *well_formed, int for_shell);
-static char * expand_preview(char expanded[], int key, int *well_formed);
-static preview_area_t get_preview_area(view_t *view);
+static char * expand_preview(const macro_ctx_t *ctx, char expanded[], int key,
+		int *well_formed);
+static preview_area_t get_preview_area(const macro_ctx_t *ctx);
 static char * append_path_to_expanded(char expanded[], int quotes,
 		const char path[]);
 static char * append_to_expanded(char expanded[], const char str[]);
@@ -93,8 +106,31 @@ ma_expand(const char command[], const char args[], MacroFlags *flags,
 	int lpending_marking = lwin.pending_marking;
 	int rpending_marking = rwin.pending_marking;
 
+	const macro_ctx_t ctx = { .curr = curr_view, .other = other_view };
 	char *res = expand_macros_i(command, args, flags, for_shell, for_op,
-			&filter_all);
+			&filter_all, &ctx);
+
+	lwin.pending_marking = lpending_marking;
+	rwin.pending_marking = rpending_marking;
+
+	return res;
+}
+
+char *
+ma_expand_for_entry(const char command[], view_t *view,
+		const dir_entry_t *entry, const preview_area_t *parea, MacroFlags *flags)
+{
+	int lpending_marking = lwin.pending_marking;
+	int rpending_marking = rwin.pending_marking;
+
+	const macro_ctx_t ctx = {
+		.curr = view,
+		.other = (view == curr_view ? other_view : curr_view),
+		.entry = entry,
+		.parea = parea,
+	};
+	char *const res = expand_macros_i(command, NULL, flags, /*for_shell=*/1,
+			/*for_op=*/0, &filter_all, &ctx);
 
 	lwin.pending_marking = lpending_marking;
 	rwin.pending_marking = rpending_marking;
@@ -116,8 +152,9 @@ ma_expand_single(const char command[])
 	int lpending_marking = lwin.pending_marking;
 	int rpending_marking = rwin.pending_marking;
 
+	const macro_ctx_t ctx = { .curr = curr_view, .other = other_view };
 	char *const res = expand_macros_i(command, NULL, NULL, /*for_shell=*/0,
-			/*for_op=*/0, &filter_single);
+			/*for_op=*/0, &filter_single, &ctx);
 
 	lwin.pending_marking = lpending_marking;
 	rwin.pending_marking = rpending_marking;
@@ -164,7 +201,8 @@ filter_single(int *quoted, char c, char data, int ncurr, int nother)
  * values. */
 static char *
 expand_macros_i(const char command[], const char args[], MacroFlags *flags,
-		int for_shell, int for_op, macro_filter_func filter)
+		int for_shell, int for_op, macro_filter_func filter,
+		const macro_ctx_t *ctx)
 {
 	/* TODO: refactor this function expand_macros_i() */
 	/* FIXME: repetitive len = strlen(expanded) could be optimized. */
@@ -200,14 +238,14 @@ expand_macros_i(const char command[], const char args[], MacroFlags *flags,
 		flist_set_marking(&lwin, 0);
 		flist_set_marking(&rwin, 0);
 
-		ncurr = flist_count_marked(curr_view);
-		nother = flist_count_marked(other_view);
+		ncurr = flist_count_marked(ctx->curr);
+		nother = flist_count_marked(ctx->other);
 	}
 	else
 	{
 		iter = &iter_selection_or_current;
-		ncurr = curr_view->selected_files;
-		nother = other_view->selected_files;
+		ncurr = (ctx->entry == NULL ? ctx->curr->selected_files : 0);
+		nother = ctx->other->selected_files;
 	}
 
 	if(strstr(command + x, "%r") != NULL)
@@ -245,50 +283,50 @@ expand_macros_i(const char command[], const char args[], MacroFlags *flags,
 				}
 				break;
 			case 'b': /* selected files of both dirs */
-				expanded = append_selected_files(curr_view, expanded, 0, quotes,
-						command + x + 1, iter, for_shell);
+				expanded = append_selected_files(ctx->curr, ctx->entry, expanded, 0,
+						quotes, command + x + 1, iter, for_shell);
 				expanded = append_to_expanded(expanded, " ");
-				expanded = append_selected_files(other_view, expanded, 0, quotes,
-						command + x + 1, iter, for_shell);
+				expanded = append_selected_files(ctx->other, NULL, expanded, 0,
+						quotes, command + x + 1, iter, for_shell);
 				len = strlen(expanded);
 				break;
 			case 'c': /* current dir file under the cursor */
-				expanded = append_selected_files(curr_view, expanded, 1, quotes,
-						command + x + 1, iter, for_shell);
+				expanded = append_selected_files(ctx->curr, ctx->entry, expanded, 1,
+						quotes, command + x + 1, iter, for_shell);
 				len = strlen(expanded);
 				break;
 			case 'C': /* other dir file under the cursor */
-				expanded = append_selected_files(other_view, expanded, 1, quotes,
-						command + x + 1, iter, for_shell);
+				expanded = append_selected_files(ctx->other, NULL, expanded, 1,
+						quotes, command + x + 1, iter, for_shell);
 				len = strlen(expanded);
 				break;
 			case 'f': /* current dir selected files */
-				expanded = append_selected_files(curr_view, expanded, 0, quotes,
-						command + x + 1, iter, for_shell);
+				expanded = append_selected_files(ctx->curr, ctx->entry, expanded, 0,
+						quotes, command + x + 1, iter, for_shell);
 				len = strlen(expanded);
 				break;
 			case 'F': /* other dir selected files */
-				expanded = append_selected_files(other_view, expanded, 0, quotes,
-						command + x + 1, iter, for_shell);
+				expanded = append_selected_files(ctx->other, NULL, expanded, 0,
+						quotes, command + x + 1, iter, for_shell);
 				len = strlen(expanded);
 				break;
 			case 'l': /* current dir selected files or nothing if no selection */
-				expanded = append_selected_files(curr_view, expanded, 0, quotes,
-						command + x + 1, &iter_selected_entries, for_shell);
+				expanded = append_selected_files(ctx->curr, ctx->entry, expanded, 0,
+						quotes, command + x + 1, &iter_selected_entries, for_shell);
 				len = strlen(expanded);
 				break;
 			case 'L': /* other dir selected files or nothing if no selection */
-				expanded = append_selected_files(other_view, expanded, 0, quotes,
-						command + x + 1, &iter_selected_entries, for_shell);
+				expanded = append_selected_files(ctx->other, NULL, expanded, 0,
+						quotes, command + x + 1, &iter_selected_entries, for_shell);
 				len = strlen(expanded);
 				break;
 			case 'd': /* current directory */
-				expanded = expand_directory_path(curr_view, expanded, quotes,
+				expanded = expand_directory_path(ctx->curr, expanded, quotes,
 						command + x + 1, for_shell);
 				len = strlen(expanded);
 				break;
 			case 'D': /* Directory of the other view. */
-				expanded = expand_directory_path(other_view, expanded, quotes,
+				expanded = expand_directory_path(ctx->other, expanded, quotes,
 						command + x + 1, for_shell);
 				len = strlen(expanded);
 				break;
@@ -340,7 +378,7 @@ expand_macros_i(const char command[], const char args[], MacroFlags *flags,
 				}
 				break;
 			case 'r': /* Registers' content. */
-				expanded = expand_register(flist_get_dir(curr_view), expanded, quotes,
+				expanded = expand_register(flist_get_dir(ctx->curr), expanded, quotes,
 						command + x + 2, command[x + 1], &well_formed, for_shell);
 				len = strlen(expanded);
 				if(well_formed)
@@ -367,7 +405,7 @@ expand_macros_i(const char command[], const char args[], MacroFlags *flags,
 					break;
 				}
 
-				expanded = expand_preview(expanded, key, &well_formed);
+				expanded = expand_preview(ctx, expanded, key, &well_formed);
 				len = strlen(expanded);
 				if(well_formed)
 				{
@@ -464,9 +502,13 @@ ma_flags_set(MacroFlags *flags, MacroFlags flag)
 	}
 }
 
+/* Appends paths to selected files or to the file under cursor of the view.
+ * Non-NULL entry replaces the one under cursor and means that there is no
+ * selection.  Returns new value of expanded string. */
 TSTATIC char *
-append_selected_files(view_t *view, char expanded[], int under_cursor,
-		int quotes, const char mod[], iter_func iter, int for_shell)
+append_selected_files(view_t *view, const dir_entry_t *entry, char expanded[],
+		int under_cursor, int quotes, const char mod[], iter_func iter,
+		int for_shell)
 {
 	const PathType type = (view == other_view)
 	                    ? PT_FULL
@@ -475,7 +517,17 @@ append_selected_files(view_t *view, char expanded[], int under_cursor,
 	size_t old_len = strlen(expanded);
 #endif
 
-	if(!under_cursor)
+	if(entry != NULL)
+	{
+		/* Without selection only the iterator of selected entries yields
+		 * nothing. */
+		if(under_cursor || iter != &iter_selected_entries)
+		{
+			expanded = append_entry(view, expanded, type, entry, quotes, mod,
+					for_shell);
+		}
+	}
+	else if(!under_cursor)
 	{
 		int first = 1;
 		dir_entry_t *entry = NULL;
@@ -512,8 +564,8 @@ append_selected_files(view_t *view, char expanded[], int under_cursor,
 /* Appends path to the entry to the expanded string.  Returns new value of
  * expanded string. */
 static char *
-append_entry(view_t *view, char expanded[], PathType type, dir_entry_t *entry,
-		int quotes, const char mod[], int for_shell)
+append_entry(view_t *view, char expanded[], PathType type,
+		const dir_entry_t *entry, int quotes, const char mod[], int for_shell)
 {
 	char path[PATH_MAX + 1];
 	const char *modified;
@@ -605,7 +657,8 @@ expand_register(const char curr_dir[], char expanded[], int quotes,
  * the key.  Reallocates the expanded string and returns result (possibly
  * NULL). */
 static char *
-expand_preview(char expanded[], int key, int *well_formed)
+expand_preview(const macro_ctx_t *ctx, char expanded[], int key,
+		int *well_formed)
 {
 	*well_formed = char_is_one_of("hwxy", key);
 	if(!*well_formed)
@@ -614,7 +667,7 @@ expand_preview(char expanded[], int key, int *well_formed)
 		return expanded;
 	}
 
-	const preview_area_t parea = get_preview_area(curr_view);
+	const preview_area_t parea = get_preview_area(ctx);
 
 	int param;
 	switch(key)
@@ -639,9 +692,15 @@ expand_preview(char expanded[], int key, int *well_formed)
 /* Applies heuristics to determine area that is going to be used for preview.
  * Returns the area. */
 static preview_area_t
-get_preview_area(view_t *view)
+get_preview_area(const macro_ctx_t *ctx)
 {
-	view_t *const other = (view == curr_view) ? other_view : curr_view;
+	view_t *view = ctx->curr;
+	view_t *const other = ctx->other;
+
+	if(ctx->parea != NULL)
+	{
+		return *ctx->parea;
+	}
 
 	if(curr_stats.preview_hint != NULL)
 	{
@@ -24,6 +24,10 @@
 
 #include "utils/test_helpers.h"
 
+struct dir_entry_t;
+struct preview_area_t;
+struct view_t;
+
 /* Macros that affect running of commands and processing their output. */
 typedef enum
 {
@@ -118,6 +122,14 @@ char * ma_expand(const char command[], const char args[], MacroFlags *flags,
  * single string, so escaping is disabled. */
 char * ma_expand_single(const char command[]);
 
+/* Like ma_expand() for a shell command, but expands macros as if the view was
+ * the current one and the entry was under its cursor without any selection.
+ * Preview macros are expanded for the parea.  The string returned needs to be
+ * freed in the calling function. */
+char * ma_expand_for_entry(const char command[], struct view_t *view,
+		const struct dir_entry_t *entry, const struct preview_area_t *parea,
+		MacroFlags *flags);
+
 /* Gets clear part of the viewer.  Returns NULL if there is none, otherwise
  * pointer inside the cmd string is returned. */
 const char * ma_get_clear_cmd(const char cmd[]);
@@ -149,12 +161,10 @@ int ma_flags_missing(MacroFlags flags, MacroFlags flag);
 const char * ma_flags_to_str(MacroFlags flags);
 
 TSTATIC_DEFS(
-	struct dir_entry_t;
-	struct view_t;
 	typedef int (*iter_func)(struct view_t *view, struct dir_entry_t **entry);
-	char * append_selected_files(struct view_t *view, char expanded[],
-		int under_cursor, int quotes, const char mod[], iter_func iter,
-		int for_shell);
+	char * append_selected_files(struct view_t *view,
+		const struct dir_entry_t *entry, char expanded[], int under_cursor,
+		int quotes, const char mod[], iter_func iter, int for_shell);
 )
 
 #endif /* VIFM__MACROS_H__ */
@@ -20,6 +20,7 @@
 #include "jobs_menu.h"
 
 #include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() */
 #include <stdio.h> /* snprintf() */
 #include <string.h> /* strlen() strdup() */
 
@@ -29,6 +30,7 @@
 #include "../utils/str.h"
 #include "../utils/string_array.h"
 #include "../background.h"
+#include "../fops_journal.h"
 #include "menus.h"
 
 static int execute_jobs_cb(view_t *view, menu_data_t *m);
@@ -36,6 +38,8 @@ static KHandlerResponse jobs_khandler(view_t *view, menu_data_t *m,
 		const wchar_t keys[]);
 static int cancel_job(menu_data_t *m, bg_job_t *job);
 static void reload_jobs_list(menu_data_t *m);
+static void append_journals(menu_data_t *m);
+static const char * get_journal(const menu_data_t *m);
 static char * format_job_item(bg_job_t *job);
 static void show_job_errors(view_t *view, menu_data_t *m, bg_job_t *job);
 static KHandlerResponse errs_khandler(view_t *view, menu_data_t *m,
@@ -62,7 +66,13 @@ show_jobs_menu(view_t *view)
 static int
 execute_jobs_cb(view_t *view, menu_data_t *m)
 {
-	/* TODO: write code for job control. */
+	/* TODO: write code for control of running jobs. */
+	const char *const journal = get_journal(m);
+	if(journal != NULL && fops_journal_resume(journal) != 0)
+	{
+		show_error_msg("Resuming operation",
+				"Failed to resume interrupted operation");
+	}
 	return 0;
 }
 
@@ -71,7 +81,15 @@ execute_jobs_cb(view_t *view, menu_data_t *m)
 static KHandlerResponse
 jobs_khandler(view_t *view, menu_data_t *m, const wchar_t keys[])
 {
-	if(wcscmp(keys, L"dd") == 0)
+	if(wcscmp(keys, L"dd") == 0 && get_journal(m) != NULL)
+	{
+		fops_journal_discard(get_journal(m));
+		reload_jobs_list(m);
+		menus_set_pos(m->state, m->pos);
+		menus_partial_redraw(m->state);
+		return KHR_REFRESH_WINDOW;
+	}
+	else if(wcscmp(keys, L"dd") == 0)
 	{
 		if(!cancel_job(m, m->void_data[m->pos]))
 		{
@@ -127,9 +145,11 @@ static void
 reload_jobs_list(menu_data_t *m)
 {
 	free(m->void_data);
+	free_string_array(m->data, m->len);
 	free_string_array(m->items, m->len);
 
 	m->void_data = NULL;
+	m->data = NULL;
 	m->items = NULL;
 	m->len = 0;
 
@@ -171,6 +191,71 @@ reload_jobs_list(menu_data_t *m)
 	}
 
 	m->len = len;
+
+	append_journals(m);
+}
+
+/* Appends interrupted operations that can be resumed to the list of jobs. */
+static void
+append_journals(menu_data_t *m)
+{
+	int njournals;
+	char **journals = fops_journal_list(&njournals);
+
+	if(njournals == 0)
+	{
+		return;
+	}
+
+	char **data = calloc(m->len + njournals, sizeof(*data));
+	void **void_data = reallocarray(m->void_data, m->len + njournals,
+			sizeof(*void_data));
+	if(void_data != NULL)
+	{
+		m->void_data = void_data;
+	}
+	if(data == NULL || void_data == NULL)
+	{
+		free(data);
+		free_string_array(journals, njournals);
+		return;
+	}
+	m->data = data;
+
+	int i;
+	for(i = 0; i < njournals; ++i)
+	{
+		char *const descr = fops_journal_describe(journals[i]);
+		if(descr == NULL)
+		{
+			continue;
+		}
+
+		char *const item = format_str("%-8s  %s", "resume", descr);
+		free(descr);
+
+		const int new_len = put_into_string_array(&m->items, m->len, item);
+		if(new_len != m->len + 1)
+		{
+			free(item);
+			continue;
+		}
+
+		m->data[m->len] = journals[i];
+		m->void_data[m->len] = NULL;
+		journals[i] = NULL;
+		m->len = new_len;
+	}
+
+	free_string_array(journals, njournals);
+}
+
+/* Retrieves journal of an interrupted operation under the cursor.  Returns path
+ * to the journal or NULL if current item is a job. */
+static const char *
+get_journal(const menu_data_t *m)
+{
+	return (m->data == NULL ? NULL : m->data[m->pos]);
 }
 
 /* Formats single menu line that describes state of the job.  Returns formatted
@@ -184,14 +269,18 @@ format_job_item(bg_job_t *job)
 		snprintf(info_buf, sizeof(info_buf), "%" PRINTF_ULL,
 				(unsigned long long)job->pid);
 	}
+	else if(bg_job_is_queued(job))
+	{
+		snprintf(info_buf, sizeof(info_buf), "queued");
+	}
 	else if(job->bg_op.total == BG_UNDEFINED_TOTAL)
 	{
 		snprintf(info_buf, sizeof(info_buf), "n/a");
 	}
 	else
 	{
-		snprintf(info_buf, sizeof(info_buf), "%d/%d", job->bg_op.done + 1,
-				job->bg_op.total);
+		snprintf(info_buf, sizeof(info_buf), "%d/%d",
+				bg_op_get_done(&job->bg_op) + 1, job->bg_op.total);
 	}
 
 	const char *cancelled = (bg_job_cancelled(job) ? "(cancelling...) " : "");
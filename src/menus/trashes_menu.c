@@ -21,6 +21,7 @@
 #include <stdint.h> /* uint64_t */
 #include <string.h> /* strchr() strdup() */
 
+#include "../cfg/config.h"
 #include "../ui/ui.h"
 #include "../utils/cancellation.h"
 #include "../utils/str.h"
@@ -70,7 +71,7 @@ static char *
 format_item(const char trash_dir[], int calc_size)
 {
 	char msg[PATH_MAX + 1];
-	uint64_t size;
+	uint64_t size, alloc;
 	char size_str[64];
 
 	if(!calc_size)
@@ -81,7 +82,11 @@ format_item(const char trash_dir[], int calc_size)
 	snprintf(msg, sizeof(msg), "Calculating size of %s...", trash_dir);
 	show_progress(msg, 1);
 
-	size = fops_dir_size(trash_dir, 1, &no_cancellation);
+	fops_dir_sizes(trash_dir, 1, &no_cancellation, &size, &alloc);
+	if(cfg.disk_usage)
+	{
+		size = alloc;
+	}
 
 	size_str[0] = '\0';
 	friendly_size_notation(size, sizeof(size_str), size_str);
@@ -39,14 +39,17 @@
 #include "../engine/mode.h"
 #include "../int/vim.h"
 #include "../modes/dialogs/msg_dialog.h"
+#include "../ui/cancellation.h"
 #include "../ui/colors.h"
 #include "../ui/escape.h"
 #include "../ui/fileview.h"
 #include "../ui/quickview.h"
 #include "../ui/statusbar.h"
 #include "../ui/ui.h"
+#include "../utils/dynarray.h"
 #include "../utils/filemon.h"
 #include "../utils/fs.h"
+#include "../utils/fswatch.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/regexp.h"
@@ -59,6 +62,7 @@
 #include "../filetype.h"
 #include "../running.h"
 #include "../status.h"
+#include "../text_index.h"
 #include "../types.h"
 #include "../vcache.h"
 #include "cmdline.h"
@@ -73,17 +77,45 @@ enum
 	SILENT,   /* Do not display error message dialog. */
 };
 
+/* Files of at least this size are read on demand instead of being loaded. */
+#define HUGE_FILE_SIZE (1024*1024)
+
+/* Number of lines of a huge file whose virtual lines are counted at once. */
+#define VBLOCK_SIZE 64
+
+/* Number of lines of a huge file whose virtual lines are counted per check for
+ * updates. */
+#define VLINES_PER_CHECK (16*1024)
+
+/* Interval in milliseconds between checks for interruption while waiting for
+ * results of indexing or searching in a huge file. */
+#define POLL_INTERVAL 50
+
 /* Describes view state and its properties. */
 struct modview_info_t
 {
 	/* Data of the view. */
 	char **lines;     /* List of real lines (owned by vcache unit). */
-	int (*widths)[2]; /* (virtual line, screen width) pair per real line. */
+	int (*widths)[2]; /* (virtual line, screen width) pair per real line or per
+	                     line of vblock for huge files. */
 	int nlines;       /* Number of real lines. */
 	int nlinesv;      /* Number of virtual (possibly wrapped) lines. */
 	int line;         /* Current real line number (first visible line). */
 	int linev;        /* Current virtual line number. */
 
+	/* Huge or followed file that is read on demand (lines field is NULL then).
+	 * Field nlines is the number of lines that can be navigated to. */
+	text_index_t *index; /* Index of lines of the file. */
+	int index_lines;     /* Number of lines found in the file so far. */
+	int index_complete;  /* Whether the whole file has been indexed. */
+	char *cached_line;   /* Last line retrieved from the index. */
+	int cached_num;      /* Number of the cached line or -1. */
+	int *vblocks;        /* First virtual line per block of VBLOCK_SIZE lines
+	                        plus one past the last counted block. */
+	int vblocks_len;     /* Number of allocated elements of vblocks. */
+	int nvblocks;        /* Number of blocks with counted virtual lines. */
+	int vblock;          /* Block described by widths field or -1. */
+
 	/* Dimensions, units of actions. */
 	int win_size; /* Scroll window size. */
 	int half_win; /* Height of a "page" (can be changed). */
@@ -91,12 +123,15 @@ struct modview_info_t
 
 	/* Monitoring of changes for automatic forwarding. */
 	int auto_forward;   /* Whether auto forwarding (tail -F) is enabled. */
-	filemon_t file_mon; /* File monitor for auto forwarding mode. */
+	fswatch_t *watch;   /* Watcher of the file in auto forwarding mode. */
+	filemon_t file_mon; /* Monitor of the file when it can't be watched. */
 
 	/* Related to search. */
 	regex_t re;               /* Search regular expression. */
 	int last_search_backward; /* Value -1 means no search was performed. */
 	int search_repeat;        /* Saved count prefix of search commands. */
+	char *pattern;            /* Pattern of the last search. */
+	tidx_search_t *search;    /* Search in a huge file or NULL. */
 
 	/* Viewers. */
 	strlist_t viewers;       /* List of viewers of current file. */
@@ -132,6 +167,19 @@ static void redraw(void);
 static void calc_vlines(void);
 static void calc_vlines_wrapped(modview_info_t *vi);
 static void calc_vlines_non_wrapped(modview_info_t *vi);
+static int measure_line(const char line[]);
+static int read_on_demand(const modview_info_t *vi, const char path[]);
+static void look_ahead(modview_info_t *vi, int distance);
+static void wait_for_index(modview_info_t *vi, int distance);
+static int update_index(modview_info_t *vi, int nlines);
+static int wait_for_lines(modview_info_t *vi, int nlines);
+static void reset_vlines(modview_info_t *vi);
+static void count_vlines(modview_info_t *vi, int nlines);
+static void load_vblock(modview_info_t *vi, int block);
+static const char * get_line(modview_info_t *vi, int line);
+static int line_vstart(modview_info_t *vi, int line);
+static int line_width(modview_info_t *vi, int line);
+static int find_real_line(modview_info_t *vi, int vline);
 static void draw(void);
 static int get_part(const char line[], int offset, size_t max_len, char part[]);
 static void display_error(const char error_msg[]);
@@ -188,6 +236,7 @@ static void goto_search_result(int repeat_count, int inverse_direction);
 static void search(int repeat_count, int backward);
 static int find_previous(void);
 static int find_next(void);
+static int find_in_index(int backward);
 static void cmd_q(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_u(key_info_t key_info, keys_info_t *keys_info);
 static void update_with_half_win(key_info_t *key_info);
@@ -198,6 +247,11 @@ static void update_with_win(key_info_t *key_info);
 static int is_trying_the_same_file(void);
 static int get_file_to_explore(const view_t *view, char buf[], size_t buf_len);
 static int forward_if_changed(modview_info_t *vi);
+static void start_watching(modview_info_t *vi);
+static FSWatchState poll_file(modview_info_t *vi);
+static void update_contents(modview_info_t *vi, int replaced);
+static void pick_up_appended(modview_info_t *vi);
+static int check_index(modview_info_t *vi);
 static int scroll_to_bottom(modview_info_t *vi);
 static void reload_view(modview_info_t *vi, int silent);
 static void cleanup(modview_info_t *vi);
@@ -208,6 +262,7 @@ TSTATIC int modview_is_detached(modview_info_t *vi);
 TSTATIC const char * modview_current_viewer(modview_info_t *vi);
 TSTATIC int modview_current_line(modview_info_t *vi);
 TSTATIC strlist_t modview_lines(modview_info_t *vi);
+TSTATIC const char * modview_line(modview_info_t *vi, int line);
 
 /* Points to current (for quick view) or last used (for explore mode)
  * modview_info_t structure. */
@@ -582,6 +637,8 @@ init_view_info(modview_info_t *vi)
 	vi->width = -1;
 	vi->last_search_backward = -1;
 	vi->search_repeat = NO_COUNT_GIVEN;
+	vi->cached_num = -1;
+	vi->vblock = -1;
 }
 
 /* Frees all resources allocated by modview_info_t structure instance. */
@@ -590,10 +647,16 @@ free_view_info(modview_info_t *vi)
 {
 	free_string_array(vi->viewers.items, vi->viewers.nitems);
 	free(vi->widths);
+	fswatch_free(vi->watch);
+	tidx_search_free(vi->search);
+	tidx_free(vi->index);
+	free(vi->cached_line);
+	dynarray_free(vi->vblocks);
 	if(vi->last_search_backward != -1)
 	{
 		regfree(&vi->re);
 	}
+	free(vi->pattern);
 	free(vi->filename);
 	free(vi->ext_viewer);
 }
@@ -620,7 +683,13 @@ calc_vlines(void)
 	vi->width = ui_qv_width(vi->view);
 	vi->wrap = cfg.wrap_quick_view;
 
-	if(vi->wrap)
+	if(vi->index != NULL)
+	{
+		reset_vlines(vi);
+		look_ahead(vi, 0);
+		vi->linev = line_vstart(vi, vi->line);
+	}
+	else if(vi->wrap)
 	{
 		calc_vlines_wrapped(vi);
 	}
@@ -639,8 +708,7 @@ calc_vlines_wrapped(modview_info_t *vi)
 	for(i = 0; i < vi->nlines; i++)
 	{
 		vi->widths[i][0] = vi->nlinesv++;
-		vi->widths[i][1] = utf8_strsw_with_tabs(vi->lines[i], cfg.tab_stop) -
-			esc_str_overhead(vi->lines[i]);
+		vi->widths[i][1] = measure_line(vi->lines[i]);
 		vi->nlinesv += vi->widths[i][1]/vi->width;
 	}
 }
@@ -658,16 +726,325 @@ calc_vlines_non_wrapped(modview_info_t *vi)
 	}
 }
 
+/* Calculates screen width of a line.  Returns the width. */
+static int
+measure_line(const char line[])
+{
+	return utf8_strsw_with_tabs(line, cfg.tab_stop) - esc_str_overhead(line);
+}
+
+/* Checks whether a file should be read on demand instead of being loaded,
+ * which is the case for regular files that are viewed without a viewer and are
+ * either big or followed (only appended data is read then).  Returns non-zero
+ * if so. */
+static int
+read_on_demand(const modview_info_t *vi, const char path[])
+{
+	const char *viewer = (vi->curr_viewer == vi->ext_viewer)
+	                   ? vi->ext_viewer
+	                   : (vi->raw ? NULL : vi->curr_viewer);
+	return viewer == NULL
+	    && is_regular_file(path)
+	    && (vi->auto_forward || get_file_size(path) >= HUGE_FILE_SIZE);
+}
+
+/* Makes sure that lines of a huge file that are within specified distance from
+ * the current one (plus a couple of screens) can be navigated to if the file
+ * has them. */
+static void
+look_ahead(modview_info_t *vi, int distance)
+{
+	if(vi->index != NULL)
+	{
+		const long long nlines =
+			(long long)vi->line + distance + 2*ui_qv_height(vi->view);
+		(void)update_index(vi, MIN(nlines, INT_MAX));
+	}
+}
+
+/* Waits for the whole huge file to be indexed and makes sure that lines within
+ * specified distance from the current one can be navigated to.  Can be
+ * cancelled. */
+static void
+wait_for_index(modview_info_t *vi, int distance)
+{
+	if(vi->index == NULL)
+	{
+		return;
+	}
+
+	(void)wait_for_lines(vi, INT_MAX);
+	look_ahead(vi, distance);
+}
+
+/* Picks up lines of a huge file found by the indexer waiting only for lines
+ * of the screen and counts virtual lines of at least nlines lines when lines
+ * are wrapped.  Returns non-zero if number of lines has changed. */
+static int
+update_index(modview_info_t *vi, int nlines)
+{
+	const int old_nlines = vi->nlines;
+	const int old_nlinesv = vi->nlinesv;
+
+	const int visible = vi->line + ui_qv_height(vi->view) + 1;
+	(void)wait_for_lines(vi, MIN(nlines, visible));
+	vi->index_lines = tidx_count(vi->index, &vi->index_complete);
+
+	if(vi->wrap)
+	{
+		count_vlines(vi, nlines);
+		vi->nlines = MIN(vi->nvblocks*(long long)VBLOCK_SIZE, vi->index_lines);
+		vi->nlinesv = (vi->vblocks == NULL ? 0 : vi->vblocks[vi->nvblocks]);
+	}
+	else
+	{
+		vi->nlines = vi->index_lines;
+		vi->nlinesv = vi->index_lines;
+	}
+
+	if(vi->line >= vi->nlines)
+	{
+		vi->line = MAX(vi->nlines - 1, 0);
+		vi->linev = line_vstart(vi, vi->line);
+	}
+
+	return (vi->nlines != old_nlines || vi->nlinesv != old_nlinesv);
+}
+
+/* Waits until at least nlines lines of a huge file are indexed or indexing is
+ * finished checking for interruption in between.  Returns non-zero if waiting
+ * was interrupted. */
+static int
+wait_for_lines(modview_info_t *vi, int nlines)
+{
+	int interrupted = 0;
+
+	ui_cancellation_push_on();
+
+	while(tidx_wait_for(vi->index, nlines, POLL_INTERVAL) < nlines)
+	{
+		int complete;
+		(void)tidx_count(vi->index, &complete);
+		if(complete)
+		{
+			break;
+		}
+
+		if(ui_cancellation_requested() || ui_char_pressed(NC_ESC))
+		{
+			interrupted = 1;
+			break;
+		}
+	}
+
+	ui_cancellation_pop();
+
+	return interrupted;
+}
+
+/* Drops virtual lines of a huge file counted so far. */
+static void
+reset_vlines(modview_info_t *vi)
+{
+	dynarray_free(vi->vblocks);
+	vi->vblocks = dynarray_cextend(NULL, sizeof(*vi->vblocks));
+	vi->vblocks_len = (vi->vblocks == NULL ? 0 : 1);
+	vi->nvblocks = 0;
+	vi->vblock = -1;
+}
+
+/* Counts virtual lines of a huge file block by block until at least nlines
+ * lines are covered or lines found so far run out.  Blocks that might still
+ * grow are skipped.  Can be cancelled. */
+static void
+count_vlines(modview_info_t *vi, int nlines)
+{
+	if(vi->vblocks == NULL)
+	{
+		return;
+	}
+
+	const int nblocks = DIV_ROUND_UP(MIN(nlines, vi->index_lines), VBLOCK_SIZE);
+
+	ui_cancellation_push_on();
+
+	while(vi->nvblocks < nblocks && !ui_cancellation_requested())
+	{
+		const int first = vi->nvblocks*VBLOCK_SIZE;
+		const int count = MIN(vi->index_lines - first, VBLOCK_SIZE);
+		if(count < VBLOCK_SIZE && !vi->index_complete)
+		{
+			break;
+		}
+
+		if(vi->nvblocks + 1 == vi->vblocks_len)
+		{
+			int *const vblocks = dynarray_extend(vi->vblocks, sizeof(*vblocks));
+			if(vblocks == NULL)
+			{
+				break;
+			}
+			vi->vblocks = vblocks;
+			++vi->vblocks_len;
+		}
+
+		int vlines = 0;
+		int i;
+		for(i = 0; i < count; ++i)
+		{
+			char *const line = tidx_get(vi->index, first + i);
+			vlines += 1 + (line == NULL ? 0 : measure_line(line)/vi->width);
+			free(line);
+		}
+
+		vi->vblocks[vi->nvblocks + 1] = vi->vblocks[vi->nvblocks] + vlines;
+		++vi->nvblocks;
+	}
+
+	ui_cancellation_pop();
+}
+
+/* Fills widths field with information about lines of a block of a huge file
+ * whose virtual lines have been counted. */
+static void
+load_vblock(modview_info_t *vi, int block)
+{
+	if(vi->vblock == block)
+	{
+		return;
+	}
+
+	const int first = block*VBLOCK_SIZE;
+	const int count = MIN(vi->index_lines - first, VBLOCK_SIZE);
+
+	int vline = vi->vblocks[block];
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char *const line = tidx_get(vi->index, first + i);
+		vi->widths[i][0] = vline;
+		vi->widths[i][1] = (line == NULL ? 0 : measure_line(line));
+		vline += 1 + vi->widths[i][1]/vi->width;
+		free(line);
+	}
+
+	vi->vblock = block;
+}
+
+/* Retrieves a real line.  For huge files the result is valid until the next
+ * call.  Returns the line. */
+static const char *
+get_line(modview_info_t *vi, int line)
+{
+	if(vi->index == NULL)
+	{
+		return vi->lines[line];
+	}
+
+	if(vi->cached_num != line)
+	{
+		free(vi->cached_line);
+		vi->cached_line = tidx_get(vi->index, line);
+		vi->cached_num = line;
+	}
+	return (vi->cached_line == NULL ? "" : vi->cached_line);
+}
+
+/* Retrieves number of the first virtual line of a real line.  Returns the
+ * number. */
+static int
+line_vstart(modview_info_t *vi, int line)
+{
+	if(vi->index == NULL)
+	{
+		return vi->widths[line][0];
+	}
+
+	if(!vi->wrap || vi->nlines == 0)
+	{
+		return line;
+	}
+
+	load_vblock(vi, line/VBLOCK_SIZE);
+	return vi->widths[line%VBLOCK_SIZE][0];
+}
+
+/* Retrieves screen width of a real line.  Returns the width. */
+static int
+line_width(modview_info_t *vi, int line)
+{
+	if(vi->index == NULL)
+	{
+		return vi->widths[line][1];
+	}
+
+	if(!vi->wrap || vi->nlines == 0)
+	{
+		return vi->width;
+	}
+
+	load_vblock(vi, line/VBLOCK_SIZE);
+	return vi->widths[line%VBLOCK_SIZE][1];
+}
+
+/* Finds real line that contains specified virtual line.  Returns number of the
+ * real line. */
+static int
+find_real_line(modview_info_t *vi, int vline)
+{
+	int lo = 0;
+	int hi = MAX(vi->nlines - 1, 0);
+
+	if(vi->index != NULL && vi->wrap && vi->nvblocks > 0)
+	{
+		/* Narrow the search to a single block. */
+		int block_lo = 0;
+		int block_hi = vi->nvblocks - 1;
+		while(block_lo < block_hi)
+		{
+			const int mid = block_lo + (block_hi - block_lo + 1)/2;
+			if(vi->vblocks[mid] <= vline)
+			{
+				block_lo = mid;
+			}
+			else
+			{
+				block_hi = mid - 1;
+			}
+		}
+
+		lo = block_lo*VBLOCK_SIZE;
+		hi = MIN(hi, lo + VBLOCK_SIZE - 1);
+	}
+
+	while(lo < hi)
+	{
+		const int mid = lo + (hi - lo + 1)/2;
+		if(line_vstart(vi, mid) <= vline)
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid - 1;
+		}
+	}
+
+	return lo;
+}
+
 static void
 draw(void)
 {
 	int l, vl;
 	const int height = ui_qv_height(vi->view);
 	const int width = ui_qv_width(vi->view);
-	const int max_l = MIN(vi->line + height, vi->nlines);
 	const int searched = (vi->last_search_backward != -1);
 	esc_state state;
 
+	look_ahead(vi, 0);
+	const int max_l = MIN(vi->line + height, vi->nlines);
+
 	if(vi->kind != VK_TEXTUAL)
 	{
 		cleanup(vi);
@@ -696,23 +1073,23 @@ draw(void)
 	{
 		int offset = 0;
 		int processed = 0;
-		char *const line = vi->lines[l];
-		char *p = searched ? esc_highlight_pattern(line, &vi->re) : line;
+		const char *const line = get_line(vi, l);
+		char *const highlighted = searched
+		                        ? esc_highlight_pattern(line, &vi->re)
+		                        : NULL;
+		const char *const p = (highlighted == NULL ? line : highlighted);
 		do
 		{
 			int printed;
 			const int vis = l != vi->line
-			             || vl + processed >= vi->linev - vi->widths[vi->line][0];
+			             || vl + processed >= vi->linev - line_vstart(vi, vi->line);
 			offset += esc_print_line(p + offset, vi->view->win, ui_qv_left(vi->view),
 					ui_qv_top(vi->view) + vl, width, !vis, !vi->wrap, &state, &printed);
 			vl += vis;
 			++processed;
 		}
 		while(vi->wrap && p[offset] != '\0' && vl < height);
-		if(searched)
-		{
-			free(p);
-		}
+		free(highlighted);
 	}
 	refresh_view_win(vi->view);
 
@@ -740,6 +1117,11 @@ modview_find(const char pattern[], int backward)
 
 	vi->last_search_backward = backward;
 
+	/* Search in a huge file is started on demand. */
+	tidx_search_free(vi->search);
+	vi->search = NULL;
+	replace_string(&vi->pattern, pattern);
+
 	search(vi->search_repeat, backward);
 
 	return curr_stats.save_msg;
@@ -950,6 +1332,8 @@ cmd_meta_space(key_info_t key_info, keys_info_t *keys_info)
 static void
 cmd_percent(key_info_t key_info, keys_info_t *keys_info)
 {
+	wait_for_index(vi, INT_MAX);
+
 	if(vi->nlines == 0)
 	{
 		return;
@@ -960,10 +1344,10 @@ cmd_percent(key_info_t key_info, keys_info_t *keys_info)
 	if(key_info.count > 100)
 		key_info.count = 100;
 
-	vi->line = (key_info.count*vi->nlinesv)/100;
+	vi->line = (key_info.count*(long long)vi->nlinesv)/100;
 	if(vi->line >= vi->nlines)
 		vi->line = vi->nlines - 1;
-	vi->linev = vi->widths[vi->line][0];
+	vi->linev = line_vstart(vi, vi->line);
 	draw();
 }
 
@@ -1028,9 +1412,15 @@ static void
 cmd_F(key_info_t key_info, keys_info_t *keys_info)
 {
 	vi->auto_forward = !vi->auto_forward;
+
+	fswatch_free(vi->watch);
+	vi->watch = NULL;
+
 	if(vi->auto_forward)
 	{
-		if(forward_if_changed(vi) || scroll_to_bottom(vi))
+		start_watching(vi);
+		update_contents(vi, 0);
+		if(scroll_to_bottom(vi))
 		{
 			draw();
 		}
@@ -1087,13 +1477,14 @@ load_view_data(modview_info_t *vi, const char action[],
 		return 1;
 	}
 
-	if(vi->nlines == 0)
+	const int nwidths = (vi->index == NULL ? vi->nlines : VBLOCK_SIZE);
+	if(nwidths == 0)
 	{
 		vi->widths = NULL;
 	}
 	else
 	{
-		vi->widths = reallocarray(NULL, vi->nlines, sizeof(*vi->widths));
+		vi->widths = reallocarray(NULL, nwidths, sizeof(*vi->widths));
 		if(vi->widths == NULL)
 		{
 			vi->lines = NULL;
@@ -1113,6 +1504,15 @@ get_view_data(modview_info_t *vi, const char file_to_view[])
 {
 	pick_current_viewer(vi);
 
+	if(read_on_demand(vi, file_to_view))
+	{
+		vi->lines = NULL;
+		vi->nlines = 0;
+		vi->kind = VK_TEXTUAL;
+		vi->index = tidx_open(file_to_view);
+		return (vi->index == NULL ? "Failed to read file's contents" : NULL);
+	}
+
 	const ViewerKind kind = ft_viewer_kind(vi->curr_viewer);
 	view_t *const curr = curr_view;
 	curr_view = (curr_stats.preview.on ? curr_view : vi->view);
@@ -1200,6 +1600,9 @@ replace_vi(modview_info_t *orig, modview_info_t *new)
 		new->last_search_backward = orig->last_search_backward;
 		new->re = orig->re;
 		orig->last_search_backward = -1;
+
+		new->pattern = orig->pattern;
+		orig->pattern = NULL;
 	}
 
 	new->win_size = orig->win_size;
@@ -1208,6 +1611,8 @@ replace_vi(modview_info_t *orig, modview_info_t *new)
 	new->linev = orig->linev;
 	new->view = orig->view;
 	new->auto_forward = orig->auto_forward;
+	new->watch = orig->watch;
+	orig->watch = NULL;
 	new->file_mon = orig->file_mon;
 
 	free_view_info(orig);
@@ -1295,16 +1700,18 @@ cmd_g(key_info_t key_info, keys_info_t *keys_info)
 	if(key_info.count == NO_COUNT_GIVEN)
 		key_info.count = 1;
 
+	look_ahead(vi, key_info.count);
+
 	key_info.count = MIN(vi->nlinesv - ui_qv_height(vi->view), key_info.count);
 	key_info.count = MAX(1, key_info.count);
 
-	if(vi->nlines == 0 || vi->linev == vi->widths[key_info.count - 1][0])
+	if(vi->nlines == 0 || vi->linev == line_vstart(vi, key_info.count - 1))
 	{
 		return;
 	}
 
 	vi->line = key_info.count - 1;
-	vi->linev = vi->widths[vi->line][0];
+	vi->linev = line_vstart(vi, vi->line);
 	draw();
 }
 
@@ -1322,6 +1729,8 @@ cmd_i(key_info_t key_info, keys_info_t *keys_info)
 static void
 cmd_j(key_info_t key_info, keys_info_t *keys_info)
 {
+	look_ahead(vi, def_count(key_info.count));
+
 	if(key_info.reg == NO_REG_GIVEN)
 	{
 		if((vi->linev + 1) + ui_qv_height(vi->view) > vi->nlinesv)
@@ -1343,8 +1752,9 @@ cmd_j(key_info_t key_info, keys_info_t *keys_info)
 
 	while(key_info.count-- > 0)
 	{
-		const int height = MAX(DIV_ROUND_UP(vi->widths[vi->line][1], vi->width), 1);
-		if(vi->linev + 1 >= vi->widths[vi->line][0] + height)
+		const int height = MAX(DIV_ROUND_UP(line_width(vi, vi->line), vi->width),
+				1);
+		if(vi->linev + 1 >= line_vstart(vi, vi->line) + height)
 			++vi->line;
 
 		++vi->linev;
@@ -1362,7 +1772,7 @@ cmd_k(key_info_t key_info, keys_info_t *keys_info)
 	int repeat_count = MIN(def_count(key_info.count), vi->linev);
 	while(repeat_count-- > 0)
 	{
-		if(vi->linev - 1 < vi->widths[vi->line][0])
+		if(vi->linev - 1 < line_vstart(vi, vi->line))
 			--vi->line;
 
 		--vi->linev;
@@ -1402,7 +1812,10 @@ search(int repeat_count, int backward)
 
 	while(repeat_count-- > 0)
 	{
-		if(backward ? find_previous() : find_next())
+		const int failed = (vi->index != NULL)
+		                 ? find_in_index(backward)
+		                 : (backward ? find_previous() : find_next());
+		if(failed)
 		{
 			break;
 		}
@@ -1426,16 +1839,16 @@ find_previous(void)
 	int vl = vi->linev - 1;
 	int l = vi->line;
 
-	if(l > 0 && vl < vi->widths[l][0])
+	if(l > 0 && vl < line_vstart(vi, l))
 	{
 		--l;
 	}
 
 	int i;
 	int offset = 0;
-	for(i = 0; l < vi->nlines && i <= vl - vi->widths[l][0]; ++i)
+	for(i = 0; l < vi->nlines && i <= vl - line_vstart(vi, l); ++i)
 	{
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+		offset = get_part(get_line(vi, l), offset, ui_qv_width(vi->view), buf);
 	}
 
 	/* Don't stop until we go above first virtual line of the first line. */
@@ -1447,15 +1860,15 @@ find_previous(void)
 			vi->line = l;
 			break;
 		}
-		if(l > 0 && vl - 1 < vi->widths[l][0])
+		if(l > 0 && vl - 1 < line_vstart(vi, l))
 		{
 			--l;
 			offset = 0;
-			for(i = 0; i <= vl - 1 - vi->widths[l][0]; i++)
-				offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+			for(i = 0; i <= vl - 1 - line_vstart(vi, l); i++)
+				offset = get_part(get_line(vi, l), offset, ui_qv_width(vi->view), buf);
 		}
 		else
-			offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+			offset = get_part(get_line(vi, l), offset, ui_qv_width(vi->view), buf);
 		--vl;
 	}
 
@@ -1479,16 +1892,16 @@ find_next(void)
 	int vl = vi->linev + 1;
 	int l = vi->line;
 
-	if(l < vi->nlines - 1 && vl == vi->widths[l + 1][0])
+	if(l < vi->nlines - 1 && vl == line_vstart(vi, l + 1))
 	{
 		++l;
 	}
 
 	int i;
 	int offset = 0;
-	for(i = 0; l < vi->nlines && i <= vl - vi->widths[l][0]; ++i)
+	for(i = 0; l < vi->nlines && i <= vl - line_vstart(vi, l); ++i)
 	{
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+		offset = get_part(get_line(vi, l), offset, ui_qv_width(vi->view), buf);
 	}
 
 	while(l < vi->nlines)
@@ -1504,12 +1917,12 @@ find_next(void)
 			break;
 		}
 
-		if(vl + 1 >= vi->widths[l + 1][0])
+		if(vl + 1 >= line_vstart(vi, l + 1))
 		{
 			++l;
 			offset = 0;
 		}
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+		offset = get_part(get_line(vi, l), offset, ui_qv_width(vi->view), buf);
 		++vl;
 	}
 
@@ -1523,6 +1936,80 @@ find_next(void)
 	return 0;
 }
 
+/* Scrolls to the next/previous line of a huge file that matches the pattern.
+ * Lines are searched in background and this waits only until the match is
+ * found, which can be interrupted.  Returns zero on success and non-zero if
+ * pattern wasn't found.  Prints a message on search failure. */
+static int
+find_in_index(int backward)
+{
+	if(vi->search == NULL && vi->pattern != NULL)
+	{
+		vi->search = tidx_search_start(vi->index, vi->pattern,
+				get_regexp_cflags(vi->pattern));
+	}
+	if(vi->search == NULL)
+	{
+		draw();
+		display_error("Failed to start search");
+		return 1;
+	}
+
+	int match = tidx_search_find(vi->search, vi->line, backward);
+	if(match == -2)
+	{
+		ui_sb_quick_msgf("%s", "Searching... (Esc to interrupt)");
+		ui_cancellation_push_on();
+
+		while(match == -2)
+		{
+			if(ui_cancellation_requested() || ui_char_pressed(NC_ESC))
+			{
+				break;
+			}
+
+			(void)tidx_search_wait(vi->search, POLL_INTERVAL);
+			match = tidx_search_find(vi->search, vi->line, backward);
+		}
+
+		ui_cancellation_pop();
+		ui_sb_quick_msg_clear();
+	}
+
+	if(match == -2)
+	{
+		/* Next attempt will start the search anew. */
+		tidx_search_free(vi->search);
+		vi->search = NULL;
+
+		draw();
+		display_error("Search interrupted");
+		return 1;
+	}
+
+	if(match == -1)
+	{
+		draw();
+		display_error("Pattern not found");
+		return 1;
+	}
+
+	/* Indexing might be behind the search. */
+	if(wait_for_lines(vi, match + 1))
+	{
+		draw();
+		display_error("Search interrupted");
+		return 1;
+	}
+
+	vi->line = match;
+	look_ahead(vi, 0);
+	vi->linev = line_vstart(vi, vi->line);
+
+	draw();
+	return 0;
+}
+
 /* Extracts part of the line replacing all occurrences of horizontal tabulation
  * character with appropriate number of spaces.  The offset specifies beginning
  * of the part in the line.  The max_len parameter designates the maximum number
@@ -1713,37 +2200,154 @@ modview_check_for_updates(void)
 	need_redraw += forward_if_changed(lwin.vi);
 	need_redraw += forward_if_changed(rwin.vi);
 
+	need_redraw += check_index(curr_stats.preview.explore);
+	need_redraw += check_index(lwin.vi);
+	need_redraw += check_index(rwin.vi);
+
 	if(need_redraw)
 	{
 		stats_redraw_later();
 	}
 }
 
-/* Forwards the view if underlying file changed.  Returns non-zero if reload
- * occurred, otherwise zero is returned. */
+/* Picks up changes of the underlying file and forwards the view if it was
+ * scrolled to the bottom.  Appended data of files read on demand is read
+ * incrementally, other files are reloaded.  Returns non-zero if the view has
+ * changed, otherwise zero is returned. */
 static int
 forward_if_changed(modview_info_t *vi)
 {
-	filemon_t mon;
-
 	if(vi == NULL || !vi->auto_forward)
 	{
 		return 0;
 	}
 
-	if(filemon_from_file(vi->filename, FMT_MODIFIED, &mon) != 0)
+	const FSWatchState state = (vi->watch == NULL)
+	                         ? poll_file(vi)
+	                         : fswatch_poll(vi->watch);
+	if(state == FSWS_UNCHANGED || state == FSWS_ERRORED)
 	{
 		return 0;
 	}
 
+	const int at_bottom =
+		(vi->linev + ui_qv_height(vi->view) >= vi->nlinesv);
+
+	update_contents(vi, state == FSWS_REPLACED);
+
+	if(at_bottom)
+	{
+		(void)scroll_to_bottom(vi);
+	}
+	return 1;
+}
+
+/* Starts monitoring the file for changes.  Watching isn't possible for files
+ * on some systems and for missing files, polling is used for them. */
+static void
+start_watching(modview_info_t *vi)
+{
+	vi->watch = fswatch_create(vi->filename);
+	if(vi->watch == NULL)
+	{
+		(void)filemon_from_file(vi->filename, FMT_MODIFIED, &vi->file_mon);
+	}
+}
+
+/* Checks the file for changes in the absence of a watcher.  Returns the kind of
+ * the change. */
+static FSWatchState
+poll_file(modview_info_t *vi)
+{
+	filemon_t mon;
+	if(filemon_from_file(vi->filename, FMT_MODIFIED, &mon) != 0)
+	{
+		/* The file might be missing for a while during rotation. */
+		filemon_reset(&vi->file_mon);
+		return FSWS_UNCHANGED;
+	}
+
+	if(!filemon_is_set(&vi->file_mon))
+	{
+		/* The file has appeared, try watching it from now on. */
+		vi->file_mon = mon;
+		vi->watch = fswatch_create(vi->filename);
+		return FSWS_REPLACED;
+	}
+
 	if(filemon_equal(&mon, &vi->file_mon))
 	{
-		return 0;
+		return FSWS_UNCHANGED;
 	}
 
+	/* Without inode numbers (e.g., on Windows) replacement of the file can't be
+	 * told apart from its update, so treat every change as replacement. */
+	const int same_file = (mon.inode != 0 && mon.inode == vi->file_mon.inode &&
+			mon.dev == vi->file_mon.dev);
 	vi->file_mon = mon;
-	reload_view(vi, SILENT);
-	return scroll_to_bottom(vi);
+	return (same_file ? FSWS_UPDATED : FSWS_REPLACED);
+}
+
+/* Brings contents of the view up to date with the file.  Only appended data of
+ * files read on demand is read, other files are reloaded as well as truncated
+ * or replaced (e.g., rotated) ones. */
+static void
+update_contents(modview_info_t *vi, int replaced)
+{
+	/* Files without a viewer get to be read on demand on reloading. */
+	if(replaced || vi->index == NULL || tidx_extend(vi->index) != 0)
+	{
+		reload_view(vi, SILENT);
+	}
+	else
+	{
+		pick_up_appended(vi);
+	}
+}
+
+/* Makes lines appended to a file read on demand available. */
+static void
+pick_up_appended(modview_info_t *vi)
+{
+	/* The last line might have become longer. */
+	free(vi->cached_line);
+	vi->cached_line = NULL;
+	vi->cached_num = -1;
+	vi->vblock = -1;
+	if(vi->nvblocks*VBLOCK_SIZE >= vi->index_lines && vi->nvblocks > 0)
+	{
+		--vi->nvblocks;
+	}
+
+	/* Next request restarts the search if it can't go on over new lines. */
+	if(vi->search != NULL && tidx_search_extend(vi->search, vi->index) != 0)
+	{
+		tidx_search_free(vi->search);
+		vi->search = NULL;
+	}
+
+	/* Usually only a small piece of data is appended. */
+	wait_for_index(vi, 0);
+}
+
+/* Picks up progress of indexing of a huge file.  Returns non-zero if the view
+ * needs to be redrawn, otherwise zero is returned. */
+static int
+check_index(modview_info_t *vi)
+{
+	/* Width is set on the first drawing. */
+	if(vi == NULL || vi->index == NULL || vi->width < 0)
+	{
+		return 0;
+	}
+
+	if(vi->index_complete && vi->nlines == vi->index_lines)
+	{
+		return 0;
+	}
+
+	const long long nlines = (long long)vi->nlines + VLINES_PER_CHECK;
+	return update_index(vi, MIN(nlines, INT_MAX));
 }
 
 /* Scrolls view to the bottom if there is any room for that.  Returns non-zero
@@ -1751,19 +2355,15 @@ forward_if_changed(modview_info_t *vi)
 static int
 scroll_to_bottom(modview_info_t *vi)
 {
+	wait_for_index(vi, INT_MAX);
+
 	if(vi->linev + 1 + ui_qv_height(vi->view) > vi->nlinesv)
 	{
 		return 0;
 	}
 
 	vi->linev = vi->nlinesv - ui_qv_height(vi->view);
-	for(vi->line = 0; vi->line < vi->nlines - 1; ++vi->line)
-	{
-		if(vi->linev < vi->widths[vi->line + 1][0])
-		{
-			break;
-		}
-	}
+	vi->line = find_real_line(vi, vi->linev);
 
 	return 1;
 }
@@ -1782,6 +2382,7 @@ reload_view(modview_info_t *vi, int silent)
 	new_vi.ext_viewer = vi->ext_viewer;
 	new_vi.viewers = vi->viewers;
 	new_vi.raw = vi->raw;
+	new_vi.auto_forward = vi->auto_forward;
 
 	if(load_view_data(&new_vi, "File exploring reload", vi->filename, silent)
 			== 0)
@@ -1921,5 +2522,11 @@ modview_lines(modview_info_t *vi)
 	return lines;
 }
 
+TSTATIC const char *
+modview_line(modview_info_t *vi, int line)
+{
+	return (line < vi->nlines ? get_line(vi, line) : NULL);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
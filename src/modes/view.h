@@ -101,6 +101,7 @@ TSTATIC_DEFS(
 	int modview_current_line(modview_info_t *vi);
 	struct strlist_t;
 	struct strlist_t modview_lines(modview_info_t *vi);
+	const char * modview_line(modview_info_t *vi, int line);
 )
 
 #endif /* VIFM__MODES__VIEW_H__ */
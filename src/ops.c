@@ -25,10 +25,11 @@
 #include "utils/utf8.h"
 #endif
 
-#include <sys/stat.h> /* gid_t uid_t */
+#include <sys/stat.h> /* gid_t stat uid_t */
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* calloc() free() */
 #include <string.h> /* strdup() */
@@ -80,6 +81,47 @@ typedef enum
 }
 ConflictAction;
 
+/* Size of a file system entry as seen by dcache. */
+typedef struct
+{
+	int exists;     /* Whether the entry exists. */
+	uint64_t size;  /* Apparent size or DCACHE_UNKNOWN. */
+	uint64_t alloc; /* Allocated size or DCACHE_UNKNOWN. */
+}
+entry_size_t;
+
+/* Directory whose contents is changed by an operation. */
+typedef struct
+{
+	char *path;        /* Path to the directory. */
+	uint64_t inode;    /* Inode number of the directory. */
+	uint64_t size;     /* Up-to-date cached size or DCACHE_UNKNOWN. */
+	uint64_t alloc;    /* Up-to-date cached allocated size or DCACHE_UNKNOWN. */
+	uint64_t nitems;   /* Up-to-date cached number of items or DCACHE_UNKNOWN. */
+	uint64_t size_by;  /* Change of apparent size (modulo 2^64). */
+	uint64_t alloc_by; /* Change of allocated size (modulo 2^64). */
+	int sizes_known;   /* Whether size_by and alloc_by are exact. */
+	int nitems_by;     /* Change of number of items. */
+}
+dir_change_t;
+
+/* Entries affected by a single operation along with their parents, which is
+ * used to keep dcache up to date without rescanning directories. */
+typedef struct
+{
+	int count;                /* Number of affected entries. */
+	const char *paths[2];     /* Affected entries. */
+	entry_size_t before[2];   /* Sizes of the entries before the operation. */
+	entry_size_t origin;      /* Size of the source of a copy. */
+	int fallback[2];          /* What's used for entries whose size can't be
+	                             measured after the operation: 0 - nothing, 1 -
+	                             origin, 2 - before[0]. */
+	dir_change_t parents[2];  /* Parents of the entries. */
+	int parent_of[2];         /* Index of parent of each entry. */
+	int nparents;             /* Number of distinct parents. */
+}
+fs_change_t;
+
 /* Type of function that implements single operation. */
 typedef OpsResult (*op_func)(ops_t *ops, void *data, const char src[],
 		const char dst[]);
@@ -147,6 +189,13 @@ static OpsResult run_operation_command(ops_t *ops, char cmd[], int cancellable);
 static int ops_runs_in_bg(const ops_t *ops);
 static int bg_cancellation_hook(void *arg);
 static OpsResult result_from_code(int exit_code);
+static void fs_change_begin(fs_change_t *change, OPS op, void *data,
+		const char src[], const char dst[]);
+static void fs_change_add(fs_change_t *change, const char path[],
+		int fallback);
+static void fs_change_end(fs_change_t *change, int succeeded);
+static void apply_dir_change(const dir_change_t *dir);
+static entry_size_t measure_entry(const char path[]);
 
 /* List of functions that implement operations. */
 static op_func op_funcs[] = {
@@ -199,6 +248,8 @@ ops_alloc(OPS main_op, int bg, const char descr[], const char base_dir[],
 	ops->use_system_calls = cfg.use_system_calls;
 	ops->fast_file_cloning = cfg.fast_file_cloning;
 	ops->data_sync = cfg.data_sync;
+	ops->bulk_copy = cfg.bulk_copy;
+	ops->verify = cfg.verify_copies;
 	ops->shell_type = curr_stats.shell_type;
 
 	ops->choose = choose;
@@ -227,7 +278,7 @@ ops_enqueue(ops_t *ops, const char src[], const char dst[])
 	}
 
 	/* Check once and cache result, it should be the same for each invocation. */
-	if(ops->estim->total_items == 0)
+	if(ops->total == 1)
 	{
 		switch(ops->main_op)
 		{
@@ -263,7 +314,8 @@ ops_enqueue(ops_t *ops, const char src[], const char dst[])
 		}
 	}
 
-	ioeta_calculate(ops->estim, src, ops->shallow_eta);
+	/* Estimation runs alongside the operation instead of delaying its start. */
+	ioeta_calculate_async(ops->estim, src, ops->shallow_eta);
 }
 
 void
@@ -278,6 +330,32 @@ ops_advance(ops_t *ops, int succeeded)
 	}
 }
 
+void
+ops_add_dev(ops_t *ops, const char path[])
+{
+	struct stat st;
+	if(os_stat(path, &st) != 0 && os_lstat(path, &st) != 0)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < ops->ndevs; ++i)
+	{
+		if(ops->devs[i] == st.st_dev)
+		{
+			return;
+		}
+	}
+
+	dev_t *const devs = reallocarray(ops->devs, ops->ndevs + 1, sizeof(*devs));
+	if(devs != NULL)
+	{
+		ops->devs = devs;
+		ops->devs[ops->ndevs++] = st.st_dev;
+	}
+}
+
 void
 ops_free(ops_t *ops)
 {
@@ -292,6 +370,7 @@ ops_free(ops_t *ops)
 	free(ops->delete_prg);
 	free(ops->base_dir);
 	free(ops->target_dir);
+	free(ops->devs);
 	free(ops);
 }
 
@@ -299,10 +378,15 @@ OpsResult
 perform_operation(OPS op, ops_t *ops, void *data, const char src[],
 		const char dst[])
 {
+	fs_change_t change;
+	fs_change_begin(&change, op, data, src, dst);
+
 	if(ops_runs_in_bg(ops))
 	{
 		/* Not reporting events from background jobs. */
-		return op_funcs[op](ops, data, src, dst);
+		OpsResult status = op_funcs[op](ops, data, src, dst);
+		fs_change_end(&change, status == OPS_SUCCEEDED);
+		return status;
 	}
 
 	int dir = 0;
@@ -316,6 +400,7 @@ perform_operation(OPS op, ops_t *ops, void *data, const char src[],
 	}
 
 	OpsResult status = op_funcs[op](ops, data, src, dst);
+	fs_change_end(&change, status == OPS_SUCCEEDED);
 	if(status == OPS_SUCCEEDED)
 	{
 		vlua_events_app_fsop(curr_stats.vlua, op, src, dst, data, dir);
@@ -323,6 +408,213 @@ perform_operation(OPS op, ops_t *ops, void *data, const char src[],
 	return status;
 }
 
+/* Records state of entries that are about to be affected by an operation and
+ * of their parent directories. */
+static void
+fs_change_begin(fs_change_t *change, OPS op, void *data, const char src[],
+		const char dst[])
+{
+	change->count = 0;
+	change->nparents = 0;
+
+	switch(op)
+	{
+		case OP_REMOVE:
+		case OP_REMOVESL:
+		case OP_RMDIR:
+		case OP_MKFILE:
+			fs_change_add(change, src, 0);
+			break;
+		case OP_MKDIR:
+			/* Can't tell which of parents gets new item with -p. */
+			if(data == NULL)
+			{
+				fs_change_add(change, src, 0);
+			}
+			break;
+		case OP_COPY:
+		case OP_COPYF:
+		case OP_COPYA:
+			change->origin = measure_entry(src);
+			fs_change_add(change, dst, 1);
+			break;
+		case OP_MOVE:
+		case OP_MOVEF:
+		case OP_MOVEA:
+		case OP_MOVETMP1:
+		case OP_MOVETMP2:
+		case OP_MOVETMP3:
+		case OP_MOVETMP4:
+			fs_change_add(change, src, 0);
+			fs_change_add(change, dst, 2);
+			break;
+		case OP_SYMLINK:
+		case OP_SYMLINK2:
+			fs_change_add(change, dst, 0);
+			break;
+
+		default:
+			/* Other operations don't change sizes or are opaque. */
+			break;
+	}
+}
+
+/* Adds an entry affected by an operation to the change. */
+static void
+fs_change_add(fs_change_t *change, const char path[], int fallback)
+{
+	if(path == NULL || !is_path_absolute(path))
+	{
+		return;
+	}
+
+	char parent[PATH_MAX + 1];
+	copy_str(parent, sizeof(parent), path);
+	remove_last_path_component(parent);
+
+	int i;
+	for(i = 0; i < change->nparents; ++i)
+	{
+		if(stroscmp(change->parents[i].path, parent) == 0)
+		{
+			break;
+		}
+	}
+
+	if(i == change->nparents)
+	{
+		struct stat st;
+		dir_change_t *const dir = &change->parents[i];
+		if(os_stat(parent, &st) != 0 || (dir->path = strdup(parent)) == NULL)
+		{
+			return;
+		}
+
+		dir->inode = st.st_ino;
+		dcache_get_at(parent, st.st_mtime, st.st_ino, &dir->size, &dir->alloc,
+				&dir->nitems);
+		dir->size_by = 0U;
+		dir->alloc_by = 0U;
+		dir->sizes_known = 1;
+		dir->nitems_by = 0;
+		++change->nparents;
+	}
+
+	change->paths[change->count] = path;
+	change->before[change->count] = measure_entry(path);
+	change->fallback[change->count] = fallback;
+	change->parent_of[change->count] = i;
+	++change->count;
+}
+
+/* Updates dcache after an operation and frees resources of the change.  Parents
+ * whose cached values were up to date before the operation remain up to
+ * date. */
+static void
+fs_change_end(fs_change_t *change, int succeeded)
+{
+	int i;
+	for(i = 0; i < change->count && succeeded; ++i)
+	{
+		const entry_size_t *const before = &change->before[i];
+		entry_size_t after = measure_entry(change->paths[i]);
+		if(after.exists && after.size == DCACHE_UNKNOWN)
+		{
+			if(change->fallback[i] == 1)
+			{
+				after = change->origin;
+			}
+			else if(change->fallback[i] == 2)
+			{
+				after = change->before[0];
+			}
+		}
+
+		dir_change_t *const dir = &change->parents[change->parent_of[i]];
+		dir->nitems_by += after.exists - before->exists;
+		if(before->size == DCACHE_UNKNOWN || before->alloc == DCACHE_UNKNOWN ||
+				after.size == DCACHE_UNKNOWN || after.alloc == DCACHE_UNKNOWN)
+		{
+			dir->sizes_known = 0;
+			continue;
+		}
+		dir->size_by += after.size - before->size;
+		dir->alloc_by += after.alloc - before->alloc;
+	}
+
+	for(i = 0; i < change->nparents; ++i)
+	{
+		if(succeeded)
+		{
+			apply_dir_change(&change->parents[i]);
+		}
+		free(change->parents[i].path);
+	}
+}
+
+/* Adjusts cached information about a directory and sizes of its parents. */
+static void
+apply_dir_change(const dir_change_t *dir)
+{
+	uint64_t size = DCACHE_UNKNOWN, alloc = DCACHE_UNKNOWN;
+	if(dir->sizes_known)
+	{
+		if(dir->size != DCACHE_UNKNOWN)
+		{
+			size = dir->size + dir->size_by;
+		}
+		if(dir->alloc != DCACHE_UNKNOWN)
+		{
+			alloc = dir->alloc + dir->alloc_by;
+		}
+	}
+
+	const uint64_t nitems = (dir->nitems == DCACHE_UNKNOWN)
+	                      ? DCACHE_UNKNOWN
+	                      : dir->nitems + dir->nitems_by;
+
+	/* This also refreshes timestamps to account for the change of the
+	 * directory.  Timestamp isn't put ahead of current time, so the data stays
+	 * stale if the directory was changed within the current second, because
+	 * another change could follow within the same second. */
+	(void)dcache_set_at(dir->path, dir->inode, size, alloc, nitems);
+
+	if(dir->sizes_known)
+	{
+		dcache_update_parent_sizes(dir->path, dir->size_by, dir->alloc_by);
+	}
+}
+
+/* Determines size of an entry.  Sizes of directories are taken from dcache.
+ * Returns the size. */
+static entry_size_t
+measure_entry(const char path[])
+{
+	entry_size_t result = { .exists = 0, .size = 0U, .alloc = 0U };
+
+	struct stat st;
+	if(os_lstat(path, &st) != 0)
+	{
+		return result;
+	}
+
+	result.exists = 1;
+	if(S_ISDIR(st.st_mode))
+	{
+		dcache_get_at(path, st.st_mtime, st.st_ino, &result.size, &result.alloc,
+				NULL);
+		return result;
+	}
+
+	result.size = st.st_size;
+#ifndef _WIN32
+	result.alloc = (uint64_t)st.st_blocks*512U;
+#else
+	result.alloc = result.size;
+#endif
+	return result;
+}
+
 static OpsResult
 op_none(ops_t *ops, void *data, const char src[], const char dst[])
 {
@@ -506,6 +798,8 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 	                             ? cfg.fast_file_cloning
 	                             : ops->fast_file_cloning;
 	const int data_sync = (ops == NULL ? cfg.data_sync : ops->data_sync);
+	const int bulk_copy = (ops == NULL ? cfg.bulk_copy : ops->bulk_copy);
+	const int verify = (ops == NULL ? cfg.verify_copies : ops->verify);
 
 	if(!ops_uses_syscalls(ops))
 	{
@@ -585,6 +879,8 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		.arg4 = {
 			.fast_file_cloning = fast_file_cloning,
 			.data_sync = data_sync,
+			.bulk_copy = bulk_copy,
+			.verify = verify,
 		},
 	};
 	return exec_io_op(ops, &ior_cp, &args, data == NULL);
@@ -684,6 +980,8 @@ op_mv(ops_t *ops, void *data, const char src[], const char dst[],
 				/* It's safe to always use fast file cloning on moving files. */
 				.fast_file_cloning = 1,
 				.data_sync = (ops == NULL ? cfg.data_sync : ops->data_sync),
+				.bulk_copy = (ops == NULL ? cfg.bulk_copy : ops->bulk_copy),
+				.verify = (ops == NULL ? cfg.verify_copies : ops->verify),
 			},
 		};
 
@@ -19,6 +19,8 @@
 #ifndef VIFM__OPS_H__
 #define VIFM__OPS_H__
 
+#include <sys/types.h> /* dev_t */
+
 #include "io/ioeta.h"
 
 /* Kinds of operations on files. */
@@ -115,6 +117,8 @@ typedef struct ops_t
 	int use_system_calls;  /* Copy of 'syscalls' option value. */
 	int fast_file_cloning; /* Copy of part of 'iooptions' option value. */
 	int data_sync;         /* Copy of part of 'iooptions' option value. */
+	int bulk_copy;         /* Copy of part of 'iooptions' option value. */
+	int verify;            /* Copy of part of 'iooptions' option value. */
 	int shell_type;        /* Copy of curr_stats.shell_type */
 
 	/* Pointers to user-interaction functions. */
@@ -125,6 +129,9 @@ typedef struct ops_t
 	char *target_dir; /* Target directory of the operation (same as base_dir if
 	                     none). */
 
+	dev_t *devs; /* Devices which are involved in the operation. */
+	int ndevs;   /* Number of elements in devs. */
+
 	ConflictResolutionPolicy crp; /* What should be done on conflicts. */
 	ErrorResolutionPolicy erp;    /* What should be done on unexpected errors. */
 
@@ -147,6 +154,10 @@ void ops_enqueue(ops_t *ops, const char src[], const char dst[]);
 /* Advances ops to the next item. */
 void ops_advance(ops_t *ops, int succeeded);
 
+/* Registers device on which the path resides as one involved in the
+ * operation.  Does nothing if the path doesn't exist. */
+void ops_add_dev(ops_t *ops, const char path[]);
+
 /* Frees ops_t.  The ops can be NULL. */
 void ops_free(ops_t *ops);
 
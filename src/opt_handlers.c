@@ -114,6 +114,7 @@ static void load_sort_option_inner(view_t *view, signed char sort_keys[]);
 static void aproposprg_handler(OPT_OP op, optval_t val);
 static void autocd_handler(OPT_OP op, optval_t val);
 static void autochpos_handler(OPT_OP op, optval_t val);
+static void bgthreads_handler(OPT_OP op, optval_t val);
 static void caseoptions_handler(OPT_OP op, optval_t val);
 static void cdpath_handler(OPT_OP op, optval_t val);
 static void chaselinks_handler(OPT_OP op, optval_t val);
@@ -129,6 +130,7 @@ static void cpoptions_handler(OPT_OP op, optval_t val);
 static void cvoptions_handler(OPT_OP op, optval_t val);
 static void deleteprg_handler(OPT_OP op, optval_t val);
 static void dirsize_handler(OPT_OP op, optval_t val);
+static void diskusage_handler(OPT_OP op, optval_t val);
 static void dotdirs_handler(OPT_OP op, optval_t val);
 static void fastrun_handler(OPT_OP op, optval_t val);
 static void fillchars_handler(OPT_OP op, optval_t val);
@@ -331,10 +333,13 @@ static const char *navoptions_vals[][2] = {
 
 /* Possible values of 'previewoptions'. */
 static const char *previewoptions_vals[][2] = {
+	{ "diskcache:",        "size of on-disk cache of viewers in MiB" },
 	{ "graphicsdelay:",    "delay before drawing graphics" },
 	{ "hardgraphicsclear", "redraw screen to get rid of graphics" },
 	{ "maxtreedepth:",     "how many tree levels to display" },
+	{ "prefetch:",         "number of entries to preview ahead of time" },
 	{ "toptreestats",      "show file counts on top of the tree" },
+	{ "viewerdelay:",      "delay before starting viewers in ms" },
 };
 
 /* Possible values of 'suggestoptions'. */
@@ -361,6 +366,9 @@ ARRAY_GUARD(suggestoptions_vals, NUM_SUGGESTION_FLAGS);
 static const char *iooptions_vals[][2] = {
 	{ "fastfilecloning", "use COW if FS supports it" },
 	{ "datasync",        "synchronize writes to storage" },
+	{ "bulkcopy",        "copy without trashing page cache" },
+	{ "journal",         "make background copy/move resumable" },
+	{ "verify",          "check copied data against the source" },
 };
 
 /* Possible flags of 'shortmess' and their count. */
@@ -551,6 +559,7 @@ static const char *vifminfo_set[][2] = {
 	[BIT(VINFO_FHISTORY)]  = { "fhistory",  "local filter history" },
 	[BIT(VINFO_MCHISTORY)] = { "mchistory", "menu cmdline history" },
 	[BIT(VINFO_TABS)]      = { "tabs",      "global or pane tabs" },
+	[BIT(VINFO_DCACHE)]    = { "dcache",    "directory sizes cache" },
 };
 ARRAY_GUARD(vifminfo_set, NUM_VINFO);
 
@@ -593,6 +602,10 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &autochpos_handler, NULL,
 	  { .ref.bool_val = &cfg.auto_ch_pos },
 	},
+	{ "bgthreads", "", "threads for background work",
+	  OPT_INT, 0, NULL, &bgthreads_handler, NULL,
+	  { .ref.int_val = &cfg.bg_threads },
+	},
 	{ "caseoptions", "", "case sensitivity overrides",
 	  OPT_CHARSET, ARRAY_LEN(caseoptions_vals), caseoptions_vals,
 		&caseoptions_handler, NULL,
@@ -636,6 +649,10 @@ options[] = {
 	  OPT_ENUM, ARRAY_LEN(dirsize_enum), dirsize_enum, &dirsize_handler, NULL,
 	  { .init = &init_dirsize },
 	},
+	{ "diskusage", "", "show allocated size instead of apparent one",
+	  OPT_BOOL, 0, NULL, &diskusage_handler, NULL,
+	  { .ref.bool_val = &cfg.disk_usage },
+	},
 	{ "dotdirs", "", "which dot directories to show",
 	  OPT_SET, ARRAY_LEN(dotdirs_vals), dotdirs_vals, &dotdirs_handler, NULL,
 	  { .ref.set_items = &cfg.dot_dirs },
@@ -1253,7 +1270,7 @@ init_navoptions(optval_t *val)
 static void
 init_previewoptions(optval_t *val)
 {
-	static char buf[128];
+	static char buf[256];
 
 	size_t len = 0U;
 	buf[0] = '\0';
@@ -1268,14 +1285,29 @@ init_previewoptions(optval_t *val)
 	}
 	if(cfg.max_tree_depth > 0)
 	{
-		snprintf(buf + len, sizeof(buf) - len, "maxtreedepth:%d,",
+		len += snprintf(buf + len, sizeof(buf) - len, "maxtreedepth:%d,",
 				cfg.max_tree_depth);
 	}
 	if(cfg.graphics_delay != 0)
 	{
-		snprintf(buf + len, sizeof(buf) - len, "graphicsdelay:%d,",
+		len += snprintf(buf + len, sizeof(buf) - len, "graphicsdelay:%d,",
 				cfg.graphics_delay);
 	}
+	if(cfg.preview_cache_size != 0)
+	{
+		len += snprintf(buf + len, sizeof(buf) - len, "diskcache:%d,",
+				cfg.preview_cache_size);
+	}
+	if(cfg.preview_prefetch != 0)
+	{
+		len += snprintf(buf + len, sizeof(buf) - len, "prefetch:%d,",
+				cfg.preview_prefetch);
+	}
+	if(cfg.viewer_delay != 0)
+	{
+		snprintf(buf + len, sizeof(buf) - len, "viewerdelay:%d,",
+				cfg.viewer_delay);
+	}
 
 	val->str_val = buf;
 }
@@ -1312,7 +1344,10 @@ static void
 init_iooptions(optval_t *val)
 {
 	val->set_items = (cfg.fast_file_cloning != 0) << 0
-	               | (cfg.data_sync         != 0) << 1;
+	               | (cfg.data_sync         != 0) << 1
+	               | (cfg.bulk_copy         != 0) << 2
+	               | (cfg.journal_ops       != 0) << 3
+	               | (cfg.verify_copies     != 0) << 4;
 }
 
 /* Default-initializes whether to display file numbers. */
@@ -1749,6 +1784,22 @@ autochpos_handler(OPT_OP op, optval_t val)
 	}
 }
 
+/* Sets maximum number of threads for background operations and tasks. */
+static void
+bgthreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be > 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 1;
+		vle_opts_assign("bgthreads", val, OPT_GLOBAL);
+		return;
+	}
+
+	cfg.bg_threads = val.int_val;
+}
+
 /* Handles changes of 'caseoptions' option.  Updates configuration and
  * normalizes option value. */
 static void
@@ -2110,6 +2161,14 @@ dirsize_handler(OPT_OP op, optval_t val)
 	update_screen(UT_REDRAW);
 }
 
+/* Handles switching between apparent and allocated sizes of files. */
+static void
+diskusage_handler(OPT_OP op, optval_t val)
+{
+	cfg.disk_usage = val.bool_val;
+	update_screen(UT_FULL);
+}
+
 static void
 dotdirs_handler(OPT_OP op, optval_t val)
 {
@@ -2354,6 +2413,9 @@ iooptions_handler(OPT_OP op, optval_t val)
 {
 	cfg.fast_file_cloning = ((val.set_items & 1) != 0);
 	cfg.data_sync = ((val.set_items & 2) != 0);
+	cfg.bulk_copy = ((val.set_items & 4) != 0);
+	cfg.journal_ops = ((val.set_items & 8) != 0);
+	cfg.verify_copies = ((val.set_items & 16) != 0);
 }
 
 static void
@@ -2542,10 +2604,29 @@ previewoptions_handler(OPT_OP op, optval_t val)
 	int hard_graphics_clear = 0;
 	int top_tree_stats = 0;
 	int max_tree_depth = 0;
+	int preview_cache_size = 0;
+	int preview_prefetch = 0;
+	int viewer_delay = 0;
 
 	while((part = split_and_get(part, ',', &state)) != NULL)
 	{
-		if(starts_with_lit(part, "graphicsdelay:"))
+		if(starts_with_lit(part, "diskcache:"))
+		{
+			const char *const num = after_first(part, ':');
+			if(!read_int(num, &preview_cache_size))
+			{
+				vle_tb_append_linef(vle_err,
+						"Failed to parse \"diskcache\" value: %s", num);
+				break;
+			}
+			if(preview_cache_size < 0)
+			{
+				vle_tb_append_linef(vle_err,
+						"\"diskcache\" can't be negative, got: %s", num);
+				break;
+			}
+		}
+		else if(starts_with_lit(part, "graphicsdelay:"))
 		{
 			const char *const num = after_first(part, ':');
 			if(!read_int(num, &graphics_delay))
@@ -2577,6 +2658,38 @@ previewoptions_handler(OPT_OP op, optval_t val)
 				break;
 			}
 		}
+		else if(starts_with_lit(part, "prefetch:"))
+		{
+			const char *const num = after_first(part, ':');
+			if(!read_int(num, &preview_prefetch))
+			{
+				vle_tb_append_linef(vle_err,
+						"Failed to parse \"prefetch\" value: %s", num);
+				break;
+			}
+			if(preview_prefetch < 0)
+			{
+				vle_tb_append_linef(vle_err,
+						"\"prefetch\" can't be negative, got: %s", num);
+				break;
+			}
+		}
+		else if(starts_with_lit(part, "viewerdelay:"))
+		{
+			const char *const num = after_first(part, ':');
+			if(!read_int(num, &viewer_delay))
+			{
+				vle_tb_append_linef(vle_err,
+						"Failed to parse \"viewerdelay\" value: %s", num);
+				break;
+			}
+			if(viewer_delay < 0)
+			{
+				vle_tb_append_linef(vle_err,
+						"\"viewerdelay\" can't be negative, got: %s", num);
+				break;
+			}
+		}
 		else if(strcmp(part, "hardgraphicsclear") == 0)
 		{
 			hard_graphics_clear = 1;
@@ -2604,6 +2717,9 @@ previewoptions_handler(OPT_OP op, optval_t val)
 		cfg.hard_graphics_clear = hard_graphics_clear;
 		cfg.top_tree_stats = top_tree_stats;
 		cfg.max_tree_depth = max_tree_depth;
+		cfg.preview_cache_size = preview_cache_size;
+		cfg.preview_prefetch = preview_prefetch;
+		cfg.viewer_delay = viewer_delay;
 
 		if(need_update)
 		{
@@ -40,6 +40,9 @@
 #include "flist_sel.h"
 #include "status.h"
 
+static void unfold_matches(view_t *view, const char pattern[]);
+static int name_matches(const char dir[], const char name[], int is_dir,
+		void *arg);
 static int find_match(view_t *view, int start, int backward);
 
 int
@@ -49,6 +52,12 @@ search_find(view_t *view, const char pattern[], int backward,
 {
 	int save_msg = 0;
 
+	/* Searching while pattern is being typed sticks to what's loaded. */
+	if(print_msg)
+	{
+		unfold_matches(view, pattern);
+	}
+
 	if(search_pattern(view, pattern, stash_selection, select_matches) != 0)
 	{
 		*found = 0;
@@ -88,6 +97,7 @@ search_next(view_t *view, int backward, int stash_selection, int select_matches,
 	if(view->matches == 0)
 	{
 		const char *const pattern = hists_search_last();
+		unfold_matches(view, pattern);
 		if(search_pattern(view, pattern, stash_selection, select_matches) != 0)
 		{
 			print_search_fail_msg(view, backward);
@@ -103,6 +113,35 @@ search_next(view_t *view, int backward, int stash_selection, int select_matches,
 	return save_msg;
 }
 
+/* Loads folds of a lazy tree which contain matches of the pattern. */
+static void
+unfold_matches(view_t *view, const char pattern[])
+{
+	if(pattern[0] == '\0')
+	{
+		return;
+	}
+
+	regex_t re;
+	if(regexp_compile(&re, pattern, get_regexp_cflags(pattern)) == 0 &&
+			flist_tree_unfold_matching(view, &name_matches, &re) != 0)
+	{
+		(void)populate_dir_list(view, 1);
+	}
+	regfree(&re);
+}
+
+/* Checks whether name of a file matches regular expression in the arg.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+name_matches(const char dir[], const char name[], int is_dir, void *arg)
+{
+	char *const full_name = format_str("%s%s", name, is_dir ? "/" : "");
+	const int matches = (regexec(arg, full_name, 0, NULL, 0) == 0);
+	free(full_name);
+	return matches;
+}
+
 int
 goto_search_match(view_t *view, int backward, int count,
 		move_cursor_and_redraw_cb cb)
@@ -23,12 +23,17 @@
 
 #include <assert.h> /* assert() */
 #include <limits.h> /* INT_MIN */
-#include <stddef.h> /* NULL */
-#include <string.h> /* memcpy() memmove() */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* int64_t uint16_t uint64_t */
+#include <stdio.h> /* FILE fclose() fread() fwrite() getc() putc() remove()
+                      snprintf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcmp() memcpy() memmove() strlen() */
 #include <time.h> /* time_t time() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/os.h"
 #include "compat/pthread.h"
 #include "compat/reallocarray.h"
 #include "lua/vlua.h"
@@ -59,10 +64,23 @@
 #define SCREEN_ENVVAR "STY"
 #define TMUX_ENVVAR "TMUX"
 
+/* Magic string at the start of a file with persistent dcache, which also
+ * identifies version of its format.  Numbers in the file are stored in native
+ * byte order, because the file is as local as the cache itself. */
+#define DCACHE_MAGIC "vifm-dcache-2"
+
+/* Kinds of records in dcache file. */
+enum
+{
+	DCACHE_REC_SIZE,   /* Entry of dcache_size. */
+	DCACHE_REC_NITEMS, /* Entry of dcache_nitems. */
+};
+
 /* dcache entry. */
 typedef struct
 {
 	uint64_t value;   /* Stored value. */
+	uint64_t alloc;   /* Allocated size for entries of dcache_size. */
 #ifndef _WIN32
 	ino_t inode;      /* Inode number. */
 #endif
@@ -70,6 +88,16 @@ typedef struct
 }
 dcache_data_t;
 
+/* State of writing dcache to a file. */
+typedef struct
+{
+	FILE *fp;                 /* Destination file. */
+	int kind;                 /* DCACHE_REC_* value of records being written. */
+	char prev[PATH_MAX + 1];  /* Path of previous record. */
+	size_t prev_len;          /* Length of the prev field. */
+}
+dcache_writer_t;
+
 /* Saved view selection. */
 typedef struct
 {
@@ -85,8 +113,15 @@ static void determine_fuse_umount_cmd(status_t *stats);
 static int reset_dircache(void);
 static void set_last_cmdline_command(const char cmd[]);
 static void dcache_get(const char path[], time_t mtime, uint64_t inode,
-		dcache_result_t *size, dcache_result_t *nitems);
+		dcache_result_t *size, dcache_result_t *alloc, dcache_result_t *nitems);
+static int is_dcache_data_valid(const dcache_data_t *data, time_t mtime,
+		uint64_t inode);
 static void size_updater(void *data, void *arg);
+static int write_dcache_entry(const char path[], const void *data, void *arg);
+static void dcache_ensure_loaded(void);
+static void load_dcache_file(const char path[]);
+static int read_dcache(FILE *fp, fsdata_t *sizes, fsdata_t *nitems);
+static int copy_dcache_entry(const char path[], const void *data, void *arg);
 TSTATIC time_t dcache_get_size_timestamp(const char path[]);
 TSTATIC void dcache_set_size_timestamp(const char path[], time_t ts);
 
@@ -100,14 +135,21 @@ static int pending_refresh;
 static int inside_screen;
 static int inside_tmux;
 
-/* Thread-safety guard for dcache_size variable. */
-static pthread_mutex_t dcache_size_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Thread-safety guard for dcache_size variable.  Readers don't block each
+ * other, so drawing isn't held up by background calculations. */
+static pthread_rwlock_t dcache_size_lock = PTHREAD_RWLOCK_INITIALIZER;
 /* Thread-safety guard for dcache_nitems variable. */
-static pthread_mutex_t dcache_nitems_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t dcache_nitems_lock = PTHREAD_RWLOCK_INITIALIZER;
 /* Cache for directory sizes. */
 static fsdata_t *dcache_size;
 /* Cache for directory item count. */
 static fsdata_t *dcache_nitems;
+/* Path to dcache file which is yet to be loaded or NULL.  Guarded by both of
+ * dcache locks. */
+static char *dcache_file;
+/* Whether dcache_file should be loaded on the next access to dcache.  Accessed
+ * atomically to keep the fast path free of locking. */
+static int dcache_load_pending;
 
 /* Whether UI updates should be "paused" (a counter, not a flag). */
 static int silent_ui;
@@ -578,16 +620,21 @@ hists_search_last(void)
 
 void
 dcache_get_at(const char path[], time_t mtime, uint64_t inode, uint64_t *size,
-		uint64_t *nitems)
+		uint64_t *alloc, uint64_t *nitems)
 {
-	dcache_result_t size_res, nitems_res;
+	dcache_result_t size_res, alloc_res, nitems_res;
 	dcache_get(path, mtime, inode, (size == NULL ? NULL : &size_res),
+			(alloc == NULL ? NULL : &alloc_res),
 			(nitems == NULL ? NULL : &nitems_res));
 
 	if(size != NULL)
 	{
 		*size = (size_res.is_valid ? size_res.value : DCACHE_UNKNOWN);
 	}
+	if(alloc != NULL)
+	{
+		*alloc = (alloc_res.is_valid ? alloc_res.value : DCACHE_UNKNOWN);
+	}
 	if(nitems != NULL)
 	{
 		*nitems = (nitems_res.is_valid ? nitems_res.value : DCACHE_UNKNOWN);
@@ -596,9 +643,9 @@ dcache_get_at(const char path[], time_t mtime, uint64_t inode, uint64_t *size,
 
 void
 dcache_get_of(const dir_entry_t *entry, dcache_result_t *size,
-		dcache_result_t *nitems)
+		dcache_result_t *alloc, dcache_result_t *nitems)
 {
-	if(size == NULL && nitems == NULL)
+	if(size == NULL && alloc == NULL && nitems == NULL)
 	{
 		return;
 	}
@@ -607,33 +654,40 @@ dcache_get_of(const dir_entry_t *entry, dcache_result_t *size,
 	get_full_path_of(entry, sizeof(full_path), full_path);
 
 	uint64_t inode = get_true_inode(entry);
-	dcache_get(full_path, entry->mtime, inode, size, nitems);
+	dcache_get(full_path, entry->mtime, inode, size, alloc, nitems);
 }
 
-/* Retrieves information about the path checking whether it's outdated.  size
- * and/or nitems can be NULL. */
+/* Retrieves information about the path checking whether it's outdated.  size,
+ * alloc and/or nitems can be NULL. */
 static void
 dcache_get(const char path[], time_t mtime, uint64_t inode,
-		dcache_result_t *size, dcache_result_t *nitems)
+		dcache_result_t *size, dcache_result_t *alloc, dcache_result_t *nitems)
 {
-	if(size != NULL)
+	dcache_ensure_loaded();
+
+	if(size != NULL || alloc != NULL)
 	{
+		dcache_result_t dummy;
+		size = (size == NULL ? &dummy : size);
+		alloc = (alloc == NULL ? &dummy : alloc);
+
 		size->value = DCACHE_UNKNOWN;
 		size->is_valid = 0;
+		alloc->value = DCACHE_UNKNOWN;
+		alloc->is_valid = 0;
 
-		pthread_mutex_lock(&dcache_size_mutex);
+		pthread_rwlock_rdlock(&dcache_size_lock);
 		dcache_data_t size_data;
-		if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
+		if(dcache_size != NULL &&
+				fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
 		{
+			const int is_valid = is_dcache_data_valid(&size_data, mtime, inode);
 			size->value = size_data.value;
-			/* We check strictly for less than to handle scenario when multiple
-			 * changes occurred during the same second. */
-			size->is_valid = (mtime < size_data.timestamp);
-#ifndef _WIN32
-			size->is_valid &= (inode == size_data.inode);
-#endif
+			size->is_valid = (is_valid && size_data.value != DCACHE_UNKNOWN);
+			alloc->value = size_data.alloc;
+			alloc->is_valid = (is_valid && size_data.alloc != DCACHE_UNKNOWN);
 		}
-		pthread_mutex_unlock(&dcache_size_mutex);
+		pthread_rwlock_unlock(&dcache_size_lock);
 	}
 
 	if(nitems != NULL)
@@ -641,76 +695,344 @@ dcache_get(const char path[], time_t mtime, uint64_t inode,
 		nitems->value = DCACHE_UNKNOWN;
 		nitems->is_valid = 0;
 
-		pthread_mutex_lock(&dcache_nitems_mutex);
+		pthread_rwlock_rdlock(&dcache_nitems_lock);
 		dcache_data_t nitems_data;
-		if(fsdata_get(dcache_nitems, path, &nitems_data, sizeof(nitems_data)) == 0)
+		if(dcache_nitems != NULL &&
+				fsdata_get(dcache_nitems, path, &nitems_data, sizeof(nitems_data)) == 0)
 		{
 			nitems->value = nitems_data.value;
-			/* We check strictly for less than to handle scenario when multiple
-			 * changes occurred during the same second. */
-			nitems->is_valid = (mtime < nitems_data.timestamp);
-#ifndef _WIN32
-			nitems->is_valid &= (inode == nitems_data.inode);
-#endif
+			nitems->is_valid = is_dcache_data_valid(&nitems_data, mtime, inode);
 		}
-		pthread_mutex_unlock(&dcache_nitems_mutex);
+		pthread_rwlock_unlock(&dcache_nitems_lock);
 	}
 }
 
+/* Checks whether cached data corresponds to specified state of a file.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_dcache_data_valid(const dcache_data_t *data, time_t mtime, uint64_t inode)
+{
+	/* We check strictly for less than to handle scenario when multiple changes
+	 * occurred during the same second. */
+	int is_valid = (mtime < data->timestamp);
+#ifndef _WIN32
+	is_valid &= (inode == data->inode);
+#else
+	(void)inode;
+#endif
+	return is_valid;
+}
+
 void
-dcache_update_parent_sizes(const char path[], uint64_t by)
+dcache_update_parent_sizes(const char path[], uint64_t by, uint64_t alloc_by)
 {
-	pthread_mutex_lock(&dcache_size_mutex);
-	(void)fsdata_map_parents(dcache_size, path, &size_updater, &by);
-	pthread_mutex_unlock(&dcache_size_mutex);
+	dcache_ensure_loaded();
+
+	if(dcache_size == NULL)
+	{
+		/* dcache isn't initialized yet. */
+		return;
+	}
+
+	const uint64_t deltas[] = { by, alloc_by };
+
+	pthread_rwlock_wrlock(&dcache_size_lock);
+	(void)fsdata_map_parents(dcache_size, path, &size_updater, (void *)deltas);
+	pthread_rwlock_unlock(&dcache_size_lock);
 }
 
-/* Updates cached value by a fixed amount. */
+/* Updates cached sizes by fixed amounts. */
 static void
 size_updater(void *data, void *arg)
 {
-	const uint64_t *const by = arg;
+	const uint64_t *const deltas = arg;
 	dcache_data_t *const what = data;
 
-	what->value += *by;
+	what->value += deltas[0];
+	if(what->alloc != DCACHE_UNKNOWN)
+	{
+		what->alloc += deltas[1];
+	}
 }
 
 int
-dcache_set_at(const char path[], uint64_t inode, uint64_t size, uint64_t nitems)
+dcache_set_at(const char path[], uint64_t inode, uint64_t size, uint64_t alloc,
+		uint64_t nitems)
 {
 	int ret = 0;
 	const time_t ts = time(NULL);
 
-	if(size != DCACHE_UNKNOWN)
+	dcache_ensure_loaded();
+
+	if(dcache_size == NULL || dcache_nitems == NULL)
+	{
+		/* dcache isn't initialized yet. */
+		return 1;
+	}
+
+	if(size != DCACHE_UNKNOWN || alloc != DCACHE_UNKNOWN)
 	{
-		dcache_data_t data = { .value = size, .timestamp = ts };
+		dcache_data_t data = { .value = size, .alloc = alloc, .timestamp = ts };
 #ifndef _WIN32
 		data.inode = (ino_t)inode;
 #endif
 
-		pthread_mutex_lock(&dcache_size_mutex);
+		pthread_rwlock_wrlock(&dcache_size_lock);
 		ret |= fsdata_set(dcache_size, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_size_mutex);
+		pthread_rwlock_unlock(&dcache_size_lock);
 	}
 
 	if(nitems != DCACHE_UNKNOWN)
 	{
-		dcache_data_t data = { .value = nitems, .timestamp = ts };
+		dcache_data_t data = {
+			.value = nitems, .alloc = DCACHE_UNKNOWN, .timestamp = ts
+		};
 #ifndef _WIN32
 		data.inode = (ino_t)inode;
 #endif
 
-		pthread_mutex_lock(&dcache_nitems_mutex);
+		pthread_rwlock_wrlock(&dcache_nitems_lock);
 		ret |= fsdata_set(dcache_nitems, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_nitems_mutex);
+		pthread_rwlock_unlock(&dcache_nitems_lock);
 	}
 
 	return ret;
 }
 
+int
+dcache_save(const char path[])
+{
+	dcache_ensure_loaded();
+
+	char tmp_path[PATH_MAX + 16];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	dcache_writer_t *const writer = malloc(sizeof(*writer));
+	if(writer == NULL)
+	{
+		return 1;
+	}
+
+	writer->fp = os_fopen(tmp_path, "wb");
+	if(writer->fp == NULL)
+	{
+		free(writer);
+		return 1;
+	}
+
+	writer->prev[0] = '\0';
+	writer->prev_len = 0U;
+
+	int failed =
+		(fwrite(DCACHE_MAGIC, sizeof(DCACHE_MAGIC), 1U, writer->fp) != 1U);
+
+	/* Traversal can reorder nodes of a tree, hence exclusive locking. */
+	writer->kind = DCACHE_REC_SIZE;
+	pthread_rwlock_wrlock(&dcache_size_lock);
+	failed = failed
+	      || fsdata_traverse_paths(dcache_size, &write_dcache_entry, writer);
+	pthread_rwlock_unlock(&dcache_size_lock);
+
+	writer->kind = DCACHE_REC_NITEMS;
+	pthread_rwlock_wrlock(&dcache_nitems_lock);
+	failed = failed
+	      || fsdata_traverse_paths(dcache_nitems, &write_dcache_entry, writer);
+	pthread_rwlock_unlock(&dcache_nitems_lock);
+
+	failed |= (fclose(writer->fp) != 0);
+	free(writer);
+
+	if(failed || rename_file(tmp_path, path) != 0)
+	{
+		(void)remove(tmp_path);
+		return 1;
+	}
+	return 0;
+}
+
+/* Writes single dcache entry to a file.  Path is stored as length of prefix
+ * shared with the previous entry followed by the rest of it.  Returns non-zero
+ * on error. */
+static int
+write_dcache_entry(const char path[], const void *data, void *arg)
+{
+	dcache_writer_t *const writer = arg;
+	const dcache_data_t *const entry = data;
+
+	const size_t len = strlen(path);
+	size_t prefix = 0U;
+	while(prefix < writer->prev_len && path[prefix] == writer->prev[prefix])
+	{
+		++prefix;
+	}
+
+	const uint16_t prefix_len = prefix;
+	const uint16_t suffix_len = len - prefix;
+	const uint64_t value = entry->value;
+	const uint64_t alloc = entry->alloc;
+#ifndef _WIN32
+	const uint64_t inode = entry->inode;
+#else
+	const uint64_t inode = 0U;
+#endif
+	const int64_t timestamp = entry->timestamp;
+
+	FILE *const fp = writer->fp;
+	(void)putc(writer->kind, fp);
+	(void)fwrite(&prefix_len, sizeof(prefix_len), 1U, fp);
+	(void)fwrite(&suffix_len, sizeof(suffix_len), 1U, fp);
+	(void)fwrite(path + prefix, 1U, suffix_len, fp);
+	(void)fwrite(&value, sizeof(value), 1U, fp);
+	(void)fwrite(&alloc, sizeof(alloc), 1U, fp);
+	(void)fwrite(&inode, sizeof(inode), 1U, fp);
+	(void)fwrite(&timestamp, sizeof(timestamp), 1U, fp);
+
+	memcpy(writer->prev, path, len + 1U);
+	writer->prev_len = len;
+
+	return ferror(fp);
+}
+
+void
+dcache_load_lazily(const char path[])
+{
+	pthread_rwlock_wrlock(&dcache_size_lock);
+	pthread_rwlock_wrlock(&dcache_nitems_lock);
+	(void)replace_string(&dcache_file, path);
+	__atomic_store_n(&dcache_load_pending, dcache_file != NULL, __ATOMIC_RELEASE);
+	pthread_rwlock_unlock(&dcache_nitems_lock);
+	pthread_rwlock_unlock(&dcache_size_lock);
+}
+
+/* Loads file registered by dcache_load_lazily() if it wasn't done yet.  Must be
+ * called without holding dcache locks. */
+static void
+dcache_ensure_loaded(void)
+{
+	if(!__atomic_load_n(&dcache_load_pending, __ATOMIC_ACQUIRE))
+	{
+		return;
+	}
+
+	pthread_rwlock_wrlock(&dcache_size_lock);
+	pthread_rwlock_wrlock(&dcache_nitems_lock);
+	if(dcache_load_pending)
+	{
+		load_dcache_file(dcache_file);
+		(void)update_string(&dcache_file, NULL);
+		__atomic_store_n(&dcache_load_pending, 0, __ATOMIC_RELEASE);
+	}
+	pthread_rwlock_unlock(&dcache_nitems_lock);
+	pthread_rwlock_unlock(&dcache_size_lock);
+}
+
+/* Merges contents of dcache file into dcache.  Entries that are already in
+ * dcache are newer and thus are preserved.  Staleness of loaded entries is
+ * checked on their retrieval.  Corrupted or incompatible files are ignored. */
+static void
+load_dcache_file(const char path[])
+{
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	fsdata_t *sizes = fsdata_create(0, 1);
+	fsdata_t *nitems = fsdata_create(0, 1);
+
+	if(sizes != NULL && nitems != NULL && read_dcache(fp, sizes, nitems) == 0 &&
+			fsdata_traverse_paths(dcache_size, &copy_dcache_entry, sizes) == 0 &&
+			fsdata_traverse_paths(dcache_nitems, &copy_dcache_entry, nitems) == 0)
+	{
+		fsdata_t *tmp;
+
+		tmp = dcache_size;
+		dcache_size = sizes;
+		sizes = tmp;
+
+		tmp = dcache_nitems;
+		dcache_nitems = nitems;
+		nitems = tmp;
+	}
+
+	fclose(fp);
+	fsdata_free(sizes);
+	fsdata_free(nitems);
+}
+
+/* Reads dcache entries from a file.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+read_dcache(FILE *fp, fsdata_t *sizes, fsdata_t *nitems)
+{
+	char magic[sizeof(DCACHE_MAGIC)];
+	if(fread(magic, sizeof(magic), 1U, fp) != 1U ||
+			memcmp(magic, DCACHE_MAGIC, sizeof(magic)) != 0)
+	{
+		return 1;
+	}
+
+	char path[PATH_MAX + 1] = "";
+	size_t len = 0U;
+
+	int kind;
+	while((kind = getc(fp)) != EOF)
+	{
+		uint16_t prefix_len, suffix_len;
+		uint64_t value, alloc, inode;
+		int64_t timestamp;
+
+		if(kind != DCACHE_REC_SIZE && kind != DCACHE_REC_NITEMS)
+		{
+			return 1;
+		}
+
+		if(fread(&prefix_len, sizeof(prefix_len), 1U, fp) != 1U ||
+				fread(&suffix_len, sizeof(suffix_len), 1U, fp) != 1U ||
+				prefix_len > len || prefix_len + suffix_len > PATH_MAX ||
+				fread(path + prefix_len, 1U, suffix_len, fp) != suffix_len ||
+				fread(&value, sizeof(value), 1U, fp) != 1U ||
+				fread(&alloc, sizeof(alloc), 1U, fp) != 1U ||
+				fread(&inode, sizeof(inode), 1U, fp) != 1U ||
+				fread(&timestamp, sizeof(timestamp), 1U, fp) != 1U)
+		{
+			return 1;
+		}
+
+		len = prefix_len + suffix_len;
+		path[len] = '\0';
+
+		dcache_data_t data = {
+			.value = value, .alloc = alloc, .timestamp = timestamp
+		};
+#ifndef _WIN32
+		data.inode = (ino_t)inode;
+#endif
+
+		fsdata_t *const fsd = (kind == DCACHE_REC_SIZE ? sizes : nitems);
+		if(fsdata_set_resolved(fsd, path, &data, sizeof(data)) != 0)
+		{
+			return 1;
+		}
+	}
+
+	return ferror(fp);
+}
+
+/* Copies dcache entry into another fsdata.  Returns non-zero on error. */
+static int
+copy_dcache_entry(const char path[], const void *data, void *arg)
+{
+	fsdata_t *const to = arg;
+	return fsdata_set_resolved(to, path, data, sizeof(dcache_data_t));
+}
+
 TSTATIC time_t
 dcache_get_size_timestamp(const char path[])
 {
+	dcache_ensure_loaded();
+
 	dcache_data_t size_data;
 	if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
 	{
@@ -723,6 +1045,8 @@ dcache_get_size_timestamp(const char path[])
 TSTATIC void
 dcache_set_size_timestamp(const char path[], time_t ts)
 {
+	dcache_ensure_loaded();
+
 	dcache_data_t size_data;
 	if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
 	{
@@ -332,23 +332,36 @@ const char * hists_search_last(void);
 /* Caching of information about directories. */
 
 /* Retrieves information about the path at specified state checking whether it's
- * outdated.  size and/or nitems can be NULL.  On unknown or outdated values
- * variables are set to DCACHE_UNKNOWN. */
+ * outdated.  size is apparent size, while alloc is allocated size.  size, alloc
+ * and/or nitems can be NULL.  On unknown or outdated values variables are set
+ * to DCACHE_UNKNOWN. */
 void dcache_get_at(const char path[], time_t mtime, uint64_t inode,
-		uint64_t *size, uint64_t *nitems);
+		uint64_t *size, uint64_t *alloc, uint64_t *nitems);
 
-/* Retrieves information about the entry checking whether it's outdated.  size
- * and/or nitems can be NULL. */
+/* Retrieves information about the entry checking whether it's outdated.  size,
+ * alloc and/or nitems can be NULL. */
 void dcache_get_of(const struct dir_entry_t *entry, dcache_result_t *size,
-		dcache_result_t *nitems);
+		dcache_result_t *alloc, dcache_result_t *nitems);
 
-/* Updates cached sizes of parents by specified amount. */
-void dcache_update_parent_sizes(const char path[], uint64_t by);
+/* Updates cached apparent and allocated sizes of parents by specified
+ * amounts. */
+void dcache_update_parent_sizes(const char path[], uint64_t by,
+		uint64_t alloc_by);
 
-/* Updates information about the path.  Returns zero on success, otherwise
- * non-zero is returned. */
+/* Updates information about the path.  Both sizes are stored together, so
+ * setting only one of them forgets the other one.  Returns zero on success,
+ * otherwise non-zero is returned. */
 int dcache_set_at(const char path[], uint64_t inode, uint64_t size,
-		uint64_t nitems);
+		uint64_t alloc, uint64_t nitems);
+
+/* Writes contents of dcache to a file in compact binary format.  Returns zero
+ * on success, otherwise non-zero is returned. */
+int dcache_save(const char path[]);
+
+/* Schedules loading of dcache from a file on first access to dcache, so that
+ * startup isn't slowed down by it.  Entries that are already present aren't
+ * overwritten by loaded ones. */
+void dcache_load_lazily(const char path[]);
 
 /* Selection history. */
 
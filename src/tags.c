@@ -43,6 +43,7 @@ const char *tags[] = {
 	"vifm-'aproposprg'",
 	"vifm-'autocd'",
 	"vifm-'autochpos'",
+	"vifm-'bgthreads'",
 	"vifm-'caseoptions'",
 	"vifm-'cd'",
 	"vifm-'cdpath'",
@@ -57,6 +58,7 @@ const char *tags[] = {
 	"vifm-'cvoptions'",
 	"vifm-'deleteprg'",
 	"vifm-'dirsize'",
+	"vifm-'diskusage'",
 	"vifm-'dotdirs'",
 	"vifm-'dotfiles'",
 	"vifm-'fastrun'",
@@ -536,6 +538,7 @@ const char *tags[] = {
 	"vifm-al",
 	"vifm-app.txt",
 	"vifm-av",
+	"vifm-bulk-param",
 	"vifm-cW",
 	"vifm-c_ALT-.",
 	"vifm-c_ALT-B",
@@ -977,6 +980,7 @@ const char *tags[] = {
 	"vifm-v_o",
 	"vifm-v_u",
 	"vifm-v_v",
+	"vifm-verify-param",
 	"vifm-view",
 	"vifm-view-look",
 	"vifm-vifminfo",
@@ -0,0 +1,1055 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "text_index.h"
+
+#ifndef _WIN32
+#include <unistd.h> /* pread() */
+#endif
+
+#include <regex.h> /* regex_t regexec() regfree() */
+
+#include <limits.h> /* INT_MAX */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE SEEK_SET fclose() fileno() fread() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memchr() memcmp() memmem() strdup() strlen() strpbrk() */
+#include <time.h> /* CLOCK_REALTIME clock_gettime() timespec */
+
+#include "compat/os.h"
+#include "compat/pthread.h"
+#include "utils/dynarray.h"
+#include "utils/fs.h"
+#include "utils/macros.h"
+#include "utils/regexp.h"
+
+/* Offset of every INDEX_STEP-th line is stored, the rest are found by reading
+ * the file. */
+#define INDEX_STEP 64
+
+/* Size of blocks in which the file is read. */
+#define CHUNK_SIZE (1024*1024)
+
+/* Size of blocks in which lines are read. */
+#define LINE_CHUNK_SIZE (64*1024)
+
+/* Lines longer than this are cut to avoid exhausting memory on files without
+ * line breaks.  Search matches only this many first bytes of a line as well. */
+#define MAX_LINE_LEN (1024*1024)
+
+/* Number of lines per element of the bitmap of matches. */
+#define WORD_BITS 64
+
+struct text_index_t
+{
+	char *path;           /* Path to the file. */
+	FILE *fp;             /* File for retrieving lines. */
+	uint64_t start;       /* Offset of the first line (after BOM). */
+
+	pthread_t tid;        /* Indexing thread. */
+	int started;          /* Whether the thread is started and not joined. */
+
+	/* State of indexing that's used by the thread between its runs. */
+	uint64_t indexed;     /* Number of processed bytes. */
+	int line_pending;     /* Whether a line starts at the end of processed data
+	                         if there is any data after it. */
+
+	pthread_mutex_t lock; /* Protects fields below (size is changed only by
+	                         the main thread). */
+	pthread_cond_t found; /* Signals progress of indexing. */
+	uint64_t size;        /* Size of the file, which is indexed. */
+	int stop;             /* Whether indexing should be stopped. */
+	int complete;         /* Whether the whole file was indexed. */
+	uint64_t *marks;      /* Offsets of every INDEX_STEP-th line. */
+	int nlines;           /* Number of found lines. */
+
+	/* Position of the line after the last retrieved one, which is used only by
+	 * tidx_get(). */
+	int next_line;        /* Number of the line or -1. */
+	uint64_t next_off;    /* Offset of the line. */
+};
+
+struct tidx_search_t
+{
+	char *path;           /* Path to the file. */
+	uint64_t size;        /* Size of the file to search through. */
+	uint64_t offset;      /* Offset of the first line to be scanned. */
+	int line;             /* Number of the first line to be scanned. */
+	int failed;           /* Whether the search can't be continued. */
+
+	char *literal;        /* Pattern without special characters or NULL. */
+	size_t literal_len;   /* Length of the literal pattern. */
+	regex_t re;           /* Compiled pattern when it's not a literal. */
+
+	pthread_t tid;        /* Searching thread. */
+	int started;          /* Whether searching thread was started. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	pthread_cond_t found; /* Signals progress of the search. */
+	int stop;             /* Whether search should be stopped. */
+	int complete;         /* Whether the search is over. */
+	uint64_t *matches;    /* Bitmap of matching lines among scanned ones. */
+	int nlines;           /* Number of scanned lines. */
+};
+
+static void * index_thread(void *arg);
+static int add_line(text_index_t *tidx, uint64_t offset);
+static void finish_indexing(text_index_t *tidx);
+static void free_search(tidx_search_t *search);
+static int is_literal(const char pattern[], int cflags);
+static void * search_thread(void *arg);
+static int search_chunk(tidx_search_t *search, char buf[], size_t len,
+		int line, int **hits, int *nhits);
+static int add_hit(int **hits, int *nhits, int line);
+static int count_newlines(const char buf[], const char end[]);
+static int publish_hits(tidx_search_t *search, int nlines, const int hits[],
+		int nhits);
+static int find_match(const uint64_t matches[], int from, int to, int step);
+static const char * find_literal(const char buf[], size_t len,
+		const char literal[], size_t literal_len);
+static uint64_t find_eol(FILE *fp, uint64_t offset, uint64_t limit);
+static size_t read_at(FILE *fp, uint64_t offset, char buf[], size_t len);
+static void make_deadline(int msec, struct timespec *deadline);
+
+text_index_t *
+tidx_open(const char path[])
+{
+	text_index_t *const tidx = calloc(1, sizeof(*tidx));
+	if(tidx == NULL)
+	{
+		return NULL;
+	}
+
+	tidx->next_line = -1;
+	tidx->line_pending = 1;
+
+	tidx->path = strdup(path);
+	/* Binary mode is important on Windows. */
+	tidx->fp = os_fopen(path, "rb");
+	if(tidx->path == NULL || tidx->fp == NULL)
+	{
+		if(tidx->fp != NULL)
+		{
+			fclose(tidx->fp);
+		}
+		free(tidx->path);
+		free(tidx);
+		return NULL;
+	}
+
+	tidx->size = get_file_size(path);
+
+	char bom[3];
+	if(read_at(tidx->fp, 0, bom, sizeof(bom)) == sizeof(bom) &&
+			bom[0] == '\xef' && bom[1] == '\xbb' && bom[2] == '\xbf')
+	{
+		tidx->start = sizeof(bom);
+	}
+	tidx->indexed = tidx->start;
+
+	if(pthread_mutex_init(&tidx->lock, NULL) != 0)
+	{
+		fclose(tidx->fp);
+		free(tidx->path);
+		free(tidx);
+		return NULL;
+	}
+	if(pthread_cond_init(&tidx->found, NULL) != 0)
+	{
+		(void)pthread_mutex_destroy(&tidx->lock);
+		fclose(tidx->fp);
+		free(tidx->path);
+		free(tidx);
+		return NULL;
+	}
+
+	if(pthread_create(&tidx->tid, NULL, &index_thread, tidx) != 0)
+	{
+		(void)pthread_cond_destroy(&tidx->found);
+		(void)pthread_mutex_destroy(&tidx->lock);
+		fclose(tidx->fp);
+		free(tidx->path);
+		free(tidx);
+		return NULL;
+	}
+
+	tidx->started = 1;
+	return tidx;
+}
+
+void
+tidx_free(text_index_t *tidx)
+{
+	if(tidx == NULL)
+	{
+		return;
+	}
+
+	(void)pthread_mutex_lock(&tidx->lock);
+	tidx->stop = 1;
+	(void)pthread_mutex_unlock(&tidx->lock);
+
+	if(tidx->started)
+	{
+		(void)pthread_join(tidx->tid, NULL);
+	}
+
+	(void)pthread_cond_destroy(&tidx->found);
+	(void)pthread_mutex_destroy(&tidx->lock);
+
+	if(tidx->fp != NULL)
+	{
+		fclose(tidx->fp);
+	}
+	dynarray_free(tidx->marks);
+	free(tidx->path);
+	free(tidx);
+}
+
+/* Entry point of the indexing thread.  Looks for line breaks from where the
+ * previous run has stopped until the end of the file or until stopped.
+ * Returns NULL. */
+static void *
+index_thread(void *arg)
+{
+	text_index_t *const tidx = arg;
+
+	/* The stream isn't shared to not mess with its position on Windows. */
+	FILE *const fp = os_fopen(tidx->path, "rb");
+	char *const buf = malloc(CHUNK_SIZE);
+	if(fp == NULL || buf == NULL)
+	{
+		if(fp != NULL)
+		{
+			fclose(fp);
+		}
+		free(buf);
+		finish_indexing(tidx);
+		return NULL;
+	}
+
+	uint64_t offset = tidx->indexed;
+	int ok = 1;
+	while(1)
+	{
+		(void)pthread_mutex_lock(&tidx->lock);
+		/* Checking for the end and finishing are done at once to not miss
+		 * extension of the file. */
+		if(!ok || tidx->stop || offset >= tidx->size)
+		{
+			tidx->indexed = offset;
+			tidx->complete = 1;
+			(void)pthread_cond_broadcast(&tidx->found);
+			(void)pthread_mutex_unlock(&tidx->lock);
+			break;
+		}
+		const uint64_t size = tidx->size;
+		(void)pthread_cond_broadcast(&tidx->found);
+		(void)pthread_mutex_unlock(&tidx->lock);
+
+		if(tidx->line_pending)
+		{
+			ok = (add_line(tidx, offset) == 0);
+			tidx->line_pending = 0;
+		}
+
+		const size_t len = read_at(fp, offset, buf,
+				(size_t)MIN((uint64_t)CHUNK_SIZE, size - offset));
+		if(len == 0)
+		{
+			/* The file got shorter. */
+			ok = 0;
+		}
+
+		const char *p = buf;
+		const char *const end = buf + len;
+		while(ok && (p = memchr(p, '\n', end - p)) != NULL)
+		{
+			++p;
+			const uint64_t line_start = offset + (p - buf);
+			if(line_start < size)
+			{
+				ok = (add_line(tidx, line_start) == 0);
+			}
+			else
+			{
+				tidx->line_pending = 1;
+			}
+		}
+
+		offset += len;
+	}
+
+	free(buf);
+	fclose(fp);
+	return NULL;
+}
+
+/* Registers beginning of the next line.  Returns zero on success and non-zero
+ * if no more lines can be added. */
+static int
+add_line(text_index_t *tidx, uint64_t offset)
+{
+	int error = 0;
+
+	(void)pthread_mutex_lock(&tidx->lock);
+	if(tidx->nlines == INT_MAX)
+	{
+		error = 1;
+	}
+	else if(tidx->nlines%INDEX_STEP == 0)
+	{
+		uint64_t *const marks = dynarray_extend(tidx->marks, sizeof(*marks));
+		if(marks == NULL)
+		{
+			error = 1;
+		}
+		else
+		{
+			tidx->marks = marks;
+			tidx->marks[tidx->nlines/INDEX_STEP] = offset;
+		}
+	}
+
+	if(!error)
+	{
+		++tidx->nlines;
+	}
+	(void)pthread_mutex_unlock(&tidx->lock);
+
+	return error;
+}
+
+/* Marks indexing as finished and notifies waiters. */
+static void
+finish_indexing(text_index_t *tidx)
+{
+	(void)pthread_mutex_lock(&tidx->lock);
+	tidx->complete = 1;
+	(void)pthread_cond_broadcast(&tidx->found);
+	(void)pthread_mutex_unlock(&tidx->lock);
+}
+
+int
+tidx_extend(text_index_t *tidx)
+{
+	const uint64_t size = get_file_size(tidx->path);
+	if(size < tidx->size)
+	{
+		return 1;
+	}
+	if(size == tidx->size)
+	{
+		return 0;
+	}
+
+	(void)pthread_mutex_lock(&tidx->lock);
+	tidx->size = size;
+	/* A running thread will pick up the new size by itself. */
+	const int restart = tidx->complete;
+	tidx->complete = 0;
+	(void)pthread_mutex_unlock(&tidx->lock);
+
+	if(restart)
+	{
+		if(tidx->started)
+		{
+			(void)pthread_join(tidx->tid, NULL);
+		}
+
+		tidx->started =
+			(pthread_create(&tidx->tid, NULL, &index_thread, tidx) == 0);
+		if(!tidx->started)
+		{
+			finish_indexing(tidx);
+		}
+	}
+
+	return 0;
+}
+
+int
+tidx_count(text_index_t *tidx, int *complete)
+{
+	(void)pthread_mutex_lock(&tidx->lock);
+	const int nlines = tidx->nlines;
+	*complete = tidx->complete;
+	(void)pthread_mutex_unlock(&tidx->lock);
+	return nlines;
+}
+
+int
+tidx_wait(text_index_t *tidx, int nlines)
+{
+	(void)pthread_mutex_lock(&tidx->lock);
+	while(!tidx->complete && tidx->nlines < nlines)
+	{
+		(void)pthread_cond_wait(&tidx->found, &tidx->lock);
+	}
+	nlines = tidx->nlines;
+	(void)pthread_mutex_unlock(&tidx->lock);
+	return nlines;
+}
+
+int
+tidx_wait_for(text_index_t *tidx, int nlines, int msec)
+{
+	struct timespec deadline;
+	make_deadline(msec, &deadline);
+
+	(void)pthread_mutex_lock(&tidx->lock);
+	while(!tidx->complete && tidx->nlines < nlines)
+	{
+		if(pthread_cond_timedwait(&tidx->found, &tidx->lock, &deadline) != 0)
+		{
+			break;
+		}
+	}
+	nlines = tidx->nlines;
+	(void)pthread_mutex_unlock(&tidx->lock);
+	return nlines;
+}
+
+char *
+tidx_get(text_index_t *tidx, int n)
+{
+	int line;
+	uint64_t offset;
+
+	(void)pthread_mutex_lock(&tidx->lock);
+	if(n < 0 || n >= tidx->nlines)
+	{
+		(void)pthread_mutex_unlock(&tidx->lock);
+		return NULL;
+	}
+	line = n - n%INDEX_STEP;
+	offset = tidx->marks[n/INDEX_STEP];
+	(void)pthread_mutex_unlock(&tidx->lock);
+
+	/* Continue from the previous line if it's closer than the checkpoint. */
+	if(tidx->next_line >= line && tidx->next_line <= n)
+	{
+		line = tidx->next_line;
+		offset = tidx->next_off;
+	}
+
+	while(line < n)
+	{
+		offset = find_eol(tidx->fp, offset, tidx->size) + 1;
+		++line;
+	}
+
+	const uint64_t limit = MIN(tidx->size, offset + MAX_LINE_LEN);
+	const uint64_t eol = find_eol(tidx->fp, offset, limit);
+	if(eol < limit)
+	{
+		tidx->next_line = n + 1;
+		tidx->next_off = eol + 1;
+	}
+	else
+	{
+		tidx->next_line = -1;
+	}
+
+	size_t len = eol - offset;
+	char *const text = malloc(len + 1);
+	if(text == NULL)
+	{
+		return NULL;
+	}
+
+	len = read_at(tidx->fp, offset, text, len);
+	if(len > 0 && text[len - 1] == '\r')
+	{
+		--len;
+	}
+	text[len] = '\0';
+	return text;
+}
+
+tidx_search_t *
+tidx_search_start(text_index_t *tidx, const char pattern[], int cflags)
+{
+	tidx_search_t *const search = calloc(1, sizeof(*search));
+	if(search == NULL)
+	{
+		return NULL;
+	}
+
+	search->path = strdup(tidx->path);
+	search->size = tidx->size;
+	search->offset = tidx->start;
+	if(search->path == NULL)
+	{
+		free(search);
+		return NULL;
+	}
+
+	if(is_literal(pattern, cflags))
+	{
+		search->literal = strdup(pattern);
+		search->literal_len = strlen(pattern);
+		if(search->literal == NULL)
+		{
+			free(search->path);
+			free(search);
+			return NULL;
+		}
+	}
+	else if(regexp_compile(&search->re, pattern, cflags) != 0)
+	{
+		regfree(&search->re);
+		free(search->path);
+		free(search);
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&search->lock, NULL) != 0)
+	{
+		free_search(search);
+		return NULL;
+	}
+	if(pthread_cond_init(&search->found, NULL) != 0)
+	{
+		(void)pthread_mutex_destroy(&search->lock);
+		free_search(search);
+		return NULL;
+	}
+
+	if(pthread_create(&search->tid, NULL, &search_thread, search) != 0)
+	{
+		(void)pthread_cond_destroy(&search->found);
+		(void)pthread_mutex_destroy(&search->lock);
+		free_search(search);
+		return NULL;
+	}
+	search->started = 1;
+
+	return search;
+}
+
+int
+tidx_search_extend(tidx_search_t *search, const text_index_t *tidx)
+{
+	(void)pthread_mutex_lock(&search->lock);
+	search->stop = 1;
+	(void)pthread_mutex_unlock(&search->lock);
+
+	if(search->started)
+	{
+		(void)pthread_join(search->tid, NULL);
+		search->started = 0;
+	}
+
+	if(search->failed)
+	{
+		return 1;
+	}
+
+	(void)pthread_mutex_lock(&search->lock);
+	/* Incomplete last line is scanned again. */
+	if(search->nlines > search->line)
+	{
+		search->matches[search->line/WORD_BITS] &=
+			~(1ULL << (search->line%WORD_BITS));
+		search->nlines = search->line;
+	}
+	search->size = tidx->size;
+	search->stop = 0;
+	search->complete = 0;
+	(void)pthread_mutex_unlock(&search->lock);
+
+	search->started =
+		(pthread_create(&search->tid, NULL, &search_thread, search) == 0);
+	if(!search->started)
+	{
+		search->failed = 1;
+
+		(void)pthread_mutex_lock(&search->lock);
+		search->complete = 1;
+		(void)pthread_mutex_unlock(&search->lock);
+		return 1;
+	}
+
+	return 0;
+}
+
+void
+tidx_search_free(tidx_search_t *search)
+{
+	if(search == NULL)
+	{
+		return;
+	}
+
+	(void)pthread_mutex_lock(&search->lock);
+	search->stop = 1;
+	(void)pthread_mutex_unlock(&search->lock);
+
+	if(search->started)
+	{
+		(void)pthread_join(search->tid, NULL);
+	}
+
+	(void)pthread_cond_destroy(&search->found);
+	(void)pthread_mutex_destroy(&search->lock);
+
+	free_search(search);
+}
+
+/* Frees the pattern, results and the search itself. */
+static void
+free_search(tidx_search_t *search)
+{
+	if(search->literal == NULL)
+	{
+		regfree(&search->re);
+	}
+	free(search->literal);
+	dynarray_free(search->matches);
+	free(search->path);
+	free(search);
+}
+
+/* Checks whether pattern can be looked up as a sequence of bytes instead of
+ * being matched as a regular expression.  Returns non-zero if so. */
+static int
+is_literal(const char pattern[], int cflags)
+{
+	return pattern[0] != '\0'
+	    && !(cflags & REG_ICASE)
+	    && strpbrk(pattern, "\\.[]()*+?{}|^$\r\n") == NULL;
+}
+
+/* Entry point of the searching thread.  Scans lines of the file in chunks
+ * starting where previous run has stopped and publishes matches after each
+ * chunk until the end of the file or until stopped.  Returns NULL. */
+static void *
+search_thread(void *arg)
+{
+	tidx_search_t *const search = arg;
+
+	FILE *const fp = os_fopen(search->path, "rb");
+	/* Extra byte is for the terminating null character. */
+	char *const buf = malloc(CHUNK_SIZE + 1);
+
+	int *hits = NULL;
+	int nhits = 0;
+	int line = search->line;
+
+	uint64_t offset = search->offset;
+	int ok = (fp != NULL && buf != NULL);
+	search->failed = !ok;
+	while(ok && offset < search->size)
+	{
+		size_t len = read_at(fp, offset, buf,
+				(size_t)MIN((uint64_t)CHUNK_SIZE, search->size - offset));
+		if(len == 0)
+		{
+			break;
+		}
+
+		uint64_t next = offset + len;
+		if(next < search->size)
+		{
+			/* Incomplete line at the end is processed as part of the next chunk. */
+			size_t whole = len;
+			while(whole > 0 && buf[whole - 1] != '\n')
+			{
+				--whole;
+			}
+
+			if(whole == 0)
+			{
+				/* The line doesn't fit, match its beginning and skip the rest. */
+				next = find_eol(fp, next, search->size) + 1;
+			}
+			else
+			{
+				len = whole;
+				next = offset + whole;
+			}
+		}
+
+		/* The last line of the file might still be growing, so it's scanned again
+		 * when more data is appended. */
+		uint64_t resume = next;
+		int partial = 0;
+		if(next >= search->size && buf[len - 1] != '\n')
+		{
+			size_t last = len;
+			while(last > 0 && buf[last - 1] != '\n')
+			{
+				--last;
+			}
+			resume = offset + last;
+			partial = 1;
+		}
+
+		line = search_chunk(search, buf, len, line, &hits, &nhits);
+		search->failed = (line < 0);
+		ok = (!search->failed && publish_hits(search, line, hits, nhits) == 0);
+
+		dynarray_free(hits);
+		hits = NULL;
+		nhits = 0;
+
+		if(!search->failed)
+		{
+			search->offset = resume;
+			search->line = line - partial;
+		}
+
+		/* Number of lines in a chunk is limited by its size. */
+		if(line > INT_MAX - CHUNK_SIZE)
+		{
+			search->failed = 1;
+			ok = 0;
+		}
+
+		offset = next;
+	}
+
+	dynarray_free(hits);
+	free(buf);
+	if(fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	(void)pthread_mutex_lock(&search->lock);
+	search->complete = 1;
+	(void)pthread_cond_broadcast(&search->found);
+	(void)pthread_mutex_unlock(&search->lock);
+	return NULL;
+}
+
+/* Looks for matches in a chunk of complete lines (except possibly for the last
+ * line of the file), the first of which has the specified number.  Numbers of
+ * matching lines are appended to *hits.  Returns number of the line that
+ * follows the chunk or -1 on error. */
+static int
+search_chunk(tidx_search_t *search, char buf[], size_t len, int line,
+		int **hits, int *nhits)
+{
+	char *const end = buf + len;
+
+	if(search->literal != NULL)
+	{
+		const char *p = buf;
+		while(p < end)
+		{
+			const char *const hit = find_literal(p, end - p, search->literal,
+					search->literal_len);
+			if(hit == NULL)
+			{
+				/* The last line of the file might lack line break. */
+				return line + count_newlines(p, end) + (end[-1] != '\n');
+			}
+
+			line += count_newlines(p, hit);
+			if(add_hit(hits, nhits, line) != 0)
+			{
+				return -1;
+			}
+
+			/* The rest of the line doesn't matter. */
+			++line;
+			p = memchr(hit, '\n', end - hit);
+			if(p == NULL)
+			{
+				break;
+			}
+			++p;
+		}
+		return line;
+	}
+
+	char *p = buf;
+	*end = '\0';
+	while(p < end)
+	{
+		char *const eol = memchr(p, '\n', end - p);
+		char *const line_end = (eol == NULL ? end : eol);
+
+		*line_end = '\0';
+		if(line_end != p && line_end[-1] == '\r')
+		{
+			line_end[-1] = '\0';
+		}
+
+		if(regexec(&search->re, p, 0, NULL, 0) == 0)
+		{
+			if(add_hit(hits, nhits, line) != 0)
+			{
+				return -1;
+			}
+		}
+
+		++line;
+		p = line_end + 1;
+	}
+	return line;
+}
+
+/* Appends number of a matching line to the list of hits.  Returns zero on
+ * success and non-zero on error. */
+static int
+add_hit(int **hits, int *nhits, int line)
+{
+	int *const extended = dynarray_extend(*hits, sizeof(**hits));
+	if(extended == NULL)
+	{
+		return 1;
+	}
+
+	*hits = extended;
+	(*hits)[(*nhits)++] = line;
+	return 0;
+}
+
+/* Counts line breaks in a piece of text.  Returns the number. */
+static int
+count_newlines(const char buf[], const char end[])
+{
+	int count = 0;
+	while((buf = memchr(buf, '\n', end - buf)) != NULL)
+	{
+		++buf;
+		++count;
+	}
+	return count;
+}
+
+/* Makes results of scanning a chunk visible to other threads.  Sets failed
+ * field of the search on error.  Returns zero on success and non-zero if search
+ * should be stopped. */
+static int
+publish_hits(tidx_search_t *search, int nlines, const int hits[], int nhits)
+{
+	int error = 0;
+
+	(void)pthread_mutex_lock(&search->lock);
+
+	const int have = DIV_ROUND_UP(search->nlines, WORD_BITS);
+	const int need = DIV_ROUND_UP(nlines, WORD_BITS);
+	if(need > have)
+	{
+		uint64_t *const matches = dynarray_cextend(search->matches,
+				(need - have)*sizeof(*matches));
+		if(matches == NULL)
+		{
+			search->failed = 1;
+			error = 1;
+		}
+		else
+		{
+			search->matches = matches;
+		}
+	}
+
+	if(!error)
+	{
+		int i;
+		for(i = 0; i < nhits; ++i)
+		{
+			search->matches[hits[i]/WORD_BITS] |= 1ULL << (hits[i]%WORD_BITS);
+		}
+		search->nlines = nlines;
+	}
+
+	error |= search->stop;
+	(void)pthread_cond_broadcast(&search->found);
+	(void)pthread_mutex_unlock(&search->lock);
+
+	return error;
+}
+
+int
+tidx_search_find(tidx_search_t *search, int line, int backward)
+{
+	int match;
+
+	(void)pthread_mutex_lock(&search->lock);
+	if(backward)
+	{
+		/* All lines above have to be scanned. */
+		if(line > search->nlines && !search->complete)
+		{
+			match = -2;
+		}
+		else
+		{
+			match = find_match(search->matches, MIN(line, search->nlines) - 1, -1,
+					-1);
+		}
+	}
+	else
+	{
+		match = find_match(search->matches, line + 1, search->nlines, 1);
+		if(match == -1 && !search->complete)
+		{
+			match = -2;
+		}
+	}
+	(void)pthread_mutex_unlock(&search->lock);
+
+	return match;
+}
+
+/* Looks for a set bit in [from, to) range of the bitmap going forward or in
+ * (to, from] range going backward depending on the step (1 or -1).  Returns
+ * number of the bit or -1. */
+static int
+find_match(const uint64_t matches[], int from, int to, int step)
+{
+	int i = from;
+	while(step > 0 ? i < to : i > to)
+	{
+		if(matches[i/WORD_BITS] == 0)
+		{
+			/* Skip the rest of the word at once. */
+			i = (step > 0 ? i - i%WORD_BITS + WORD_BITS : i - i%WORD_BITS - 1);
+			continue;
+		}
+
+		if(matches[i/WORD_BITS] & (1ULL << (i%WORD_BITS)))
+		{
+			return i;
+		}
+		i += step;
+	}
+	return -1;
+}
+
+int
+tidx_search_wait(tidx_search_t *search, int msec)
+{
+	struct timespec deadline;
+	make_deadline(msec, &deadline);
+
+	(void)pthread_mutex_lock(&search->lock);
+	if(!search->complete)
+	{
+		(void)pthread_cond_timedwait(&search->found, &search->lock, &deadline);
+	}
+	const int complete = search->complete;
+	(void)pthread_mutex_unlock(&search->lock);
+
+	return complete;
+}
+
+/* Looks for a sequence of bytes in a buffer.  Returns pointer to the first
+ * occurrence or NULL. */
+static const char *
+find_literal(const char buf[], size_t len, const char literal[],
+		size_t literal_len)
+{
+#ifndef _WIN32
+	/* Implementations of memmem() use vector instructions where available. */
+	return memmem(buf, len, literal, literal_len);
+#else
+	if(len < literal_len)
+	{
+		return NULL;
+	}
+
+	const char *const last = buf + len - literal_len;
+	while((buf = memchr(buf, literal[0], last - buf + 1)) != NULL)
+	{
+		if(memcmp(buf, literal, literal_len) == 0)
+		{
+			return buf;
+		}
+		++buf;
+	}
+	return NULL;
+#endif
+}
+
+/* Looks for the end of a line that starts at the offset without looking past
+ * the limit.  Returns offset of the new line character or the limit. */
+static uint64_t
+find_eol(FILE *fp, uint64_t offset, uint64_t limit)
+{
+	char buf[LINE_CHUNK_SIZE];
+	while(offset < limit)
+	{
+		const size_t len = read_at(fp, offset, buf,
+				MIN(sizeof(buf), limit - offset));
+		if(len == 0)
+		{
+			/* The file got shorter. */
+			return limit;
+		}
+
+		const char *const eol = memchr(buf, '\n', len);
+		if(eol != NULL)
+		{
+			return offset + (eol - buf);
+		}
+
+		offset += len;
+	}
+	return limit;
+}
+
+/* Reads a block of a file at specified offset.  Returns number of bytes read,
+ * which is zero on error or end of file. */
+static size_t
+read_at(FILE *fp, uint64_t offset, char buf[], size_t len)
+{
+#ifndef _WIN32
+	size_t total = 0;
+	while(total < len)
+	{
+		const ssize_t n = pread(fileno(fp), buf + total, len - total,
+				offset + total);
+		if(n <= 0)
+		{
+			break;
+		}
+		total += n;
+	}
+	return total;
+#else
+	if(_fseeki64(fp, offset, SEEK_SET) != 0)
+	{
+		return 0;
+	}
+	return fread(buf, 1, len, fp);
+#endif
+}
+
+/* Computes absolute time that's specified number of milliseconds from now. */
+static void
+make_deadline(int msec, struct timespec *deadline)
+{
+	(void)clock_gettime(CLOCK_REALTIME, deadline);
+	deadline->tv_sec += msec/1000;
+	deadline->tv_nsec += (msec%1000)*1000000L;
+	if(deadline->tv_nsec >= 1000000000L)
+	{
+		++deadline->tv_sec;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
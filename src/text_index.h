@@ -0,0 +1,87 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__TEXT_INDEX_H__
+#define VIFM__TEXT_INDEX_H__
+
+/* text_index - access to lines of huge or growing text files without reading
+ * them into memory, offsets of lines are collected by a background thread */
+
+/* Opaque index type. */
+typedef struct text_index_t text_index_t;
+
+/* Opaque type of search in a file. */
+typedef struct tidx_search_t tidx_search_t;
+
+/* Opens a file and starts indexing its lines in background.  Returns the index
+ * or NULL on error. */
+text_index_t * tidx_open(const char path[]);
+
+/* Stops indexing and frees all resources.  tidx can be NULL. */
+void tidx_free(text_index_t *tidx);
+
+/* Picks up data appended to the file since it was opened or last extended and
+ * resumes indexing.  Returns zero on success and non-zero if the file got
+ * shorter, in which case it should be reopened. */
+int tidx_extend(text_index_t *tidx);
+
+/* Retrieves number of lines found so far.  *complete is set to non-zero when
+ * the whole file has been indexed.  Returns the number. */
+int tidx_count(text_index_t *tidx, int *complete);
+
+/* Blocks until at least specified number of lines is found or until indexing
+ * is finished.  Returns number of found lines. */
+int tidx_wait(text_index_t *tidx, int nlines);
+
+/* Same as tidx_wait(), but gives up after specified number of milliseconds.
+ * Returns number of found lines. */
+int tidx_wait_for(text_index_t *tidx, int nlines, int msec);
+
+/* Retrieves a line by its zero-based number without end-of-line sequence.
+ * Sequential retrieval is the fastest one.  Returns newly allocated string or
+ * NULL if the line isn't indexed yet or on error. */
+char * tidx_get(text_index_t *tidx, int n);
+
+/* Starts looking for lines of the file that match the pattern in background.
+ * Patterns without special characters are looked up as plain strings.  Returns
+ * the search or NULL on error. */
+tidx_search_t * tidx_search_start(text_index_t *tidx, const char pattern[],
+		int cflags);
+
+/* Continues the search over lines appended to the file since the search has
+ * started.  The index must have been extended already.  Returns zero on
+ * success and non-zero if the search can't go on and must be restarted. */
+int tidx_search_extend(tidx_search_t *search, const text_index_t *tidx);
+
+/* Stops the search and frees all resources.  search can be NULL. */
+void tidx_search_free(tidx_search_t *search);
+
+/* Looks up the closest matching line after or before (if backward is
+ * non-zero) the specified one among lines scanned so far.  Returns number of
+ * the line, -1 if there is no such line or -2 if the search hasn't yet got far
+ * enough to know. */
+int tidx_search_find(tidx_search_t *search, int line, int backward);
+
+/* Blocks until the search makes progress, finishes or until timeout expires.
+ * Returns non-zero if the search is over. */
+int tidx_search_wait(tidx_search_t *search, int msec);
+
+#endif /* VIFM__TEXT_INDEX_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
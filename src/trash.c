@@ -310,8 +310,11 @@ empty_trash_dir(const char trash_dir[], int can_delete)
 	/* Yes, this isn't pretty.  It's a simple way to bundle string and bool. */
 	char *trash_dir_copy = format_str("%c%s", can_delete ? '1' : '0', trash_dir);
 
-	if(bg_execute(task_desc, op_desc, BG_UNDEFINED_TOTAL, 1, &empty_trash_in_bg,
-			trash_dir_copy) != 0)
+	struct stat st;
+	const int has_dev = (os_stat(trash_dir, &st) == 0);
+
+	if(bg_execute_on(task_desc, op_desc, BG_UNDEFINED_TOTAL, &st.st_dev, has_dev,
+			&empty_trash_in_bg, trash_dir_copy) != 0)
 	{
 		free(trash_dir_copy);
 	}
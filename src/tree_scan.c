@@ -0,0 +1,449 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "tree_scan.h"
+
+#include <sys/stat.h> /* S_ISDIR() S_ISLNK() fstatat() stat */
+#include <dirent.h> /* DIR dirfd() */
+#ifndef _WIN32
+#include <fcntl.h> /* AT_SYMLINK_NOFOLLOW */
+#endif
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strdup() */
+
+#include "compat/os.h"
+#include "compat/pthread.h"
+#include "utils/dynarray.h"
+#include "utils/fs.h"
+#include "utils/path.h"
+#include "utils/str.h"
+
+/* Number of threads that list directories.  Listing is bound by I/O rather than
+ * by CPU, so this doesn't depend on number of CPUs. */
+#define NWORKERS 4
+
+/* State of a listing. */
+typedef enum
+{
+	JS_QUEUED,  /* Waits in the queue. */
+	JS_RUNNING, /* Is being listed. */
+	JS_DONE,    /* Result is available. */
+}
+JobState;
+
+struct tree_scan_job_t
+{
+	char *path;            /* Path to the directory. */
+	JobState state;        /* State of the job. */
+	int dropped;           /* Whether result is not needed anymore. */
+	tree_scan_list_t list; /* Result of listing. */
+	tree_scan_job_t *prev; /* Previous job in the queue. */
+	tree_scan_job_t *next; /* Next job in the queue. */
+};
+
+struct tree_scan_t
+{
+	pthread_mutex_t lock;      /* Protects all fields below and jobs. */
+	pthread_cond_t work_cond;  /* Signals new jobs and stopping. */
+	pthread_cond_t done_cond;  /* Signals completion of a job. */
+	tree_scan_job_t *top;      /* Most recently queued job. */
+	int stop;                  /* Whether workers should quit. */
+	pthread_t tids[NWORKERS];  /* Threads of the workers. */
+	int nworkers;              /* Number of started workers. */
+};
+
+static void * worker_thread(void *arg);
+static void unlink_job(tree_scan_t *ts, tree_scan_job_t *job);
+static void free_job(tree_scan_job_t *job);
+static tree_scan_entry_t * add_entry(tree_scan_list_t *list,
+		const char name[]);
+
+tree_scan_t *
+tree_scan_alloc(void)
+{
+	tree_scan_t *const ts = calloc(1, sizeof(*ts));
+	if(ts == NULL)
+	{
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&ts->lock, NULL) != 0)
+	{
+		free(ts);
+		return NULL;
+	}
+	if(pthread_cond_init(&ts->work_cond, NULL) != 0)
+	{
+		(void)pthread_mutex_destroy(&ts->lock);
+		free(ts);
+		return NULL;
+	}
+	if(pthread_cond_init(&ts->done_cond, NULL) != 0)
+	{
+		(void)pthread_cond_destroy(&ts->work_cond);
+		(void)pthread_mutex_destroy(&ts->lock);
+		free(ts);
+		return NULL;
+	}
+
+	for(ts->nworkers = 0; ts->nworkers < NWORKERS; ++ts->nworkers)
+	{
+		if(pthread_create(&ts->tids[ts->nworkers], NULL, &worker_thread, ts) != 0)
+		{
+			break;
+		}
+	}
+
+	if(ts->nworkers == 0)
+	{
+		tree_scan_free(ts);
+		return NULL;
+	}
+
+	return ts;
+}
+
+void
+tree_scan_free(tree_scan_t *ts)
+{
+	if(ts == NULL)
+	{
+		return;
+	}
+
+	(void)pthread_mutex_lock(&ts->lock);
+	ts->stop = 1;
+	(void)pthread_cond_broadcast(&ts->work_cond);
+	(void)pthread_mutex_unlock(&ts->lock);
+
+	int i;
+	for(i = 0; i < ts->nworkers; ++i)
+	{
+		(void)pthread_join(ts->tids[i], NULL);
+	}
+
+	while(ts->top != NULL)
+	{
+		tree_scan_job_t *const job = ts->top;
+		unlink_job(ts, job);
+		free_job(job);
+	}
+
+	(void)pthread_cond_destroy(&ts->done_cond);
+	(void)pthread_cond_destroy(&ts->work_cond);
+	(void)pthread_mutex_destroy(&ts->lock);
+	free(ts);
+}
+
+/* Entry point of a worker.  Lists directories from the queue until stopped.
+ * Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	tree_scan_t *const ts = arg;
+
+	(void)pthread_mutex_lock(&ts->lock);
+	while(1)
+	{
+		while(!ts->stop && ts->top == NULL)
+		{
+			(void)pthread_cond_wait(&ts->work_cond, &ts->lock);
+		}
+		if(ts->stop)
+		{
+			break;
+		}
+
+		tree_scan_job_t *const job = ts->top;
+		unlink_job(ts, job);
+		job->state = JS_RUNNING;
+		(void)pthread_mutex_unlock(&ts->lock);
+
+		tree_scan_list(job->path, &job->list);
+
+		(void)pthread_mutex_lock(&ts->lock);
+		job->state = JS_DONE;
+		if(job->dropped)
+		{
+			free_job(job);
+		}
+		else
+		{
+			(void)pthread_cond_broadcast(&ts->done_cond);
+		}
+	}
+	(void)pthread_mutex_unlock(&ts->lock);
+
+	return NULL;
+}
+
+tree_scan_job_t *
+tree_scan_queue(tree_scan_t *ts, const char path[])
+{
+	if(ts == NULL)
+	{
+		return NULL;
+	}
+
+	tree_scan_job_t *const job = calloc(1, sizeof(*job));
+	if(job == NULL)
+	{
+		return NULL;
+	}
+
+	job->path = strdup(path);
+	if(job->path == NULL)
+	{
+		free(job);
+		return NULL;
+	}
+
+	job->state = JS_QUEUED;
+
+	(void)pthread_mutex_lock(&ts->lock);
+	job->next = ts->top;
+	if(ts->top != NULL)
+	{
+		ts->top->prev = job;
+	}
+	ts->top = job;
+	(void)pthread_cond_signal(&ts->work_cond);
+	(void)pthread_mutex_unlock(&ts->lock);
+
+	return job;
+}
+
+void
+tree_scan_wait(tree_scan_t *ts, tree_scan_job_t *job, tree_scan_list_t *list)
+{
+	(void)pthread_mutex_lock(&ts->lock);
+	if(job->state == JS_QUEUED)
+	{
+		/* Doing the work is faster than waiting for it to be done. */
+		unlink_job(ts, job);
+		(void)pthread_mutex_unlock(&ts->lock);
+
+		tree_scan_list(job->path, list);
+		free_job(job);
+		return;
+	}
+
+	while(job->state != JS_DONE)
+	{
+		(void)pthread_cond_wait(&ts->done_cond, &ts->lock);
+	}
+	(void)pthread_mutex_unlock(&ts->lock);
+
+	*list = job->list;
+	job->list.entries = NULL;
+	job->list.count = 0;
+	free_job(job);
+}
+
+void
+tree_scan_drop(tree_scan_t *ts, tree_scan_job_t *job)
+{
+	if(job == NULL)
+	{
+		return;
+	}
+
+	(void)pthread_mutex_lock(&ts->lock);
+	if(job->state == JS_RUNNING)
+	{
+		/* The worker will free the job. */
+		job->dropped = 1;
+		job = NULL;
+	}
+	else if(job->state == JS_QUEUED)
+	{
+		unlink_job(ts, job);
+	}
+	(void)pthread_mutex_unlock(&ts->lock);
+
+	if(job != NULL)
+	{
+		free_job(job);
+	}
+}
+
+/* Removes the job from the queue.  Must be called with the lock held. */
+static void
+unlink_job(tree_scan_t *ts, tree_scan_job_t *job)
+{
+	if(job->prev == NULL)
+	{
+		ts->top = job->next;
+	}
+	else
+	{
+		job->prev->next = job->next;
+	}
+
+	if(job->next != NULL)
+	{
+		job->next->prev = job->prev;
+	}
+
+	job->prev = NULL;
+	job->next = NULL;
+}
+
+/* Frees the job along with its result. */
+static void
+free_job(tree_scan_job_t *job)
+{
+	tree_scan_free_list(&job->list);
+	free(job->path);
+	free(job);
+}
+
+#ifndef _WIN32
+
+void
+tree_scan_list(const char path[], tree_scan_list_t *list)
+{
+	list->entries = NULL;
+	list->count = 0;
+
+	DIR *const dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		list->count = -1;
+		return;
+	}
+
+	const int dfd = dirfd(dir);
+
+	struct dirent *d;
+	while((d = os_readdir(dir)) != NULL)
+	{
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		tree_scan_entry_t *const entry = add_entry(list, d->d_name);
+		if(entry == NULL)
+		{
+			continue;
+		}
+
+		/* A single lstat() provides everything that's needed for non-links. */
+		entry->has_stat =
+			(fstatat(dfd, d->d_name, &entry->st, AT_SYMLINK_NOFOLLOW) == 0);
+		if(entry->has_stat)
+		{
+			entry->is_link = S_ISLNK(entry->st.st_mode);
+			entry->is_dir = S_ISDIR(entry->st.st_mode);
+		}
+		else
+		{
+			entry->is_link = (d->d_type == DT_LNK);
+			entry->is_dir = (d->d_type == DT_DIR);
+		}
+
+		if(entry->is_link)
+		{
+			struct stat target;
+			entry->is_dir = (fstatat(dfd, d->d_name, &target, 0) == 0)
+			             && S_ISDIR(target.st_mode);
+		}
+	}
+
+	os_closedir(dir);
+}
+
+#else
+
+void
+tree_scan_list(const char path[], tree_scan_list_t *list)
+{
+	list->entries = NULL;
+	list->count = 0;
+
+	int len;
+	char **const names = list_all_files(path, &len);
+	if(len < 0)
+	{
+		list->count = -1;
+		return;
+	}
+
+	int i;
+	for(i = 0; i < len; ++i)
+	{
+		tree_scan_entry_t *const entry = add_entry(list, names[i]);
+		if(entry == NULL)
+		{
+			continue;
+		}
+
+		char *const full_path = format_str("%s/%s", path, names[i]);
+		entry->is_dir = is_dir(full_path);
+		entry->is_link = is_symlink(full_path);
+		free(full_path);
+	}
+
+	free_string_array(names, len);
+}
+
+#endif
+
+/* Appends an entry to the list.  Returns pointer to zero-initialized entry with
+ * the name set or NULL on error. */
+static tree_scan_entry_t *
+add_entry(tree_scan_list_t *list, const char name[])
+{
+	tree_scan_entry_t *const entries = dynarray_extend(list->entries,
+			sizeof(*list->entries));
+	if(entries == NULL)
+	{
+		return NULL;
+	}
+	list->entries = entries;
+
+	tree_scan_entry_t *const entry = &entries[list->count];
+	*entry = (tree_scan_entry_t){ .name = strdup(name) };
+	if(entry->name == NULL)
+	{
+		return NULL;
+	}
+
+	++list->count;
+	return entry;
+}
+
+void
+tree_scan_free_list(tree_scan_list_t *list)
+{
+	int i;
+	for(i = 0; i < list->count; ++i)
+	{
+		free(list->entries[i].name);
+	}
+	dynarray_free(list->entries);
+
+	list->entries = NULL;
+	list->count = 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,81 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__TREE_SCAN_H__
+#define VIFM__TREE_SCAN_H__
+
+#include <sys/stat.h> /* stat */
+
+/* tree_scan - listing of directories for tree view, which can be done ahead of
+ * time by a pool of threads */
+
+/* Opaque scanner type. */
+typedef struct tree_scan_t tree_scan_t;
+
+/* Opaque handle of listing of a single directory. */
+typedef struct tree_scan_job_t tree_scan_job_t;
+
+/* Single entry of a directory. */
+typedef struct
+{
+	char *name;     /* Name of the entry. */
+	int is_dir;     /* Whether it's a directory or a symbolic link to one. */
+	int is_link;    /* Whether it's a symbolic link. */
+	int has_stat;   /* Whether st field is filled (never on Windows). */
+	struct stat st; /* lstat() information about the entry. */
+}
+tree_scan_entry_t;
+
+/* Entries of a directory in the order in which they were read. */
+typedef struct
+{
+	tree_scan_entry_t *entries; /* List of entries. */
+	int count;                  /* Number of entries or -1 on error. */
+}
+tree_scan_list_t;
+
+/* Starts threads that list directories.  Returns the scanner or NULL on
+ * error. */
+tree_scan_t * tree_scan_alloc(void);
+
+/* Stops the threads and frees all resources.  All handles must be waited for or
+ * dropped before calling this.  ts can be NULL. */
+void tree_scan_free(tree_scan_t *ts);
+
+/* Schedules listing of a directory.  Directories scheduled last are listed
+ * first.  Returns handle of the listing or NULL on error or if ts is NULL. */
+tree_scan_job_t * tree_scan_queue(tree_scan_t *ts, const char path[]);
+
+/* Retrieves result of listing by its handle, which gets freed.  Lists the
+ * directory in the calling thread if no thread has picked it up yet. */
+void tree_scan_wait(tree_scan_t *ts, tree_scan_job_t *job,
+		tree_scan_list_t *list);
+
+/* Discards listing that is no longer needed.  job can be NULL. */
+void tree_scan_drop(tree_scan_t *ts, tree_scan_job_t *job);
+
+/* Lists directory in the calling thread. */
+void tree_scan_list(const char path[], tree_scan_list_t *list);
+
+/* Frees entries of a listing. */
+void tree_scan_free_list(tree_scan_list_t *list);
+
+#endif /* VIFM__TREE_SCAN_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
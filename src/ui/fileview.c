@@ -1586,7 +1586,7 @@ format_size(void *data, size_t buf_len, char buf[], const format_info_t *info)
 
 	if(size == DCACHE_UNKNOWN)
 	{
-		size = cdt->entry->size;
+		size = (cfg.disk_usage ? cdt->entry->alloc_size : cdt->entry->size);
 	}
 
 	str[0] = '\0';
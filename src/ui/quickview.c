@@ -101,6 +101,8 @@ static void update_cache(quickview_cache_t *cache, const char path[],
 		const char viewer[], ViewerKind kind, const preview_area_t *parea,
 		int max_lines);
 static strlist_t get_lines(const quickview_cache_t *cache);
+static void prefetch_neighbours(view_t *view, const preview_area_t *parea);
+static void prefetch_entry(view_t *view, int pos, const preview_area_t *parea);
 static void print_tree_stats(tree_print_state_t *s);
 static int print_dir_tree(tree_print_state_t *s, const char path[], int last);
 static void collect_subtree_stats(tree_print_state_t *s, const char path[]);
@@ -119,6 +121,8 @@ static void draw_lines(const strlist_t *lines, int wrapped,
 		const preview_area_t *parea, ViewerKind kind);
 static void write_message(const char msg[], const preview_area_t *parea);
 static void cleanup_for_text(const preview_area_t *parea);
+static char * expand_viewer(view_t *view, const dir_entry_t *entry,
+		const preview_area_t *parea, const char viewer[], MacroFlags *flags);
 static void wipe_area(const preview_area_t *parea);
 static void fill_area(const preview_area_t *parea);
 
@@ -220,6 +224,7 @@ qv_draw(view_t *view)
 			.h = ui_qv_height(other_view),
 		};
 		(void)view_entry(curr, &parea, &qv_cache);
+		prefetch_neighbours(view, &parea);
 	}
 
 	refresh_view_win(other_view);
@@ -451,6 +456,71 @@ get_lines(const quickview_cache_t *cache)
 	return lines;
 }
 
+/* Starts viewers of entries that follow the current one in direction of cursor
+ * movement to have their previews ready when cursor gets there. */
+static void
+prefetch_neighbours(view_t *view, const preview_area_t *parea)
+{
+	static const view_t *last_view;
+	static int last_pos;
+	static int direction = 1;
+
+	if(view == last_view && view->list_pos != last_pos)
+	{
+		direction = (view->list_pos > last_pos ? 1 : -1);
+	}
+	last_view = view;
+	last_pos = view->list_pos;
+
+	vcache_prefetch_begin();
+
+	/* Viewers that use selection produce the same output for all entries. */
+	if(view->selected_files == 0)
+	{
+		int i;
+		for(i = 1; i <= cfg.preview_prefetch; ++i)
+		{
+			const int pos = view->list_pos + direction*i;
+			if(pos < 0 || pos >= view->list_rows)
+			{
+				break;
+			}
+			prefetch_entry(view, pos, parea);
+		}
+	}
+
+	vcache_prefetch_end();
+}
+
+/* Starts viewer of a regular file at specified position of the view in the
+ * same way as it would be started when cursor is on it. */
+static void
+prefetch_entry(view_t *view, int pos, const preview_area_t *parea)
+{
+	const dir_entry_t *const entry = &view->dir_entry[pos];
+	if(entry->type != FT_REG || fentry_is_fake(entry))
+	{
+		return;
+	}
+
+	char path[PATH_MAX + 1];
+	qv_get_path_to_explore(entry, path, sizeof(path));
+
+	const char *const viewer = qv_get_viewer(path);
+	if(viewer == NULL || ft_viewer_kind(viewer) != VK_TEXTUAL)
+	{
+		return;
+	}
+
+	MacroFlags flags;
+	char *const expanded = expand_viewer(view, entry, parea, viewer, &flags);
+	if(expanded != NULL)
+	{
+		vcache_prefetch(path, expanded, flags, MAX_PREVIEW_LINES);
+		free(expanded);
+	}
+}
+
 FILE *
 qv_view_dir(const char path[], int max_lines)
 {
@@ -857,21 +927,38 @@ qv_hide(void)
 
 char *
 qv_expand_viewer(view_t *view, const char viewer[], MacroFlags *flags)
+{
+	return expand_viewer(view, NULL, NULL, viewer, flags);
+}
+
+/* Expands viewer for the entry of the view and the preview area as if the
+ * entry was under cursor.  NULL entry means current entry and state of the
+ * views, in which case parea is ignored.  Returns newly allocated string or
+ * NULL on error. */
+static char *
+expand_viewer(view_t *view, const dir_entry_t *entry,
+		const preview_area_t *parea, const char viewer[], MacroFlags *flags)
 {
 	ma_flags_set(flags, MF_NONE);
 
 	char *result;
 	if(strchr(viewer, '%') == NULL)
 	{
-		char *escaped =
-			shell_arg_escape(get_current_file_name(view), curr_stats.shell_type);
+		const char *const name = (entry == NULL)
+		                       ? get_current_file_name(view)
+		                       : entry->name;
+		char *escaped = shell_arg_escape(name, curr_stats.shell_type);
 		result = format_str("%s %s", viewer, escaped);
 		free(escaped);
 	}
-	else
+	else if(entry == NULL)
 	{
 		result = ma_expand(viewer, NULL, flags, MER_SHELL);
 	}
+	else
+	{
+		result = ma_expand_for_entry(viewer, view, entry, parea, flags);
+	}
 	return result;
 }
 
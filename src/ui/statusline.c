@@ -26,11 +26,10 @@
 #include <stddef.h> /* NULL size_t */
 #include <stdlib.h> /* free() */
 #include <string.h> /* strcat() strdup() strlen() */
-#include <time.h> /* time() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() time() */
 #include <unistd.h>
 
 #include "../cfg/config.h"
-#include "../compat/pthread.h"
 #include "../compat/reallocarray.h"
 #include "../engine/mode.h"
 #include "../engine/parsing.h"
@@ -64,8 +63,8 @@ static void check_expanded_str(const char buf[], int skip, int *nexpansions);
 static char * fetch_status_line(view_t *view, int width);
 TSTATIC char * find_view_macro(const char **format, const char macros[],
 		char macro, int opt);
-static pthread_spinlock_t * get_job_bar_changed_lock(void);
-static void init_job_bar_changed_lock(void);
+static int job_bar_progress_changed(void);
+static unsigned int get_progress_signature(void);
 static int is_job_bar_visible(void);
 static const char * format_job_bar(void);
 static char ** take_job_descr_snapshot(void);
@@ -77,10 +76,10 @@ static const char STATUS_LINE_MACROS[] = "tTfacAugsEdD-xlLoPSz%[]{*";
 static size_t nbar_jobs;
 /* Array of jobs. */
 static bg_op_t **bar_jobs;
-/* Whether list of jobs needs to be redrawn. */
+/* Whether list of jobs needs to be redrawn.  Accessed atomically. */
 static int job_bar_changed;
-/* Protects accesses to job_bar_changed variable. */
-static pthread_spinlock_t job_bar_changed_lock;
+/* Signature of progress values of jobs as they were drawn last time. */
+static unsigned int drawn_progress_signature;
 
 void
 ui_stat_update(view_t *view, int lazy_redraw)
@@ -895,11 +894,7 @@ ui_stat_job_bar_remove(bg_op_t *bg_op)
 void
 ui_stat_job_bar_changed(bg_op_t *bg_op)
 {
-	pthread_spinlock_t *const lock = get_job_bar_changed_lock();
-
-	pthread_spin_lock(lock);
-	job_bar_changed = 1;
-	pthread_spin_unlock(lock);
+	__atomic_store_n(&job_bar_changed, 1, __ATOMIC_RELEASE);
 }
 
 void
@@ -907,15 +902,10 @@ ui_stat_job_bar_check_for_updates(void)
 {
 	static int prev_width;
 
-	pthread_spinlock_t *const lock = get_job_bar_changed_lock();
-	int job_bar_changed_value;
-
-	pthread_spin_lock(lock);
-	job_bar_changed_value = job_bar_changed;
-	job_bar_changed = 0;
-	pthread_spin_unlock(lock);
+	const int changed = __atomic_exchange_n(&job_bar_changed, 0,
+			__ATOMIC_ACQ_REL);
 
-	if(job_bar_changed_value || getmaxx(job_bar) != prev_width)
+	if(changed || getmaxx(job_bar) != prev_width || job_bar_progress_changed())
 	{
 		ui_stat_job_bar_redraw();
 	}
@@ -923,23 +913,44 @@ ui_stat_job_bar_check_for_updates(void)
 	prev_width = getmaxx(job_bar);
 }
 
-/* Gets spinlock for the job_bar_changed variable in thread-safe way.  Returns
- * the lock. */
-static pthread_spinlock_t *
-get_job_bar_changed_lock(void)
+/* Samples progress of jobs on the job bar at most once per frame.  Returns
+ * non-zero if it differs from what's displayed, otherwise zero is returned. */
+static int
+job_bar_progress_changed(void)
 {
-	static pthread_once_t once = PTHREAD_ONCE_INIT;
-	pthread_once(&once, &init_job_bar_changed_lock);
-	return &job_bar_changed_lock;
+	/* Period of sampling in milliseconds, which is about 10 frames a second. */
+	enum { FRAME_MS = 100 };
+
+	static long long last_sample_ms;
+
+	struct timespec now;
+	if(nbar_jobs == 0U || clock_gettime(CLOCK_MONOTONIC, &now) != 0)
+	{
+		return 0;
+	}
+
+	const long long now_ms = now.tv_sec*1000LL + now.tv_nsec/1000000;
+	if(now_ms - last_sample_ms < FRAME_MS)
+	{
+		return 0;
+	}
+	last_sample_ms = now_ms;
+
+	return (get_progress_signature() != drawn_progress_signature);
 }
 
-/* Performs spinlock initialization at most once. */
-static void
-init_job_bar_changed_lock(void)
+/* Combines progress values of jobs on the job bar into a single value.  Returns
+ * the signature. */
+static unsigned int
+get_progress_signature(void)
 {
-	int ret = pthread_spin_init(&job_bar_changed_lock, PTHREAD_PROCESS_PRIVATE);
-	assert(ret == 0 && "Failed to initialize spinlock!");
-	(void)ret;
+	unsigned int signature = 0U;
+	size_t i;
+	for(i = 0U; i < nbar_jobs; ++i)
+	{
+		signature = signature*131U + (unsigned int)bg_op_get_progress(bar_jobs[i]);
+	}
+	return signature;
 }
 
 /* Checks whether job bar is visible.  Returns non-zero if so, and zero
@@ -998,9 +1009,12 @@ format_job_bar(void)
 	/* The check of stage is for tests. */
 	max_width = (curr_stats.load_stage < 2) ? 80 : getmaxx(job_bar);
 	width_used = 0U;
+	drawn_progress_signature = 0U;
 	for(i = 0U; i < nbar_jobs; ++i)
 	{
-		const int progress = bar_jobs[i]->progress;
+		const int progress = bg_op_get_progress(bar_jobs[i]);
+		drawn_progress_signature = drawn_progress_signature*131U
+		                         + (unsigned int)progress;
 		const unsigned int reserved = (progress == -1) ? 0U : 5U;
 		char item_text[max_width*MAX_UTF_CHAR_LEN + 1U];
 
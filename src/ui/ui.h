@@ -221,6 +221,7 @@ struct dir_entry_t
 	                     view_t::curr_dir for non-cv views or is allocated on
 	                     a heap depending on owns_origin field. */
 	uint64_t size;    /* File size in bytes. */
+	uint64_t alloc_size; /* Size allocated on disk in bytes. */
 	time_t mtime;     /* Modification time. */
 	time_t atime;     /* Access time. */
 	time_t ctime;     /* Change time. */
@@ -253,6 +254,8 @@ struct dir_entry_t
 	int child_count; /* Number of child entries (all, not just direct). */
 	int child_pos;   /* Position of this entry in among children of its parent.
 	                    Zero for top-level entries. */
+	int child_filtered; /* Number of filtered out entries among children of
+	                       unfolded directory of file-system tree view. */
 
 	int search_match;      /* Non-zero if the item matches last search.  Equals to
 	                          search match number (top to bottom order). */
@@ -326,6 +329,9 @@ struct cv_data_t
 
 	/* List of paths to directories that are folded.  Used by tree-view. */
 	struct trie_t *folded_paths;
+	/* Whether folds of tree-view that weren't loaded yet are loaded on search or
+	 * filtering. */
+	int lazy;
 
 	/* Names of files in custom view while it's being composed.  Used for
 	 * duplicate elimination during construction of custom list. */
@@ -399,6 +405,12 @@ struct view_t
 
 	fswatch_t *watch;  /* Monitor that checks for directory changes. */
 	char *watched_dir; /* Path for which the monitor was created. */
+	/* Whether set of unfolded directories of a tree view has changed since they
+	 * were last passed to the monitor. */
+	int tree_watch_outdated;
+	/* Whether unfolded directories of a tree view are tracked by the monitor, if
+	 * not they are polled. */
+	int tree_watched;
 
 	char *last_dir; /* Location visited by the view before the current one. */
 
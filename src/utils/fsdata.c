@@ -18,13 +18,16 @@
 
 /* The implementation is a tree (with links to leftmost child and right
  * sibling), which is traversed according to slash separated path.  Siblings are
- * sorted by name. */
+ * sorted by name.  Nodes with many children additionally keep a hash table of
+ * them, new children of such nodes are put at the front of the list and the
+ * list is sorted on traversal. */
 
 #include "fsdata.h"
 #include "private/fsdata.h"
 
+#include <ctype.h> /* tolower() */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* free() malloc() */
+#include <stdlib.h> /* calloc() free() malloc() */
 #include <string.h> /* memcpy() */
 
 #include "../compat/fs_limits.h"
@@ -35,15 +38,23 @@
  * from creating a node. */
 #define NO_CREATE (size_t)-1
 
+/* Number of children at which a node gets hash table of children. */
+#define INDEX_THRESHOLD 32U
+
 /* Tree node type. */
 typedef struct node_t
 {
-	char *name;           /* Name of this node. */
-	size_t name_len;      /* Length of the name. */
-	int valid;            /* Whether data in this node is meaningful. */
-	struct node_t *next;  /* Next sibling on this level. */
-	struct node_t *child; /* Leftmost child of this node. */
-	char data[];          /* Data associated with the node follows. */
+	char *name;            /* Name of this node. */
+	size_t name_len;       /* Length of the name. */
+	int valid;             /* Whether data in this node is meaningful. */
+	struct node_t *next;   /* Next sibling on this level. */
+	struct node_t *child;  /* Leftmost child of this node. */
+	size_t nchildren;      /* Number of children. */
+	struct node_t **index; /* Hash table of children or NULL. */
+	size_t index_size;     /* Capacity of the hash table (power of two). */
+	int unsorted;          /* Whether list of children needs sorting. */
+	size_t data_size;      /* Size of data allocated for the node. */
+	char data[];           /* Data associated with the node follows. */
 }
 node_t;
 
@@ -59,7 +70,17 @@ struct fsdata_t
 static void do_nothing(void *data);
 static void nodes_free(node_t *node, fsd_cleanup_func cleanup);
 static node_t * get_or_create_node(node_t *root, const char path[],
-		size_t data_size, node_t **last, node_t **link);
+		size_t data_size, node_t **last);
+static node_t * grow_node(fsdata_t *fsd, const char path[], size_t data_size);
+static node_t * find_child(node_t *node, const char name[], size_t name_len,
+		node_t **prev);
+static int add_child(node_t *node, node_t *child, node_t *prev);
+static int index_children(node_t *node, size_t size);
+static node_t ** index_slot(node_t *node, const char name[], size_t name_len);
+static size_t hash_name(const char name[], size_t name_len);
+static void sort_children(node_t *node);
+static node_t * merge_sort(node_t *head, size_t len);
+static int node_cmp(const node_t *a, const node_t *b);
 static node_t * make_node(const char name[], size_t name_len, size_t data_size);
 static int map_parents(node_t *root, const char path[],
 		fsdata_visit_func visitor, void *arg);
@@ -67,6 +88,8 @@ static int resolve_path(const fsdata_t *fsd, const char path[],
 		char real_path[]);
 static int traverse_node(node_t *node, const node_t *parent,
 		fsdata_traverser_func traverser, void *arg);
+static int traverse_node_paths(node_t *node, char path[], size_t len,
+		fsdata_path_traverser_func traverser, void *arg);
 
 fsdata_t *
 fsdata_create(int prefix, int resolve_paths)
@@ -111,34 +134,44 @@ fsdata_free(fsdata_t *fsd)
 static void
 nodes_free(node_t *node, fsd_cleanup_func cleanup)
 {
-	if(node == NULL)
+	/* Siblings are processed in a loop as there can be lots of them. */
+	while(node != NULL)
 	{
-		return;
-	}
+		node_t *const next = node->next;
 
-	if(node->valid)
-	{
-		cleanup(&node->data);
-	}
+		if(node->valid)
+		{
+			cleanup(&node->data);
+		}
+
+		nodes_free(node->child, cleanup);
 
-	nodes_free(node->child, cleanup);
-	nodes_free(node->next, cleanup);
+		free(node->index);
+		free(node->name);
+		free(node);
 
-	free(node->name);
-	free(node);
+		node = next;
+	}
 }
 
 int
 fsdata_set(fsdata_t *fsd, const char path[], const void *data, size_t len)
 {
-	node_t *node;
 	char real_path[PATH_MAX + 1];
-
 	if(resolve_path(fsd, path, real_path) != 0)
 	{
 		return -1;
 	}
 
+	return fsdata_set_resolved(fsd, real_path, data, len);
+}
+
+int
+fsdata_set_resolved(fsdata_t *fsd, const char real_path[], const void *data,
+		size_t len)
+{
+	node_t *node;
+
 	/* Create root node lazily, when we know data size. */
 	if(fsd->root == NULL)
 	{
@@ -149,7 +182,11 @@ fsdata_set(fsdata_t *fsd, const char path[], const void *data, size_t len)
 		}
 	}
 
-	node = get_or_create_node(fsd->root, real_path, len, NULL, &fsd->root);
+	node = get_or_create_node(fsd->root, real_path, len, NULL);
+	if(node != NULL && node->data_size < len)
+	{
+		node = grow_node(fsd, real_path, len);
+	}
 	if(node == NULL)
 	{
 		return -1;
@@ -184,7 +221,7 @@ fsdata_get(fsdata_t *fsd, const char path[], void *data, size_t len)
 	}
 
 	node = get_or_create_node(fsd->root, real_path, NO_CREATE,
-			fsd->prefix ? &last : NULL, NULL);
+			fsd->prefix ? &last : NULL);
 	if((node == NULL || !node->valid) && last == NULL)
 	{
 		return -1;
@@ -197,54 +234,33 @@ fsdata_get(fsdata_t *fsd, const char path[], void *data, size_t len)
 
 /* Looks up a node by its path.  Inserts a node if it doesn't exist and
  * data_size is not equal to NO_CREATE.  If last is not NULL *last is assigned
- * closest valid parent node.  Optionally reallocates and updates *link.
- * Returns the node at the path or NULL on error. */
+ * closest valid parent node.  Returns the node at the path or NULL on error. */
 static node_t *
 get_or_create_node(node_t *root, const char path[], size_t data_size,
-		node_t **last, node_t **link)
+		node_t **last)
 {
 	const char *end;
 	size_t name_len;
-	node_t *prev = NULL, *curr;
+	node_t *prev, *curr;
 	node_t *new_node;
 
 	path = skip_char(path, '/');
 	if(*path == '\0')
 	{
-		if(link != NULL)
-		{
-			root = realloc(root, sizeof(*root) + data_size);
-			if(root != NULL)
-			{
-				*link = root;
-			}
-		}
 		return root;
 	}
 
 	end = until_first(path, '/');
 
 	name_len = end - path;
-	curr = root->child;
-	while(curr != NULL)
+	curr = find_child(root, path, name_len, &prev);
+	if(curr != NULL)
 	{
-		int comp = strnoscmp(path, curr->name, name_len);
-		if(comp == 0 && curr->name_len == name_len)
-		{
-			if(curr->valid && last != NULL)
-			{
-				*last = curr;
-			}
-			return get_or_create_node(curr, end, data_size, last,
-					(data_size == NO_CREATE) ? NULL :
-					(root->child == curr) ? &root->child : &prev->next);
-		}
-		else if(comp < 0)
+		if(curr->valid && last != NULL)
 		{
-			break;
+			*last = curr;
 		}
-		prev = curr;
-		curr = curr->next;
+		return get_or_create_node(curr, end, data_size, last);
 	}
 
 	if(data_size == NO_CREATE)
@@ -258,19 +274,252 @@ get_or_create_node(node_t *root, const char path[], size_t data_size,
 		return NULL;
 	}
 
-	new_node->next = curr;
+	if(add_child(root, new_node, prev) != 0)
+	{
+		free(new_node->name);
+		free(new_node);
+		return NULL;
+	}
 
-	if(root->child == curr)
+	return get_or_create_node(new_node, end, data_size, last);
+}
+
+/* Reallocates existing node at the path to fit data of specified size and
+ * updates all links to it.  Returns the node or NULL on error. */
+static node_t *
+grow_node(fsdata_t *fsd, const char path[], size_t data_size)
+{
+	node_t *parent = NULL;
+	node_t **link = &fsd->root;
+
+	path = skip_char(path, '/');
+	while(*path != '\0')
 	{
-		root->child = new_node;
+		const char *const end = until_first(path, '/');
+
+		node_t *prev;
+		parent = *link;
+		node_t *const child = find_child(parent, path, end - path, &prev);
+
+		link = &parent->child;
+		while(*link != child)
+		{
+			link = &(*link)->next;
+		}
+
+		path = skip_char(end, '/');
+	}
+
+	/* Looking up the slot requires comparing names of nodes, so do it while the
+	 * node is still alive. */
+	node_t **const slot = (parent != NULL && parent->index != NULL)
+	                    ? index_slot(parent, (*link)->name, (*link)->name_len)
+	                    : NULL;
+
+	node_t *const node = realloc(*link, sizeof(*node) + data_size);
+	if(node == NULL)
+	{
+		return NULL;
+	}
+
+	node->data_size = data_size;
+	*link = node;
+	if(slot != NULL)
+	{
+		*slot = node;
+	}
+	return node;
+}
+
+/* Looks up child of a node by its name.  For nodes without hash table, *prev is
+ * set to the child after which the one being looked up is or should be located
+ * (NULL means the head of the list).  Returns the child or NULL. */
+static node_t *
+find_child(node_t *node, const char name[], size_t name_len, node_t **prev)
+{
+	*prev = NULL;
+
+	if(node->index != NULL)
+	{
+		return *index_slot(node, name, name_len);
+	}
+
+	node_t *curr;
+	for(curr = node->child; curr != NULL; curr = curr->next)
+	{
+		int comp = strnoscmp(name, curr->name, name_len);
+		if(comp == 0 && curr->name_len == name_len)
+		{
+			return curr;
+		}
+		else if(comp < 0)
+		{
+			break;
+		}
+		*prev = curr;
+	}
+	return NULL;
+}
+
+/* Inserts new child of a node after prev (NULL means the head of the list),
+ * which is ignored if the node has hash table.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+add_child(node_t *node, node_t *child, node_t *prev)
+{
+	const size_t nchildren = node->nchildren + 1U;
+	if(node->index == NULL && nchildren >= INDEX_THRESHOLD)
+	{
+		/* Failing to allocate hash table just makes things slower. */
+		(void)index_children(node, INDEX_THRESHOLD*2U);
+	}
+	else if(node->index != NULL && nchildren*4U > node->index_size*3U)
+	{
+		if(index_children(node, node->index_size*2U) != 0)
+		{
+			return 1;
+		}
+	}
+
+	if(node->index != NULL)
+	{
+		*index_slot(node, child->name, child->name_len) = child;
+		child->next = node->child;
+		node->child = child;
+		node->unsorted = (child->next != NULL);
+	}
+	else if(prev == NULL)
+	{
+		child->next = node->child;
+		node->child = child;
 	}
 	else
 	{
-		prev->next = new_node;
+		child->next = prev->next;
+		prev->next = child;
 	}
-	/* No need to update anything here, because size is guaranteed to be the
-	 * same. */
-	return get_or_create_node(new_node, end, data_size, last, NULL);
+
+	node->nchildren = nchildren;
+	return 0;
+}
+
+/* (Re)builds hash table of children of the node.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+index_children(node_t *node, size_t size)
+{
+	node_t **const index = calloc(size, sizeof(*index));
+	if(index == NULL)
+	{
+		return 1;
+	}
+
+	free(node->index);
+	node->index = index;
+	node->index_size = size;
+
+	node_t *curr;
+	for(curr = node->child; curr != NULL; curr = curr->next)
+	{
+		*index_slot(node, curr->name, curr->name_len) = curr;
+	}
+	return 0;
+}
+
+/* Looks up slot of hash table that corresponds to the name.  Returns pointer to
+ * the slot which is either empty or holds the child. */
+static node_t **
+index_slot(node_t *node, const char name[], size_t name_len)
+{
+	const size_t mask = node->index_size - 1U;
+	size_t i = hash_name(name, name_len) & mask;
+	while(node->index[i] != NULL)
+	{
+		const node_t *const child = node->index[i];
+		if(child->name_len == name_len &&
+				strnoscmp(name, child->name, name_len) == 0)
+		{
+			break;
+		}
+		i = (i + 1U) & mask;
+	}
+	return &node->index[i];
+}
+
+/* Computes FNV-1a hash of a name consistently with strnoscmp().  Returns the
+ * hash. */
+static size_t
+hash_name(const char name[], size_t name_len)
+{
+	size_t hash = 2166136261U;
+	size_t i;
+	for(i = 0U; i < name_len; ++i)
+	{
+#ifndef _WIN32
+		hash ^= (unsigned char)name[i];
+#else
+		hash ^= tolower((unsigned char)name[i]);
+#endif
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/* Restores sorted order of children of a node if it was broken. */
+static void
+sort_children(node_t *node)
+{
+	if(node->unsorted)
+	{
+		node->child = merge_sort(node->child, node->nchildren);
+		node->unsorted = 0;
+	}
+}
+
+/* Sorts list of len nodes by their names.  Returns new head of the list. */
+static node_t *
+merge_sort(node_t *head, size_t len)
+{
+	if(len < 2U)
+	{
+		if(head != NULL)
+		{
+			head->next = NULL;
+		}
+		return head;
+	}
+
+	node_t *middle = head;
+	size_t i;
+	for(i = 0U; i < len/2U; ++i)
+	{
+		middle = middle->next;
+	}
+
+	node_t *a = merge_sort(head, len/2U);
+	node_t *b = merge_sort(middle, len - len/2U);
+
+	node_t *result = NULL;
+	node_t **tail = &result;
+	while(a != NULL && b != NULL)
+	{
+		node_t **const smaller = (node_cmp(b, a) < 0 ? &b : &a);
+		*tail = *smaller;
+		tail = &(*smaller)->next;
+		*smaller = (*smaller)->next;
+	}
+	*tail = (a != NULL ? a : b);
+	return result;
+}
+
+/* Compares names of two nodes.  Returns negative number, zero or positive
+ * number like strcmp() does. */
+static int
+node_cmp(const node_t *a, const node_t *b)
+{
+	const size_t len = (a->name_len < b->name_len ? a->name_len : b->name_len);
+	/* Comparing terminating null character puts shorter names first. */
+	return strnoscmp(a->name, b->name, len + 1U);
 }
 
 /* Creates new node for the tree.  Returns the node or NULL on memory allocation
@@ -296,6 +545,11 @@ make_node(const char name[], size_t name_len, size_t data_size)
 	new_node->valid = 0;
 	new_node->child = NULL;
 	new_node->next = NULL;
+	new_node->nchildren = 0U;
+	new_node->index = NULL;
+	new_node->index_size = 0U;
+	new_node->unsorted = 0;
+	new_node->data_size = data_size;
 
 	return new_node;
 }
@@ -304,6 +558,11 @@ int
 fsdata_map_parents(fsdata_t *fsd, const char path[], fsdata_visit_func visitor,
 		void *arg)
 {
+	if(fsd->root == NULL)
+	{
+		return 1;
+	}
+
 	char real_path[PATH_MAX + 1];
 	if(resolve_path(fsd, path, real_path) != 0)
 	{
@@ -335,7 +594,7 @@ map_parents(node_t *root, const char path[], fsdata_visit_func visitor,
 {
 	const char *end;
 	size_t name_len;
-	node_t *curr;
+	node_t *prev, *curr;
 
 	path = skip_char(path, '/');
 	if(*path == '\0')
@@ -346,30 +605,17 @@ map_parents(node_t *root, const char path[], fsdata_visit_func visitor,
 	end = until_first(path, '/');
 
 	name_len = end - path;
-	curr = root->child;
-	while(curr != NULL)
+	curr = find_child(root, path, name_len, &prev);
+	if(curr == NULL || map_parents(curr, end, visitor, arg) != 0)
 	{
-		const int cmp = strnoscmp(path, curr->name, name_len);
-		if(cmp == 0 && curr->name_len == name_len)
-		{
-			if(map_parents(curr, end, visitor, arg) == 0)
-			{
-				if(root->valid)
-				{
-					visitor(&root->data, arg);
-				}
-				return 0;
-			}
-			break;
-		}
-		else if(cmp < 0)
-		{
-			break;
-		}
-		curr = curr->next;
+		return 1;
 	}
 
-	return 1;
+	if(root->valid)
+	{
+		visitor(&root->data, arg);
+	}
+	return 0;
 }
 
 int
@@ -382,6 +628,7 @@ fsdata_traverse(fsdata_t *fsd, fsdata_traverser_func traverser, void *arg)
 		return 0;
 	}
 
+	sort_children(fsd->root);
 	for(node = fsd->root->child; node != NULL; node = node->next)
 	{
 		if(traverse_node(node, NULL, traverser, arg) != 0)
@@ -392,6 +639,67 @@ fsdata_traverse(fsdata_t *fsd, fsdata_traverser_func traverser, void *arg)
 	return 0;
 }
 
+int
+fsdata_traverse_paths(fsdata_t *fsd, fsdata_path_traverser_func traverser,
+		void *arg)
+{
+	if(fsd->root == NULL)
+	{
+		return 0;
+	}
+
+	char path[PATH_MAX + 1] = "/";
+	if(fsd->root->valid && traverser(path, fsd->root->data, arg) != 0)
+	{
+		return 1;
+	}
+
+	node_t *node;
+	sort_children(fsd->root);
+	for(node = fsd->root->child; node != NULL; node = node->next)
+	{
+		if(traverse_node_paths(node, path, 1U, traverser, arg) != 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* fsdata_traverse_paths() helper which works with node_t type.  path is a
+ * buffer of PATH_MAX + 1 bytes that holds path to parent of the node of len
+ * bytes (including trailing slash).  Return non-zero if traversing was stopped
+ * prematurely, otherwise zero is returned. */
+static int
+traverse_node_paths(node_t *node, char path[], size_t len,
+		fsdata_path_traverser_func traverser, void *arg)
+{
+	if(len + node->name_len + 1U > PATH_MAX)
+	{
+		return 0;
+	}
+
+	memcpy(path + len, node->name, node->name_len);
+	len += node->name_len;
+	path[len] = '\0';
+
+	if(node->valid && traverser(path, node->data, arg) != 0)
+	{
+		return 1;
+	}
+
+	path[len++] = '/';
+	sort_children(node);
+	for(node = node->child; node != NULL; node = node->next)
+	{
+		if(traverse_node_paths(node, path, len, traverser, arg) != 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /* fsdata_traverse() helper which works with node_t type.  Return non-zero if
  * traversing was stopped prematurely, otherwise zero is returned. */
 static int
@@ -404,6 +712,7 @@ traverse_node(node_t *node, const node_t *parent,
 		return 1;
 	}
 
+	sort_children(node);
 	for(parent = node, node = node->child; node != NULL; node = node->next)
 	{
 		if(traverse_node(node, parent, traverser, arg) != 0)
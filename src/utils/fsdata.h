@@ -34,6 +34,11 @@ typedef struct fsdata_t fsdata_t;
 typedef int (*fsdata_traverser_func)(const char name[], int valid,
 		const void *parent_data, void *data, void *arg);
 
+/* Type of callback for fsdata_traverse_paths().  Receives full path of a node
+ * with valid data.  Should return non-zero to stop traverser. */
+typedef int (*fsdata_path_traverser_func)(const char path[], const void *data,
+		void *arg);
+
 /* Type of callback for fsdata_map_parents(). */
 typedef void (*fsdata_visit_func)(void *data, void *arg);
 
@@ -49,6 +54,12 @@ void fsdata_free(fsdata_t *fsd);
  * success, otherwise non-zero is returned. */
 int fsdata_set(fsdata_t *fsd, const char path[], const void *data, size_t len);
 
+/* Same as fsdata_set(), but never resolves the path, which is assumed to be
+ * resolved already (e.g., it was reported by fsdata_traverse_paths()).  Returns
+ * zero on success, otherwise non-zero is returned. */
+int fsdata_set_resolved(fsdata_t *fsd, const char path[], const void *data,
+		size_t len);
+
 /* Retrieves data associated with the path (or closest predecessor on prefix
  * matches).  Doesn't change data content if path absent.  Returns zero on
  * success and non-zero on error. */
@@ -63,6 +74,12 @@ int fsdata_map_parents(fsdata_t *fsd, const char path[],
  * prematurely, otherwise zero is returned. */
 int fsdata_traverse(fsdata_t *fsd, fsdata_traverser_func traverser, void *arg);
 
+/* Calls the callback for each valid node in depth-first order, so paths that
+ * share prefixes come one after another.  Return non-zero if traversing was
+ * stopped prematurely, otherwise zero is returned. */
+int fsdata_traverse_paths(fsdata_t *fsd, fsdata_path_traverser_func traverser,
+		void *arg);
+
 #endif /* VIFM__UTILS__FSDATA_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -21,6 +21,8 @@
 
 /* Implementation of file system changes checks via polling. */
 
+struct strlist_t;
+
 /* Kinds of state reports. */
 typedef enum
 {
@@ -45,6 +47,19 @@ void fswatch_free(fswatch_t *w);
  * query.  Returns latest state. */
 FSWatchState fswatch_poll(fswatch_t *w);
 
+/* Makes the watcher also track changes of lists of files of a set of additional
+ * directories replacing the previous set.  Watches of directories that stay in
+ * the set are reused.  Returns zero on success and non-zero if some of the
+ * directories couldn't be watched (e.g., when system limit on number of watches
+ * is reached or such watching isn't supported at all).  Changes of these
+ * directories are reported only by fswatch_poll_dirs(). */
+int fswatch_set_dirs(fswatch_t *w, char *paths[], int npaths);
+
+/* Same as fswatch_poll(), but also appends paths of additional directories
+ * which have changed since last query to the *changed_dirs list (without
+ * duplicates).  Returns latest state of the main path. */
+FSWatchState fswatch_poll_dirs(fswatch_t *w, struct strlist_t *changed_dirs);
+
 #endif /* VIFM__UTILS__FSWATCH_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -28,18 +28,28 @@
 
 #include <errno.h> /* EAGAIN errno */
 #include <stddef.h> /* NULL */
-#include <stdint.h> /* uint32_t */
+#include <stdint.h> /* intptr_t uint32_t */
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
 #include <string.h> /* strdup() */
 #include <time.h> /* time_t time() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "string_array.h"
 #include "trie.h"
 
 /* TODO: consider implementation that could reuse already available descriptor
  *       by just removing old watch and then adding a new one. */
 
+/* Additional directory that's being watched. */
+typedef struct
+{
+	char *path; /* Path to the directory. */
+	int wd;     /* Watch descriptor or -1 if the watch was removed by kernel. */
+}
+dir_watch_t;
+
 /* Watcher data. */
 struct fswatch_t
 {
@@ -54,6 +64,13 @@ struct fswatch_t
 	/* To monitor mount events, which aren't reported by inotify. */
 	dev_t dev;
 	ino_t inode;
+
+	/* Additional directories to watch for changes in their lists of files. */
+	dir_watch_t *dirs;
+	int ndirs;
+	/* Map paths and textual watch descriptors to indexes in dirs plus one. */
+	trie_t *dirs_by_path;
+	trie_t *dirs_by_wd;
 };
 
 /* Per file statistics information. */
@@ -70,12 +87,23 @@ notif_stat_t;
 static FSWatchState poll_for_replacement(fswatch_t *w);
 static int update_file_stats(fswatch_t *w, const struct inotify_event *e,
 		time_t now);
+static void process_dir_event(fswatch_t *w, const struct inotify_event *e,
+		strlist_t *changed);
+static int get_dir_index(trie_t *trie, const char key[]);
+static void put_dir_index(trie_t *trie, const char key[], int index);
+static void free_dirs(dir_watch_t dirs[], int ndirs);
 
 /* Events we're interested in. */
 static const uint32_t EVENTS_MASK = IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE
                                   | IN_CREATE | IN_DELETE | IN_EXCL_UNLINK
                                   | IN_MOVED_FROM | IN_MOVED_TO;
 
+/* Events of additional directories we're interested in.  These are the ones
+ * that change list of files. */
+static const uint32_t DIR_EVENTS_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM
+                                      | IN_MOVED_TO | IN_DELETE_SELF
+                                      | IN_MOVE_SELF | IN_EXCL_UNLINK;
+
 fswatch_t *
 fswatch_create(const char path[])
 {
@@ -94,6 +122,11 @@ fswatch_create(const char path[])
 	w->dev = st.st_dev;
 	w->inode = st.st_ino;
 
+	w->dirs = NULL;
+	w->ndirs = 0;
+	w->dirs_by_path = NULL;
+	w->dirs_by_wd = NULL;
+
 	/* Create tree to collect update frequency statistics. */
 	w->stats = trie_create(&free);
 	if(w->stats == NULL)
@@ -139,6 +172,9 @@ fswatch_free(fswatch_t *w)
 	{
 		free(w->path);
 		trie_free(w->stats);
+		free_dirs(w->dirs, w->ndirs);
+		trie_free(w->dirs_by_path);
+		trie_free(w->dirs_by_wd);
 		close(w->fd);
 		free(w);
 	}
@@ -146,6 +182,109 @@ fswatch_free(fswatch_t *w)
 
 FSWatchState
 fswatch_poll(fswatch_t *w)
+{
+	return fswatch_poll_dirs(w, NULL);
+}
+
+int
+fswatch_set_dirs(fswatch_t *w, char *paths[], int npaths)
+{
+	dir_watch_t *const dirs = malloc(sizeof(*dirs)*(npaths + 1));
+	trie_t *const by_path = trie_create(/*free_func=*/NULL);
+	trie_t *const by_wd = trie_create(/*free_func=*/NULL);
+	if(dirs == NULL || by_path == NULL || by_wd == NULL)
+	{
+		free(dirs);
+		trie_free(by_path);
+		trie_free(by_wd);
+		return 1;
+	}
+
+	int failed = 0;
+	int ndirs = 0;
+	int i;
+	for(i = 0; i < npaths; ++i)
+	{
+		const char *const path = paths[i];
+		if(get_dir_index(by_path, path) >= 0)
+		{
+			continue;
+		}
+
+		dir_watch_t *const dir = &dirs[ndirs];
+
+		const int old_idx = get_dir_index(w->dirs_by_path, path);
+		if(old_idx >= 0 && w->dirs[old_idx].wd != -1)
+		{
+			/* Take over existing watch. */
+			*dir = w->dirs[old_idx];
+			w->dirs[old_idx].path = NULL;
+		}
+		else
+		{
+			/* Adding to the mask keeps events of the main path intact if it's the
+			 * same directory. */
+			dir->wd = inotify_add_watch(w->fd, path,
+					DIR_EVENTS_MASK | IN_MASK_ADD | IN_ONLYDIR);
+			if(dir->wd == -1)
+			{
+				/* Most likely ENOSPC, which means that limit on number of watches is
+				 * reached. */
+				failed = 1;
+				continue;
+			}
+
+			dir->path = strdup(path);
+			if(dir->path == NULL)
+			{
+				/* The watch might be shared with another directory, so it's left in
+				 * place and its events are ignored. */
+				failed = 1;
+				continue;
+			}
+		}
+
+		char wd_str[32];
+		snprintf(wd_str, sizeof(wd_str), "%d", dir->wd);
+		put_dir_index(by_path, path, ndirs);
+		if(get_dir_index(by_wd, wd_str) < 0)
+		{
+			put_dir_index(by_wd, wd_str, ndirs);
+		}
+		++ndirs;
+	}
+
+	/* Release watches that aren't needed anymore. */
+	for(i = 0; i < w->ndirs; ++i)
+	{
+		const dir_watch_t *const dir = &w->dirs[i];
+		if(dir->path == NULL || dir->wd == -1 || dir->wd == w->wd)
+		{
+			continue;
+		}
+
+		char wd_str[32];
+		snprintf(wd_str, sizeof(wd_str), "%d", dir->wd);
+		if(get_dir_index(by_wd, wd_str) < 0)
+		{
+			(void)inotify_rm_watch(w->fd, dir->wd);
+		}
+	}
+
+	free_dirs(w->dirs, w->ndirs);
+	trie_free(w->dirs_by_path);
+	trie_free(w->dirs_by_wd);
+
+	w->dirs = dirs;
+	w->ndirs = ndirs;
+	w->dirs_by_path = by_path;
+	w->dirs_by_wd = by_wd;
+
+	return failed;
+}
+
+FSWatchState
+fswatch_poll_dirs(fswatch_t *w, strlist_t *changed_dirs)
 {
 	enum { MAX_READS = 100 };
 	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
@@ -176,7 +315,15 @@ fswatch_poll(fswatch_t *w)
 		for(p = buf; p < buf + nread; p += sizeof(struct inotify_event) + e->len)
 		{
 			e = (struct inotify_event *)p;
-			if((e->mask & IN_IGNORED) != 0 && e->wd == w->wd)
+			/* Overflow of event queue has no watch descriptor and is handled as a
+			 * change of the main path. */
+			if(e->wd != w->wd && !(e->mask & IN_Q_OVERFLOW))
+			{
+				process_dir_event(w, e, changed_dirs);
+				continue;
+			}
+
+			if((e->mask & IN_IGNORED) != 0)
 			{
 				return poll_for_replacement(w);
 			}
@@ -298,6 +445,78 @@ update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
 	return 1;
 }
 
+/* Records change of an additional directory.  changed can be NULL. */
+static void
+process_dir_event(fswatch_t *w, const struct inotify_event *e,
+		strlist_t *changed)
+{
+	char wd_str[32];
+	snprintf(wd_str, sizeof(wd_str), "%d", e->wd);
+
+	const int idx = get_dir_index(w->dirs_by_wd, wd_str);
+	if(idx < 0)
+	{
+		/* A late event of a watch that was removed. */
+		return;
+	}
+
+	dir_watch_t *const dir = &w->dirs[idx];
+	if(e->mask & IN_IGNORED)
+	{
+		/* Directory is gone and so is the watch. */
+		dir->wd = -1;
+	}
+	else if((e->mask & IN_MOVE_SELF) && dir->wd != -1)
+	{
+		/* The watch follows the directory, but the path is what matters. */
+		(void)inotify_rm_watch(w->fd, dir->wd);
+		dir->wd = -1;
+	}
+	else if(!(e->mask & DIR_EVENTS_MASK))
+	{
+		return;
+	}
+
+	if(changed != NULL &&
+			!is_in_string_array(changed->items, changed->nitems, dir->path))
+	{
+		changed->nitems = add_to_string_array(&changed->items, changed->nitems,
+				dir->path);
+	}
+}
+
+/* Looks up index of additional directory by a key.  Returns the index or -1 if
+ * there is no such key. */
+static int
+get_dir_index(trie_t *trie, const char key[])
+{
+	void *data;
+	if(trie == NULL || trie_get(trie, key, &data) != 0)
+	{
+		return -1;
+	}
+	return (intptr_t)data - 1;
+}
+
+/* Maps key to index of additional directory. */
+static void
+put_dir_index(trie_t *trie, const char key[], int index)
+{
+	(void)trie_set(trie, key, (void *)(intptr_t)(index + 1));
+}
+
+/* Frees list of additional directories. */
+static void
+free_dirs(dir_watch_t dirs[], int ndirs)
+{
+	int i;
+	for(i = 0; i < ndirs; ++i)
+	{
+		free(dirs[i].path);
+	}
+	free(dirs);
+}
+
 #else
 
 #include "filemon.h"
@@ -362,6 +581,20 @@ fswatch_poll(fswatch_t *w)
 	return (changed ? FSWS_UPDATED : FSWS_UNCHANGED);
 }
 
+int
+fswatch_set_dirs(fswatch_t *w, char *paths[], int npaths)
+{
+	/* Polling lots of directories here would be no better than what the caller
+	 * can do by itself. */
+	return (npaths != 0);
+}
+
+FSWatchState
+fswatch_poll_dirs(fswatch_t *w, struct strlist_t *changed_dirs)
+{
+	return fswatch_poll(w);
+}
+
 #endif
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
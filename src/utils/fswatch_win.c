@@ -107,6 +107,19 @@ fswatch_poll(fswatch_t *w)
 	return (changed ? FSWS_UPDATED : FSWS_UNCHANGED);
 }
 
+int
+fswatch_set_dirs(fswatch_t *w, char *paths[], int npaths)
+{
+	/* Not implemented, the main watch covers the whole subtree anyway. */
+	return (npaths != 0);
+}
+
+FSWatchState
+fswatch_poll_dirs(fswatch_t *w, struct strlist_t *changed_dirs)
+{
+	return fswatch_poll(w);
+}
+
 /* Gets last directory modification time.  Returns non-zero on error, otherwise
  * zero is returned. */
 static int
@@ -20,7 +20,9 @@
 #define VIFM__UTILS__SELECTOR_H__
 
 /* This unit is meant to provide abstraction over platform-specific mechanism
- * for waiting for available data. */
+ * for waiting for available data.  On Linux it's implemented via epoll, which
+ * allows watching large sets of objects without enumerating all of them on
+ * each wait. */
 
 /* Type of object selector works with. */
 #ifdef _WIN32
@@ -45,6 +47,10 @@ void selector_reset(selector_t *selector);
 /* Adds item to the set of objects to watch.  If error occurs, its ignored. */
 void selector_add(selector_t *selector, selector_item_t item);
 
+/* Same as selector_add(), but also associates data with the item, which is
+ * then returned by selector_next_ready(). */
+void selector_add_data(selector_t *selector, selector_item_t item, void *data);
+
 /* Removes item from the set of objects to watch. */
 void selector_remove(selector_t *selector, selector_item_t item);
 
@@ -58,6 +64,12 @@ int selector_wait(selector_t *selector, int delay);
  * selector_wait().  Returns non-zero if so, otherwise zero is returned. */
 int selector_is_ready(selector_t *selector, selector_item_t item);
 
+/* Enumerates items that are ready for read after selector_wait() without
+ * visiting the rest of them.  Sets *data to data associated with the item.
+ * Returns non-zero if one more ready item was found, otherwise zero is
+ * returned. */
+int selector_next_ready(selector_t *selector, void **data);
+
 #endif /* VIFM__UTILS__SELECTOR_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -18,10 +18,39 @@
 
 #include "selector.h"
 
+#ifdef __linux__
+#include <sys/epoll.h> /* EPOLL* epoll_create1() epoll_ctl() epoll_event
+                          epoll_wait() */
+#include <unistd.h> /* close() */
+#else
 #include <sys/select.h> /* FD_* fd_set select() */
+#endif
 
+#include <stddef.h> /* NULL */
 #include <stdlib.h> /* free() malloc() */
-#include <string.h> /* memcpy() */
+#include <string.h> /* memcpy() memset() */
+
+#include "../compat/reallocarray.h"
+
+#ifdef __linux__
+
+/* Maximum number of ready items retrieved by single wait. */
+#define MAX_READY 64
+
+/* Selector object. */
+struct selector_t
+{
+	int epoll_fd; /* Descriptor of epoll instance. */
+
+	void **data;   /* Data of items indexed by descriptor. */
+	int data_size; /* Number of elements in data array. */
+
+	struct epoll_event ready[MAX_READY]; /* Ready items after successful wait. */
+	int nready;                          /* Number of elements in ready. */
+	int next_ready;                      /* Next element of ready to visit. */
+};
+
+#else
 
 /* Selector object. */
 struct selector_t
@@ -29,52 +58,180 @@ struct selector_t
 	fd_set set;   /* Set of selectors to check. */
 	fd_set ready; /* Set of ready selectors after successful check. */
 	int max_fd;   /* Maximal value among descriptors in the set. */
+
+	void *data[FD_SETSIZE]; /* Data of items indexed by descriptor. */
+	int next_ready;         /* Next descriptor to check for being ready. */
 };
 
+#endif
+
+static int set_data(selector_t *selector, selector_item_t item, void *data);
+
 selector_t *
 selector_alloc(void)
 {
 	selector_t *selector = malloc(sizeof(*selector));
-	if(selector != NULL)
+	if(selector == NULL)
+	{
+		return NULL;
+	}
+
+#ifdef __linux__
+	selector->epoll_fd = -1;
+	selector->data = NULL;
+	selector->data_size = 0;
+#endif
+
+	selector_reset(selector);
+
+#ifdef __linux__
+	if(selector->epoll_fd == -1)
 	{
-		selector_reset(selector);
+		free(selector);
+		return NULL;
 	}
+#endif
+
 	return selector;
 }
 
 void
 selector_free(selector_t *selector)
 {
-	free(selector);
+	if(selector != NULL)
+	{
+#ifdef __linux__
+		if(selector->epoll_fd != -1)
+		{
+			close(selector->epoll_fd);
+		}
+		free(selector->data);
+#endif
+		free(selector);
+	}
 }
 
 void
 selector_reset(selector_t *selector)
 {
+#ifdef __linux__
+	/* Recreating epoll instance is the quickest way of forgetting all items. */
+	if(selector->epoll_fd != -1)
+	{
+		close(selector->epoll_fd);
+	}
+	selector->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	if(selector->data != NULL)
+	{
+		memset(selector->data, 0, sizeof(*selector->data)*selector->data_size);
+	}
+	selector->nready = 0;
+#else
 	FD_ZERO(&selector->set);
 	FD_ZERO(&selector->ready);
 	selector->max_fd = -1;
+	memset(selector->data, 0, sizeof(selector->data));
+#endif
+	selector->next_ready = 0;
 }
 
 void
 selector_add(selector_t *selector, selector_item_t item)
 {
+	selector_add_data(selector, item, NULL);
+}
+
+void
+selector_add_data(selector_t *selector, selector_item_t item, void *data)
+{
+	if(set_data(selector, item, data) != 0)
+	{
+		return;
+	}
+
+#ifdef __linux__
+	struct epoll_event event = { .events = EPOLLIN, .data.fd = item };
+	(void)epoll_ctl(selector->epoll_fd, EPOLL_CTL_ADD, item, &event);
+#else
 	FD_SET(item, &selector->set);
 	if(item > selector->max_fd)
 	{
 		selector->max_fd = item;
 	}
+#endif
+}
+
+/* Associates data with the item.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+set_data(selector_t *selector, selector_item_t item, void *data)
+{
+	if(item < 0)
+	{
+		return 1;
+	}
+
+#ifdef __linux__
+	if(item >= selector->data_size)
+	{
+		const int new_size = item + 1 > selector->data_size*2
+		                   ? item + 1
+		                   : selector->data_size*2;
+		void **new_data = reallocarray(selector->data, new_size,
+				sizeof(*selector->data));
+		if(new_data == NULL)
+		{
+			return 1;
+		}
+
+		memset(&new_data[selector->data_size], 0,
+				sizeof(*new_data)*(new_size - selector->data_size));
+		selector->data = new_data;
+		selector->data_size = new_size;
+	}
+#else
+	if(item >= FD_SETSIZE)
+	{
+		return 1;
+	}
+#endif
+
+	selector->data[item] = data;
+	return 0;
 }
 
 void
 selector_remove(selector_t *selector, selector_item_t item)
 {
+#ifdef __linux__
+	/* Non-NULL event is for compatibility with kernels older than 2.6.9. */
+	struct epoll_event event = {};
+	(void)epoll_ctl(selector->epoll_fd, EPOLL_CTL_DEL, item, &event);
+
+	/* Make sure the item won't be reported by selector_next_ready(). */
+	int i;
+	for(i = selector->next_ready; i < selector->nready; ++i)
+	{
+		if(selector->ready[i].data.fd == item)
+		{
+			selector->ready[i].data.fd = -1;
+		}
+	}
+
+	if(item >= 0 && item < selector->data_size)
+	{
+		selector->data[item] = NULL;
+	}
+#else
 	FD_CLR(item, &selector->set);
+	FD_CLR(item, &selector->ready);
 	if(item == selector->max_fd)
 	{
 		/* Could do more here. */
 		--selector->max_fd;
 	}
+#endif
 }
 
 int
@@ -85,6 +242,17 @@ selector_wait(selector_t *selector, int delay)
 		delay = 0;
 	}
 
+	selector->next_ready = 0;
+
+#ifdef __linux__
+	selector->nready = epoll_wait(selector->epoll_fd, selector->ready, MAX_READY,
+			delay);
+	if(selector->nready < 0)
+	{
+		selector->nready = 0;
+	}
+	return (selector->nready > 0);
+#else
 	memcpy(&selector->ready, &selector->set, sizeof(selector->ready));
 
 	struct timeval ts = { .tv_sec = delay/1000, .tv_usec = (delay%1000)*1000 };
@@ -94,12 +262,52 @@ selector_wait(selector_t *selector, int delay)
 		FD_ZERO(&selector->ready);
 	}
 	return r;
+#endif
 }
 
 int
 selector_is_ready(selector_t *selector, selector_item_t item)
 {
+#ifdef __linux__
+	int i;
+	for(i = 0; i < selector->nready; ++i)
+	{
+		if(selector->ready[i].data.fd == item)
+		{
+			return 1;
+		}
+	}
+	return 0;
+#else
 	return FD_ISSET(item, &selector->ready);
+#endif
+}
+
+int
+selector_next_ready(selector_t *selector, void **data)
+{
+#ifdef __linux__
+	while(selector->next_ready < selector->nready)
+	{
+		const int fd = selector->ready[selector->next_ready++].data.fd;
+		if(fd != -1)
+		{
+			*data = selector->data[fd];
+			return 1;
+		}
+	}
+#else
+	while(selector->next_ready <= selector->max_fd)
+	{
+		const int fd = selector->next_ready++;
+		if(FD_ISSET(fd, &selector->ready))
+		{
+			*data = selector->data[fd];
+			return 1;
+		}
+	}
+#endif
+	return 0;
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
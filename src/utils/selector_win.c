@@ -29,9 +29,12 @@
 struct selector_t
 {
 	selector_item_t *items; /* Set of items to watch. */
+	void **data;            /* Data associated with items. */
 	int size;               /* Used amount of items. */
 	int capacity;           /* Reserved amount of items. */
 	selector_item_t ready;  /* Item that is ready to be read from or invalid. */
+	void *ready_data;       /* Data associated with the ready item. */
+	int ready_visited;      /* Whether selector_next_ready() returned it. */
 };
 
 selector_t *
@@ -41,6 +44,7 @@ selector_alloc(void)
 	if(selector != NULL)
 	{
 		selector->items = NULL;
+		selector->data = NULL;
 		selector->capacity = 0;
 		selector_reset(selector);
 	}
@@ -51,6 +55,7 @@ void
 selector_free(selector_t *selector)
 {
 	free(selector->items);
+	free(selector->data);
 	free(selector);
 }
 
@@ -63,12 +68,19 @@ selector_reset(selector_t *selector)
 
 void
 selector_add(selector_t *selector, selector_item_t item)
+{
+	selector_add_data(selector, item, NULL);
+}
+
+void
+selector_add_data(selector_t *selector, selector_item_t item, void *data)
 {
 	int i;
 	for(i = 0; i < selector->size; ++i)
 	{
 		if(selector->items[i] == item)
 		{
+			selector->data[i] = data;
 			return;
 		}
 	}
@@ -82,23 +94,40 @@ selector_add(selector_t *selector, selector_item_t item)
 		{
 			return;
 		}
-
 		selector->items = items;
+
+		void **new_data = reallocarray(selector->data, new_capacity,
+				sizeof(*selector->data));
+		if(new_data == NULL)
+		{
+			return;
+		}
+		selector->data = new_data;
+
 		selector->capacity = new_capacity;
 	}
 
-	selector->items[selector->size++] = item;
+	selector->items[selector->size] = item;
+	selector->data[selector->size] = data;
+	++selector->size;
 }
 
 void
 selector_remove(selector_t *selector, selector_item_t item)
 {
+	if(selector->ready == item)
+	{
+		selector->ready = INVALID_HANDLE_VALUE;
+	}
+
 	int i;
 	for(i = 0; i < selector->size; ++i)
 	{
 		if(selector->items[i] == item)
 		{
-			selector->items[i] = selector->items[--selector->size];
+			--selector->size;
+			selector->items[i] = selector->items[selector->size];
+			selector->data[i] = selector->data[selector->size];
 			break;
 		}
 	}
@@ -120,6 +149,8 @@ selector_wait(selector_t *selector, int delay)
 	}
 
 	selector->ready = selector->items[res - WAIT_OBJECT_0];
+	selector->ready_data = selector->data[res - WAIT_OBJECT_0];
+	selector->ready_visited = 0;
 	return 1;
 }
 
@@ -130,5 +161,18 @@ selector_is_ready(selector_t *selector, selector_item_t item)
 	    && selector->ready == item;
 }
 
+int
+selector_next_ready(selector_t *selector, void **data)
+{
+	if(selector->ready == INVALID_HANDLE_VALUE || selector->ready_visited)
+	{
+		return 0;
+	}
+
+	selector->ready_visited = 1;
+	*data = selector->ready_data;
+	return 1;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
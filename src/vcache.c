@@ -18,20 +18,28 @@
 
 #include "vcache.h"
 
+#include <sys/stat.h> /* S_IRWXU stat */
+#ifndef _WIN32
+#include <sys/time.h> /* utimes() */
+#endif
+#include <dirent.h> /* DIR dirent */
 #include <fcntl.h> /* F_GETFL O_NONBLOCK fcntl() */
 
-#include <stdio.h> /* FILE */
-#include <stdlib.h> /* free() */
-#include <string.h> /* memmove() memset() strcmp() */
-#include <time.h> /* time_t time() */
+#include <ctype.h> /* isxdigit() tolower() */
+#include <stdint.h> /* int64_t uint64_t */
+#include <stdio.h> /* FILE fclose() fprintf() fputs() remove() snprintf() */
+#include <stdlib.h> /* calloc() free() qsort() */
+#include <string.h> /* memset() strcmp() strlen() strpbrk() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() time_t time() */
 
 #include "cfg/config.h"
+#include "compat/fs_limits.h"
 #include "compat/os.h"
 #include "lua/vlua.h"
 #include "ui/cancellation.h"
 #include "ui/quickview.h"
 #include "ui/ui.h"
-#include "utils/darray.h"
+#include "utils/dynarray.h"
 #include "utils/file_streams.h"
 #include "utils/filemon.h"
 #include "utils/fs.h"
@@ -50,6 +58,22 @@ enum { MAX_RUN_TIME_S = 60 };
 /* Maximum number of seconds to wait for process to cancel. */
 enum { MAX_KILL_DELAY_S = 2 };
 
+/* First line of files of on-disk cache, which is followed by a flag of
+ * completeness of the output. */
+#define DISK_CACHE_MAGIC "vifm-preview-v1"
+
+/* Maximum number of viewers that are running at the same time. */
+enum { MAX_VIEWER_JOBS = 4 };
+
+/* Maximum number of viewers that are prefetching data at the same time. */
+enum { MAX_PREFETCH_JOBS = 2 };
+
+/* Length of names of files of on-disk cache (hexadecimal hash). */
+enum { DISK_NAME_LEN = 16 };
+
+/* Size of buffers for paths to files of on-disk cache. */
+#define DISK_PATH_LEN (sizeof(cfg.preview_cache_dir) + 32)
+
 /* Cached output of a specific previewer for a specific file. */
 typedef struct vcache_entry_t
 {
@@ -62,19 +86,50 @@ typedef struct vcache_entry_t
 	time_t kill_timer; /* Since when we're waiting for the job to die or zero. */
 	size_t size;       /* Size taken up by this entry (lower bound). */
 	int max_lines;     /* Number of lines requested. */
+	MacroFlags flags;  /* Flags of the viewer for starting it later. */
+
+	/* Since when viewer of pending entry waits to be started (milliseconds). */
+	long long requested_at;
 
 	/* Value of maxtreedepth for this entry. */
 	int max_tree_depth;
+
+	size_t hash;                  /* Hash of path and viewer. */
+	struct vcache_entry_t *hnext; /* Next entry in the same hash bucket. */
+	struct vcache_entry_t *prev;  /* Less recently used entry. */
+	struct vcache_entry_t *next;  /* More recently used entry. */
+
 	/* Whether cache contains complete output of the viewer. */
 	unsigned int complete : 1;
 	/* Whether last line is truncated. */
 	unsigned int truncated : 1;
 	/* Value of toptreestats for this entry. */
 	unsigned int top_tree_stats : 1;
+	/* Whether output is stored in on-disk cache. */
+	unsigned int persistent : 1;
+	/* Whether the entry was created ahead of time and wasn't looked up yet. */
+	unsigned int speculative : 1;
+	/* Whether speculative entry was requested in current round of prefetching. */
+	unsigned int wanted : 1;
+	/* Whether viewer wasn't started yet due to a delay or too many jobs. */
+	unsigned int pending : 1;
 }
 vcache_entry_t;
 
+/* File of on-disk cache. */
+typedef struct
+{
+	char *name;    /* Name of the file. */
+	uint64_t size; /* Size of the file. */
+	time_t mtime;  /* Time of last use of the file. */
+}
+disk_file_t;
+
 TSTATIC size_t vcache_entry_size(void);
+static int count_prefetch_jobs(void);
+static int count_viewer_jobs(void);
+static void start_pending(vcache_entry_t *centry);
+static long long get_time_ms(void);
 static void wait_async_finish(vcache_entry_t *centry);
 static vcache_entry_t * find_cache_entry(const char full_path[],
 		const char viewer[], int max_lines);
@@ -82,48 +137,75 @@ static vcache_entry_t * alloc_cache_entry(void);
 static void compact_cache(void);
 static vcache_entry_t * new_cache_entry(void);
 TSTATIC void vcache_reset(size_t max_size);
+static void drop_cache_entry(vcache_entry_t *centry);
 static void free_cache_entry(vcache_entry_t *centry);
+static void lru_append(vcache_entry_t *centry);
+static void lru_unlink(vcache_entry_t *centry);
+static void hash_insert(vcache_entry_t *centry);
+static void hash_remove(const vcache_entry_t *centry);
+static int hash_grow(void);
+static size_t hash_key(const char path[], const char viewer[]);
 static int is_cache_match(const vcache_entry_t *centry, const char path[],
 		const char viewer[]);
 static int is_cache_valid(const vcache_entry_t *centry, const char path[],
 		const char viewer[], int max_lines);
 static void update_cache_entry(vcache_entry_t *centry, const char path[],
-		const char viewer[], MacroFlags flags, int max_lines, const char **error);
+		const char viewer[], MacroFlags flags, int max_lines, int sync,
+		const char **error);
 static void update_sizes(vcache_entry_t *centry);
+static int uses_disk_cache(const vcache_entry_t *centry);
+static int load_from_disk(vcache_entry_t *centry);
+static void store_on_disk(const vcache_entry_t *centry);
+static int64_t trim_disk_cache(const char keep[]);
+static int disk_file_cmp(const void *a, const void *b);
+static int is_disk_cache_name(const char name[]);
+static void get_disk_path(const vcache_entry_t *centry, char buf[],
+		size_t buf_len);
 static int pull_async(vcache_entry_t *centry);
 static int read_async_output(vcache_entry_t *centry);
 static void cancel_job(vcache_entry_t *centry);
 static int is_ready_for_read(FILE *stream);
-static int need_more_async_output(vcache_entry_t *centry);
+static int need_more_async_output(const vcache_entry_t *centry);
 static strlist_t view_entry(vcache_entry_t *centry, MacroFlags flags,
-		const char **error);
+		int can_defer, const char **error);
 static strlist_t view_builtin(vcache_entry_t *centry, const char **error);
 static strlist_t view_plugin(vcache_entry_t *centry, const char **error);
 static strlist_t view_external(vcache_entry_t *centry, MacroFlags flags,
-		const char **error);
+		int can_defer, const char **error);
 TSTATIC strlist_t read_lines(FILE *fp, int max_lines, int *complete);
 
-/* Cache of viewers' output.  Ordered from least to most recently used. */
-static vcache_entry_t **cache;
-/* Declarations to enable use of DA_* on cache. */
-static DA_INSTANCE(cache);
+/* Cache of viewers' output as a list ordered from least to most recently
+ * used. */
+static vcache_entry_t *lru_head;
+static vcache_entry_t *lru_tail;
+/* Number of entries in the cache. */
+static size_t nentries;
+/* Hash table of entries that have path set with buckets chained through hnext
+ * field.  Number of buckets is zero or a power of two. */
+static vcache_entry_t **buckets;
+static size_t nbuckets;
 /* Amount of memory taken up by the cache (lower bound). */
 static size_t cache_size;
 /* Maximum size of the cache. */
 static size_t max_cache_size = 3U*1024*1024;
+/* Size of on-disk cache in bytes or -1 if it hasn't been counted yet.  It's
+ * counted once and then updated as files are stored. */
+static int64_t disk_cache_size = -1;
+/* Location of on-disk cache whose size is in disk_cache_size. */
+static char disk_cache_dir[PATH_MAX + 1];
 
 void
 vcache_finish(void)
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
 	{
-		if(cache[i]->job != NULL)
+		if(centry->job != NULL)
 		{
-			bg_job_cancel(cache[i]->job);
-			bg_job_terminate(cache[i]->job);
-			bg_job_decref(cache[i]->job);
-			cache[i]->job = NULL;
+			bg_job_cancel(centry->job);
+			bg_job_terminate(centry->job);
+			bg_job_decref(centry->job);
+			centry->job = NULL;
 		}
 	}
 }
@@ -147,12 +229,36 @@ vcache_check(vcache_is_previewed_cb is_previewed)
 
 	/* TODO: consider doing this in a separate thread. */
 
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	const long long now = get_time_ms();
+
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
 	{
-		if(cache[i]->job != NULL)
+		if(centry->pending)
 		{
-			changed |= (pull_async(cache[i]) && is_previewed(cache[i]->path));
+			if(!is_previewed(centry->path))
+			{
+				/* Cursor has moved on, forget about this request. */
+				centry->pending = 0;
+			}
+			else if(now - centry->requested_at >= cfg.viewer_delay &&
+					count_viewer_jobs() < MAX_VIEWER_JOBS)
+			{
+				start_pending(centry);
+			}
+			continue;
+		}
+
+		if(centry->job != NULL)
+		{
+			/* Nobody needs output of this viewer anymore. */
+			if(!centry->speculative && centry->kill_timer == 0 &&
+					!is_previewed(centry->path))
+			{
+				cancel_job(centry);
+			}
+
+			changed |= (pull_async(centry) && is_previewed(centry->path));
 		}
 	}
 
@@ -176,13 +282,17 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 		replace_string(&non_cache.path, full_path);
 		update_string(&non_cache.viewer, viewer);
 
-		non_cache.lines = view_entry(&non_cache, flags, error);
+		non_cache.lines = view_entry(&non_cache, flags, /*can_defer=*/0, error);
 		wait_async_finish(&non_cache);
 
 		return non_cache.lines;
 	}
 
 	vcache_entry_t *centry = find_cache_entry(full_path, viewer, max_lines);
+	if(centry != NULL)
+	{
+		centry->speculative = 0;
+	}
 	if(centry != NULL && is_cache_valid(centry, full_path, viewer, max_lines))
 	{
 		return centry->lines;
@@ -199,7 +309,7 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 		}
 	}
 
-	update_cache_entry(centry, full_path, viewer, flags, max_lines, error);
+	update_cache_entry(centry, full_path, viewer, flags, max_lines, sync, error);
 
 	if(sync)
 	{
@@ -207,7 +317,7 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 	}
 
 	if(kind != VK_PASS_THROUGH && centry->lines.nitems == 0 &&
-			centry->job != NULL)
+			(centry->job != NULL || centry->pending))
 	{
 		/* TODO: consider printing time we're waiting for output. */
 		static char *items[] = { "[...]" };
@@ -218,6 +328,131 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 	return centry->lines;
 }
 
+void
+vcache_prefetch_begin(void)
+{
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
+	{
+		centry->wanted = 0;
+	}
+}
+
+void
+vcache_prefetch(const char full_path[], const char viewer[], MacroFlags flags,
+		int max_lines)
+{
+	/* Only external viewers run asynchronously and output of viewers that depend
+	 * on selection doesn't correspond to the file. */
+	if(is_null_or_empty(viewer) || ma_flags_present(flags, MF_NO_CACHE) ||
+			ma_flags_present(flags, MF_PIPE_FILE_LIST) ||
+			ma_flags_present(flags, MF_PIPE_FILE_LIST_Z) ||
+			vlua_handler_cmd(curr_stats.vlua, viewer))
+	{
+		return;
+	}
+
+	vcache_entry_t *centry = find_cache_entry(full_path, viewer, max_lines);
+	if(centry != NULL)
+	{
+		centry->wanted = 1;
+		if(centry->job != NULL || centry->pending ||
+				is_cache_valid(centry, full_path, viewer, max_lines))
+		{
+			return;
+		}
+	}
+
+	if(count_prefetch_jobs() >= MAX_PREFETCH_JOBS ||
+			count_viewer_jobs() >= MAX_VIEWER_JOBS)
+	{
+		return;
+	}
+
+	if(centry == NULL)
+	{
+		centry = alloc_cache_entry();
+		if(centry == NULL)
+		{
+			return;
+		}
+	}
+
+	centry->speculative = 1;
+	centry->wanted = 1;
+
+	const char *error;
+	update_cache_entry(centry, full_path, viewer, flags, max_lines, VC_ASYNC,
+			&error);
+}
+
+void
+vcache_prefetch_end(void)
+{
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
+	{
+		if(centry->speculative && !centry->wanted && centry->job != NULL &&
+				centry->kill_timer == 0)
+		{
+			cancel_job(centry);
+		}
+	}
+}
+
+/* Counts viewers that are still running including those that are being
+ * stopped.  Returns the number. */
+static int
+count_viewer_jobs(void)
+{
+	int count = 0;
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
+	{
+		count += (centry->job != NULL);
+	}
+	return count;
+}
+
+/* Starts viewer of an entry whose start was postponed. */
+static void
+start_pending(vcache_entry_t *centry)
+{
+	centry->pending = 0;
+
+	const char *error;
+	free_string_array(centry->lines.items, centry->lines.nitems);
+	centry->lines = view_external(centry, centry->flags, /*can_defer=*/0, &error);
+	update_sizes(centry);
+}
+
+/* Retrieves current value of a monotonic clock.  Returns the value in
+ * milliseconds. */
+static long long
+get_time_ms(void)
+{
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+	{
+		return (long long)time(NULL)*1000;
+	}
+	return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/* Counts viewers that were started ahead of time and are still running.
+ * Returns the number. */
+static int
+count_prefetch_jobs(void)
+{
+	int count = 0;
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
+	{
+		count += (centry->speculative && centry->job != NULL);
+	}
+	return count;
+}
+
 /* Waits for asynchronous job to be done. */
 static void
 wait_async_finish(vcache_entry_t *centry)
@@ -263,6 +498,11 @@ wait_async_finish(vcache_entry_t *centry)
 		centry->lines.nitems = add_to_string_array(&centry->lines.items,
 				centry->lines.nitems, "[cancelled]");
 	}
+	else
+	{
+		centry->complete = (centry->kill_timer == 0 || !bg_job_was_killed(job));
+		store_on_disk(centry);
+	}
 	ui_cancellation_pop();
 
 	bg_job_decref(centry->job);
@@ -274,18 +514,21 @@ wait_async_finish(vcache_entry_t *centry)
 static vcache_entry_t *
 find_cache_entry(const char full_path[], const char viewer[], int max_lines)
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	if(nbuckets == 0U)
 	{
-		if(is_cache_match(cache[i], full_path, viewer))
-		{
-			vcache_entry_t *centry = cache[i];
+		return NULL;
+	}
 
+	const size_t hash = hash_key(full_path, viewer);
+	vcache_entry_t *centry;
+	for(centry = buckets[hash & (nbuckets - 1U)]; centry != NULL;
+			centry = centry->hnext)
+	{
+		if(centry->hash == hash && is_cache_match(centry, full_path, viewer))
+		{
 			/* Make the most recently used entry the last one. */
-			memmove(cache + i, cache + i + 1,
-					sizeof(*cache)*(DA_SIZE(cache) - 1U - i));
-			cache[DA_SIZE(cache) - 1U] = centry;
-
+			lru_unlink(centry);
+			lru_append(centry);
 			return centry;
 		}
 	}
@@ -310,67 +553,77 @@ alloc_cache_entry(void)
 static void
 compact_cache(void)
 {
-	if(cache == NULL)
+	vcache_entry_t *centry = lru_head;
+	while(centry != NULL && cache_size >= max_cache_size)
 	{
-		return;
-	}
+		vcache_entry_t *const next = centry->next;
 
-	size_t i;
-	size_t j = 0U;
-	for(i = 0U; i < DA_SIZE(cache) && cache_size >= max_cache_size; ++i)
-	{
-		vcache_entry_t *centry = cache[i];
 		if(centry->job != NULL)
 		{
-			cache[j++] = centry;
 			/* Give it a chance to finish gracefully. */
 			cancel_job(centry);
-			continue;
+		}
+		else
+		{
+			cache_size -= centry->size;
+			drop_cache_entry(centry);
 		}
 
-		cache_size -= centry->size;
-		free_cache_entry(centry);
-		free(centry);
+		centry = next;
 	}
-
-	memmove(cache + j, cache + i, sizeof(*cache)*(DA_SIZE(cache) - i));
-	DA_REMOVE_AFTER(cache, cache + j + DA_SIZE(cache) - i);
 }
 
 /* Allocates a new cache entry unconditionally.  Returns the entry. */
 static vcache_entry_t *
 new_cache_entry(void)
 {
-	vcache_entry_t **centry = DA_EXTEND(cache);
-	if(centry == NULL)
+	if(nentries >= nbuckets && hash_grow() != 0)
 	{
 		return NULL;
 	}
 
-	*centry = calloc(1, sizeof(**centry));
-	if(*centry == NULL)
+	vcache_entry_t *const centry = calloc(1, sizeof(*centry));
+	if(centry == NULL)
 	{
 		return NULL;
 	}
 
-	DA_COMMIT(cache);
-	return *centry;
+	lru_append(centry);
+	++nentries;
+	return centry;
 }
 
 /* Invalidates all cache entries and changes size limit. */
 TSTATIC void
 vcache_reset(size_t max_size)
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	while(lru_head != NULL)
 	{
-		free_cache_entry(cache[i]);
-		free(cache[i]);
+		drop_cache_entry(lru_head);
 	}
-	DA_REMOVE_ALL(cache);
+
+	free(buckets);
+	buckets = NULL;
+	nbuckets = 0U;
 
 	max_cache_size = max_size;
 	cache_size = 0;
+	disk_cache_size = -1;
+}
+
+/* Removes entry from the cache and frees it. */
+static void
+drop_cache_entry(vcache_entry_t *centry)
+{
+	if(centry->path != NULL)
+	{
+		hash_remove(centry);
+	}
+	lru_unlink(centry);
+	--nentries;
+
+	free_cache_entry(centry);
+	free(centry);
 }
 
 /* Frees resources of a cache entry. */
@@ -379,6 +632,7 @@ free_cache_entry(vcache_entry_t *centry)
 {
 	update_string(&centry->path, NULL);
 	update_string(&centry->viewer, NULL);
+	centry->pending = 0;
 
 	free_string_array(centry->lines.items, centry->lines.nitems);
 	centry->lines.items = NULL;
@@ -393,6 +647,137 @@ free_cache_entry(vcache_entry_t *centry)
 	}
 }
 
+/* Makes the entry the most recently used one. */
+static void
+lru_append(vcache_entry_t *centry)
+{
+	centry->prev = lru_tail;
+	centry->next = NULL;
+	if(lru_tail == NULL)
+	{
+		lru_head = centry;
+	}
+	else
+	{
+		lru_tail->next = centry;
+	}
+	lru_tail = centry;
+}
+
+/* Excludes the entry from the list of entries. */
+static void
+lru_unlink(vcache_entry_t *centry)
+{
+	if(centry->prev == NULL)
+	{
+		lru_head = centry->next;
+	}
+	else
+	{
+		centry->prev->next = centry->next;
+	}
+
+	if(centry->next == NULL)
+	{
+		lru_tail = centry->prev;
+	}
+	else
+	{
+		centry->next->prev = centry->prev;
+	}
+
+	centry->prev = NULL;
+	centry->next = NULL;
+}
+
+/* Adds the entry to the hash table, which must have at least one bucket. */
+static void
+hash_insert(vcache_entry_t *centry)
+{
+	vcache_entry_t **const bucket = &buckets[centry->hash & (nbuckets - 1U)];
+	centry->hnext = *bucket;
+	*bucket = centry;
+}
+
+/* Removes the entry from the hash table. */
+static void
+hash_remove(const vcache_entry_t *centry)
+{
+	vcache_entry_t **link = &buckets[centry->hash & (nbuckets - 1U)];
+	while(*link != NULL)
+	{
+		if(*link == centry)
+		{
+			*link = centry->hnext;
+			break;
+		}
+		link = &(*link)->hnext;
+	}
+}
+
+/* Doubles number of buckets of the hash table to keep chains short.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+hash_grow(void)
+{
+	const size_t new_nbuckets = (nbuckets == 0U ? 16U : nbuckets*2U);
+	vcache_entry_t **const new_buckets = calloc(new_nbuckets,
+			sizeof(*new_buckets));
+	if(new_buckets == NULL)
+	{
+		return 1;
+	}
+
+	free(buckets);
+	buckets = new_buckets;
+	nbuckets = new_nbuckets;
+
+	vcache_entry_t *centry;
+	for(centry = lru_head; centry != NULL; centry = centry->next)
+	{
+		if(centry->path != NULL)
+		{
+			hash_insert(centry);
+		}
+	}
+
+	return 0;
+}
+
+/* Computes hash of canonical form of the path combined with the viewer.
+ * Returns the hash. */
+static size_t
+hash_key(const char path[], const char viewer[])
+{
+	/* Some additional space is allocated for adding slashes. */
+	char canonic[strlen(path) + 8];
+	canonicalize_path(path, canonic, sizeof(canonic));
+
+	/* FNV-1a. */
+	size_t hash = 2166136261U;
+	const char *p;
+	for(p = canonic; *p != '\0'; ++p)
+	{
+#ifndef _WIN32
+		hash = (hash ^ (unsigned char)*p)*16777619U;
+#else
+		hash = (hash ^ (unsigned char)tolower(*p))*16777619U;
+#endif
+	}
+
+	/* Separate path from viewer and no viewer from an empty one. */
+	hash = (hash ^ (viewer == NULL ? 0U : 1U))*16777619U;
+	if(viewer != NULL)
+	{
+		for(p = viewer; *p != '\0'; ++p)
+		{
+			hash = (hash ^ (unsigned char)*p)*16777619U;
+		}
+	}
+
+	return hash;
+}
+
 /* Checks whether cache entry matches specified file and viewer.  Returns
  * non-zero if so, otherwise zero is returned. */
 static int
@@ -440,18 +825,43 @@ is_cache_valid(const vcache_entry_t *centry, const char path[],
  * failure. */
 static void
 update_cache_entry(vcache_entry_t *centry, const char path[],
-		const char viewer[], MacroFlags flags, int max_lines, const char **error)
+		const char viewer[], MacroFlags flags, int max_lines, int sync,
+		const char **error)
 {
 	(void)filemon_from_file(path, FMT_MODIFIED, &centry->filemon);
 	centry->max_lines = max_lines;
 
+	/* Key of an existing entry stays the same, so it's added to hash table only
+	 * once. */
+	const int is_new = (centry->path == NULL);
+
 	replace_string(&centry->path, path);
 	update_string(&centry->viewer, viewer);
 
+	if(is_new && centry->path != NULL)
+	{
+		centry->hash = hash_key(path, viewer);
+		hash_insert(centry);
+	}
+
 	if(centry->job == NULL)
 	{
+		if(centry->pending && !sync)
+		{
+			/* Keep waiting instead of restarting the delay. */
+			return;
+		}
+		centry->pending = 0;
+
 		free_string_array(centry->lines.items, centry->lines.nitems);
-		centry->lines = view_entry(centry, flags, error);
+		centry->lines.items = NULL;
+		centry->lines.nitems = 0;
+
+		centry->persistent = uses_disk_cache(centry);
+		if(!centry->persistent || load_from_disk(centry) != 0)
+		{
+			centry->lines = view_entry(centry, flags, !sync, error);
+		}
 
 		update_sizes(centry);
 	}
@@ -479,6 +889,302 @@ update_sizes(vcache_entry_t *centry)
 	cache_size += centry->size;
 }
 
+/* Checks whether output for the entry should be looked up in and saved to
+ * on-disk cache.  Only external viewers are slow enough to benefit from it.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+uses_disk_cache(const vcache_entry_t *centry)
+{
+	return cfg.preview_cache_size > 0
+	    && cfg.preview_cache_dir[0] != '\0'
+	    && filemon_is_set(&centry->filemon)
+	    && !is_null_or_empty(centry->viewer)
+	    && !vlua_handler_cmd(curr_stats.vlua, centry->viewer);
+}
+
+/* Fills the entry with output from on-disk cache if it has enough lines.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+load_from_disk(vcache_entry_t *centry)
+{
+	char path[DISK_PATH_LEN];
+	get_disk_path(centry, path, sizeof(path));
+
+	FILE *fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	char *const header = read_line(fp, NULL);
+	char *const file_path = read_line(fp, NULL);
+	char *const viewer = read_line(fp, NULL);
+
+	int complete = 0;
+	/* The path and the viewer are checked to rule out hash collisions. */
+	const int valid = header != NULL && file_path != NULL && viewer != NULL
+	               && sscanf(header, DISK_CACHE_MAGIC " %d", &complete) == 1
+	               && strcmp(file_path, centry->path) == 0
+	               && strcmp(viewer, centry->viewer) == 0;
+
+	free(header);
+	free(file_path);
+	free(viewer);
+
+	if(!valid)
+	{
+		fclose(fp);
+		return 1;
+	}
+
+	int read_all;
+	strlist_t lines = read_lines(fp, centry->max_lines, &read_all);
+	fclose(fp);
+
+	if(!(complete && read_all) && lines.nitems < centry->max_lines)
+	{
+		free_string_array(lines.items, lines.nitems);
+		return 1;
+	}
+
+#ifndef _WIN32
+	/* Modification time is used to find least recently used files. */
+	(void)utimes(path, NULL);
+#endif
+
+	centry->lines = lines;
+	centry->complete = (complete && read_all);
+	centry->truncated = 0;
+	return 0;
+}
+
+/* Saves output of the entry in on-disk cache if it's usable there and evicts
+ * least recently used files if cache is too big after that. */
+static void
+store_on_disk(const vcache_entry_t *centry)
+{
+	if(!centry->persistent ||
+			(!centry->complete && need_more_async_output(centry)))
+	{
+		return;
+	}
+
+	/* File format is line-based. */
+	if(strpbrk(centry->path, "\r\n") != NULL ||
+			strpbrk(centry->viewer, "\r\n") != NULL)
+	{
+		return;
+	}
+
+	char path[DISK_PATH_LEN];
+	get_disk_path(centry, path, sizeof(path));
+
+	char tmp_path[DISK_PATH_LEN + 8];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	/* The file might be replaced. */
+	struct stat st;
+	const int64_t old_size = (os_stat(path, &st) == 0 ? st.st_size : 0);
+
+	if(make_path(cfg.preview_cache_dir, S_IRWXU) != 0)
+	{
+		return;
+	}
+
+	FILE *fp = os_fopen(tmp_path, "wb");
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	fprintf(fp, DISK_CACHE_MAGIC " %d\n%s\n%s\n", (int)centry->complete,
+			centry->path, centry->viewer);
+
+	/* Partial last line of incomplete output is of no use. */
+	int nlines = centry->lines.nitems;
+	if(centry->truncated && !centry->complete)
+	{
+		--nlines;
+	}
+
+	int i;
+	for(i = 0; i < nlines; ++i)
+	{
+		fputs(centry->lines.items[i], fp);
+		fputc('\n', fp);
+	}
+
+	const int failed = ferror(fp);
+	if(fclose(fp) != 0 || failed || os_rename(tmp_path, path) != 0)
+	{
+		(void)remove(tmp_path);
+		return;
+	}
+
+	if(disk_cache_size < 0 || strcmp(disk_cache_dir, cfg.preview_cache_dir) != 0)
+	{
+		copy_str(disk_cache_dir, sizeof(disk_cache_dir), cfg.preview_cache_dir);
+		disk_cache_size = trim_disk_cache(path);
+		return;
+	}
+
+	if(os_stat(path, &st) == 0)
+	{
+		disk_cache_size += st.st_size - old_size;
+	}
+
+	const int64_t limit = (int64_t)cfg.preview_cache_size*1024*1024;
+	if(disk_cache_size > limit)
+	{
+		disk_cache_size = trim_disk_cache(path);
+	}
+}
+
+/* Removes least recently used files of on-disk cache until its size is within
+ * the limit.  The file at the keep path is never removed.  Returns size of the
+ * cache after trimming or -1 on error. */
+static int64_t
+trim_disk_cache(const char keep[])
+{
+	DIR *dir = os_opendir(cfg.preview_cache_dir);
+	if(dir == NULL)
+	{
+		return -1;
+	}
+
+	disk_file_t *files = NULL;
+	int nfiles = 0;
+	uint64_t total = 0U;
+
+	struct dirent *d;
+	while((d = os_readdir(dir)) != NULL)
+	{
+		if(!is_disk_cache_name(d->d_name))
+		{
+			continue;
+		}
+
+		char path[DISK_PATH_LEN];
+		snprintf(path, sizeof(path), "%s/%.*s", cfg.preview_cache_dir,
+				(int)DISK_NAME_LEN, d->d_name);
+
+		struct stat st;
+		if(os_stat(path, &st) != 0 || paths_are_equal(path, keep))
+		{
+			continue;
+		}
+
+		disk_file_t *const new_files = dynarray_extend(files, sizeof(*files));
+		if(new_files == NULL)
+		{
+			continue;
+		}
+		files = new_files;
+
+		files[nfiles].name = strdup(d->d_name);
+		if(files[nfiles].name == NULL)
+		{
+			continue;
+		}
+		files[nfiles].size = st.st_size;
+		files[nfiles].mtime = st.st_mtime;
+		total += st.st_size;
+		++nfiles;
+	}
+	os_closedir(dir);
+
+	struct stat st;
+	if(os_stat(keep, &st) == 0)
+	{
+		total += st.st_size;
+	}
+
+	qsort(files, nfiles, sizeof(*files), &disk_file_cmp);
+
+	const uint64_t limit = (uint64_t)cfg.preview_cache_size*1024U*1024U;
+
+	int i;
+	for(i = 0; i < nfiles; ++i)
+	{
+		if(total > limit)
+		{
+			char path[DISK_PATH_LEN];
+			snprintf(path, sizeof(path), "%s/%.*s", cfg.preview_cache_dir,
+					(int)DISK_NAME_LEN, files[i].name);
+			if(remove(path) == 0)
+			{
+				total -= files[i].size;
+			}
+		}
+		free(files[i].name);
+	}
+	dynarray_free(files);
+
+	return total;
+}
+
+/* qsort() comparer that puts least recently used files first.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+disk_file_cmp(const void *a, const void *b)
+{
+	const disk_file_t *const file_a = a;
+	const disk_file_t *const file_b = b;
+	return (file_a->mtime > file_b->mtime) - (file_a->mtime < file_b->mtime);
+}
+
+/* Checks whether file name looks like a name of on-disk cache file.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_disk_cache_name(const char name[])
+{
+	int i;
+	for(i = 0; i < DISK_NAME_LEN; ++i)
+	{
+		if(!isxdigit((unsigned char)name[i]))
+		{
+			return 0;
+		}
+	}
+	return (name[DISK_NAME_LEN] == '\0');
+}
+
+/* Formats path to a file of on-disk cache that corresponds to the entry.  The
+ * name is a hash of the path, viewer and timestamp of the file, so a change of
+ * any of them makes old file unreachable until it's evicted. */
+static void
+get_disk_path(const vcache_entry_t *centry, char buf[], size_t buf_len)
+{
+	const filemon_t *const fm = &centry->filemon;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	const long long sec = fm->ts.tv_sec;
+	const long nsec = fm->ts.tv_nsec;
+#else
+	const long long sec = fm->ts;
+	const long nsec = 0;
+#endif
+
+	/* Some additional space is allocated for adding slashes. */
+	char canonic[strlen(centry->path) + 8];
+	canonicalize_path(centry->path, canonic, sizeof(canonic));
+
+	char *const key = format_str("%s\n%s\n%lld.%ld:%llu:%llu", canonic,
+			centry->viewer, sec, nsec, (unsigned long long)fm->dev,
+			(unsigned long long)fm->inode);
+
+	/* 64-bit FNV-1a. */
+	uint64_t hash = 14695981039346656037ULL;
+	const char *p;
+	for(p = (key == NULL ? "" : key); *p != '\0'; ++p)
+	{
+		hash = (hash ^ (unsigned char)*p)*1099511628211ULL;
+	}
+	free(key);
+
+	snprintf(buf, buf_len, "%s/%016llx", cfg.preview_cache_dir,
+			(unsigned long long)hash);
+}
+
 /* Updates single entry backed by an asynchronous job.  Returns non-zero if
  * entry was updated, otherwise zero is returned. */
 static int
@@ -520,6 +1226,8 @@ pull_async(vcache_entry_t *centry)
 		bg_job_decref(centry->job);
 		centry->job = NULL;
 		changed = 1;
+
+		store_on_disk(centry);
 	}
 
 	return changed;
@@ -631,7 +1339,7 @@ is_ready_for_read(FILE *stream)
 /* Checks whether entry is full with data already.  Returns non-zero if so,
  * otherwise zero is returned. */
 static int
-need_more_async_output(vcache_entry_t *centry)
+need_more_async_output(const vcache_entry_t *centry)
 {
 	int effective_lines = centry->lines.nitems;
 	if(centry->truncated)
@@ -643,10 +1351,11 @@ need_more_async_output(vcache_entry_t *centry)
 }
 
 /* Processes cache entry to get preview of a file.  Might spawn job for the
- * viewer and return. *error is set to an error message on failure.  Returns
- * output. */
+ * viewer and return or postpone starting it if can_defer is set. *error is set
+ * to an error message on failure.  Returns output. */
 static strlist_t
-view_entry(vcache_entry_t *centry, MacroFlags flags, const char **error)
+view_entry(vcache_entry_t *centry, MacroFlags flags, int can_defer,
+		const char **error)
 {
 	if(is_null_or_empty(centry->viewer))
 	{
@@ -658,7 +1367,7 @@ view_entry(vcache_entry_t *centry, MacroFlags flags, const char **error)
 		return view_plugin(centry, error);
 	}
 
-	return view_external(centry, flags, error);
+	return view_external(centry, flags, can_defer, error);
 }
 
 /* Generates view via builtin means.  *error is set to an error message on
@@ -710,13 +1419,32 @@ view_plugin(vcache_entry_t *centry, const char **error)
 			curr_stats.preview_hint);
 }
 
-/* Invokes viewer of a file to get its output.  *error is set to an error
- * message on failure.  Returns output. */
+/* Invokes viewer of a file to get its output.  If can_defer is set, starting
+ * the viewer can be postponed until cursor rests on the file or until some of
+ * running viewers finish.  *error is set to an error message on failure.
+ * Returns output. */
 static strlist_t
-view_external(vcache_entry_t *centry, MacroFlags flags, const char **error)
+view_external(vcache_entry_t *centry, MacroFlags flags, int can_defer,
+		const char **error)
 {
 	strlist_t lines = {};
 
+	centry->complete = 0;
+	centry->truncated = 0;
+
+	/* Speculative entries are limited on their own and viewers that read list of
+	 * files need it at the moment of the request. */
+	if(can_defer && !centry->speculative &&
+			!ma_flags_present(flags, MF_PIPE_FILE_LIST) &&
+			!ma_flags_present(flags, MF_PIPE_FILE_LIST_Z) &&
+			(cfg.viewer_delay > 0 || count_viewer_jobs() >= MAX_VIEWER_JOBS))
+	{
+		centry->pending = 1;
+		centry->flags = flags;
+		centry->requested_at = get_time_ms();
+		return lines;
+	}
+
 	BgJobFlags bg_flags = BJF_CAPTURE_OUT | BJF_MERGE_STREAMS;
 	if(ma_flags_present(flags, MF_PIPE_FILE_LIST) ||
 			ma_flags_present(flags, MF_PIPE_FILE_LIST_Z))
@@ -729,6 +1457,11 @@ view_external(vcache_entry_t *centry, MacroFlags flags, const char **error)
 		bg_flags |= BJF_KEEP_IN_FG;
 	}
 
+	if(centry->speculative)
+	{
+		bg_flags |= BJF_LOW_PRIORITY;
+	}
+
 	centry->job = bg_run_external_job(centry->viewer, bg_flags);
 	if(centry->job == NULL)
 	{
@@ -738,8 +1471,6 @@ view_external(vcache_entry_t *centry, MacroFlags flags, const char **error)
 
 	centry->kill_timer = 0;
 	centry->started_at = time(NULL);
-	centry->complete = 0;
-	centry->truncated = 0;
 
 	if(centry->job->input != NULL)
 	{
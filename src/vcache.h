@@ -61,6 +61,20 @@ struct strlist_t vcache_lookup(const char full_path[], const char viewer[],
 		MacroFlags flags, ViewerKind kind, int max_lines, int sync,
 		const char **error);
 
+/* Marks beginning of a round of prefetching, which consists of calls to
+ * vcache_prefetch() and ends with a call to vcache_prefetch_end(). */
+void vcache_prefetch_begin(void);
+
+/* Starts viewer of a file in background with low priority ahead of time, so
+ * that its output is ready by the time it's looked up.  Does nothing if output
+ * is already cached or too many viewers are being prefetched.  Arguments have
+ * the same meaning as for vcache_lookup(). */
+void vcache_prefetch(const char full_path[], const char viewer[],
+		MacroFlags flags, int max_lines);
+
+/* Cancels prefetching jobs that weren't requested during the current round. */
+void vcache_prefetch_end(void);
+
 TSTATIC_DEFS(
 	struct strlist_t read_lines(FILE *fp, int max_lines, int *complete);
 	void vcache_reset(size_t max_size);
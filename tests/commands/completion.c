@@ -609,7 +609,8 @@ TEST(highlight_columns_are_completed)
 
 TEST(command_options_are_completed)
 {
-	ASSERT_COMPLETION(L"copy -", L"copy -skip");
+	ASSERT_COMPLETION(L"copy -", L"copy -bulk");
+	ASSERT_COMPLETION(L"alink -", L"alink -skip");
 
 	other_view = &rwin;
 #ifndef _WIN32
@@ -93,6 +93,18 @@ TEST(copy_can_skip_existing_files)
 	remove_file(SANDBOX_PATH "/right/b");
 }
 
+TEST(copy_can_be_done_in_bulk_mode_with_verification)
+{
+	ui_sb_msg("");
+	assert_failure(cmds_dispatch("%copy -bulk -verify -skip", &lwin,
+				CIT_COMMAND));
+	assert_string_equal("2 files successfully processed", ui_sb_last());
+
+	assert_int_equal(2, get_file_size(SANDBOX_PATH "/right/a"));
+	assert_int_equal(1, get_file_size(SANDBOX_PATH "/right/b"));
+	remove_file(SANDBOX_PATH "/right/b");
+}
+
 TEST(link_can_skip_existing_files, IF(not_windows))
 {
 	ui_sb_msg("");
@@ -602,6 +602,12 @@ TEST(tree_command)
 	assert_true(cv_tree(lwin.custom.type));
 	assert_int_equal(1, lwin.list_rows);
 
+	assert_success(cmds_dispatch("tree lazy", &lwin, CIT_COMMAND));
+	assert_true(flist_custom_active(&lwin));
+	assert_true(cv_tree(lwin.custom.type));
+	assert_int_equal(1, lwin.list_rows);
+	assert_true(lwin.dir_entry[0].folded);
+
 	remove_dir(sub_sub_path);
 	remove_dir(sub_path);
 }
@@ -0,0 +1,247 @@
+#include <stic.h>
+
+#include <stdlib.h> /* free() */
+#include <string.h> /* strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/fops_journal.h"
+
+static char src_a[PATH_MAX + 1], src_b[PATH_MAX + 1];
+static char dst_a[PATH_MAX + 1], dst_b[PATH_MAX + 1];
+static char saved_config_dir[PATH_MAX + 1];
+
+SETUP()
+{
+	char *const cwd = save_cwd();
+
+	strcpy(saved_config_dir, cfg.config_dir);
+	make_abs_path(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH, "",
+			cwd);
+	cfg.journal_ops = 1;
+
+	make_abs_path(src_a, sizeof(src_a), SANDBOX_PATH, "a", cwd);
+	make_abs_path(src_b, sizeof(src_b), SANDBOX_PATH, "b", cwd);
+	make_abs_path(dst_a, sizeof(dst_a), SANDBOX_PATH, "dst/a", cwd);
+	make_abs_path(dst_b, sizeof(dst_b), SANDBOX_PATH, "dst/b", cwd);
+
+	restore_cwd(cwd);
+
+	make_file(src_a, "first");
+	make_file(src_b, "second");
+	create_dir(SANDBOX_PATH "/dst");
+	create_dir(SANDBOX_PATH "/journal");
+}
+
+TEARDOWN()
+{
+	cfg.journal_ops = 0;
+	strcpy(cfg.config_dir, saved_config_dir);
+
+	remove_file(src_a);
+	remove_file(src_b);
+	remove_dir(SANDBOX_PATH "/dst");
+	remove_dir(SANDBOX_PATH "/journal");
+}
+
+TEST(nothing_is_journaled_if_disabled)
+{
+	char *src[] = { src_a };
+	char *dst[] = { dst_a };
+
+	cfg.journal_ops = 0;
+	assert_null(fops_journal_start("descr", SANDBOX_PATH, 0, 0, src, dst, 1));
+	assert_true(is_dir_empty(SANDBOX_PATH "/journal"));
+}
+
+TEST(journal_of_running_operation_is_not_listed, IF(not_windows))
+{
+	char *src[] = { src_a };
+	char *dst[] = { dst_a };
+
+	fops_journal_t *journal =
+		fops_journal_start("descr", SANDBOX_PATH, 0, 0, src, dst, 1);
+	assert_non_null(journal);
+
+	int len;
+	char **list = fops_journal_list(&len);
+	assert_int_equal(0, len);
+	free_string_array(list, len);
+
+	fops_journal_item_done(journal, 0);
+	fops_journal_finish(journal, /*cancelled=*/0);
+
+	list = fops_journal_list(&len);
+	assert_int_equal(0, len);
+	free_string_array(list, len);
+}
+
+TEST(journal_of_cancelled_operation_is_removed, IF(not_windows))
+{
+	char *src[] = { src_a };
+	char *dst[] = { dst_a };
+
+	fops_journal_t *journal =
+		fops_journal_start("descr", SANDBOX_PATH, 0, 0, src, dst, 1);
+	assert_non_null(journal);
+	fops_journal_finish(journal, /*cancelled=*/1);
+
+	int len;
+	char **list = fops_journal_list(&len);
+	assert_int_equal(0, len);
+	free_string_array(list, len);
+}
+
+TEST(interrupted_operation_can_be_discarded, IF(not_windows))
+{
+	char *src[] = { src_a };
+	char *dst[] = { dst_a };
+
+	fops_journal_t *journal =
+		fops_journal_start("descr", SANDBOX_PATH, 0, 0, src, dst, 1);
+	assert_non_null(journal);
+	fops_journal_finish(journal, /*cancelled=*/0);
+
+	int len;
+	char **list = fops_journal_list(&len);
+	assert_int_equal(1, len);
+
+	fops_journal_discard(list[0]);
+	free_string_array(list, len);
+
+	list = fops_journal_list(&len);
+	assert_int_equal(0, len);
+	free_string_array(list, len);
+}
+
+TEST(interrupted_operation_is_resumed, IF(not_windows))
+{
+	char *src[] = { src_a, src_b };
+	char *dst[] = { dst_a, dst_b };
+
+	fops_journal_t *journal =
+		fops_journal_start("copy", SANDBOX_PATH, 0, 0, src, dst, 2);
+	assert_non_null(journal);
+	/* First item is processed, second one is copied partially. */
+	fops_journal_item_done(journal, 0);
+	make_file(dst_b, "sec");
+	fops_journal_finish(journal, /*cancelled=*/0);
+
+	int len;
+	char **list = fops_journal_list(&len);
+	assert_int_equal(1, len);
+
+	char *descr = fops_journal_describe(list[0]);
+	assert_string_equal("copy (1 of 2 done)", descr);
+	free(descr);
+
+	assert_success(fops_journal_resume(list[0]));
+	wait_for_bg();
+	free_string_array(list, len);
+
+	/* Processed item isn't touched. */
+	assert_false(path_exists(dst_a, NODEREF));
+
+	const char *lines[] = { "second" };
+	file_is(dst_b, lines, 1);
+	remove_file(dst_b);
+
+	list = fops_journal_list(&len);
+	assert_int_equal(0, len);
+	free_string_array(list, len);
+}
+
+TEST(replaced_destination_is_not_continued, IF(not_windows))
+{
+	char *src[] = { src_a };
+	char *dst[] = { dst_a };
+
+	/* Unrelated file that's smaller than the source. */
+	make_file(dst_a, "xy");
+
+	fops_journal_t *journal =
+		fops_journal_start("copy", SANDBOX_PATH, 0, /*force=*/1, src, dst, 1);
+	assert_non_null(journal);
+	fops_journal_finish(journal, /*cancelled=*/0);
+
+	int len;
+	char **list = fops_journal_list(&len);
+	assert_int_equal(1, len);
+	assert_success(fops_journal_resume(list[0]));
+	wait_for_bg();
+	free_string_array(list, len);
+
+	const char *lines[] = { "first" };
+	file_is(dst_a, lines, 1);
+	remove_file(dst_a);
+
+	list = fops_journal_list(&len);
+	assert_int_equal(0, len);
+	free_string_array(list, len);
+}
+
+TEST(interrupted_directory_copy_is_continued, IF(not_windows))
+{
+	char src_dir[PATH_MAX + 1], dst_dir[PATH_MAX + 1];
+	char *const cwd = save_cwd();
+	make_abs_path(src_dir, sizeof(src_dir), SANDBOX_PATH, "dir", cwd);
+	make_abs_path(dst_dir, sizeof(dst_dir), SANDBOX_PATH, "dst/dir", cwd);
+	restore_cwd(cwd);
+
+	create_dir(SANDBOX_PATH "/dir");
+	create_dir(SANDBOX_PATH "/dir/sub");
+	make_file(SANDBOX_PATH "/dir/done", "first");
+	make_file(SANDBOX_PATH "/dir/part", "second");
+	make_file(SANDBOX_PATH "/dir/sub/new", "third");
+	reset_timestamp(SANDBOX_PATH "/dir/done");
+	reset_timestamp(SANDBOX_PATH "/dir/part");
+
+	char *src[] = { src_dir };
+	char *dst[] = { dst_dir };
+
+	fops_journal_t *journal =
+		fops_journal_start("copy", SANDBOX_PATH, 0, 0, src, dst, 1);
+	assert_non_null(journal);
+	/* One file is copied completely (different contents show whether it's
+	 * copied again), another one partially and subdirectory isn't copied. */
+	create_dir(SANDBOX_PATH "/dst/dir");
+	make_file(SANDBOX_PATH "/dst/dir/done", "FIRST");
+	reset_timestamp(SANDBOX_PATH "/dst/dir/done");
+	make_file(SANDBOX_PATH "/dst/dir/part", "sec");
+	fops_journal_finish(journal, /*cancelled=*/0);
+
+	int len;
+	char **list = fops_journal_list(&len);
+	assert_int_equal(1, len);
+	assert_success(fops_journal_resume(list[0]));
+	wait_for_bg();
+	free_string_array(list, len);
+
+	const char *done_lines[] = { "FIRST" };
+	file_is(SANDBOX_PATH "/dst/dir/done", done_lines, 1);
+	const char *part_lines[] = { "second" };
+	file_is(SANDBOX_PATH "/dst/dir/part", part_lines, 1);
+	const char *new_lines[] = { "third" };
+	file_is(SANDBOX_PATH "/dst/dir/sub/new", new_lines, 1);
+
+	list = fops_journal_list(&len);
+	assert_int_equal(0, len);
+	free_string_array(list, len);
+
+	remove_file(SANDBOX_PATH "/dir/sub/new");
+	remove_dir(SANDBOX_PATH "/dir/sub");
+	remove_file(SANDBOX_PATH "/dir/done");
+	remove_file(SANDBOX_PATH "/dir/part");
+	remove_dir(SANDBOX_PATH "/dir");
+	remove_file(SANDBOX_PATH "/dst/dir/sub/new");
+	remove_dir(SANDBOX_PATH "/dst/dir/sub");
+	remove_file(SANDBOX_PATH "/dst/dir/done");
+	remove_file(SANDBOX_PATH "/dst/dir/part");
+	remove_dir(SANDBOX_PATH "/dst/dir");
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
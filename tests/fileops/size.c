@@ -1,8 +1,9 @@
 #include <stic.h>
 
 #include <sys/stat.h> /* stat */
-#include <unistd.h> /* rmdir() unlink() */
+#include <unistd.h> /* link() rmdir() truncate() unlink() */
 
+#include <stdio.h> /* snprintf() */
 #include <string.h> /* strcpy() strdup() */
 #include <time.h> /* time() time_t */
 
@@ -11,6 +12,7 @@
 #include "../../src/cfg/config.h"
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/utils/cancellation.h"
 #include "../../src/utils/dynarray.h"
 #include "../../src/utils/fs.h"
 #include "../../src/filelist.h"
@@ -129,6 +131,88 @@ TEST(symlinks_to_dirs, IF(not_windows))
 	assert_success(rmdir(SANDBOX_PATH "/dir"));
 }
 
+TEST(sizes_of_nested_directories_are_summed_and_cached)
+{
+	char path[PATH_MAX + 1];
+	int i;
+
+	create_dir(SANDBOX_PATH "/dir");
+	for(i = 0; i < 20; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/dir/%d", SANDBOX_PATH, i);
+		create_dir(path);
+		snprintf(path, sizeof(path), "%s/dir/%d/sub", SANDBOX_PATH, i);
+		create_dir(path);
+		snprintf(path, sizeof(path), "%s/dir/%d/a", SANDBOX_PATH, i);
+		make_file(path, "12345");
+		snprintf(path, sizeof(path), "%s/dir/%d/sub/b", SANDBOX_PATH, i);
+		make_file(path, "123");
+	}
+
+	assert_ulong_equal(20*8,
+			fops_dir_size(SANDBOX_PATH "/dir", 0, &no_cancellation));
+	assert_int_equal(8, wait_for_size(SANDBOX_PATH "/dir/7"));
+	assert_int_equal(3, wait_for_size(SANDBOX_PATH "/dir/19/sub"));
+
+	for(i = 0; i < 20; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/dir/%d/sub/b", SANDBOX_PATH, i);
+		remove_file(path);
+		snprintf(path, sizeof(path), "%s/dir/%d/a", SANDBOX_PATH, i);
+		remove_file(path);
+		snprintf(path, sizeof(path), "%s/dir/%d/sub", SANDBOX_PATH, i);
+		remove_dir(path);
+		snprintf(path, sizeof(path), "%s/dir/%d", SANDBOX_PATH, i);
+		remove_dir(path);
+	}
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+TEST(allocated_size_counts_hard_links_once, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/dir");
+	make_file(SANDBOX_PATH "/dir/a", "12345");
+	assert_success(link(SANDBOX_PATH "/dir/a", SANDBOX_PATH "/dir/b"));
+
+	struct stat dir_st, file_st;
+	assert_success(os_stat(SANDBOX_PATH "/dir", &dir_st));
+	assert_success(os_stat(SANDBOX_PATH "/dir/a", &file_st));
+
+	uint64_t size, alloc;
+	fops_dir_sizes(SANDBOX_PATH "/dir", 0, &no_cancellation, &size, &alloc);
+	assert_ulong_equal(10, size);
+	assert_ulong_equal((dir_st.st_blocks + file_st.st_blocks)*512, alloc);
+
+	remove_file(SANDBOX_PATH "/dir/b");
+	remove_file(SANDBOX_PATH "/dir/a");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+TEST(both_sizes_are_cached, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/dir");
+	create_dir(SANDBOX_PATH "/dir/sub");
+	create_file(SANDBOX_PATH "/dir/sub/sparse");
+	assert_success(truncate(SANDBOX_PATH "/dir/sub/sparse", 1024*1024));
+
+	struct stat st;
+	assert_success(os_stat(SANDBOX_PATH "/dir/sub", &st));
+
+	uint64_t size, alloc;
+	fops_dir_sizes(SANDBOX_PATH "/dir", 0, &no_cancellation, &size, &alloc);
+	assert_ulong_equal(1024*1024, size);
+	assert_true(alloc < size);
+
+	dcache_get_at(SANDBOX_PATH "/dir/sub", st.st_mtime - 10, st.st_ino, &size,
+			&alloc, NULL);
+	assert_ulong_equal(1024*1024, size);
+	assert_true(alloc < size);
+
+	remove_file(SANDBOX_PATH "/dir/sub/sparse");
+	remove_dir(SANDBOX_PATH "/dir/sub");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
 static void
 setup_single_entry(view_t *view, const char name[])
 {
@@ -157,7 +241,7 @@ wait_for_size(const char path[])
 
 	uint64_t size;
 	/* Tests are executed fast, so decrement mtime. */
-	dcache_get_at(path, mtime - 10, inode, &size, NULL);
+	dcache_get_at(path, mtime - 10, inode, &size, NULL, NULL);
 	return size;
 }
 
@@ -64,6 +64,59 @@ TEST(shallow_estimation_does_not_recur)
 	ioeta_free(estim);
 }
 
+TEST(async_estimation_matches_sync_one)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_calculate_async(estim, TEST_DATA_PATH "/various-sizes", 0);
+	ioeta_calculate_async(estim, TEST_DATA_PATH "/existing-files", 0);
+	ioeta_wait(estim);
+
+	assert_int_equal(10, estim->total_items);
+	assert_int_equal(0, estim->current_item);
+	assert_int_equal(73728, estim->total_bytes);
+	assert_int_equal(0, estim->current_byte);
+
+	ioeta_free(estim);
+}
+
+TEST(async_estimation_is_merged_on_update)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_calculate_async(estim, TEST_DATA_PATH "/various-sizes", 0);
+	ioeta_update(estim, "file", "file", 1, 100);
+	ioeta_wait(estim);
+
+	/* Processed item and bytes are absorbed by results of estimation. */
+	assert_int_equal(7, estim->total_items);
+	assert_int_equal(1, estim->current_item);
+	assert_int_equal(73728, estim->total_bytes);
+	assert_int_equal(100, estim->current_byte);
+
+	ioeta_free(estim);
+}
+
+TEST(async_estimation_can_be_freed_while_running)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+	ioeta_calculate_async(estim, TEST_DATA_PATH, 0);
+	ioeta_free(estim);
+}
+
+TEST(shallow_async_estimation_is_immediate)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_calculate_async(estim, TEST_DATA_PATH "/various-sizes", 1);
+
+	assert_int_equal(1, estim->total_items);
+	assert_int_equal(0, estim->total_bytes);
+	assert_null(estim->walker);
+
+	ioeta_free(estim);
+}
+
 #ifndef _WIN32
 
 TEST(symlink_calculated_as_zero_bytes)
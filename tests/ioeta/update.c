@@ -101,5 +101,16 @@ TEST(finished_update_increments_current_item)
 	assert_int_equal(prev + 1, estim->current_item);
 }
 
+TEST(batch_update_accounts_for_all_items_and_extends_totals)
+{
+	ioeta_update_batch(estim, "d", "w", 10, 1000);
+	assert_int_equal(10, estim->current_item);
+	assert_int_equal(1000, estim->current_byte);
+	assert_int_equal(10, estim->total_items);
+	assert_int_equal(1000, estim->total_bytes);
+	assert_string_equal("d", estim->item);
+	assert_string_equal("w", estim->target);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
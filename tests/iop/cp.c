@@ -6,15 +6,18 @@
 #endif
 #include <sys/stat.h> /* chmod() stat */
 #include <sys/types.h> /* stat */
-#include <unistd.h> /* _Exit() lstat() */
+#include <fcntl.h> /* O_CREAT O_WRONLY open() */
+#include <unistd.h> /* _Exit() close() ftruncate() lstat() pwrite() */
 
 #include <signal.h> /* SIGXFSZ SIG_IGN signal() */
+#include <stdio.h> /* FILE fclose() fopen() fputc() */
 #include <stdlib.h> /* EXIT_FAILURE EXIT_SUCCESS */
 
 #include <test-utils.h>
 
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 #include "../../src/utils/fs.h"
 
@@ -220,6 +223,100 @@ TEST(appending_works_for_files)
 	delete_test_file(SANDBOX_PATH "/appending");
 }
 
+TEST(copy_can_be_verified)
+{
+	const char *const src = TEST_DATA_PATH
+		"/various-sizes/double-block-size-plus-one-file";
+
+	io_args_t args = {
+		.arg1.src = src,
+		.arg2.dst = SANDBOX_PATH "/copy",
+		.arg4.verify = 1,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+	assert_true(files_are_identical(SANDBOX_PATH "/copy", src));
+
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(appending_can_be_verified)
+{
+	clone_test_file(TEST_DATA_PATH "/various-sizes/block-size-minus-one-file",
+			SANDBOX_PATH "/appending");
+	assert_success(chmod(SANDBOX_PATH "/appending", 0700));
+
+	io_args_t args = {
+		.arg1.src = TEST_DATA_PATH "/various-sizes/block-size-file",
+		.arg2.dst = SANDBOX_PATH "/appending",
+		.arg3.crs = IO_CRS_APPEND_TO_FILES,
+		.arg4.verify = 1,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+	assert_true(files_are_identical(SANDBOX_PATH "/appending",
+				TEST_DATA_PATH "/various-sizes/block-size-file"));
+
+	delete_test_file(SANDBOX_PATH "/appending");
+}
+
+/* Cancellation hook that damages the last byte of the copy once copying is
+ * over, i.e. while it's being verified. */
+static int
+corrupt_copy(void *arg)
+{
+	int *const size = arg;
+	if(*size != 0 && get_file_size(SANDBOX_PATH "/copy") == (uint64_t)*size)
+	{
+		const int fd = open(SANDBOX_PATH "/copy", O_WRONLY);
+		assert_true(fd != -1);
+		assert_int_equal(1, pwrite(fd, "b", 1, *size - 1));
+		close(fd);
+		*size = 0;
+	}
+	return 0;
+}
+
+/* CopyFileEx() path isn't verified on Windows. */
+TEST(mismatch_of_copy_is_reported, IF(not_windows))
+{
+	/* Several blocks of data, so that the damaged one is read after the first
+	 * check for cancellation during verification. */
+	int size = 100*1024 + 1;
+	FILE *const fp = fopen(SANDBOX_PATH "/src", "wb");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < size; ++i)
+	{
+		fputc('a', fp);
+	}
+	fclose(fp);
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/copy",
+		.arg4.verify = 1,
+
+		.cancellation.hook = &corrupt_copy,
+		.cancellation.arg = &size,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_FAILED, iop_cp(&args));
+	assert_int_equal(0, size);
+	assert_int_equal(1, args.result.errors.error_count);
+	assert_string_equal("Destination file doesn't match the source",
+			args.result.errors.errors[0].msg);
+	ioe_errlst_free(&args.result.errors);
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
 TEST(appending_does_not_shrink_files)
 {
 	uint64_t size;
@@ -511,6 +608,89 @@ TEST(socket_is_copied, IF(can_create_sockets))
 	assert_int_equal(0, args.result.errors.error_count);
 }
 
+TEST(sparse_file_is_copied_with_holes, IF(not_windows))
+{
+	enum { SIZE = 8*1024*1024 };
+
+	const int fd = open(SANDBOX_PATH "/sparse", O_WRONLY | O_CREAT, 0600);
+	assert_true(fd != -1);
+	assert_int_equal(4, pwrite(fd, "data", 4, 1024*1024));
+	assert_int_equal(4, pwrite(fd, "tail", 4, 3*1024*1024));
+	assert_success(ftruncate(fd, SIZE));
+	assert_success(close(fd));
+
+	struct stat src_st;
+	assert_success(stat(SANDBOX_PATH "/sparse", &src_st));
+
+	const io_cancellation_t no_cancellation = {};
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/sparse",
+		.arg2.dst = SANDBOX_PATH "/sparse-copy",
+		.arg4.verify = 1,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+		.result.errors = IOE_ERRLST_INIT,
+	};
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	/* Holes are accounted for in progress. */
+	assert_int_equal(SIZE, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/sparse",
+				SANDBOX_PATH "/sparse-copy"));
+
+	struct stat dst_st;
+	assert_success(stat(SANDBOX_PATH "/sparse-copy", &dst_st));
+	assert_int_equal(SIZE, dst_st.st_size);
+	if(src_st.st_blocks*512 < src_st.st_size)
+	{
+		/* Check holes only if file system supports them. */
+		assert_true(dst_st.st_blocks*512 < dst_st.st_size);
+	}
+
+	delete_test_file(SANDBOX_PATH "/sparse");
+	delete_test_file(SANDBOX_PATH "/sparse-copy");
+}
+
+TEST(file_is_copied_in_bulk_mode)
+{
+	enum { SIZE = 3*1024*1024 + 1 };
+
+	FILE *const f = fopen(SANDBOX_PATH "/big", "wb");
+	assert_non_null(f);
+	int i;
+	for(i = 0; i < SIZE; ++i)
+	{
+		assert_int_equal(i%251, fputc(i%251, f));
+	}
+	assert_success(fclose(f));
+
+	const io_cancellation_t no_cancellation = {};
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/big",
+		.arg2.dst = SANDBOX_PATH "/big-copy",
+		.arg4.bulk_copy = 1,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+		.result.errors = IOE_ERRLST_INIT,
+	};
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(SIZE, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/big",
+				SANDBOX_PATH "/big-copy"));
+
+	delete_test_file(SANDBOX_PATH "/big");
+	delete_test_file(SANDBOX_PATH "/big-copy");
+}
+
 TEST(append_truncates_destination_files_on_error, IF(not_windows))
 {
 	int status;
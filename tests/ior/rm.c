@@ -2,7 +2,10 @@
 
 #include <unistd.h> /* F_OK access() */
 
+#include <test-utils.h>
+
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/ior.h"
 #include "../../src/utils/fs.h"
 
@@ -65,5 +68,65 @@ TEST(non_empty_directory_is_removed)
 	assert_failure(access(DIRECTORY_NAME, F_OK));
 }
 
+TEST(tree_is_removed_and_progress_is_reported)
+{
+	const io_cancellation_t no_cancellation = {};
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	create_dir(DIRECTORY_NAME);
+	create_dir(DIRECTORY_NAME "/a");
+	create_dir(DIRECTORY_NAME "/a/a");
+	create_dir(DIRECTORY_NAME "/b");
+	create_dir(DIRECTORY_NAME "/c");
+	make_file(DIRECTORY_NAME "/file", "12345");
+	make_file(DIRECTORY_NAME "/a/file", "123");
+	make_file(DIRECTORY_NAME "/a/a/file", "1");
+	make_file(DIRECTORY_NAME "/b/file", "1");
+	create_file(DIRECTORY_NAME "/c/file");
+
+	{
+		io_args_t args = {
+			.arg1.path = DIRECTORY_NAME,
+			.estim = estim,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, ior_rm(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_failure(access(DIRECTORY_NAME, F_OK));
+
+	/* Five files and five directories. */
+	assert_int_equal(10, estim->current_item);
+	assert_int_equal(10, estim->current_byte);
+
+	ioeta_free(estim);
+}
+
+TEST(symbolic_links_to_directories_are_not_followed, IF(not_windows))
+{
+	create_dir(DIRECTORY_NAME);
+	create_dir(SANDBOX_PATH "/target");
+	create_file(SANDBOX_PATH "/target/file");
+	assert_success(make_symlink("../target", DIRECTORY_NAME "/link"));
+
+	{
+		io_args_t args = {
+			.arg1.path = DIRECTORY_NAME,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, ior_rm(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_failure(access(DIRECTORY_NAME, F_OK));
+	assert_success(access(SANDBOX_PATH "/target/file", F_OK));
+
+	remove_file(SANDBOX_PATH "/target/file");
+	remove_dir(SANDBOX_PATH "/target");
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -85,24 +85,24 @@ TEST(f)
 	char *expanded;
 
 	expanded = strdup("");
-	expanded = append_selected_files(&lwin, expanded, 0, 0, "", iter, 1);
+	expanded = append_selected_files(&lwin, NULL, expanded, 0, 0, "", iter, 1);
 	assert_string_equal("lfile0 lfile2", expanded);
 	free(expanded);
 
 	expanded = strdup("/");
-	expanded = append_selected_files(&lwin, expanded, 0, 0, "", iter, 1);
+	expanded = append_selected_files(&lwin, NULL, expanded, 0, 0, "", iter, 1);
 	assert_string_equal("/lfile0 lfile2", expanded);
 	free(expanded);
 
 	expanded = strdup("");
-	expanded = append_selected_files(&rwin, expanded, 0, 0, "", iter, 1);
+	expanded = append_selected_files(&rwin, NULL, expanded, 0, 0, "", iter, 1);
 	assert_string_equal(SL "rwin" SL "rfile1 " SL "rwin" SL "rfile3 "
 	                    SL "rwin" SL "rfile5 " SL "rwin" SL "rdir6",
 			expanded);
 	free(expanded);
 
 	expanded = strdup("/");
-	expanded = append_selected_files(&rwin, expanded, 0, 0, "", iter, 1);
+	expanded = append_selected_files(&rwin, NULL, expanded, 0, 0, "", iter, 1);
 	assert_string_equal("/" SL "rwin" SL "rfile1 " SL "rwin" SL "rfile3 "
 	                    SL "rwin" SL "rfile5 " SL "rwin" SL "rdir6",
 			expanded);
@@ -114,22 +114,22 @@ TEST(c)
 	char *expanded;
 
 	expanded = strdup("");
-	expanded = append_selected_files(&lwin, expanded, 1, 0, "", iter, 1);
+	expanded = append_selected_files(&lwin, NULL, expanded, 1, 0, "", iter, 1);
 	assert_string_equal("lfile2", expanded);
 	free(expanded);
 
 	expanded = strdup("/");
-	expanded = append_selected_files(&lwin, expanded, 1, 0, "", iter, 1);
+	expanded = append_selected_files(&lwin, NULL, expanded, 1, 0, "", iter, 1);
 	assert_string_equal("/lfile2", expanded);
 	free(expanded);
 
 	expanded = strdup("");
-	expanded = append_selected_files(&rwin, expanded, 1, 0, "", iter, 1);
+	expanded = append_selected_files(&rwin, NULL, expanded, 1, 0, "", iter, 1);
 	assert_string_equal("" SL "rwin" SL "rfile5", expanded);
 	free(expanded);
 
 	expanded = strdup("/");
-	expanded = append_selected_files(&rwin, expanded, 1, 0, "", iter, 1);
+	expanded = append_selected_files(&rwin, NULL, expanded, 1, 0, "", iter, 1);
 	assert_string_equal("/" SL "rwin" SL "rfile5", expanded);
 	free(expanded);
 }
@@ -6,6 +6,7 @@
 
 #include <test-utils.h>
 
+#include "../../src/cfg/config.h"
 #include "../../src/compat/pthread.h"
 #include "../../src/engine/var.h"
 #include "../../src/engine/variables.h"
@@ -18,7 +19,12 @@
 
 static void on_job_exit(struct bg_job_t *job, void *data);
 static void task(bg_op_t *bg_op, void *arg);
+static void counting_task(bg_op_t *bg_op, void *arg);
 static void wait_until_locked(pthread_spinlock_t *lock);
+static void release_task(pthread_spinlock_t locks[2]);
+static void * inc_done_thread(void *arg);
+
+static int counter;
 
 SETUP_ONCE()
 {
@@ -264,6 +270,117 @@ TEST(background_redirects_streams_properly, IF(not_windows))
 	assert_success(bg_and_wait_for_errors("echo a", &no_cancellation));
 }
 
+TEST(identical_waiting_tasks_are_merged)
+{
+	pthread_spinlock_t locks[2];
+	pthread_spin_init(&locks[0], PTHREAD_PROCESS_PRIVATE);
+	pthread_spin_init(&locks[1], PTHREAD_PROCESS_PRIVATE);
+
+	/* Only one task can run at a time with one thread. */
+	cfg.bg_threads = 1;
+	counter = 0;
+
+	assert_success(bg_execute("", "", 0, 0, &task, (void *)locks));
+	wait_until_locked(&locks[0]);
+
+	assert_int_equal(0, bg_execute_once("a", "", 0, 0, &counting_task, NULL));
+	assert_true(bg_execute_once("a", "", 0, 0, &counting_task, NULL) > 0);
+	assert_int_equal(0, bg_execute_once("b", "", 0, 0, &counting_task, NULL));
+
+	release_task(locks);
+	wait_for_bg();
+	assert_int_equal(2, counter);
+
+	cfg.bg_threads = 0;
+}
+
+TEST(operations_are_not_blocked_by_tasks)
+{
+	pthread_spinlock_t locks[2];
+	pthread_spin_init(&locks[0], PTHREAD_PROCESS_PRIVATE);
+	pthread_spin_init(&locks[1], PTHREAD_PROCESS_PRIVATE);
+
+	/* Tasks can occupy only one of two threads. */
+	cfg.bg_threads = 2;
+	counter = 0;
+
+	assert_success(bg_execute("", "", 0, 0, &task, (void *)locks));
+	wait_until_locked(&locks[0]);
+
+	assert_success(bg_execute("", "", 0, 0, &counting_task, NULL));
+	assert_success(bg_execute("", "", 0, 1, &counting_task, NULL));
+
+	int attempts = 0;
+	while(counter == 0 && ++attempts < 100)
+	{
+		usleep(5000);
+	}
+	assert_int_equal(1, counter);
+
+	release_task(locks);
+	wait_for_bg();
+	assert_int_equal(2, counter);
+
+	cfg.bg_threads = 0;
+}
+
+TEST(operations_on_the_same_device_are_serialized)
+{
+	pthread_spinlock_t locks[2];
+	pthread_spin_init(&locks[0], PTHREAD_PROCESS_PRIVATE);
+	pthread_spin_init(&locks[1], PTHREAD_PROCESS_PRIVATE);
+
+	const dev_t devs[] = { 1, 2 };
+
+	cfg.bg_threads = 4;
+	counter = 0;
+
+	assert_success(bg_execute_on("", "", 0, &devs[0], 1, &task, (void *)locks));
+	wait_until_locked(&locks[0]);
+
+	assert_success(bg_execute_on("same", "", 0, &devs[0], 1, &counting_task,
+				NULL));
+	assert_true(bg_job_is_queued(bg_jobs));
+	assert_success(bg_execute_on("other", "", 0, &devs[1], 1, &counting_task,
+				NULL));
+
+	int attempts = 0;
+	while(counter == 0 && ++attempts < 100)
+	{
+		usleep(5000);
+	}
+	usleep(5000);
+	assert_int_equal(1, counter);
+
+	release_task(locks);
+	wait_for_bg();
+	assert_int_equal(2, counter);
+
+	cfg.bg_threads = 0;
+}
+
+TEST(progress_counters_can_be_updated_concurrently)
+{
+	bg_op_t bg_op = { .progress = -1 };
+
+	pthread_t threads[4];
+	size_t i;
+	for(i = 0U; i < sizeof(threads)/sizeof(threads[0]); ++i)
+	{
+		assert_success(pthread_create(&threads[i], NULL, &inc_done_thread,
+					&bg_op));
+	}
+	for(i = 0U; i < sizeof(threads)/sizeof(threads[0]); ++i)
+	{
+		assert_success(pthread_join(threads[i], NULL));
+	}
+
+	assert_int_equal(4*1000, bg_op_get_done(&bg_op));
+	assert_int_equal(-1, bg_op_get_progress(&bg_op));
+	bg_op_set_progress(&bg_op, 50);
+	assert_int_equal(50, bg_op_get_progress(&bg_op));
+}
+
 static void
 task(bg_op_t *bg_op, void *arg)
 {
@@ -273,6 +390,23 @@ task(bg_op_t *bg_op, void *arg)
 	pthread_spin_unlock(&locks[0]);
 }
 
+static void
+counting_task(bg_op_t *bg_op, void *arg)
+{
+	++counter;
+}
+
+static void
+release_task(pthread_spinlock_t locks[2])
+{
+	pthread_spin_lock(&locks[1]);
+	pthread_spin_lock(&locks[0]);
+	pthread_spin_unlock(&locks[0]);
+	pthread_spin_unlock(&locks[1]);
+	pthread_spin_destroy(&locks[0]);
+	pthread_spin_destroy(&locks[1]);
+}
+
 static void
 wait_until_locked(pthread_spinlock_t *lock)
 {
@@ -284,5 +418,16 @@ wait_until_locked(pthread_spinlock_t *lock)
 	}
 }
 
+static void *
+inc_done_thread(void *arg)
+{
+	int i;
+	for(i = 0; i < 1000; ++i)
+	{
+		bg_op_inc_done(arg);
+	}
+	return NULL;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
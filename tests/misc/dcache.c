@@ -28,11 +28,11 @@ TEST(size_does_not_clobber_nitems)
 	uint64_t size;
 	uint64_t nitems;
 
-	dcache_set_at(TEST_DATA_PATH, 0, 10, 11);
-	dcache_set_at(TEST_DATA_PATH, 0, 13, DCACHE_UNKNOWN);
+	dcache_set_at(TEST_DATA_PATH, 0, 10, DCACHE_UNKNOWN, 11);
+	dcache_set_at(TEST_DATA_PATH, 0, 13, DCACHE_UNKNOWN, DCACHE_UNKNOWN);
 
 	/* Tests are executed fast, so decrease mtime. */
-	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, &nitems);
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, NULL, &nitems);
 	assert_ulong_equal(13, size);
 	assert_ulong_equal(11, nitems);
 }
@@ -42,11 +42,11 @@ TEST(nitems_does_not_clobber_size)
 	uint64_t size;
 	uint64_t nitems;
 
-	dcache_set_at(TEST_DATA_PATH, 0, 10, 11);
-	dcache_set_at(TEST_DATA_PATH, 0, DCACHE_UNKNOWN, 12);
+	dcache_set_at(TEST_DATA_PATH, 0, 10, DCACHE_UNKNOWN, 11);
+	dcache_set_at(TEST_DATA_PATH, 0, DCACHE_UNKNOWN, DCACHE_UNKNOWN, 12);
 
 	/* Tests are executed fast, so decrease mtime. */
-	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, &nitems);
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, NULL, &nitems);
 	assert_ulong_equal(10, size);
 	assert_ulong_equal(12, nitems);
 }
@@ -57,17 +57,17 @@ TEST(outdated_data_is_detected)
 
 	dir_entry_t entry = { .name = "read", .origin = TEST_DATA_PATH };
 
-	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, 11);
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN, 11);
 
 	/* Entry was updated *while* it was being cached. */
 	entry.mtime = time(NULL);
-	dcache_get_of(&entry, &size, &nitems);
+	dcache_get_of(&entry, &size, NULL, &nitems);
 	assert_false(size.is_valid);
 	assert_false(nitems.is_valid);
 
 	/* Entry was updated *after* it was cached. */
 	entry.mtime = time(NULL) + 1;
-	dcache_get_of(&entry, &size, &nitems);
+	dcache_get_of(&entry, &size, NULL, &nitems);
 	assert_false(size.is_valid);
 	assert_false(nitems.is_valid);
 }
@@ -79,13 +79,13 @@ TEST(can_query_one_parameter_at_a_time)
 		.name = "read", .origin = TEST_DATA_PATH, .type = FT_DIR
 	};
 
-	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, 11);
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN, 11);
 
-	dcache_get_of(&entry, &data, NULL);
+	dcache_get_of(&entry, &data, NULL, NULL);
 	assert_true(data.is_valid);
 	assert_ulong_equal(10, data.value);
 
-	dcache_get_of(&entry, NULL, &data);
+	dcache_get_of(&entry, NULL, NULL, &data);
 	assert_true(data.is_valid);
 	assert_ulong_equal(11, data.value);
 }
@@ -103,10 +103,11 @@ TEST(symlink_inode_resolution, IF(not_windows))
 
 	assert_success(make_symlink("dir", SANDBOX_PATH "/link"));
 
-	dcache_set_at(SANDBOX_PATH "/dir", s.st_ino, 10, DCACHE_UNKNOWN);
+	dcache_set_at(SANDBOX_PATH "/dir", s.st_ino, 10, DCACHE_UNKNOWN,
+			DCACHE_UNKNOWN);
 
 	dcache_result_t data;
-	dcache_get_of(&link_entry, &data, NULL);
+	dcache_get_of(&link_entry, &data, NULL, NULL);
 	assert_true(data.is_valid);
 	assert_ulong_equal(10, data.value);
 
@@ -114,6 +115,68 @@ TEST(symlink_inode_resolution, IF(not_windows))
 	remove_dir(SANDBOX_PATH "/dir");
 }
 
+TEST(dcache_can_be_saved_and_loaded)
+{
+	uint64_t size, nitems;
+
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN, 11);
+	dcache_set_at(TEST_DATA_PATH "/rename", 0, 12, DCACHE_UNKNOWN,
+			DCACHE_UNKNOWN);
+	assert_success(dcache_save(SANDBOX_PATH "/dcache"));
+
+	assert_success(stats_init(&cfg));
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0,
+			&size, NULL, &nitems);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	dcache_load_lazily(SANDBOX_PATH "/dcache");
+
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0,
+			&size, NULL, &nitems);
+	assert_ulong_equal(10, size);
+	assert_ulong_equal(11, nitems);
+	dcache_get_at(TEST_DATA_PATH "/rename", time(NULL) - 10, 0,
+			&size, NULL, &nitems);
+	assert_ulong_equal(12, size);
+	assert_ulong_equal(DCACHE_UNKNOWN, nitems);
+
+	remove_file(SANDBOX_PATH "/dcache");
+}
+
+TEST(loaded_dcache_does_not_override_newer_entries)
+{
+	uint64_t size, nitems;
+
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN, 11);
+	assert_success(dcache_save(SANDBOX_PATH "/dcache"));
+
+	assert_success(stats_init(&cfg));
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 20, DCACHE_UNKNOWN, DCACHE_UNKNOWN);
+	dcache_load_lazily(SANDBOX_PATH "/dcache");
+
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0,
+			&size, NULL, &nitems);
+	assert_ulong_equal(20, size);
+	assert_ulong_equal(11, nitems);
+
+	remove_file(SANDBOX_PATH "/dcache");
+}
+
+TEST(broken_dcache_file_is_ignored)
+{
+	uint64_t size;
+
+	make_file(SANDBOX_PATH "/dcache", "vifm-dcache-1 and garbage");
+
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN, DCACHE_UNKNOWN);
+	dcache_load_lazily(SANDBOX_PATH "/dcache");
+
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0, &size, NULL, NULL);
+	assert_ulong_equal(10, size);
+
+	remove_file(SANDBOX_PATH "/dcache");
+}
+
 /* dir_entry_t::inode doesn't exist on Windows. */
 #ifndef _WIN32
 
@@ -125,18 +188,48 @@ TEST(inode_is_taken_into_account)
 		.name = "read", .origin = TEST_DATA_PATH, .inode = 1, .type = FT_DIR
 	};
 
-	dcache_set_at(TEST_DATA_PATH "/read", 1, 10, 11);
+	dcache_set_at(TEST_DATA_PATH "/read", 1, 10, DCACHE_UNKNOWN, 11);
 
-	dcache_get_of(&entry, &size, &nitems);
+	dcache_get_of(&entry, &size, NULL, &nitems);
 	assert_true(size.is_valid);
 	assert_true(nitems.is_valid);
 
 	entry.inode = 2;
-	dcache_get_of(&entry, &size, &nitems);
+	dcache_get_of(&entry, &size, NULL, &nitems);
 	assert_false(size.is_valid);
 	assert_false(nitems.is_valid);
 }
 
+TEST(stale_loaded_entries_are_detected)
+{
+	dcache_result_t size;
+
+	dir_entry_t entry = {
+		.name = "read", .origin = TEST_DATA_PATH, .inode = 1, .type = FT_DIR
+	};
+
+	dcache_set_at(TEST_DATA_PATH "/read", 1, 10, DCACHE_UNKNOWN, DCACHE_UNKNOWN);
+	assert_success(dcache_save(SANDBOX_PATH "/dcache"));
+
+	assert_success(stats_init(&cfg));
+	dcache_load_lazily(SANDBOX_PATH "/dcache");
+
+	dcache_get_of(&entry, &size, NULL, NULL);
+	assert_true(size.is_valid);
+	assert_ulong_equal(10, size.value);
+
+	entry.inode = 2;
+	dcache_get_of(&entry, &size, NULL, NULL);
+	assert_false(size.is_valid);
+
+	entry.inode = 1;
+	entry.mtime = time(NULL) + 10;
+	dcache_get_of(&entry, &size, NULL, NULL);
+	assert_false(size.is_valid);
+
+	remove_file(SANDBOX_PATH "/dcache");
+}
+
 #endif
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -706,6 +706,30 @@ TEST(preview_macros_use_hint)
 	curr_stats.preview_hint = NULL;
 }
 
+TEST(macros_can_be_expanded_for_an_entry)
+{
+	const preview_area_t parea = {
+		.source = &lwin,
+		.view = &rwin,
+		.w = 3,
+		.h = 4,
+	};
+
+	MacroFlags flags;
+	char *expanded = ma_expand_for_entry("view %c %f %l %d %C %pw %ph %pu",
+			&lwin, &lwin.dir_entry[1], &parea, &flags);
+	assert_string_equal("view lfile1 lfile1  " SL "lwin "
+			SL "rwin" SL "rfile5 3 4 ", expanded);
+	assert_int_equal(MF_NO_CACHE, flags);
+	free(expanded);
+
+	/* State of the views isn't changed. */
+	assert_int_equal(2, lwin.list_pos);
+	assert_int_equal(2, lwin.selected_files);
+	assert_true(curr_view == &lwin);
+	assert_null(curr_stats.preview_hint);
+}
+
 TEST(preview_clear_cmd_gets_cut_off)
 {
 	lwin.window_cols = 20;
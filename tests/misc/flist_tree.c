@@ -15,6 +15,7 @@
 #include "../../src/ui/fileview.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/fs.h"
+#include "../../src/utils/fswatch.h"
 #include "../../src/utils/str.h"
 #include "../../src/utils/utils.h"
 #include "../../src/event_loop.h"
@@ -32,6 +33,7 @@ static void verify_tree_node(column_data_t *cdt, int idx,
 static void column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info);
 static int remove_selected(view_t *view, const dir_entry_t *entry, void *arg);
+static int using_inotify(void);
 
 static char cwd[PATH_MAX + 1], test_data[PATH_MAX + 1];
 
@@ -225,6 +227,81 @@ TEST(nested_directory_change_detection)
 	assert_success(rmdir(SANDBOX_PATH "/nested-dir"));
 }
 
+TEST(nested_directory_is_updated_in_place, IF(using_inotify))
+{
+	create_dir(SANDBOX_PATH "/nested-dir");
+	create_file(SANDBOX_PATH "/nested-dir/a");
+	create_dir(SANDBOX_PATH "/other");
+	create_file(SANDBOX_PATH "/other/x");
+
+	assert_success(load_tree(&lwin, SANDBOX_PATH, cwd));
+	assert_int_equal(4, lwin.list_rows);
+	lwin.dir_entry[1].selected = 1;
+	lwin.dir_entry[3].selected = 1;
+	lwin.selected_files = 2;
+	lwin.list_pos = 3;
+
+	/* Watches are set up. */
+	check_if_filelist_has_changed(&lwin);
+	(void)ui_view_query_scheduled_event(&lwin);
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_NONE, ui_view_query_scheduled_event(&lwin));
+
+	create_file(SANDBOX_PATH "/nested-dir/b");
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(&lwin));
+
+	assert_int_equal(5, lwin.list_rows);
+	validate_tree(&lwin);
+	assert_string_equal("nested-dir", lwin.dir_entry[0].name);
+	assert_string_equal("a", lwin.dir_entry[1].name);
+	assert_string_equal("b", lwin.dir_entry[2].name);
+	assert_string_equal("other", lwin.dir_entry[3].name);
+	assert_string_equal("x", lwin.dir_entry[4].name);
+
+	assert_int_equal(2, lwin.selected_files);
+	assert_true(lwin.dir_entry[1].selected);
+	assert_false(lwin.dir_entry[2].selected);
+	assert_true(lwin.dir_entry[4].selected);
+	assert_int_equal(4, lwin.list_pos);
+
+	remove_file(SANDBOX_PATH "/nested-dir/b");
+	remove_file(SANDBOX_PATH "/nested-dir/a");
+	remove_dir(SANDBOX_PATH "/nested-dir");
+	remove_file(SANDBOX_PATH "/other/x");
+	remove_dir(SANDBOX_PATH "/other");
+}
+
+TEST(nested_directories_are_unwatched_on_leaving_tree, IF(using_inotify))
+{
+	create_dir(SANDBOX_PATH "/nested-dir");
+	create_file(SANDBOX_PATH "/nested-dir/a");
+
+	assert_success(load_tree(&lwin, SANDBOX_PATH, cwd));
+	assert_int_equal(2, lwin.list_rows);
+
+	/* Watches are set up. */
+	check_if_filelist_has_changed(&lwin);
+	(void)ui_view_query_scheduled_event(&lwin);
+	check_if_filelist_has_changed(&lwin);
+	assert_true(lwin.tree_watched);
+
+	rn_leave(&lwin, 1);
+	assert_false(flist_custom_active(&lwin));
+	assert_false(lwin.tree_watched);
+
+	/* Changes of nested directories are of no interest anymore. */
+	create_file(SANDBOX_PATH "/nested-dir/b");
+	strlist_t changed_dirs = {};
+	assert_int_equal(FSWS_UNCHANGED,
+			fswatch_poll_dirs(lwin.watch, &changed_dirs));
+	assert_int_equal(0, changed_dirs.nitems);
+
+	remove_file(SANDBOX_PATH "/nested-dir/b");
+	remove_file(SANDBOX_PATH "/nested-dir/a");
+	remove_dir(SANDBOX_PATH "/nested-dir");
+}
+
 TEST(excluding_dir_in_tree_excludes_its_children)
 {
 	assert_success(os_mkdir(SANDBOX_PATH "/nested-dir", 0700));
@@ -678,5 +755,15 @@ remove_selected(view_t *view, const dir_entry_t *entry, void *arg)
 	return !entry->selected;
 }
 
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -300,6 +300,65 @@ TEST(filtering_and_nesting_limit)
 	assert_int_equal(2, lwin.list_rows);
 }
 
+TEST(filtering_loads_folds_of_lazy_tree)
+{
+	create_dir(SANDBOX_PATH "/a");
+	create_dir(SANDBOX_PATH "/a/nested");
+	create_file(SANDBOX_PATH "/a/nested/target");
+	create_dir(SANDBOX_PATH "/a/other");
+	create_file(SANDBOX_PATH "/a/other/file");
+	create_dir(SANDBOX_PATH "/b");
+
+	assert_success(load_lazy_tree(&lwin, SANDBOX_PATH, cwd));
+	assert_int_equal(2, lwin.list_rows);
+
+	/* Typing the filter doesn't look into folds. */
+	assert_int_equal(1, local_filter_set(&lwin, "target"));
+	local_filter_accept(&lwin, /*update_history=*/1);
+	load_view(&lwin);
+	validate_tree(&lwin);
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_string_equal("target", lwin.dir_entry[0].name);
+
+	local_filter_remove(&lwin);
+	load_view(&lwin);
+	validate_tree(&lwin);
+
+	/* Only folds on the way to the match are opened. */
+	assert_int_equal(5, lwin.list_rows);
+	assert_string_equal("nested", lwin.dir_entry[1].name);
+	assert_false(lwin.dir_entry[1].folded);
+	assert_string_equal("other", lwin.dir_entry[3].name);
+	assert_true(lwin.dir_entry[3].folded);
+
+	remove_file(SANDBOX_PATH "/a/other/file");
+	remove_dir(SANDBOX_PATH "/a/other");
+	remove_file(SANDBOX_PATH "/a/nested/target");
+	remove_dir(SANDBOX_PATH "/a/nested");
+	remove_dir(SANDBOX_PATH "/a");
+	remove_dir(SANDBOX_PATH "/b");
+}
+
+TEST(applying_filter_loads_folds_of_lazy_tree)
+{
+	create_dir(SANDBOX_PATH "/a");
+	create_file(SANDBOX_PATH "/a/target");
+
+	assert_success(load_lazy_tree(&lwin, SANDBOX_PATH, cwd));
+	assert_int_equal(1, lwin.list_rows);
+
+	local_filter_apply(&lwin, "target");
+	load_view(&lwin);
+	validate_tree(&lwin);
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_string_equal("target", lwin.dir_entry[0].name);
+
+	remove_file(SANDBOX_PATH "/a/target");
+	remove_dir(SANDBOX_PATH "/a");
+}
+
 static void
 column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info)
@@ -15,6 +15,7 @@
 #include "../../src/filelist.h"
 #include "../../src/filtering.h"
 #include "../../src/running.h"
+#include "../../src/search.h"
 #include "../../src/sort.h"
 
 #include "utils.h"
@@ -23,6 +24,7 @@ static void column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info);
 static int build_custom_view(view_t *view, ...);
 static void toggle_fold_and_update(view_t *view);
+static void set_pos(int pos);
 
 static char cwd[PATH_MAX + 1];
 
@@ -433,6 +435,47 @@ TEST(lazy_unfolding_and_filtering)
 	assert_int_equal(2, lwin.list_rows);
 }
 
+TEST(unfolding_lists_only_the_directory)
+{
+	create_dir(SANDBOX_PATH "/a");
+	create_dir(SANDBOX_PATH "/a/nested");
+	create_file(SANDBOX_PATH "/a/nested/file");
+	create_file(SANDBOX_PATH "/a/file");
+	create_dir(SANDBOX_PATH "/b");
+
+	assert_success(load_limited_tree(&lwin, SANDBOX_PATH, cwd, 0));
+	assert_int_equal(2, lwin.list_rows);
+
+	/* Isn't picked up, because the tree isn't rebuilt. */
+	create_file(SANDBOX_PATH "/c");
+
+	lwin.list_pos = 0;
+	assert_string_equal("a", lwin.dir_entry[lwin.list_pos].name);
+	toggle_fold_and_update(&lwin);
+	assert_int_equal(4, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_false(lwin.dir_entry[0].folded);
+	assert_string_equal("nested", lwin.dir_entry[1].name);
+	assert_true(lwin.dir_entry[1].folded);
+	assert_string_equal("file", lwin.dir_entry[2].name);
+	assert_string_equal("b", lwin.dir_entry[3].name);
+
+	lwin.list_pos = 1;
+	toggle_fold_and_update(&lwin);
+	assert_int_equal(5, lwin.list_rows);
+	assert_string_equal("file", lwin.dir_entry[2].name);
+	assert_int_equal(1, lwin.dir_entry[2].child_pos);
+	assert_int_equal(3, lwin.dir_entry[0].child_count);
+	assert_int_equal(3, lwin.dir_entry[3].child_pos);
+
+	remove_file(SANDBOX_PATH "/c");
+	remove_file(SANDBOX_PATH "/a/file");
+	remove_file(SANDBOX_PATH "/a/nested/file");
+	remove_dir(SANDBOX_PATH "/a/nested");
+	remove_dir(SANDBOX_PATH "/a");
+	remove_dir(SANDBOX_PATH "/b");
+}
+
 TEST(folding_is_reset_on_leaving_tree)
 {
 	assert_success(load_limited_tree(&lwin, TEST_DATA_PATH "/tree", cwd,
@@ -449,6 +492,68 @@ TEST(folding_is_reset_on_leaving_tree)
 	flist_toggle_fold(&lwin);
 }
 
+TEST(search_loads_folds_of_lazy_tree)
+{
+	create_dir(SANDBOX_PATH "/a");
+	create_dir(SANDBOX_PATH "/a/nested");
+	create_file(SANDBOX_PATH "/a/nested/target");
+	create_dir(SANDBOX_PATH "/a/other");
+	create_file(SANDBOX_PATH "/a/other/file");
+	create_dir(SANDBOX_PATH "/b");
+
+	assert_success(load_lazy_tree(&lwin, SANDBOX_PATH, cwd));
+	assert_int_equal(2, lwin.list_rows);
+
+	/* Typing the pattern doesn't look into folds. */
+	int found;
+	(void)search_find(&lwin, "target", /*backward=*/0, /*stash_selection=*/0,
+			/*select_matches=*/0, /*count=*/1, &set_pos, /*print_msg=*/0, &found);
+	assert_false(found);
+	assert_int_equal(2, lwin.list_rows);
+
+	(void)search_find(&lwin, "target", /*backward=*/0, /*stash_selection=*/0,
+			/*select_matches=*/0, /*count=*/1, &set_pos, /*print_msg=*/1, &found);
+	assert_true(found);
+	validate_tree(&lwin);
+
+	/* Only folds on the way to the match are opened. */
+	assert_int_equal(5, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("nested", lwin.dir_entry[1].name);
+	assert_false(lwin.dir_entry[1].folded);
+	assert_string_equal("target", lwin.dir_entry[2].name);
+	assert_string_equal("other", lwin.dir_entry[3].name);
+	assert_true(lwin.dir_entry[3].folded);
+	assert_string_equal("b", lwin.dir_entry[4].name);
+	assert_true(lwin.dir_entry[4].folded);
+	assert_int_equal(2, lwin.list_pos);
+
+	remove_file(SANDBOX_PATH "/a/other/file");
+	remove_dir(SANDBOX_PATH "/a/other");
+	remove_file(SANDBOX_PATH "/a/nested/target");
+	remove_dir(SANDBOX_PATH "/a/nested");
+	remove_dir(SANDBOX_PATH "/a");
+	remove_dir(SANDBOX_PATH "/b");
+}
+
+TEST(search_does_not_load_folds_of_depth_limited_tree)
+{
+	create_dir(SANDBOX_PATH "/a");
+	create_file(SANDBOX_PATH "/a/target");
+
+	assert_success(load_limited_tree(&lwin, SANDBOX_PATH, cwd, 0));
+	assert_int_equal(1, lwin.list_rows);
+
+	int found;
+	(void)search_find(&lwin, "target", /*backward=*/0, /*stash_selection=*/0,
+			/*select_matches=*/0, /*count=*/1, &set_pos, /*print_msg=*/1, &found);
+	assert_false(found);
+	assert_int_equal(1, lwin.list_rows);
+
+	remove_file(SANDBOX_PATH "/a/target");
+	remove_dir(SANDBOX_PATH "/a");
+}
+
 static void
 column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info)
@@ -491,5 +596,11 @@ toggle_fold_and_update(view_t *view)
 	validate_tree(&lwin);
 }
 
+static void
+set_pos(int pos)
+{
+	lwin.list_pos = pos;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -1,26 +1,44 @@
 #include <stic.h>
 
+#include <sys/stat.h> /* stat */
+#include <sys/time.h> /* timeval utimes() */
 #include <unistd.h> /* chdir() */
 
 #include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* fclose() fopen() free() remove() */
 #include <string.h> /* strcpy() */
+#include <time.h> /* time() */
+
+#include <test-utils.h>
 
 #include "../../src/cfg/config.h"
+#include "../../src/compat/os.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/str.h"
 #include "../../src/bmarks.h"
 #include "../../src/cmd_core.h"
 #include "../../src/ops.h"
+#include "../../src/status.h"
 
 static void bmarks_cb(const char p[], const char t[], time_t timestamp,
 		void *arg);
+static void make_old(const char path[]);
 
 static char *path;
 
 SETUP_ONCE()
 {
 	cfg.use_system_calls = 1;
+	update_string(&cfg.shell, "");
+	update_string(&cfg.delete_prg, "");
+	assert_success(stats_init(&cfg));
+}
+
+TEARDOWN_ONCE()
+{
+	update_string(&cfg.shell, NULL);
+	update_string(&cfg.delete_prg, NULL);
 }
 
 SETUP()
@@ -63,6 +81,98 @@ TEST(rename_triggers_bmark_update)
 	assert_success(remove("new"));
 }
 
+TEST(ops_update_cached_sizes_of_parents, IF(not_windows))
+{
+	uint64_t size, alloc, nitems;
+	struct stat top_st, dir_st, file_st;
+
+	create_dir(SANDBOX_PATH "/top");
+	create_dir(SANDBOX_PATH "/top/dir");
+	make_file(SANDBOX_PATH "/file", "0123456789");
+	make_old(SANDBOX_PATH "/top");
+	make_old(SANDBOX_PATH "/top/dir");
+
+	assert_success(os_stat(SANDBOX_PATH "/top", &top_st));
+	assert_success(os_stat(SANDBOX_PATH "/top/dir", &dir_st));
+	assert_success(dcache_set_at(SANDBOX_PATH "/top", top_st.st_ino, 100, 200,
+				1));
+	assert_success(dcache_set_at(SANDBOX_PATH "/top/dir", dir_st.st_ino, 100,
+				200, 0));
+
+	assert_int_equal(OPS_SUCCEEDED, perform_operation(OP_COPY, NULL, NULL,
+				SANDBOX_PATH "/file", SANDBOX_PATH "/top/dir/file"));
+	assert_success(os_stat(SANDBOX_PATH "/top/dir/file", &file_st));
+	const uint64_t file_alloc = (uint64_t)file_st.st_blocks*512U;
+
+	/* Directory was changed and tests are executed fast, so decrease mtime. */
+	dcache_get_at(SANDBOX_PATH "/top/dir", time(NULL) - 10, dir_st.st_ino, &size,
+			&alloc, &nitems);
+	assert_ulong_equal(110, size);
+	assert_ulong_equal(200 + file_alloc, alloc);
+	assert_ulong_equal(1, nitems);
+
+	/* Parent is still valid without any adjustments of its timestamp. */
+	dcache_get_at(SANDBOX_PATH "/top", top_st.st_mtime, top_st.st_ino, &size,
+			&alloc, &nitems);
+	assert_ulong_equal(110, size);
+	assert_ulong_equal(200 + file_alloc, alloc);
+	assert_ulong_equal(1, nitems);
+
+	/* Changes within the same second as caching make cache invalid. */
+	make_old(SANDBOX_PATH "/top/dir");
+
+	assert_int_equal(OPS_SUCCEEDED, perform_operation(OP_REMOVESL, NULL, NULL,
+				SANDBOX_PATH "/top/dir/file", NULL));
+
+	dcache_get_at(SANDBOX_PATH "/top/dir", time(NULL) - 10, dir_st.st_ino, &size,
+			&alloc, &nitems);
+	assert_ulong_equal(100, size);
+	assert_ulong_equal(200, alloc);
+	assert_ulong_equal(0, nitems);
+
+	dcache_get_at(SANDBOX_PATH "/top", top_st.st_mtime, top_st.st_ino, &size,
+			&alloc, &nitems);
+	assert_ulong_equal(100, size);
+	assert_ulong_equal(200, alloc);
+
+	remove_file(SANDBOX_PATH "/file");
+	remove_dir(SANDBOX_PATH "/top/dir");
+	remove_dir(SANDBOX_PATH "/top");
+}
+
+TEST(stale_parents_are_not_updated, IF(not_windows))
+{
+	uint64_t size, nitems;
+	struct stat st;
+
+	create_dir(SANDBOX_PATH "/dir");
+	assert_success(os_stat(SANDBOX_PATH "/dir", &st));
+	assert_success(dcache_set_at(SANDBOX_PATH "/dir", st.st_ino, 100, 100, 5));
+	/* Make cache older than the directory. */
+	make_file(SANDBOX_PATH "/dir/old", "");
+
+	assert_int_equal(OPS_SUCCEEDED, perform_operation(OP_MKFILE, NULL, NULL,
+				SANDBOX_PATH "/dir/file", NULL));
+
+	dcache_get_at(SANDBOX_PATH "/dir", time(NULL) - 10, st.st_ino, &size, NULL,
+			&nitems);
+	assert_ulong_equal(100, size);
+	assert_ulong_equal(5, nitems);
+
+	remove_file(SANDBOX_PATH "/dir/file");
+	remove_file(SANDBOX_PATH "/dir/old");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+/* Moves modification time of a file into the past. */
+static void
+make_old(const char path[])
+{
+	struct timeval tv[2] = { { .tv_sec = time(NULL) - 100 } };
+	tv[1] = tv[0];
+	assert_success(utimes(path, tv));
+}
+
 static void
 bmarks_cb(const char p[], const char t[], time_t timestamp, void *arg)
 {
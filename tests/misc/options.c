@@ -665,11 +665,47 @@ TEST(previewoptions)
 	assert_int_equal(10, cfg.max_tree_depth);
 	assert_false(cfg.hard_graphics_clear);
 
+	assert_success(cmds_dispatch("set previewoptions=diskcache:64,maxtreedepth:2",
+				&lwin, CIT_COMMAND));
+	assert_int_equal(64, cfg.preview_cache_size);
+	assert_int_equal(2, cfg.max_tree_depth);
+	assert_string_equal("maxtreedepth:2,diskcache:64,",
+			vle_opts_get("previewoptions", OPT_GLOBAL));
+
+	assert_failure(cmds_dispatch("set previewoptions=diskcache:-1", &lwin,
+				CIT_COMMAND));
+	assert_string_equal("\"diskcache\" can't be negative, got: -1",
+			vle_tb_get_data(vle_err));
+	assert_int_equal(64, cfg.preview_cache_size);
+
+	assert_success(cmds_dispatch("set previewoptions=prefetch:3", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(3, cfg.preview_prefetch);
+	assert_int_equal(0, cfg.preview_cache_size);
+	assert_failure(cmds_dispatch("set previewoptions=prefetch:x", &lwin,
+				CIT_COMMAND));
+	assert_string_equal("Failed to parse \"prefetch\" value: x",
+			vle_tb_get_data(vle_err));
+	assert_int_equal(3, cfg.preview_prefetch);
+
+	assert_success(cmds_dispatch("set previewoptions=viewerdelay:200", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(200, cfg.viewer_delay);
+	assert_int_equal(0, cfg.preview_prefetch);
+	assert_failure(cmds_dispatch("set previewoptions=viewerdelay:-1", &lwin,
+				CIT_COMMAND));
+	assert_string_equal("\"viewerdelay\" can't be negative, got: -1",
+			vle_tb_get_data(vle_err));
+	assert_int_equal(200, cfg.viewer_delay);
+
 	assert_success(cmds_dispatch("set previewoptions=", &lwin, CIT_COMMAND));
 	assert_int_equal(0, cfg.graphics_delay);
 	assert_false(cfg.hard_graphics_clear);
 	assert_int_equal(0, cfg.max_tree_depth);
 	assert_false(cfg.top_tree_stats);
+	assert_int_equal(0, cfg.preview_cache_size);
+	assert_int_equal(0, cfg.preview_prefetch);
+	assert_int_equal(0, cfg.viewer_delay);
 }
 
 TEST(autocd)
@@ -690,6 +726,21 @@ TEST(iooptions)
 	assert_success(cmds_dispatch("set iooptions=datasync", &lwin, CIT_COMMAND));
 	assert_false(cfg.fast_file_cloning);
 	assert_true(cfg.data_sync);
+	assert_false(cfg.bulk_copy);
+
+	assert_success(cmds_dispatch("set iooptions=bulkcopy", &lwin, CIT_COMMAND));
+	assert_false(cfg.data_sync);
+	assert_true(cfg.bulk_copy);
+	assert_false(cfg.journal_ops);
+
+	assert_success(cmds_dispatch("set iooptions=journal", &lwin, CIT_COMMAND));
+	assert_false(cfg.bulk_copy);
+	assert_true(cfg.journal_ops);
+	assert_false(cfg.verify_copies);
+
+	assert_success(cmds_dispatch("set iooptions=verify", &lwin, CIT_COMMAND));
+	assert_false(cfg.journal_ops);
+	assert_true(cfg.verify_copies);
 }
 
 TEST(mouse)
@@ -314,18 +314,20 @@ TEST(sorting_uses_dcache_for_dirs)
 
 	view_set_sort(lwin.sort, SK_BY_SIZE, SK_NONE);
 
-	assert_success(dcache_set_at(TEST_DATA_PATH "/read", 1, 10, DCACHE_UNKNOWN));
-	assert_success(dcache_set_at(TEST_DATA_PATH "/rename", 2, 100,
+	assert_success(dcache_set_at(TEST_DATA_PATH "/read", 1, 10, DCACHE_UNKNOWN,
 				DCACHE_UNKNOWN));
+	assert_success(dcache_set_at(TEST_DATA_PATH "/rename", 2, 100,
+				DCACHE_UNKNOWN, DCACHE_UNKNOWN));
 
 	sort_view(&lwin);
 
 	assert_string_equal("read", lwin.dir_entry[0].name);
 	assert_string_equal("rename", lwin.dir_entry[1].name);
 
-	assert_success(dcache_set_at(TEST_DATA_PATH "/rename", 2, 10,
+	assert_success(dcache_set_at(TEST_DATA_PATH "/rename", 2, 10, DCACHE_UNKNOWN,
+				DCACHE_UNKNOWN));
+	assert_success(dcache_set_at(TEST_DATA_PATH "/read", 1, 100, DCACHE_UNKNOWN,
 				DCACHE_UNKNOWN));
-	assert_success(dcache_set_at(TEST_DATA_PATH "/read", 1, 100, DCACHE_UNKNOWN));
 
 	sort_view(&lwin);
 
@@ -0,0 +1,399 @@
+#include <stic.h>
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputs() fwrite() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() */
+
+#include <test-utils.h>
+
+#include "../../src/text_index.h"
+
+#include <regex.h> /* REG_EXTENDED REG_ICASE */
+
+static void line_is(text_index_t *tidx, int n, const char expected[]);
+static void wait_search(tidx_search_t *search);
+static void append_text(const char text[]);
+
+TEST(missing_file_is_an_error)
+{
+	assert_null(tidx_open(SANDBOX_PATH "/no-such-file"));
+}
+
+TEST(empty_file_has_no_lines)
+{
+	create_file(SANDBOX_PATH "/file");
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+	assert_int_equal(0, tidx_wait(tidx, 1));
+	assert_null(tidx_get(tidx, 0));
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(lines_are_split_like_by_builtin_viewer)
+{
+	make_file(SANDBOX_PATH "/file", "\xef\xbb\xbf" "a\r\nb\n\nc");
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+	assert_int_equal(4, tidx_wait(tidx, 100));
+
+	int complete;
+	assert_int_equal(4, tidx_count(tidx, &complete));
+	assert_true(complete);
+
+	line_is(tidx, 0, "a");
+	line_is(tidx, 1, "b");
+	line_is(tidx, 2, "");
+	line_is(tidx, 3, "c");
+	assert_null(tidx_get(tidx, 4));
+	assert_null(tidx_get(tidx, -1));
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(waiting_can_be_limited_in_time)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < 1000; ++i)
+	{
+		fprintf(fp, "line %d\n", i);
+	}
+	fclose(fp);
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+
+	int nlines;
+	do
+	{
+		nlines = tidx_wait_for(tidx, 1000, 10);
+		assert_true(nlines <= 1000);
+	}
+	while(nlines < 1000);
+
+	assert_int_equal(1000, tidx_wait_for(tidx, 2000, 10));
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(lines_can_be_retrieved_in_any_order)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < 1000; ++i)
+	{
+		fprintf(fp, "line %d\n", i);
+	}
+	fclose(fp);
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+	assert_int_equal(1000, tidx_wait(tidx, 1000));
+
+	line_is(tidx, 999, "line 999");
+	line_is(tidx, 0, "line 0");
+	line_is(tidx, 500, "line 500");
+	line_is(tidx, 501, "line 501");
+	line_is(tidx, 64, "line 64");
+	line_is(tidx, 63, "line 63");
+	assert_null(tidx_get(tidx, 1000));
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(index_can_be_freed_while_indexing)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < 100000; ++i)
+	{
+		fprintf(fp, "%d\n", i);
+	}
+	fclose(fp);
+
+	tidx_free(tidx_open(SANDBOX_PATH "/file"));
+	tidx_free(NULL);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(appended_lines_are_picked_up)
+{
+	make_file(SANDBOX_PATH "/file", "a\nb");
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+	assert_int_equal(2, tidx_wait(tidx, 100));
+	assert_success(tidx_extend(tidx));
+	assert_int_equal(2, tidx_wait(tidx, 100));
+
+	append_text("c\nd\n");
+	assert_success(tidx_extend(tidx));
+	assert_int_equal(3, tidx_wait(tidx, 100));
+	line_is(tidx, 1, "bc");
+	line_is(tidx, 2, "d");
+
+	append_text("e");
+	assert_success(tidx_extend(tidx));
+	assert_int_equal(4, tidx_wait(tidx, 100));
+	line_is(tidx, 3, "e");
+
+	int complete;
+	assert_int_equal(4, tidx_count(tidx, &complete));
+	assert_true(complete);
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(truncation_is_detected)
+{
+	make_file(SANDBOX_PATH "/file", "a\nb\n");
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+	assert_int_equal(2, tidx_wait(tidx, 100));
+
+	make_file(SANDBOX_PATH "/file", "c\n");
+	assert_failure(tidx_extend(tidx));
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(invalid_pattern_is_an_error)
+{
+	make_file(SANDBOX_PATH "/file", "a\n");
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+	assert_null(tidx_search_start(tidx, "a[", REG_EXTENDED));
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(lines_are_matched_like_by_builtin_viewer)
+{
+	make_file(SANDBOX_PATH "/file", "\xef\xbb\xbf" "abc\r\nab\r\nxbz\n\nAB\nb");
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+
+	tidx_search_t *search = tidx_search_start(tidx, "b$", REG_EXTENDED);
+	assert_non_null(search);
+	wait_search(search);
+	assert_int_equal(1, tidx_search_find(search, -1, 0));
+	assert_int_equal(5, tidx_search_find(search, 1, 0));
+	assert_int_equal(-1, tidx_search_find(search, 5, 0));
+	assert_int_equal(1, tidx_search_find(search, 5, 1));
+	assert_int_equal(-1, tidx_search_find(search, 1, 1));
+	tidx_search_free(search);
+
+	search = tidx_search_start(tidx, "ab", REG_EXTENDED | REG_ICASE);
+	assert_non_null(search);
+	wait_search(search);
+	assert_int_equal(4, tidx_search_find(search, 1, 0));
+	tidx_search_free(search);
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(literals_are_found)
+{
+	make_file(SANDBOX_PATH "/file", "\xef\xbb\xbf" "abc\r\nab\r\nxbz\n\nAB\nb");
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+
+	tidx_search_t *search = tidx_search_start(tidx, "b", REG_EXTENDED);
+	assert_non_null(search);
+	wait_search(search);
+	assert_int_equal(0, tidx_search_find(search, -1, 0));
+	assert_int_equal(1, tidx_search_find(search, 0, 0));
+	assert_int_equal(2, tidx_search_find(search, 1, 0));
+	assert_int_equal(5, tidx_search_find(search, 2, 0));
+	assert_int_equal(-1, tidx_search_find(search, 5, 0));
+	assert_int_equal(2, tidx_search_find(search, 5, 1));
+	assert_int_equal(-1, tidx_search_find(search, 0, 1));
+	tidx_search_free(search);
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(search_crosses_chunks)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < 300000; ++i)
+	{
+		fprintf(fp, "line %d\n", i);
+	}
+	fclose(fp);
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+
+	const char *const patterns[] = { "99999", "9{5}" };
+	for(i = 0; i < 2; ++i)
+	{
+		tidx_search_t *const search =
+			tidx_search_start(tidx, patterns[i], REG_EXTENDED);
+		assert_non_null(search);
+		wait_search(search);
+		assert_int_equal(99999, tidx_search_find(search, -1, 0));
+		assert_int_equal(199999, tidx_search_find(search, 99999, 0));
+		assert_int_equal(299999, tidx_search_find(search, 199999, 0));
+		assert_int_equal(-1, tidx_search_find(search, 299999, 0));
+		assert_int_equal(199999, tidx_search_find(search, 299999, 1));
+		tidx_search_free(search);
+	}
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(beginning_of_too_long_line_is_matched)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	static char line[3*1024*1024];
+	memset(line, 'a', sizeof(line));
+	line[0] = 'b';
+	fwrite(line, 1, sizeof(line), fp);
+	fputs("\nb\nc\n", fp);
+	fclose(fp);
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+
+	tidx_search_t *search = tidx_search_start(tidx, "b", REG_EXTENDED);
+	assert_non_null(search);
+	wait_search(search);
+	assert_int_equal(0, tidx_search_find(search, -1, 0));
+	assert_int_equal(1, tidx_search_find(search, 0, 0));
+	assert_int_equal(-1, tidx_search_find(search, 1, 0));
+	tidx_search_free(search);
+
+	search = tidx_search_start(tidx, "^c", REG_EXTENDED);
+	assert_non_null(search);
+	wait_search(search);
+	assert_int_equal(2, tidx_search_find(search, -1, 0));
+	tidx_search_free(search);
+
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(search_can_be_freed_while_searching)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < 100000; ++i)
+	{
+		fprintf(fp, "%d\n", i);
+	}
+	fclose(fp);
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+	tidx_search_free(tidx_search_start(tidx, "1", REG_EXTENDED));
+	tidx_search_free(NULL);
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(search_is_continued_over_appended_lines)
+{
+	make_file(SANDBOX_PATH "/file", "needle\nb");
+
+	text_index_t *const tidx = tidx_open(SANDBOX_PATH "/file");
+	assert_non_null(tidx);
+	assert_int_equal(2, tidx_wait(tidx, 100));
+
+	tidx_search_t *const re_search = tidx_search_start(tidx, "^b$",
+			REG_EXTENDED);
+	tidx_search_t *const lit_search = tidx_search_start(tidx, "needle",
+			REG_EXTENDED);
+	assert_non_null(re_search);
+	assert_non_null(lit_search);
+	wait_search(re_search);
+	wait_search(lit_search);
+	assert_int_equal(1, tidx_search_find(re_search, 0, 0));
+	assert_int_equal(-1, tidx_search_find(lit_search, 0, 0));
+
+	append_text("needle\nb\nneedle");
+	assert_success(tidx_extend(tidx));
+	assert_success(tidx_search_extend(re_search, tidx));
+	assert_success(tidx_search_extend(lit_search, tidx));
+	wait_search(re_search);
+	wait_search(lit_search);
+
+	/* The last line is matched anew. */
+	assert_int_equal(2, tidx_search_find(re_search, 0, 0));
+	assert_int_equal(-1, tidx_search_find(re_search, 2, 0));
+
+	assert_int_equal(1, tidx_search_find(lit_search, 0, 0));
+	assert_int_equal(3, tidx_search_find(lit_search, 1, 0));
+	assert_int_equal(-1, tidx_search_find(lit_search, 3, 0));
+
+	tidx_search_free(re_search);
+	tidx_search_free(lit_search);
+	tidx_free(tidx);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+static void
+line_is(text_index_t *tidx, int n, const char expected[])
+{
+	char *const line = tidx_get(tidx, n);
+	assert_string_equal(expected, line);
+	free(line);
+}
+
+/* Appends text to the test file. */
+static void
+append_text(const char text[])
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "a");
+	assert_non_null(fp);
+	fputs(text, fp);
+	fclose(fp);
+}
+
+/* Waits for the search to finish. */
+static void
+wait_search(tidx_search_t *search)
+{
+	while(!tidx_search_wait(search, 10))
+	{
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
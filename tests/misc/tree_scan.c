@@ -0,0 +1,119 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL */
+#include <string.h> /* strcmp() */
+
+#include <test-utils.h>
+
+#include "../../src/tree_scan.h"
+
+static const tree_scan_entry_t * find_entry(const tree_scan_list_t *list,
+		const char name[]);
+
+static tree_scan_t *ts;
+
+SETUP()
+{
+	ts = tree_scan_alloc();
+	assert_non_null(ts);
+}
+
+TEARDOWN()
+{
+	tree_scan_free(ts);
+}
+
+TEST(missing_directory_is_an_error)
+{
+	tree_scan_list_t list;
+	tree_scan_list(SANDBOX_PATH "/no-such-dir", &list);
+	assert_int_equal(-1, list.count);
+	tree_scan_free_list(&list);
+}
+
+TEST(queued_listing_is_retrieved)
+{
+	tree_scan_job_t *const job = tree_scan_queue(ts, TEST_DATA_PATH "/tree");
+	assert_non_null(job);
+
+	tree_scan_list_t list;
+	tree_scan_wait(ts, job, &list);
+	assert_int_equal(3, list.count);
+
+	const tree_scan_entry_t *const dir1 = find_entry(&list, "dir1");
+	assert_non_null(dir1);
+	assert_true(dir1->is_dir);
+	assert_false(dir1->is_link);
+
+	tree_scan_free_list(&list);
+}
+
+TEST(types_of_entries_are_determined, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/dir");
+	create_file(SANDBOX_PATH "/file");
+	assert_success(make_symlink("dir", SANDBOX_PATH "/dir-link"));
+
+	tree_scan_list_t list;
+	tree_scan_list(SANDBOX_PATH, &list);
+	assert_int_equal(3, list.count);
+
+	const tree_scan_entry_t *entry = find_entry(&list, "dir");
+	assert_true(entry->is_dir);
+	assert_false(entry->is_link);
+	assert_true(entry->has_stat);
+
+	entry = find_entry(&list, "file");
+	assert_false(entry->is_dir);
+	assert_false(entry->is_link);
+	assert_true(entry->has_stat);
+
+	entry = find_entry(&list, "dir-link");
+	assert_true(entry->is_dir);
+	assert_true(entry->is_link);
+	assert_true(entry->has_stat);
+
+	tree_scan_free_list(&list);
+
+	remove_file(SANDBOX_PATH "/dir-link");
+	remove_file(SANDBOX_PATH "/file");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+TEST(listings_can_be_dropped)
+{
+	int i;
+	for(i = 0; i < 100; ++i)
+	{
+		tree_scan_job_t *const job = tree_scan_queue(ts, TEST_DATA_PATH);
+		assert_non_null(job);
+		tree_scan_drop(ts, job);
+	}
+
+	/* Queued jobs are freed along with the scanner. */
+	(void)tree_scan_queue(ts, TEST_DATA_PATH);
+}
+
+TEST(null_scanner_queues_nothing)
+{
+	assert_null(tree_scan_queue(NULL, TEST_DATA_PATH));
+	tree_scan_drop(NULL, NULL);
+	tree_scan_free(NULL);
+}
+
+static const tree_scan_entry_t *
+find_entry(const tree_scan_list_t *list, const char name[])
+{
+	int i;
+	for(i = 0; i < list->count; ++i)
+	{
+		if(strcmp(list->entries[i].name, name) == 0)
+		{
+			return &list->entries[i];
+		}
+	}
+	return NULL;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
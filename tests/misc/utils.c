@@ -24,6 +24,14 @@ load_limited_tree(view_t *view, const char path[], const char cwd[], int depth)
 	return flist_load_tree(view, abs_path, depth);
 }
 
+int
+load_lazy_tree(view_t *view, const char path[], const char cwd[])
+{
+	char abs_path[PATH_MAX + 1];
+	make_abs_path(abs_path, sizeof(abs_path), path, "", cwd);
+	return flist_load_lazy_tree(view, abs_path);
+}
+
 void
 load_view(view_t *view)
 {
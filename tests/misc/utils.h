@@ -9,6 +9,8 @@ int load_tree(struct view_t *view, const char path[], const char cwd[]);
 int load_limited_tree(struct view_t *view, const char path[], const char cwd[],
 		int depth);
 
+int load_lazy_tree(struct view_t *view, const char path[], const char cwd[]);
+
 void load_view(struct view_t *view);
 
 void validate_tree(const struct view_t *view);
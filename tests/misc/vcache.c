@@ -3,15 +3,20 @@
 #include <sys/stat.h> /* chmod() */
 #include <unistd.h> /* usleep() */
 
+#include <stdio.h> /* FILE fclose() fopen() fputc() fseek() snprintf() */
 #include <string.h> /* strlen() */
 
 #include <test-utils.h>
 
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
 #include "../../src/engine/var.h"
 #include "../../src/engine/variables.h"
 #include "../../src/lua/vlua.h"
 #include "../../src/ui/quickview.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
 #include "../../src/utils/string_array.h"
 #include "../../src/background.h"
 #include "../../src/status.h"
@@ -20,6 +25,7 @@
 
 static int wait_for_cache(void);
 static int is_previewed(const char path[]);
+static int is_not_previewed(const char path[]);
 
 static const char *error;
 
@@ -260,6 +266,58 @@ TEST(cache_entries_are_reused)
 	assert_string_equal("first line", lines.items[0]);
 }
 
+TEST(equivalent_paths_share_cache_entry)
+{
+	strlist_t lines1 = vcache_lookup(TEST_DATA_PATH "/read/two-lines", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	strlist_t lines2 = vcache_lookup(TEST_DATA_PATH "/read/./two-lines", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	strlist_t lines3 = vcache_lookup(TEST_DATA_PATH "/read//two-lines", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+
+	assert_true(lines1.items == lines2.items);
+	assert_true(lines1.items == lines3.items);
+}
+
+TEST(many_entries_are_cached)
+{
+	enum { N = 100 };
+
+	char *items[N];
+	char path[64];
+	int i;
+
+	vcache_reset(1024*1024);
+
+	for(i = 0; i < N; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/file%d", SANDBOX_PATH, i);
+		make_file(path, "line");
+
+		strlist_t lines = vcache_lookup(path, NULL, MF_NONE, VK_TEXTUAL, 10,
+				VC_SYNC, &error);
+		assert_string_equal(NULL, error);
+		assert_int_equal(1, lines.nitems);
+		items[i] = lines.items[0];
+	}
+
+	for(i = N - 1; i >= 0; --i)
+	{
+		snprintf(path, sizeof(path), "%s/file%d", SANDBOX_PATH, i);
+
+		strlist_t lines = vcache_lookup(path, NULL, MF_NONE, VK_TEXTUAL, 10,
+				VC_SYNC, &error);
+		assert_string_equal(NULL, error);
+		assert_int_equal(1, lines.nitems);
+		assert_true(lines.items[0] == items[i]);
+
+		remove_file(path);
+	}
+}
+
 TEST(viewers_are_cached_independently)
 {
 	strlist_t lines1 = vcache_lookup(TEST_DATA_PATH "/read/two-lines", "echo aaa",
@@ -297,6 +355,267 @@ TEST(file_modification_is_detected)
 	remove_file(SANDBOX_PATH "/file");
 }
 
+TEST(viewer_output_is_loaded_from_disk_cache)
+{
+	copy_str(cfg.preview_cache_dir, sizeof(cfg.preview_cache_dir),
+			SANDBOX_PATH "/previews");
+	cfg.preview_cache_size = 1;
+	create_file(SANDBOX_PATH "/file");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", "echo aaa", MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("aaa", lines.items[0]);
+	assert_int_equal(1, count_dir_items(SANDBOX_PATH "/previews"));
+
+	/* Memory miss is served from disk without waiting for the viewer. */
+	vcache_reset(1024);
+	lines = vcache_lookup(SANDBOX_PATH "/file", "echo aaa", MF_NONE, VK_TEXTUAL,
+			/*max_lines=*/10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("aaa", lines.items[0]);
+
+	/* Modified file doesn't match cached output. */
+	vcache_reset(1024);
+	reset_timestamp(SANDBOX_PATH "/file");
+	lines = vcache_lookup(SANDBOX_PATH "/file", "echo aaa", MF_NONE, VK_TEXTUAL,
+			/*max_lines=*/10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_int_equal(2, count_dir_items(SANDBOX_PATH "/previews"));
+
+	cfg.preview_cache_size = 0;
+	remove_dir_content(SANDBOX_PATH "/previews");
+	remove_dir(SANDBOX_PATH "/previews");
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(disk_cache_evicts_least_recently_used_files)
+{
+	copy_str(cfg.preview_cache_dir, sizeof(cfg.preview_cache_dir),
+			SANDBOX_PATH "/previews");
+	cfg.preview_cache_size = 1;
+	create_file(SANDBOX_PATH "/file");
+	create_dir(SANDBOX_PATH "/previews");
+
+	/* Make a file that takes up more space than the limit. */
+	FILE *fp = fopen(SANDBOX_PATH "/previews/0123456789abcdef", "wb");
+	assert_non_null(fp);
+	assert_success(fseek(fp, 2*1024*1024, SEEK_SET));
+	assert_true(fputc('\n', fp) == '\n');
+	fclose(fp);
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", "echo aaa", MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+
+	assert_int_equal(1, count_dir_items(SANDBOX_PATH "/previews"));
+	assert_false(path_exists(SANDBOX_PATH "/previews/0123456789abcdef",
+				NODEREF));
+
+	cfg.preview_cache_size = 0;
+	remove_dir_content(SANDBOX_PATH "/previews");
+	remove_dir(SANDBOX_PATH "/previews");
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(disk_cache_size_is_tracked_in_memory, IF(not_windows))
+{
+	copy_str(cfg.preview_cache_dir, sizeof(cfg.preview_cache_dir),
+			SANDBOX_PATH "/previews");
+	cfg.preview_cache_size = 1;
+	create_file(SANDBOX_PATH "/file");
+	create_dir(SANDBOX_PATH "/previews");
+
+	/* Make a file that takes up most of the limit. */
+	FILE *fp = fopen(SANDBOX_PATH "/previews/0123456789abcdef", "wb");
+	assert_non_null(fp);
+	assert_success(fseek(fp, 1000*1024, SEEK_SET));
+	assert_true(fputc('\n', fp) == '\n');
+	fclose(fp);
+	reset_timestamp(SANDBOX_PATH "/previews/0123456789abcdef");
+
+	/* Size of the cache is counted. */
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", "echo aaa", MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_int_equal(2, count_dir_items(SANDBOX_PATH "/previews"));
+
+	/* Size of stored output is added to the count. */
+	lines = vcache_lookup(SANDBOX_PATH "/file", "seq 1 10000", MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10000, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(10000, lines.nitems);
+	assert_int_equal(2, count_dir_items(SANDBOX_PATH "/previews"));
+	assert_false(path_exists(SANDBOX_PATH "/previews/0123456789abcdef",
+				NODEREF));
+
+	cfg.preview_cache_size = 0;
+	remove_dir_content(SANDBOX_PATH "/previews");
+	remove_dir(SANDBOX_PATH "/previews");
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(disk_cache_is_not_used_by_default)
+{
+	copy_str(cfg.preview_cache_dir, sizeof(cfg.preview_cache_dir),
+			SANDBOX_PATH "/previews");
+	create_file(SANDBOX_PATH "/file");
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", "echo aaa", MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_false(path_exists(SANDBOX_PATH "/previews", NODEREF));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(prefetched_output_is_used)
+{
+	create_file(SANDBOX_PATH "/file");
+
+	vcache_prefetch_begin();
+	vcache_prefetch(SANDBOX_PATH "/file", "echo aaa", MF_NONE,
+			/*max_lines=*/10);
+	vcache_prefetch_end();
+	assert_true(wait_for_cache());
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", "echo aaa", MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("aaa", lines.items[0]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(viewers_that_use_selection_are_not_prefetched)
+{
+	create_file(SANDBOX_PATH "/file");
+
+	vcache_prefetch_begin();
+	vcache_prefetch(SANDBOX_PATH "/file", "echo aaa", MF_PIPE_FILE_LIST,
+			/*max_lines=*/10);
+	vcache_prefetch_end();
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/file", "echo aaa", MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("[...]", lines.items[0]);
+	assert_true(wait_for_cache());
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(viewer_is_started_after_delay, IF(not_windows))
+{
+	cfg.viewer_delay = 1000000;
+
+	const char *viewer = "touch " SANDBOX_PATH "/marker; echo aaa";
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/no-file", viewer, MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("[...]", lines.items[0]);
+
+	/* Repeated lookups don't start the viewer either. */
+	(void)vcache_lookup(SANDBOX_PATH "/no-file", viewer, MF_NONE, VK_TEXTUAL,
+			/*max_lines=*/10, VC_ASYNC, &error);
+	assert_false(vcache_check(&is_previewed));
+	assert_false(path_exists(SANDBOX_PATH "/marker", NODEREF));
+
+	cfg.viewer_delay = 0;
+	assert_true(wait_for_cache());
+
+	lines = vcache_lookup(SANDBOX_PATH "/no-file", viewer, MF_NONE, VK_TEXTUAL,
+			/*max_lines=*/10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("aaa", lines.items[0]);
+
+	remove_file(SANDBOX_PATH "/marker");
+}
+
+TEST(synchronous_lookup_is_not_delayed)
+{
+	cfg.viewer_delay = 1000000;
+
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/no-file", "echo aaa",
+			MF_NONE, VK_TEXTUAL, /*max_lines=*/10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("aaa", lines.items[0]);
+
+	cfg.viewer_delay = 0;
+}
+
+TEST(viewers_of_files_that_are_not_previewed_are_stopped, IF(not_windows))
+{
+	const char *viewer = "exec sleep 10";
+	strlist_t lines = vcache_lookup(SANDBOX_PATH "/no-file", viewer, MF_NONE,
+			VK_TEXTUAL, /*max_lines=*/10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("[...]", lines.items[0]);
+
+	assert_false(vcache_check(&is_not_previewed));
+
+	/* Viewer produces no output, so the only change is its termination, which
+	 * might take a couple of seconds if it missed the signal. */
+	int i;
+	for(i = 0; i < 400 && !vcache_check(&is_previewed); ++i)
+	{
+		usleep(10000);
+	}
+	assert_true(i < 400);
+}
+
+TEST(number_of_running_viewers_is_limited, IF(not_windows))
+{
+	char path[PATH_MAX + 1], viewer[PATH_MAX + 64], marker[PATH_MAX + 1];
+
+	int i;
+	for(i = 0; i < 5; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/file%d", SANDBOX_PATH, i);
+		snprintf(viewer, sizeof(viewer), "touch %s/marker%d; sleep 10",
+				SANDBOX_PATH, i);
+		strlist_t lines = vcache_lookup(path, viewer, MF_NONE, VK_TEXTUAL,
+				/*max_lines=*/10, VC_ASYNC, &error);
+		assert_string_equal(NULL, error);
+		assert_int_equal(1, lines.nitems);
+		assert_string_equal("[...]", lines.items[0]);
+	}
+
+	/* Wait for the first four viewers to start. */
+	for(i = 0; i < 100; ++i)
+	{
+		if(path_exists(SANDBOX_PATH "/marker3", NODEREF))
+		{
+			break;
+		}
+		usleep(10000);
+	}
+
+	assert_true(path_exists(SANDBOX_PATH "/marker0", NODEREF));
+	assert_true(path_exists(SANDBOX_PATH "/marker3", NODEREF));
+	assert_false(path_exists(SANDBOX_PATH "/marker4", NODEREF));
+
+	vcache_finish();
+
+	for(i = 0; i < 4; ++i)
+	{
+		snprintf(marker, sizeof(marker), "%s/marker%d", SANDBOX_PATH, i);
+		remove_file(marker);
+	}
+}
+
 TEST(graphics_is_not_cached)
 {
 	preview_area_t parea = { .view = curr_view };
@@ -436,5 +755,11 @@ is_previewed(const char path[])
 	return 1;
 }
 
+static int
+is_not_previewed(const char path[])
+{
+	return 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
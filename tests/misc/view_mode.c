@@ -1,5 +1,7 @@
 #include <stic.h>
 
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputs() rename() */
+
 #include <test-utils.h>
 
 #include "../../src/cfg/config.h"
@@ -23,6 +25,7 @@
 
 static int start_view_mode(const char pattern[], const char viewers[],
 		const char base_dir[], const char sub_path[]);
+static void append_text(const char path[], const char text[]);
 
 SETUP_ONCE()
 {
@@ -237,6 +240,151 @@ TEST(searching_in_view_mode)
 	remove_file(SANDBOX_PATH "/file");
 }
 
+TEST(huge_files_are_read_on_demand)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < 200000; ++i)
+	{
+		fprintf(fp, "%c%06d\n", (i == 150000 ? 'x' : 'a'), i);
+	}
+	fclose(fp);
+
+	assert_true(start_view_mode("*", NULL, SANDBOX_PATH, ""));
+
+	assert_null(modview_lines(lwin.vi).items);
+	assert_string_equal("a000000", modview_line(lwin.vi, 0));
+
+	(void)vle_keys_exec_timed_out(L"10" WK_j);
+	assert_int_equal(10, modview_current_line(lwin.vi));
+	assert_string_equal("a000010", modview_line(lwin.vi, 10));
+
+	(void)vle_keys_exec_timed_out(WK_G);
+	assert_int_equal(199999, modview_current_line(lwin.vi));
+	assert_string_equal("a199999", modview_line(lwin.vi, 199999));
+	(void)vle_keys_exec_timed_out(L"100000" WK_G);
+	assert_int_equal(99999, modview_current_line(lwin.vi));
+
+	(void)vle_keys_exec_timed_out(L"/x");
+	(void)vle_keys_exec_timed_out(WK_CR);
+	assert_int_equal(150000, modview_current_line(lwin.vi));
+
+	(void)vle_keys_exec_timed_out(L"50" WK_PERCENT);
+	assert_int_equal(100000, modview_current_line(lwin.vi));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(huge_files_are_searched_in_background)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < 200000; ++i)
+	{
+		fprintf(fp, "%s %06d\n", (i%50000 == 1 ? "needle" : "hay"), i);
+	}
+	fclose(fp);
+
+	assert_true(start_view_mode("*", NULL, SANDBOX_PATH, ""));
+
+	(void)vle_keys_exec_timed_out(L"/needle");
+	(void)vle_keys_exec_timed_out(WK_CR);
+	assert_int_equal(1, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(WK_n);
+	assert_int_equal(50001, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(L"2" WK_n);
+	assert_int_equal(150001, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(WK_n);
+	assert_int_equal(150001, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(WK_N);
+	assert_int_equal(100001, modview_current_line(lwin.vi));
+
+	(void)vle_keys_exec_timed_out(L"?^needle.*0{3}1$");
+	(void)vle_keys_exec_timed_out(WK_CR);
+	assert_int_equal(50001, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(WK_N);
+	assert_int_equal(100001, modview_current_line(lwin.vi));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+/* Changes within the same second go unnoticed by polling on Windows. */
+TEST(followed_files_are_read_incrementally, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "a\nb\n");
+
+	assert_true(start_view_mode("*", NULL, SANDBOX_PATH, ""));
+	assert_string_equal("b", modview_line(lwin.vi, 1));
+
+	(void)vle_keys_exec_timed_out(WK_F);
+	assert_null(modview_lines(lwin.vi).items);
+	assert_int_equal(1, modview_current_line(lwin.vi));
+
+	/* Bottom of the view is followed. */
+	append_text(SANDBOX_PATH "/file", "c\nd\n");
+	modview_check_for_updates();
+	assert_string_equal("d", modview_line(lwin.vi, 3));
+	assert_int_equal(3, modview_current_line(lwin.vi));
+
+	/* Position is kept if it's not at the bottom. */
+	(void)vle_keys_exec_timed_out(WK_k);
+	append_text(SANDBOX_PATH "/file", "e\n");
+	modview_check_for_updates();
+	assert_string_equal("e", modview_line(lwin.vi, 4));
+	assert_int_equal(2, modview_current_line(lwin.vi));
+
+	/* Truncated file is reopened. */
+	make_file(SANDBOX_PATH "/file", "x\n");
+	modview_check_for_updates();
+	assert_string_equal("x", modview_line(lwin.vi, 0));
+	assert_null(modview_line(lwin.vi, 1));
+
+	/* Replaced file is reopened. */
+	assert_success(rename(SANDBOX_PATH "/file", SANDBOX_PATH "/file.1"));
+	make_file(SANDBOX_PATH "/file", "y\nz\n");
+	modview_check_for_updates();
+	assert_string_equal("y", modview_line(lwin.vi, 0));
+	assert_string_equal("z", modview_line(lwin.vi, 1));
+
+	(void)vle_keys_exec_timed_out(WK_F);
+
+	remove_file(SANDBOX_PATH "/file.1");
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(wrapped_lines_of_huge_files_are_counted)
+{
+	cfg.wrap_quick_view = 1;
+
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < 200000; ++i)
+	{
+		fprintf(fp, "%07d\n", i);
+	}
+	fclose(fp);
+
+	assert_true(start_view_mode("*", NULL, SANDBOX_PATH, ""));
+
+	(void)vle_keys_exec_timed_out(WK_G);
+	assert_int_equal(199999, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(WK_k);
+	assert_int_equal(199999, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(L"7" WK_k);
+	assert_int_equal(199998, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(WK_g);
+	assert_int_equal(0, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(L"7" WK_j);
+	assert_int_equal(1, modview_current_line(lwin.vi));
+
+	remove_file(SANDBOX_PATH "/file");
+
+	cfg.wrap_quick_view = 0;
+}
+
 TEST(operations_with_empty_output)
 {
 	assert_true(start_view_mode("*", "true", TEST_DATA_PATH, "read"));
@@ -374,5 +522,14 @@ start_view_mode(const char pattern[], const char viewers[],
 	return vle_mode_is(VIEW_MODE);
 }
 
+static void
+append_text(const char path[], const char text[])
+{
+	FILE *const fp = fopen(path, "a");
+	assert_non_null(fp);
+	fputs(text, fp);
+	fclose(fp);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -3,6 +3,8 @@
 #include <unistd.h> /* rmdir() */
 
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strcmp() strcpy() */
 
 #include "../../src/compat/os.h"
 #include "../../src/utils/fsdata.h"
@@ -16,6 +18,7 @@
 static void visitor(void *data, void *arg);
 static int traverser(const char name[], int valid, const void *parent_data,
 		void *data, void *arg);
+static int path_traverser(const char path[], const void *data, void *arg);
 
 static int nnodes;
 
@@ -273,6 +276,68 @@ TEST(cancellation)
 	fsdata_free(fsd);
 }
 
+TEST(many_children_are_found_and_traversed_in_order)
+{
+	char path[64];
+	int i, data;
+	fsdata_t *const fsd = fsdata_create(0, 0);
+
+	/* Insert in reverse order to make sorting necessary. */
+	for(i = 999; i >= 0; --i)
+	{
+		snprintf(path, sizeof(path), "/dir/%03d", i);
+		assert_success(fsdata_set(fsd, path, &i, sizeof(i)));
+	}
+
+	for(i = 0; i < 1000; ++i)
+	{
+		snprintf(path, sizeof(path), "/dir/%03d", i);
+		assert_success(fsdata_get(fsd, path, &data, sizeof(data)));
+		assert_int_equal(i, data);
+	}
+	assert_failure(fsdata_get(fsd, "/dir/1000", &data, sizeof(data)));
+
+	char prev[64] = "";
+	nnodes = 0;
+	assert_success(fsdata_traverse_paths(fsd, &path_traverser, prev));
+	assert_int_equal(1000, nnodes);
+
+	fsdata_free(fsd);
+}
+
+TEST(data_size_can_change_for_child_of_node_with_many_children)
+{
+	char path[64];
+	char small_data[1] = { 'a' };
+	/* Big buffer that might overwrite some data. */
+	char big_data[128] = { 'b' };
+	char data[128];
+	int i;
+	fsdata_t *const fsd = fsdata_create(0, 0);
+
+	for(i = 0; i < 100; ++i)
+	{
+		snprintf(path, sizeof(path), "/dir/%d", i);
+		assert_success(fsdata_set(fsd, path, small_data, sizeof(small_data)));
+	}
+
+	assert_success(fsdata_set(fsd, "/dir/50", big_data, sizeof(big_data)));
+	assert_success(fsdata_set(fsd, "/dir/50/sub", small_data,
+				sizeof(small_data)));
+
+	assert_success(fsdata_get(fsd, "/dir/50", data, sizeof(data)));
+	assert_int_equal('b', data[0]);
+	assert_success(fsdata_get(fsd, "/dir/51", data, sizeof(small_data)));
+	assert_int_equal('a', data[0]);
+
+	/* This can try to use overwriten pointers. */
+	assert_success(fsdata_map_parents(fsd, "/dir/50/sub", visitor, NULL));
+	assert_success(fsdata_get(fsd, "/dir/50", data, sizeof(data)));
+	assert_int_equal('6', data[0]);
+
+	fsdata_free(fsd);
+}
+
 static void
 visitor(void *data, void *arg)
 {
@@ -287,5 +352,15 @@ traverser(const char name[], int valid, const void *parent_data, void *data,
 	return (++nnodes == 0);
 }
 
+static int
+path_traverser(const char path[], const void *data, void *arg)
+{
+	char *const prev = arg;
+	assert_true(strcmp(prev, path) < 0);
+	strcpy(prev, path);
+	++nnodes;
+	return 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
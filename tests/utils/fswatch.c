@@ -2,11 +2,14 @@
 
 #include <stdio.h> /* remove() snprintf() */
 
+#include <test-utils.h>
+
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
 #include "../../src/utils/fs.h"
 #include "../../src/utils/fswatch.h"
 #include "../../src/utils/path.h"
+#include "../../src/utils/string_array.h"
 
 static int using_inotify(void);
 
@@ -182,6 +185,71 @@ TEST(file_recreation_removes_ban, IF(using_inotify))
 	assert_success(remove(SANDBOX_PATH "/testdir"));
 }
 
+TEST(changes_of_additional_dirs_are_reported, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/dir1", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/dir2", 0700));
+
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create(SANDBOX_PATH));
+
+	char *dirs[] = { SANDBOX_PATH "/dir1", SANDBOX_PATH "/dir2" };
+	assert_success(fswatch_set_dirs(watch, dirs, 2));
+
+	create_file(SANDBOX_PATH "/dir2/file");
+
+	strlist_t changed = {};
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll_dirs(watch, &changed));
+	assert_int_equal(1, changed.nitems);
+	assert_string_equal(SANDBOX_PATH "/dir2", changed.items[0]);
+	free_string_array(changed.items, changed.nitems);
+
+	/* Events are consumed. */
+	changed = (strlist_t){};
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll_dirs(watch, &changed));
+	assert_int_equal(0, changed.nitems);
+
+	/* Directories that leave the set aren't reported. */
+	assert_success(fswatch_set_dirs(watch, dirs, 1));
+	assert_success(remove(SANDBOX_PATH "/dir2/file"));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll_dirs(watch, &changed));
+	assert_int_equal(0, changed.nitems);
+
+	/* Removed directory is reported and can be watched again. */
+	assert_success(remove(SANDBOX_PATH "/dir1"));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_dirs(watch, &changed));
+	assert_int_equal(1, changed.nitems);
+	assert_string_equal(SANDBOX_PATH "/dir1", changed.items[0]);
+	free_string_array(changed.items, changed.nitems);
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir1", 0700));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(watch));
+	assert_success(fswatch_set_dirs(watch, dirs, 1));
+	create_file(SANDBOX_PATH "/dir1/file");
+	changed = (strlist_t){};
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll_dirs(watch, &changed));
+	assert_int_equal(1, changed.nitems);
+	free_string_array(changed.items, changed.nitems);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/dir1/file"));
+	assert_success(remove(SANDBOX_PATH "/dir1"));
+	assert_success(remove(SANDBOX_PATH "/dir2"));
+}
+
+TEST(missing_additional_dir_is_an_error)
+{
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create(SANDBOX_PATH));
+
+	char *dirs[] = { SANDBOX_PATH "/no-such-dir" };
+	assert_failure(fswatch_set_dirs(watch, dirs, 1));
+	assert_success(fswatch_set_dirs(watch, NULL, 0));
+
+	fswatch_free(watch);
+}
+
 static int
 using_inotify(void)
 {
@@ -0,0 +1,88 @@
+#include <stic.h>
+
+#include <unistd.h> /* close() pipe() write() */
+
+#include <test-utils.h>
+
+#include "../../src/utils/selector.h"
+
+static int fds_a[2], fds_b[2];
+static selector_t *selector;
+
+SETUP()
+{
+	if(not_windows())
+	{
+		assert_success(pipe(fds_a));
+		assert_success(pipe(fds_b));
+	}
+
+	selector = selector_alloc();
+	assert_non_null(selector);
+}
+
+TEARDOWN()
+{
+	selector_free(selector);
+
+	if(not_windows())
+	{
+		close(fds_a[0]);
+		close(fds_a[1]);
+		close(fds_b[0]);
+		close(fds_b[1]);
+	}
+}
+
+TEST(wait_times_out_without_data, IF(not_windows))
+{
+	selector_add(selector, fds_a[0]);
+	assert_false(selector_wait(selector, 0));
+	assert_false(selector_is_ready(selector, fds_a[0]));
+}
+
+TEST(only_ready_items_are_enumerated, IF(not_windows))
+{
+	int a, b;
+	selector_add_data(selector, fds_a[0], &a);
+	selector_add_data(selector, fds_b[0], &b);
+
+	assert_int_equal(1, write(fds_b[1], "x", 1));
+	assert_true(selector_wait(selector, 1000));
+	assert_false(selector_is_ready(selector, fds_a[0]));
+	assert_true(selector_is_ready(selector, fds_b[0]));
+
+	void *data;
+	assert_true(selector_next_ready(selector, &data));
+	assert_true(data == &b);
+	assert_false(selector_next_ready(selector, &data));
+}
+
+TEST(removed_items_are_not_enumerated, IF(not_windows))
+{
+	int a, b;
+	selector_add_data(selector, fds_a[0], &a);
+	selector_add_data(selector, fds_b[0], &b);
+
+	assert_int_equal(1, write(fds_a[1], "x", 1));
+	assert_int_equal(1, write(fds_b[1], "x", 1));
+	assert_true(selector_wait(selector, 1000));
+	selector_remove(selector, fds_a[0]);
+
+	void *data;
+	assert_true(selector_next_ready(selector, &data));
+	assert_true(data == &b);
+	assert_false(selector_next_ready(selector, &data));
+}
+
+TEST(reset_forgets_all_items, IF(not_windows))
+{
+	selector_add(selector, fds_a[0]);
+	assert_int_equal(1, write(fds_a[1], "x", 1));
+
+	selector_reset(selector);
+	assert_false(selector_wait(selector, 0));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */